@@ -0,0 +1,75 @@
+/**
+ *   librib - fib.h
+ *   Developed by Christian Visintin
+ * 
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef RIB_FIB_H
+#define RIB_FIB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "rib.h"
+
+#include <stdint.h>
+
+/**
+ * Shared memory FIB
+ * A writer process publishes the compiled lookup tables of a RIB into a POSIX shared memory object;
+ * reader processes map it read-only and look up addresses without copies.
+ * Each publication is a new object (<name>.<generation>); the generation of the current one is stored
+ * in the control object <name>, and it is updated only after the table has been completely written.
+ */
+
+// Data types
+
+typedef struct RIB_fib_t RIB_fib_t;
+
+typedef struct RIB_fib_route_t {
+  const char* destination;
+  const char* netmask;    //IPv4 specific
+  int prefixLength;       //IPv6 specific
+  const char* gateway;
+  const char* iface;
+  int metric;
+  int ipv;
+} RIB_fib_route_t;
+
+// Functions
+
+// Writer functions
+RIB_ret_code_t RIB_fib_publish(RIB* rtab, const char* name);
+RIB_ret_code_t RIB_fib_unlink(const char* name);
+
+// Reader functions
+RIB_ret_code_t RIB_fib_open(RIB_fib_t** fib, const char* name);
+RIB_ret_code_t RIB_fib_refresh(RIB_fib_t* fib, int* updated);
+RIB_ret_code_t RIB_fib_match(RIB_fib_t* fib, const char* destination, RIB_fib_route_t* route);
+RIB_ret_code_t RIB_fib_match_address(RIB_fib_t* fib, int ipv, const unsigned char* address, RIB_fib_route_t* route);
+uint64_t RIB_fib_generation(const RIB_fib_t* fib);
+void RIB_fib_close(RIB_fib_t* fib);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -30,6 +30,7 @@ extern "C" {
 
 #include "route.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 
 #define RIB_LIB_VERSION "1.0.1"
@@ -38,12 +39,10 @@ extern "C" {
 #define RIB_GIT_COMMIT "??????"
 #endif // RIB_GIT_COMMIT
 
-// Data types
+#define RIB_MAX_NEXTHOPS 64 //Maximum number of equal cost next hops of a route
+#define RIB_DEFAULT_DISTANCE 1 //Admin distance of the routes added with RIB_add
 
-typedef struct RIB {
-  Route** routes;
-  size_t entries;
-} RIB;
+// Data types
 
 typedef enum RIB_ret_code_t {
   RIB_NO_ERROR,
@@ -52,18 +51,158 @@ typedef enum RIB_ret_code_t {
   RIB_DUP_RECORD,
   RIB_NOT_EXISTS,
   RIB_UNINITIALIZED_RIB,
-  RIB_BAD_ALLOC
+  RIB_BAD_ALLOC,
+  RIB_IO_ERROR,
+  RIB_INVALID_ARGUMENT,
+  RIB_NOT_SUPPORTED
 } RIB_ret_code_t;
 
+typedef enum RIB_engine_type_t {
+  RIB_ENGINE_AUTO,     //Switch engine based on table size and ip version
+  RIB_ENGINE_LINEAR,   //Linear scan over the routes
+  RIB_ENGINE_TRIE,     //Path compressed binary trie
+  RIB_ENGINE_COMPILED, //Binary search on prefix lengths; rebuilt on the first lookup after a change
+  RIB_ENGINE_RANGE     //IPv4 disjoint intervals searched with a 16-way tree; rebuilt on the first lookup after a change (compiled for IPv6)
+} RIB_engine_type_t;
+
+typedef enum RIB_hugepage_mode_t {
+  RIB_HUGEPAGES_NONE,        //Lookup tables allocated on the heap
+  RIB_HUGEPAGES_TRANSPARENT, //Large lookup tables aligned and advised for transparent huge pages
+  RIB_HUGEPAGES_EXPLICIT     //Large lookup tables mapped from the huge page pool (transparent if the pool is empty)
+} RIB_hugepage_mode_t;
+
+typedef struct RIB_options_t {
+  RIB_engine_type_t ipv4Engine;
+  RIB_engine_type_t ipv6Engine;
+  int bloomFilter;            //Use a bloom filter to skip empty prefix lengths (compiled engine)
+  size_t autoLinearThreshold; //Auto engine: max number of routes looked up with a linear scan
+  RIB_hugepage_mode_t hugePages; //Backing memory of compiled and range tables
+  int numaReplicas;           //Replicate compiled and range tables on each numa node
+} RIB_options_t;
+
+#define RIB_MRT_BEST_PEER -1 //Import the path with the shortest AS path of each prefix
+
+/**
+ * Options of the MRT imports (RIB_load_mrt)
+ */
+
+typedef struct RIB_mrt_options_t {
+  int peer;          //Index of the peer whose paths are imported (in the peer table of the file), or RIB_MRT_BEST_PEER
+  const char* iface; //Interface of the imported routes; NULL to name it after the peer index ("peer<n>")
+} RIB_mrt_options_t;
+
+struct RIB;
+typedef struct RIB_engine_t RIB_engine_t;
+
+/**
+ * Lookup engine interface; addresses are in network byte order (4 bytes for ipv4, 16 for ipv6)
+ */
+
+typedef struct RIB_engine_ops_t {
+  const char* name;
+  RIB_ret_code_t (*insert)(RIB_engine_t* engine, Route* route);
+  RIB_ret_code_t (*remove)(RIB_engine_t* engine, Route* route);
+  RIB_ret_code_t (*prepare)(RIB_engine_t* engine); //Rebuild what changed since the last lookup, so that lookups only read
+  Route* (*lookup)(RIB_engine_t* engine, const unsigned char* address);
+  void (*lookup_batch)(RIB_engine_t* engine, const unsigned char* addresses, size_t count, Route** routes);
+  size_t (*memory_usage)(const RIB_engine_t* engine);
+  void (*destroy)(RIB_engine_t* engine);
+} RIB_engine_ops_t;
+
+struct RIB_engine_t {
+  const RIB_engine_ops_t* ops;
+  struct RIB* rtab;
+  int ipv;
+  void* data;
+};
+
+/**
+ * Iterator over the routes of a RIB; it is valid until the RIB is modified
+ */
+
+typedef struct RIB_iter_t RIB_iter_t;
+
+/**
+ * Position of a walk, which can be resumed after the RIB has been modified
+ */
+
+typedef struct RIB_cursor_t {
+  unsigned char address[16]; //Network address of the last returned route, in network byte order
+  int prefixLength;
+  int ipv;                   //0 if no route has been returned yet
+} RIB_cursor_t;
+
+/**
+ * Equal cost next hop of a route; the first next hop of a route is its gateway and interface
+ */
+
+typedef struct RIB_nexthop_t {
+  const char* gateway;
+  const char* iface;
+} RIB_nexthop_t;
+
+/**
+ * Route flap dampening parameters (RFC 2439); times are in milliseconds
+ */
+
+typedef struct RIB_dampening_t {
+  int penalty;          //Penalty added by each withdrawal
+  int suppress;         //A prefix is suppressed when its penalty exceeds this threshold
+  int reuse;            //A suppressed prefix is reused when its penalty decays below this threshold
+  uint64_t halfLife;    //Time for a penalty to decay to its half
+  uint64_t maxSuppress; //Maximum time a prefix can be suppressed after its last flap
+} RIB_dampening_t;
+
+typedef struct RIB {
+  Route** routes;
+  size_t entries;
+  RIB_options_t options;
+  RIB_engine_t* engines[2]; //IPv4 and IPv6 lookup engines
+  struct RIB_index_t* index; //Prefix index and reload state
+} RIB;
+
 // Functions
 
 // Table manipulation functions 
 RIB_ret_code_t RIB_init(RIB** rtab);
+RIB_ret_code_t RIB_init_ex(RIB** rtab, const RIB_options_t* options);
+void RIB_options_init(RIB_options_t* options);
 RIB_ret_code_t RIB_free(RIB* rtab);
 RIB_ret_code_t RIB_add(RIB* rtab, const char* destination, const char* netmask, const char* gateway, const char* iface, int metric);
+RIB_ret_code_t RIB_add_with_ttl(RIB* rtab, const char* destination, const char* netmask, const char* gateway, const char* iface, int metric, uint64_t ttl);
 RIB_ret_code_t RIB_delete(RIB* rtab, const char* destination, const char* netmask);
+RIB_ret_code_t RIB_delete_subtree(RIB* rtab, const char* networkAddr, const char* netmask, size_t* removed);
+RIB_ret_code_t RIB_delete_by_iface(RIB* rtab, const char* iface, size_t* removed);
 RIB_ret_code_t RIB_update(RIB* rtab, const char* destination, const char* netmask, const char* newNetmask, const char* newGateway, const char* newIface, int newMetric);
+RIB_ret_code_t RIB_update_gateway_all(RIB* rtab, const char* gateway, const char* newGateway, size_t* updated);
+RIB_ret_code_t RIB_add_candidate(RIB* rtab, const char* destination, const char* netmask, const char* gateway, const char* iface, int distance, int metric);
+RIB_ret_code_t RIB_withdraw_candidate(RIB* rtab, const char* destination, const char* netmask, int distance);
+RIB_ret_code_t RIB_add_source_route(RIB* rtab, const char* destination, const char* netmask, const char* source, const char* sourceNetmask, const char* gateway, const char* iface, int metric);
+RIB_ret_code_t RIB_delete_source_route(RIB* rtab, const char* destination, const char* netmask, const char* source, const char* sourceNetmask);
+RIB_ret_code_t RIB_add_nexthop(RIB* rtab, const char* destination, const char* netmask, const char* gateway, const char* iface);
+RIB_ret_code_t RIB_delete_nexthop(RIB* rtab, const char* destination, const char* netmask, const char* gateway);
+RIB_ret_code_t RIB_get_nexthops(RIB* rtab, const Route* route, RIB_nexthop_t* nexthops, size_t* count);
 RIB_ret_code_t RIB_clear(RIB* rtab);
+RIB_ret_code_t RIB_set_bloom_filter(RIB* rtab, int enabled);
+RIB_ret_code_t RIB_reload_begin(RIB* rtab);
+RIB_ret_code_t RIB_reload_end(RIB* rtab, size_t* removed);
+RIB_ret_code_t RIB_expire(RIB* rtab, uint64_t now, size_t* removed);
+RIB_ret_code_t RIB_bulk_begin(RIB* rtab);
+RIB_ret_code_t RIB_bulk_end(RIB* rtab);
+
+// Binary files
+
+RIB_ret_code_t RIB_save(RIB* rtab, const char* filename);
+RIB_ret_code_t RIB_load(RIB* rtab, const char* filename, size_t* loaded);
+void RIB_mrt_options_init(RIB_mrt_options_t* options);
+RIB_ret_code_t RIB_load_mrt(RIB* rtab, const char* filename, const RIB_mrt_options_t* options, size_t* loaded);
+
+// Route flap dampening
+
+void RIB_dampening_init(RIB_dampening_t* params);
+RIB_ret_code_t RIB_set_dampening(RIB* rtab, const RIB_dampening_t* params);
+RIB_ret_code_t RIB_reuse(RIB* rtab, uint64_t now, size_t* reused);
+RIB_ret_code_t RIB_get_dampening(RIB* rtab, const char* networkAddr, const char* netmask, int* penalty, int* suppressed);
 
 // Table query functions
 
@@ -71,9 +210,36 @@ RIB_ret_code_t RIB_find(RIB* rtab, const char* networkAddr, const char* netmask,
 RIB_ret_code_t RIB_match(RIB* rtab, const char* destination, Route** route);
 RIB_ret_code_t RIB_match_ipv4(RIB* rtab, const char* destination, Route** route);
 RIB_ret_code_t RIB_match_ipv6(RIB* rtab, const char* destination, Route** route);
+RIB_ret_code_t RIB_match_address(RIB* rtab, int ipv, const unsigned char* address, Route** route);
+RIB_ret_code_t RIB_match_batch(RIB* rtab, int ipv, const unsigned char* addresses, size_t count, Route** routes);
+RIB_ret_code_t RIB_match_flow(RIB* rtab, const char* destination, uint64_t flowHash, Route** route, RIB_nexthop_t* nexthop);
+RIB_ret_code_t RIB_resolve(RIB* rtab, const char* gateway, Route** connected);
+RIB_ret_code_t RIB_match_resolved(RIB* rtab, const char* destination, Route** route, Route** connected);
+RIB_ret_code_t RIB_match_source(RIB* rtab, const char* destination, const char* source, Route** route);
+RIB_ret_code_t RIB_engine_stats(RIB* rtab, int ipv, const char** name, size_t* memoryUsage);
+RIB_ret_code_t RIB_prepare(RIB* rtab);
+
+// Hit counters
+
+RIB_ret_code_t RIB_set_hit_counters(RIB* rtab, size_t shards);
+RIB_ret_code_t RIB_collect_hits(RIB* rtab, uint64_t* hits);
+
+// Tracing (WITH_TRACE builds)
+
+RIB_ret_code_t RIB_trace_dump(const char* filename);
+
+// Iterators
+
+RIB_ret_code_t RIB_iter_more_specifics(RIB* rtab, const char* networkAddr, const char* netmask, RIB_iter_t** iter);
+RIB_ret_code_t RIB_iter_covering(RIB* rtab, const char* address, RIB_iter_t** iter);
+RIB_ret_code_t RIB_iter_walk(RIB* rtab, int ipv, const RIB_cursor_t* cursor, RIB_iter_t** iter);
+Route* RIB_iter_next(RIB_iter_t* iter);
+void RIB_iter_cursor(const RIB_iter_t* iter, RIB_cursor_t* cursor);
+void RIB_iter_free(RIB_iter_t* iter);
 
 // Misc
 const char* RIB_get_error_msg(const RIB_ret_code_t err);
+uint64_t RIB_clock(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,451 @@
+/**
+ *   librib - rib.hpp
+ *   Developed by Christian Visintin
+ * 
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+
+#ifndef RIB_RIB_HPP
+#define RIB_RIB_HPP
+
+#include "rib.h"
+
+#include <arpa/inet.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus > 201703L && defined(__has_include)
+#if __has_include(<span>)
+#include <span>
+#define RIB_HAS_STD_SPAN
+#endif
+#endif
+
+/**
+ * C++17 API
+ * rib::Table<rib::IPv4> and rib::Table<rib::IPv6> own a RIB with the lookup engine chosen at compile time.
+ * Addresses and prefixes are strong types over binary values, so lookups don't convert strings;
+ * lookups and updates don't allocate memory besides the allocations of the RIB itself.
+ */
+
+namespace rib {
+
+#ifdef RIB_HAS_STD_SPAN
+template <typename T> using Span = std::span<T>;
+#else
+
+/**
+ * Contiguous sequence of objects (std::span is available only since C++20)
+ */
+
+template <typename T> class Span {
+public:
+  constexpr Span() noexcept : data_(nullptr), size_(0) {}
+  constexpr Span(T* data, std::size_t size) noexcept : data_(data), size_(size) {}
+  template <typename Container, typename = decltype(std::declval<Container&>().data())>
+  constexpr Span(Container& container) noexcept : data_(container.data()), size_(container.size()) {}
+  constexpr T* data() const noexcept { return data_; }
+  constexpr std::size_t size() const noexcept { return size_; }
+  constexpr bool empty() const noexcept { return size_ == 0; }
+  constexpr T& operator[](std::size_t i) const noexcept { return data_[i]; }
+  constexpr T* begin() const noexcept { return data_; }
+  constexpr T* end() const noexcept { return data_ + size_; }
+  constexpr Span subspan(std::size_t offset, std::size_t count) const noexcept { return Span(data_ + offset, count); }
+
+private:
+  T* data_;
+  std::size_t size_;
+};
+
+#endif
+
+/**
+ * Address families
+ */
+
+struct IPv4 {
+  using Value = std::uint32_t; //Host byte order
+  static constexpr int version = 4;
+  static constexpr int family = AF_INET;
+  static constexpr int bits = 32;
+  static constexpr std::size_t bytes = 4;
+};
+
+struct IPv6 {
+  using Value = std::array<std::uint8_t, 16>; //Network byte order
+  static constexpr int version = 6;
+  static constexpr int family = AF_INET6;
+  static constexpr int bits = 128;
+  static constexpr std::size_t bytes = 16;
+};
+
+/**
+ * Lookup engines (see RIB_engine_type_t)
+ */
+
+enum class Engine {
+  Auto = RIB_ENGINE_AUTO,
+  Linear = RIB_ENGINE_LINEAR,
+  Trie = RIB_ENGINE_TRIE,
+  Compiled = RIB_ENGINE_COMPILED,
+  Range = RIB_ENGINE_RANGE
+};
+
+/**
+ * Error thrown by the constructors
+ */
+
+class Error : public std::runtime_error {
+public:
+  explicit Error(RIB_ret_code_t code) : std::runtime_error(RIB_get_error_msg(code)), code_(code) {}
+  RIB_ret_code_t code() const noexcept { return code_; }
+
+private:
+  RIB_ret_code_t code_;
+};
+
+/**
+ * Address of a family
+ */
+
+template <typename Family> class Address {
+public:
+  using Value = typename Family::Value;
+
+  constexpr Address() noexcept : value_() {}
+  constexpr explicit Address(const Value& value) noexcept : value_(value) {}
+
+  /**
+   * @function parse
+   * @description parse the textual representation of an address
+   * @param const char* address
+   * @returns std::optional<Address>: empty if the address isn't valid
+   */
+
+  static std::optional<Address> parse(const char* address) noexcept {
+    unsigned char bytes[Family::bytes];
+    if (address == nullptr || inet_pton(Family::family, address, bytes) != 1) {
+      return std::nullopt;
+    }
+    return fromBytes(bytes);
+  }
+
+  /**
+   * @function fromBytes
+   * @description make an address from its network byte order representation
+   * @param const unsigned char* bytes
+   * @returns Address
+   */
+
+  static Address fromBytes(const unsigned char* bytes) noexcept {
+    Value value{};
+    if constexpr (std::is_same_v<Family, IPv4>) {
+      value = (std::uint32_t(bytes[0]) << 24) | (std::uint32_t(bytes[1]) << 16) | (std::uint32_t(bytes[2]) << 8) | bytes[3];
+    } else {
+      std::memcpy(value.data(), bytes, Family::bytes);
+    }
+    return Address(value);
+  }
+
+  /**
+   * @function toBytes
+   * @description write the network byte order representation of the address
+   * @param unsigned char* bytes: Family::bytes
+   */
+
+  void toBytes(unsigned char* bytes) const noexcept {
+    if constexpr (std::is_same_v<Family, IPv4>) {
+      bytes[0] = std::uint8_t(value_ >> 24);
+      bytes[1] = std::uint8_t(value_ >> 16);
+      bytes[2] = std::uint8_t(value_ >> 8);
+      bytes[3] = std::uint8_t(value_);
+    } else {
+      std::memcpy(bytes, value_.data(), Family::bytes);
+    }
+  }
+
+  /**
+   * @function format
+   * @description write the textual representation of the address
+   * @param char* buffer: INET6_ADDRSTRLEN
+   * @returns const char*: buffer
+   */
+
+  const char* format(char* buffer) const noexcept {
+    unsigned char bytes[Family::bytes];
+    toBytes(bytes);
+    return inet_ntop(Family::family, bytes, buffer, INET6_ADDRSTRLEN);
+  }
+
+  constexpr const Value& value() const noexcept { return value_; }
+  friend bool operator==(const Address& a, const Address& b) noexcept { return a.value_ == b.value_; }
+  friend bool operator!=(const Address& a, const Address& b) noexcept { return !(a == b); }
+
+private:
+  Value value_;
+};
+
+/**
+ * Prefix of a family: network address and prefix length
+ */
+
+template <typename Family> class Prefix {
+public:
+  constexpr Prefix() noexcept : network_(), length_(0) {}
+  constexpr Prefix(const Address<Family>& network, int length) noexcept : network_(network), length_(length) {}
+
+  constexpr const Address<Family>& network() const noexcept { return network_; }
+  constexpr int length() const noexcept { return length_; }
+  constexpr bool valid() const noexcept { return length_ >= 0 && length_ <= Family::bits; }
+
+  /**
+   * @function formatNetmask
+   * @description write the netmask in the format of the C API (dotted netmask for IPv4, prefix length for IPv6)
+   * @param char* buffer: INET6_ADDRSTRLEN
+   * @returns const char*: buffer
+   */
+
+  const char* formatNetmask(char* buffer) const noexcept {
+    if constexpr (std::is_same_v<Family, IPv4>) {
+      const std::uint32_t mask = length_ == 0 ? 0 : ~std::uint32_t(0) << (32 - length_);
+      return Address<IPv4>(mask).format(buffer);
+    } else {
+      std::snprintf(buffer, INET6_ADDRSTRLEN, "%d", length_);
+      return buffer;
+    }
+  }
+
+  friend bool operator==(const Prefix& a, const Prefix& b) noexcept { return a.network_ == b.network_ && a.length_ == b.length_; }
+  friend bool operator!=(const Prefix& a, const Prefix& b) noexcept { return !(a == b); }
+
+private:
+  Address<Family> network_;
+  int length_;
+};
+
+using Ipv4Address = Address<IPv4>;
+using Ipv6Address = Address<IPv6>;
+using Ipv4Prefix = Prefix<IPv4>;
+using Ipv6Prefix = Prefix<IPv6>;
+
+/**
+ * Next hop of a matched route; valid until the route is changed or removed
+ */
+
+class NextHopId {
+public:
+  constexpr explicit NextHopId(const Route* route) noexcept : route_(route) {}
+
+  std::string_view gateway() const noexcept { return route_->gateway; }
+  std::string_view iface() const noexcept { return route_->iface; }
+  int metric() const noexcept { return route_->metric; }
+  constexpr const Route* route() const noexcept { return route_; }
+  friend bool operator==(const NextHopId& a, const NextHopId& b) noexcept { return a.route_ == b.route_; }
+  friend bool operator!=(const NextHopId& a, const NextHopId& b) noexcept { return !(a == b); }
+
+private:
+  const Route* route_;
+};
+
+/**
+ * Routing table of a family; move-only, the RIB is freed by the destructor
+ */
+
+template <typename Family, Engine LookupEngine = Engine::Auto> class Table {
+  static_assert(std::is_same_v<Family, IPv4> || std::is_same_v<Family, IPv6>, "rib::Table supports rib::IPv4 and rib::IPv6");
+
+public:
+  static constexpr std::size_t BatchSize = 64; //Addresses converted on the stack for each RIB_match_batch call
+  static constexpr std::size_t IfaceSize = 64; //Max interface name length + 1
+
+  Table() {
+    RIB_options_t options;
+    RIB_options_init(&options);
+    if constexpr (std::is_same_v<Family, IPv4>) {
+      options.ipv4Engine = static_cast<RIB_engine_type_t>(LookupEngine);
+    } else {
+      options.ipv6Engine = static_cast<RIB_engine_type_t>(LookupEngine);
+    }
+    const RIB_ret_code_t rc = RIB_init_ex(&rtab_, &options);
+    if (rc != RIB_NO_ERROR) {
+      throw Error(rc);
+    }
+  }
+
+  ~Table() { RIB_free(rtab_); }
+
+  Table(const Table&) = delete;
+  Table& operator=(const Table&) = delete;
+  Table(Table&& other) noexcept : rtab_(std::exchange(other.rtab_, nullptr)) {}
+  Table& operator=(Table&& other) noexcept {
+    if (this != &other) {
+      RIB_free(rtab_);
+      rtab_ = std::exchange(other.rtab_, nullptr);
+    }
+    return *this;
+  }
+
+  /**
+   * @function add
+   * @description add a route (see RIB_add)
+   * @param const Prefix<Family>& prefix
+   * @param const Address<Family>& gateway
+   * @param std::string_view iface: shorter than IfaceSize
+   * @param int metric
+   * @returns RIB_ret_code_t
+   */
+
+  RIB_ret_code_t add(const Prefix<Family>& prefix, const Address<Family>& gateway, std::string_view iface, int metric) noexcept {
+    char destination[INET6_ADDRSTRLEN];
+    char netmask[INET6_ADDRSTRLEN];
+    char nexthop[INET6_ADDRSTRLEN];
+    char ifname[IfaceSize];
+    if (!prefix.valid() || !copyIface(iface, ifname)) {
+      return RIB_INVALID_ARGUMENT;
+    }
+    return RIB_add(rtab_, prefix.network().format(destination), prefix.formatNetmask(netmask), gateway.format(nexthop), ifname, metric);
+  }
+
+  /**
+   * @function remove
+   * @description delete the route of a prefix (see RIB_delete)
+   * @param const Prefix<Family>& prefix
+   * @returns RIB_ret_code_t
+   */
+
+  RIB_ret_code_t remove(const Prefix<Family>& prefix) noexcept {
+    char destination[INET6_ADDRSTRLEN];
+    char netmask[INET6_ADDRSTRLEN];
+    if (!prefix.valid()) {
+      return RIB_INVALID_ARGUMENT;
+    }
+    return RIB_delete(rtab_, prefix.network().format(destination), prefix.formatNetmask(netmask));
+  }
+
+  /**
+   * @function find
+   * @description find the route of a prefix (exact match)
+   * @param const Prefix<Family>& prefix
+   * @returns std::optional<NextHopId>
+   */
+
+  std::optional<NextHopId> find(const Prefix<Family>& prefix) const noexcept {
+    char destination[INET6_ADDRSTRLEN];
+    char netmask[INET6_ADDRSTRLEN];
+    Route* route = nullptr;
+    if (!prefix.valid() || RIB_find(rtab_, prefix.network().format(destination), prefix.formatNetmask(netmask), &route) != RIB_NO_ERROR || route == nullptr) {
+      return std::nullopt;
+    }
+    return NextHopId(route);
+  }
+
+  /**
+   * @function match
+   * @description longest prefix match of an address
+   * @param const Address<Family>& address
+   * @returns std::optional<NextHopId>: empty if no route matches
+   */
+
+  std::optional<NextHopId> match(const Address<Family>& address) const noexcept {
+    unsigned char bytes[Family::bytes];
+    address.toBytes(bytes);
+    Route* route = nullptr;
+    if (RIB_match_address(rtab_, Family::version, bytes, &route) != RIB_NO_ERROR) {
+      return std::nullopt;
+    }
+    return NextHopId(route);
+  }
+
+  /**
+   * @function match
+   * @description longest prefix match of a batch of addresses
+   * @param Span<const Address<Family>> addresses
+   * @param Span<std::optional<NextHopId>> results: at least addresses.size() elements
+   * @returns RIB_ret_code_t: RIB_INVALID_ARGUMENT if results is too small
+   */
+
+  RIB_ret_code_t match(Span<const Address<Family>> addresses, Span<std::optional<NextHopId>> results) const noexcept {
+    if (results.size() < addresses.size()) {
+      return RIB_INVALID_ARGUMENT;
+    }
+    unsigned char bytes[BatchSize * Family::bytes];
+    Route* routes[BatchSize];
+    for (std::size_t offset = 0; offset < addresses.size(); offset += BatchSize) {
+      const std::size_t count = addresses.size() - offset < BatchSize ? addresses.size() - offset : BatchSize;
+      for (std::size_t i = 0; i < count; i++) {
+        addresses[offset + i].toBytes(&bytes[i * Family::bytes]);
+      }
+      const RIB_ret_code_t rc = RIB_match_batch(rtab_, Family::version, bytes, count, routes);
+      if (rc != RIB_NO_ERROR) {
+        return rc;
+      }
+      for (std::size_t i = 0; i < count; i++) {
+        results[offset + i] = routes[i] != nullptr ? std::optional<NextHopId>(NextHopId(routes[i])) : std::nullopt;
+      }
+    }
+    return RIB_NO_ERROR;
+  }
+
+  /**
+   * @function clear
+   * @description delete all the routes
+   * @returns RIB_ret_code_t
+   */
+
+  RIB_ret_code_t clear() noexcept { return RIB_clear(rtab_); }
+
+  //A moved-from table is empty
+  std::size_t size() const noexcept { return rtab_ != nullptr ? rtab_->entries : 0; }
+  bool empty() const noexcept { return size() == 0; }
+  static constexpr Engine engine() noexcept { return LookupEngine; }
+
+  /**
+   * @function get
+   * @description returns the RIB, to use the functions of the C API
+   * @returns RIB*
+   */
+
+  RIB* get() const noexcept { return rtab_; }
+
+private:
+  static bool copyIface(std::string_view iface, char* ifname) noexcept {
+    if (iface.empty() || iface.size() >= IfaceSize) {
+      return false;
+    }
+    std::memcpy(ifname, iface.data(), iface.size());
+    ifname[iface.size()] = '\0';
+    return true;
+  }
+
+  RIB* rtab_ = nullptr;
+};
+
+} // namespace rib
+
+#endif
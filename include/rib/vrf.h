@@ -0,0 +1,63 @@
+/**
+ *   librib - vrf.h
+ *   Developed by Christian Visintin
+ * 
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef RIB_VRF_H
+#define RIB_VRF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "rib.h"
+
+#include <stdint.h>
+
+#define RIB_VRF_NONE UINT32_MAX //No base table
+#define RIB_VRF_MAX_ID 1048575
+
+/**
+ * Multiple routing tables (VRFs)
+ * A container of RIBs identified by small integer IDs, selected in O(1). Tables share the equal cost
+ * next hop groups of the container. A table can be created on top of a base table: lookups fall back to the
+ * base, so the tables derived from a shared base only store the routes which differ from it.
+ */
+
+// Data types
+
+typedef struct RIB_vrfs_t RIB_vrfs_t;
+
+// Functions
+
+RIB_ret_code_t RIB_vrfs_init(RIB_vrfs_t** vrfs, const RIB_options_t* options);
+void RIB_vrfs_free(RIB_vrfs_t* vrfs);
+RIB_ret_code_t RIB_vrf_create(RIB_vrfs_t* vrfs, uint32_t vrfId, uint32_t baseId, RIB** rtab);
+RIB_ret_code_t RIB_vrf_delete(RIB_vrfs_t* vrfs, uint32_t vrfId);
+RIB_ret_code_t RIB_vrf_get(RIB_vrfs_t* vrfs, uint32_t vrfId, RIB** rtab);
+RIB_ret_code_t RIB_match_vrf(RIB_vrfs_t* vrfs, uint32_t vrfId, const char* destination, Route** route);
+RIB_ret_code_t RIB_match_vrf_address(RIB_vrfs_t* vrfs, uint32_t vrfId, int ipv, const unsigned char* address, Route** route);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,837 @@
+/**
+ *   librib - classify.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#define PROGRAM_NAME "rib-classify"
+#define PROGRAM_VERSION "1.0.0"
+#define USAGE PROGRAM_NAME " <routingTableFile> <captureFile> [--threads <n>] [--top <n>]"
+
+#include <rib/rib.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BATCH_PACKETS 4096   //Addresses looked up with a single RIB_match_batch
+#define BATCHES_PER_THREAD 4 //Batches in flight for each lookup thread
+#define MAX_THREADS 256
+
+//Link layer types (www.tcpdump.org/linktypes.html)
+#define LINKTYPE_NULL 0
+#define LINKTYPE_ETHERNET 1
+#define LINKTYPE_RAW_OPENBSD 12
+#define LINKTYPE_RAW 101
+#define LINKTYPE_LOOP 108
+#define LINKTYPE_LINUX_SLL 113
+#define LINKTYPE_IPV4 228
+#define LINKTYPE_IPV6 229
+#define LINKTYPE_LINUX_SLL2 276
+
+//pcapng block types
+#define PCAPNG_SECTION_HEADER 0x0A0D0D0A
+#define PCAPNG_INTERFACE_DESCRIPTION 1
+#define PCAPNG_SIMPLE_PACKET 3
+#define PCAPNG_ENHANCED_PACKET 6
+
+/**
+ * Capture file mapped in memory; packets are read in place
+ */
+
+typedef struct capture_t {
+  const unsigned char* data;
+  size_t size;
+  size_t position;
+  int pcapng;
+  int bigEndian;     //Byte order of the file (pcap) or of the current section (pcapng)
+  int linktype;      //pcap
+  int* linktypes;    //pcapng: link type of each interface of the current section
+  uint32_t* snaplens;
+  size_t interfaces;
+} capture_t;
+
+/**
+ * Destination addresses of packets of the same ip version, with their length on the wire
+ */
+
+typedef struct batch_t {
+  int ipv;
+  size_t count;
+  unsigned char addresses[BATCH_PACKETS * 16];
+  uint32_t bytes[BATCH_PACKETS];
+} batch_t;
+
+/**
+ * Bounded queue of batches
+ */
+
+typedef struct queue_t {
+  batch_t** batches;
+  size_t capacity;
+  size_t head;
+  size_t count;
+  int closed;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+} queue_t;
+
+/**
+ * Index of each route in rtab->routes, by address of the route
+ */
+
+typedef struct route_map_t {
+  const Route** routes;
+  size_t* indexes;
+  size_t mask;
+} route_map_t;
+
+/**
+ * Lookup thread: packets and bytes of each route (by index in rtab->routes)
+ */
+
+typedef struct worker_t {
+  pthread_t thread;
+  RIB* rtab;
+  const route_map_t* map;
+  queue_t* full;
+  queue_t* empty;
+  Route** routes;   //Matches of a batch
+  uint64_t* packets;
+  uint64_t* bytes;
+  uint64_t unmatchedPackets;
+  uint64_t unmatchedBytes;
+} worker_t;
+
+typedef struct route_stats_t {
+  const Route* route;
+  uint64_t packets;
+  uint64_t bytes;
+} route_stats_t;
+
+/**
+ * @function getUint16
+ * @description read a 16 bits number
+ * @param const unsigned char*
+ * @param int bigEndian
+ * @returns uint32_t
+ */
+
+static inline uint32_t getUint16(const unsigned char* data, int bigEndian) {
+  return bigEndian ? (uint32_t) ((data[0] << 8) | data[1]) : (uint32_t) ((data[1] << 8) | data[0]);
+}
+
+/**
+ * @function getUint32
+ * @description read a 32 bits number
+ * @param const unsigned char*
+ * @param int bigEndian
+ * @returns uint32_t
+ */
+
+static inline uint32_t getUint32(const unsigned char* data, int bigEndian) {
+  if (bigEndian) {
+    return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) | ((uint32_t) data[2] << 8) | data[3];
+  }
+  return ((uint32_t) data[3] << 24) | ((uint32_t) data[2] << 16) | ((uint32_t) data[1] << 8) | data[0];
+}
+
+/**
+ * @function loadTextTable
+ * @description add the routes of a routing table file in the router format (<networkAddr> <netmask> <gateway> <iface> <metric>)
+ * @param RIB*
+ * @param const char* filename
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t loadTextTable(RIB* rtab, const char* filename) {
+  FILE* filePtr = fopen(filename, "r");
+  if (filePtr == NULL) {
+    return RIB_IO_ERROR;
+  }
+  RIB_ret_code_t rc = RIB_bulk_begin(rtab);
+  size_t skipped = 0;
+  char line[256];
+  while (rc == RIB_NO_ERROR && fgets(line, sizeof(line), filePtr)) {
+    char* destination = strtok(line, " \t\r\n");
+    char* netmask = destination != NULL ? strtok(NULL, " \t\r\n") : NULL;
+    char* gateway = netmask != NULL ? strtok(NULL, " \t\r\n") : NULL;
+    char* iface = gateway != NULL ? strtok(NULL, " \t\r\n") : NULL;
+    char* metric = iface != NULL ? strtok(NULL, " \t\r\n") : NULL;
+    if (metric == NULL) {
+      continue;
+    }
+    if (RIB_add(rtab, destination, netmask, gateway, iface, atoi(metric)) != RIB_NO_ERROR) {
+      skipped++;
+    }
+  }
+  fclose(filePtr);
+  if (skipped > 0) {
+    fprintf(stderr, "Skipped %zu invalid or duplicate routes\n", skipped);
+  }
+  RIB_ret_code_t endRc = RIB_bulk_end(rtab);
+  return rc != RIB_NO_ERROR ? rc : endRc;
+}
+
+/**
+ * @function loadTable
+ * @description load a routing table, in the router text format, in the binary format (RIB_save) or from an MRT file
+ * @param RIB*
+ * @param const char* filename
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t loadTable(RIB* rtab, const char* filename) {
+  unsigned char magic[12] = {0};
+  FILE* filePtr = fopen(filename, "rb");
+  if (filePtr == NULL) {
+    return RIB_IO_ERROR;
+  }
+  const size_t length = fread(magic, 1, sizeof(magic), filePtr);
+  fclose(filePtr);
+  if (length >= 4 && memcmp(magic, "RIBT", 4) == 0) {
+    return RIB_load(rtab, filename, NULL);
+  }
+  //gzip, bzip2 or a TABLE_DUMP_V2 record
+  const int compressed = (length >= 2 && magic[0] == 0x1F && magic[1] == 0x8B) || (length >= 3 && memcmp(magic, "BZh", 3) == 0);
+  if (compressed || (length == sizeof(magic) && magic[4] == 0 && magic[5] == 13)) {
+    return RIB_load_mrt(rtab, filename, NULL, NULL);
+  }
+  return loadTextTable(rtab, filename);
+}
+
+/**
+ * @function createRouteMap
+ * @description index the routes of a RIB by their address
+ * @param RIB*
+ * @param route_map_t* map
+ * @returns int: 0 if succeeded
+ */
+
+int createRouteMap(RIB* rtab, route_map_t* map) {
+  size_t slots = 16;
+  while (slots < rtab->entries * 2) {
+    slots *= 2;
+  }
+  map->routes = (const Route**) calloc(slots, sizeof(Route*));
+  map->indexes = (size_t*) malloc(slots * sizeof(size_t));
+  map->mask = slots - 1;
+  if (map->routes == NULL || map->indexes == NULL) {
+    return 1;
+  }
+  for (size_t i = 0; i < rtab->entries; i++) {
+    size_t slot = ((uintptr_t) rtab->routes[i] >> 4) * 0x9E3779B97F4A7C15ULL & map->mask;
+    while (map->routes[slot] != NULL) {
+      slot = (slot + 1) & map->mask;
+    }
+    map->routes[slot] = rtab->routes[i];
+    map->indexes[slot] = i;
+  }
+  return 0;
+}
+
+/**
+ * @function routeIndex
+ * @description returns the index of a route in rtab->routes
+ * @param const route_map_t* map
+ * @param const Route* route
+ * @returns size_t
+ */
+
+static inline size_t routeIndex(const route_map_t* map, const Route* route) {
+  size_t slot = ((uintptr_t) route >> 4) * 0x9E3779B97F4A7C15ULL & map->mask;
+  while (map->routes[slot] != route) {
+    slot = (slot + 1) & map->mask;
+  }
+  return map->indexes[slot];
+}
+
+/**
+ * @function queueInit
+ * @description initialize a queue
+ * @param queue_t*
+ * @param size_t capacity
+ * @returns int: 0 if succeeded
+ */
+
+int queueInit(queue_t* queue, size_t capacity) {
+  queue->batches = (batch_t**) malloc(capacity * sizeof(batch_t*));
+  queue->capacity = capacity;
+  queue->head = 0;
+  queue->count = 0;
+  queue->closed = 0;
+  pthread_mutex_init(&queue->lock, NULL);
+  pthread_cond_init(&queue->changed, NULL);
+  return queue->batches == NULL;
+}
+
+/**
+ * @function queuePush
+ * @description add a batch to a queue; the queue can hold all the batches, so it never waits
+ * @param queue_t*
+ * @param batch_t*
+ */
+
+void queuePush(queue_t* queue, batch_t* batch) {
+  pthread_mutex_lock(&queue->lock);
+  queue->batches[(queue->head + queue->count) % queue->capacity] = batch;
+  queue->count++;
+  pthread_cond_signal(&queue->changed);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * @function queuePop
+ * @description take the first batch of a queue, waiting for one
+ * @param queue_t*
+ * @returns batch_t*: NULL if the queue has been closed and it is empty
+ */
+
+batch_t* queuePop(queue_t* queue) {
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == 0 && !queue->closed) {
+    pthread_cond_wait(&queue->changed, &queue->lock);
+  }
+  batch_t* batch = NULL;
+  if (queue->count > 0) {
+    batch = queue->batches[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return batch;
+}
+
+/**
+ * @function queueClose
+ * @description wake up the threads waiting for batches once the queue is empty
+ * @param queue_t*
+ */
+
+void queueClose(queue_t* queue) {
+  pthread_mutex_lock(&queue->lock);
+  queue->closed = 1;
+  pthread_cond_broadcast(&queue->changed);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * @function queueDestroy
+ * @description free a queue (not its batches)
+ * @param queue_t*
+ */
+
+void queueDestroy(queue_t* queue) {
+  free(queue->batches);
+  pthread_cond_destroy(&queue->changed);
+  pthread_mutex_destroy(&queue->lock);
+}
+
+/**
+ * @function workerMain
+ * @description look up the batches of the full queue and account their packets to the matched routes
+ * @param void* worker_t
+ * @returns void*
+ */
+
+void* workerMain(void* arg) {
+  worker_t* worker = (worker_t*) arg;
+  Route** routes = worker->routes;
+  batch_t* batch;
+  while ((batch = queuePop(worker->full)) != NULL) {
+    RIB_match_batch(worker->rtab, batch->ipv, batch->addresses, batch->count, routes);
+    for (size_t i = 0; i < batch->count; i++) {
+      if (routes[i] == NULL) {
+        worker->unmatchedPackets++;
+        worker->unmatchedBytes += batch->bytes[i];
+      } else {
+        const size_t index = routeIndex(worker->map, routes[i]);
+        worker->packets[index]++;
+        worker->bytes[index] += batch->bytes[i];
+      }
+    }
+    queuePush(worker->empty, batch);
+  }
+  return NULL;
+}
+
+/**
+ * @function openCapture
+ * @description map a pcap or pcapng file in memory and read its header
+ * @param const char* filename
+ * @param capture_t* capture
+ * @returns int: 0 if succeeded
+ */
+
+int openCapture(const char* filename, capture_t* capture) {
+  memset(capture, 0, sizeof(capture_t));
+  const int fd = open(filename, O_RDONLY);
+  if (fd == -1) {
+    return 1;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < 24) {
+    close(fd);
+    return 1;
+  }
+  void* data = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return 1;
+  }
+  madvise(data, (size_t) info.st_size, MADV_SEQUENTIAL);
+  capture->data = (const unsigned char*) data;
+  capture->size = (size_t) info.st_size;
+  const unsigned char* header = capture->data;
+  //pcap magic with microseconds or nanoseconds timestamps
+  const uint32_t magic = getUint32(header, 0);
+  if (magic == 0xA1B2C3D4 || magic == 0xA1B23C4D) {
+    capture->bigEndian = 0;
+  } else if (magic == 0xD4C3B2A1 || magic == 0x4D3CB2A1) {
+    capture->bigEndian = 1;
+  } else if (magic == PCAPNG_SECTION_HEADER) {
+    capture->pcapng = 1;
+    return 0;
+  } else {
+    munmap(data, capture->size);
+    return 1;
+  }
+  capture->linktype = (int) getUint32(header + 20, capture->bigEndian);
+  capture->position = 24;
+  return 0;
+}
+
+/**
+ * @function closeCapture
+ * @description unmap a capture file
+ * @param capture_t* capture
+ */
+
+void closeCapture(capture_t* capture) {
+  munmap((void*) capture->data, capture->size);
+  free(capture->linktypes);
+  free(capture->snaplens);
+}
+
+/**
+ * @function nextPcapngPacket
+ * @description read the blocks of a pcapng file up to the next packet
+ * @param capture_t* capture
+ * @param const unsigned char** packet
+ * @param size_t* captured: captured length
+ * @param size_t* length: length on the wire
+ * @param int* linktype
+ * @returns int: 1 if a packet has been read; 0 at the end of the file; -1 if the file is malformed
+ */
+
+int nextPcapngPacket(capture_t* capture, const unsigned char** packet, size_t* captured, size_t* length, int* linktype) {
+  while (capture->position + 12 <= capture->size) {
+    const unsigned char* block = capture->data + capture->position;
+    const uint32_t type = getUint32(block, capture->bigEndian);
+    //A section header sets the byte order of its blocks (its type is the same in both)
+    if (type == PCAPNG_SECTION_HEADER) {
+      if (capture->size - capture->position < 28) {
+        return -1;
+      }
+      capture->bigEndian = block[8] == 0x1A;
+      capture->interfaces = 0;
+    }
+    const uint32_t blockLength = getUint32(block + 4, capture->bigEndian);
+    if (blockLength < 12 || blockLength % 4 != 0 || blockLength > capture->size - capture->position) {
+      return -1;
+    }
+    capture->position += blockLength;
+    const unsigned char* body = block + 8;
+    const size_t bodyLength = blockLength - 12;
+    if (type == PCAPNG_INTERFACE_DESCRIPTION && bodyLength >= 8) {
+      int* linktypes = (int*) realloc(capture->linktypes, (capture->interfaces + 1) * sizeof(int));
+      if (linktypes == NULL) {
+        return -1;
+      }
+      capture->linktypes = linktypes;
+      uint32_t* snaplens = (uint32_t*) realloc(capture->snaplens, (capture->interfaces + 1) * sizeof(uint32_t));
+      if (snaplens == NULL) {
+        return -1;
+      }
+      capture->snaplens = snaplens;
+      capture->linktypes[capture->interfaces] = (int) getUint16(body, capture->bigEndian);
+      capture->snaplens[capture->interfaces] = getUint32(body + 4, capture->bigEndian);
+      capture->interfaces++;
+    } else if (type == PCAPNG_ENHANCED_PACKET && bodyLength >= 20) {
+      const uint32_t interface = getUint32(body, capture->bigEndian);
+      *captured = getUint32(body + 12, capture->bigEndian);
+      *length = getUint32(body + 16, capture->bigEndian);
+      if (interface >= capture->interfaces || *captured > bodyLength - 20) {
+        return -1;
+      }
+      *packet = body + 20;
+      *linktype = capture->linktypes[interface];
+      return 1;
+    } else if (type == PCAPNG_SIMPLE_PACKET && bodyLength >= 4 && capture->interfaces > 0) {
+      //The captured length is the original length cut to the snap length of the first interface
+      *length = getUint32(body, capture->bigEndian);
+      *captured = *length;
+      if (capture->snaplens[0] != 0 && *captured > capture->snaplens[0]) {
+        *captured = capture->snaplens[0];
+      }
+      if (*captured > bodyLength - 4) {
+        *captured = bodyLength - 4;
+      }
+      *packet = body + 4;
+      *linktype = capture->linktypes[0];
+      return 1;
+    }
+  }
+  return capture->position == capture->size ? 0 : -1;
+}
+
+/**
+ * @function nextPacket
+ * @description returns the next packet of the capture, without copying it
+ * @param capture_t* capture
+ * @param const unsigned char** packet
+ * @param size_t* captured: captured length
+ * @param size_t* length: length on the wire
+ * @param int* linktype
+ * @returns int: 1 if a packet has been read; 0 at the end of the file; -1 if the file is malformed
+ */
+
+int nextPacket(capture_t* capture, const unsigned char** packet, size_t* captured, size_t* length, int* linktype) {
+  if (capture->pcapng) {
+    return nextPcapngPacket(capture, packet, captured, length, linktype);
+  }
+  if (capture->position == capture->size) {
+    return 0;
+  }
+  if (capture->size - capture->position < 16) {
+    return -1;
+  }
+  const unsigned char* header = capture->data + capture->position;
+  *captured = getUint32(header + 8, capture->bigEndian);
+  *length = getUint32(header + 12, capture->bigEndian);
+  if (*captured > capture->size - capture->position - 16) {
+    return -1;
+  }
+  *packet = header + 16;
+  *linktype = capture->linktype;
+  capture->position += 16 + *captured;
+  return 1;
+}
+
+/**
+ * @function ipDestination
+ * @description get the destination address of an ip packet
+ * @param const unsigned char* packet
+ * @param size_t length
+ * @param const unsigned char** address
+ * @returns int: ip version; 0 if it is not an ip packet or it is truncated
+ */
+
+static inline int ipDestination(const unsigned char* packet, size_t length, const unsigned char** address) {
+  if (length >= 20 && (packet[0] >> 4) == 4) {
+    *address = packet + 16;
+    return 4;
+  }
+  if (length >= 40 && (packet[0] >> 4) == 6) {
+    *address = packet + 24;
+    return 6;
+  }
+  return 0;
+}
+
+/**
+ * @function packetDestination
+ * @description get the destination address of a captured packet
+ * @param int linktype
+ * @param const unsigned char* packet
+ * @param size_t length: captured length
+ * @param const unsigned char** address
+ * @returns int: ip version; 0 if it is not an ip packet, it is truncated or the link type is not supported
+ */
+
+int packetDestination(int linktype, const unsigned char* packet, size_t length, const unsigned char** address) {
+  size_t offset;
+  uint32_t protocol;
+  switch (linktype) {
+    case LINKTYPE_ETHERNET:
+      if (length < 14) {
+        return 0;
+      }
+      protocol = getUint16(packet + 12, 1);
+      offset = 14;
+      //802.1Q and 802.1ad tags
+      while ((protocol == 0x8100 || protocol == 0x88A8 || protocol == 0x9100) && length >= offset + 4) {
+        protocol = getUint16(packet + offset + 2, 1);
+        offset += 4;
+      }
+      break;
+    case LINKTYPE_LINUX_SLL:
+      if (length < 16) {
+        return 0;
+      }
+      protocol = getUint16(packet + 14, 1);
+      offset = 16;
+      break;
+    case LINKTYPE_LINUX_SLL2:
+      if (length < 20) {
+        return 0;
+      }
+      protocol = getUint16(packet, 1);
+      offset = 20;
+      break;
+    case LINKTYPE_NULL:
+    case LINKTYPE_LOOP:
+      //The address family doesn't have the same value on all the systems: the ip version is enough
+      return length >= 4 ? ipDestination(packet + 4, length - 4, address) : 0;
+    case LINKTYPE_RAW:
+    case LINKTYPE_RAW_OPENBSD:
+    case LINKTYPE_IPV4:
+    case LINKTYPE_IPV6:
+      return ipDestination(packet, length, address);
+    default:
+      return 0;
+  }
+  if (protocol != 0x0800 && protocol != 0x86DD) {
+    return 0;
+  }
+  const int ipv = ipDestination(packet + offset, length - offset, address);
+  return ipv == (protocol == 0x0800 ? 4 : 6) ? ipv : 0;
+}
+
+/**
+ * @function compareBytes
+ * @description compare two routes by bytes, in descending order
+ * @param const void* route_stats_t
+ * @param const void* route_stats_t
+ * @returns int
+ */
+
+int compareBytes(const void* a, const void* b) {
+  const route_stats_t* x = (const route_stats_t*) a;
+  const route_stats_t* y = (const route_stats_t*) b;
+  if (x->bytes != y->bytes) {
+    return x->bytes < y->bytes ? 1 : -1;
+  }
+  return x->packets < y->packets ? 1 : (x->packets > y->packets ? -1 : 0);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    printf("%s\n", USAGE);
+    return 1;
+  }
+  size_t threads = (size_t) sysconf(_SC_NPROCESSORS_ONLN);
+  size_t top = 0;
+  for (int i = 3; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--threads") == 0) {
+      threads = (size_t) atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--top") == 0) {
+      top = (size_t) atoi(argv[i + 1]);
+    } else {
+      printf("%s\n", USAGE);
+      return 1;
+    }
+  }
+  if (threads < 1) {
+    threads = 1;
+  } else if (threads > MAX_THREADS) {
+    threads = MAX_THREADS;
+  }
+  //Load routing table
+  RIB* rtab = NULL;
+  RIB_ret_code_t rc = RIB_init(&rtab);
+  if (rc != RIB_NO_ERROR) {
+    printf("COULD NOT INITIALIZE RIB!\n");
+    return rc;
+  }
+  if ((rc = loadTable(rtab, argv[1])) != RIB_NO_ERROR) {
+    printf("COULD NOT LOAD ROUTING TABLE: %s\n", RIB_get_error_msg(rc));
+    RIB_free(rtab);
+    return 1;
+  }
+  route_map_t map;
+  if (createRouteMap(rtab, &map) != 0) {
+    printf("%s\n", RIB_get_error_msg(RIB_BAD_ALLOC));
+    RIB_free(rtab);
+    return 1;
+  }
+  //Rebuild the lookup tables before the lookup threads start, which only read them
+  if ((rc = RIB_prepare(rtab)) != RIB_NO_ERROR) {
+    printf("%s\n", RIB_get_error_msg(rc));
+    free(map.routes);
+    free(map.indexes);
+    RIB_free(rtab);
+    return 1;
+  }
+  capture_t capture;
+  if (openCapture(argv[2], &capture) != 0) {
+    printf("COULD NOT OPEN CAPTURE %s (pcap or pcapng)\n", argv[2]);
+    free(map.routes);
+    free(map.indexes);
+    RIB_free(rtab);
+    return 1;
+  }
+  //Start lookup threads
+  int ret = 1;
+  route_stats_t* stats = NULL;
+  const size_t batchCount = threads * BATCHES_PER_THREAD + 2;
+  batch_t* batches = (batch_t*) malloc(batchCount * sizeof(batch_t));
+  worker_t* workers = (worker_t*) calloc(threads, sizeof(worker_t));
+  queue_t full;
+  queue_t empty;
+  //Both queues are initialized, so that both can be destroyed
+  const int queueFailed = queueInit(&full, batchCount);
+  if (queueInit(&empty, batchCount) != 0 || queueFailed || batches == NULL || workers == NULL) {
+    printf("%s\n", RIB_get_error_msg(RIB_BAD_ALLOC));
+    goto cleanup;
+  }
+  for (size_t i = 0; i < batchCount; i++) {
+    queuePush(&empty, &batches[i]);
+  }
+  for (size_t i = 0; i < threads; i++) {
+    workers[i].rtab = rtab;
+    workers[i].map = &map;
+    workers[i].full = &full;
+    workers[i].empty = &empty;
+    workers[i].routes = (Route**) malloc(BATCH_PACKETS * sizeof(Route*));
+    workers[i].packets = (uint64_t*) calloc(rtab->entries + 1, sizeof(uint64_t));
+    workers[i].bytes = (uint64_t*) calloc(rtab->entries + 1, sizeof(uint64_t));
+    if (workers[i].routes == NULL || workers[i].packets == NULL || workers[i].bytes == NULL) {
+      printf("%s\n", RIB_get_error_msg(RIB_BAD_ALLOC));
+      goto cleanup;
+    }
+  }
+  struct timespec start;
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  size_t started = 0;
+  while (started < threads && pthread_create(&workers[started].thread, NULL, workerMain, &workers[started]) == 0) {
+    started++;
+  }
+  if (started < threads) {
+    printf("COULD NOT START LOOKUP THREADS!\n");
+    queueClose(&full);
+    for (size_t i = 0; i < started; i++) {
+      pthread_join(workers[i].thread, NULL);
+    }
+    goto cleanup;
+  }
+  //Split the destinations of the packets into batches by ip version
+  batch_t* current[2] = {queuePop(&empty), queuePop(&empty)};
+  current[0]->ipv = 4;
+  current[0]->count = 0;
+  current[1]->ipv = 6;
+  current[1]->count = 0;
+  uint64_t packets = 0;
+  uint64_t otherPackets = 0;
+  const unsigned char* packet;
+  size_t captured;
+  size_t length;
+  int linktype;
+  int read;
+  while ((read = nextPacket(&capture, &packet, &captured, &length, &linktype)) == 1) {
+    packets++;
+    const unsigned char* address;
+    const int ipv = packetDestination(linktype, packet, captured, &address);
+    if (ipv == 0) {
+      otherPackets++;
+      continue;
+    }
+    batch_t* batch = current[ipv == 6];
+    const size_t addressLength = ipv == 6 ? 16 : 4;
+    memcpy(batch->addresses + batch->count * addressLength, address, addressLength);
+    batch->bytes[batch->count++] = (uint32_t) length;
+    if (batch->count == BATCH_PACKETS) {
+      queuePush(&full, batch);
+      batch = queuePop(&empty);
+      batch->ipv = ipv;
+      batch->count = 0;
+      current[ipv == 6] = batch;
+    }
+  }
+  for (int i = 0; i < 2; i++) {
+    if (current[i]->count > 0) {
+      queuePush(&full, current[i]);
+    }
+  }
+  queueClose(&full);
+  uint64_t unmatchedPackets = 0;
+  uint64_t unmatchedBytes = 0;
+  for (size_t i = 0; i < threads; i++) {
+    pthread_join(workers[i].thread, NULL);
+    unmatchedPackets += workers[i].unmatchedPackets;
+    unmatchedBytes += workers[i].unmatchedBytes;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  if (read == -1) {
+    fprintf(stderr, "The capture is truncated or malformed: classified the first %lu packets\n", (unsigned long) packets);
+  }
+  //Fold the counters of the threads
+  stats = (route_stats_t*) calloc(rtab->entries + 1, sizeof(route_stats_t));
+  size_t matchedRoutes = 0;
+  for (size_t r = 0; stats != NULL && r < rtab->entries; r++) {
+    route_stats_t routeStats = {rtab->routes[r], 0, 0};
+    for (size_t i = 0; i < threads; i++) {
+      routeStats.packets += workers[i].packets[r];
+      routeStats.bytes += workers[i].bytes[r];
+    }
+    if (routeStats.packets > 0) {
+      stats[matchedRoutes++] = routeStats;
+    }
+  }
+  if (stats != NULL) {
+    qsort(stats, matchedRoutes, sizeof(route_stats_t), compareBytes);
+  }
+  const size_t shown = top > 0 && top < matchedRoutes ? top : matchedRoutes;
+  printf("Destination\tNetmask\t\tGateway\t\tIface\tPackets\tBytes\n");
+  for (size_t i = 0; i < shown; i++) {
+    const Route* r = stats[i].route;
+    printf("%s\t%s\t%s\t%s\t%lu\t%lu\n", r->destination, r->netmask, r->gateway, r->iface, (unsigned long) stats[i].packets, (unsigned long) stats[i].bytes);
+  }
+  printf("(unmatched)\t\t\t\t\t%lu\t%lu\n", (unsigned long) unmatchedPackets, (unsigned long) unmatchedBytes);
+  const double elapsed = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / 1e9;
+  fprintf(stderr, "%lu packets (%lu not ip) classified against %zu routes with %zu threads in %.3f s (%.2f Mpps)\n", (unsigned long) packets,
+          (unsigned long) otherPackets, rtab->entries, threads, elapsed, elapsed > 0 ? (double) packets / elapsed / 1e6 : 0.0);
+  ret = read == -1;
+cleanup:
+  //Free resources
+  free(stats);
+  for (size_t i = 0; workers != NULL && i < threads; i++) {
+    free(workers[i].routes);
+    free(workers[i].packets);
+    free(workers[i].bytes);
+  }
+  free(workers);
+  free(batches);
+  queueDestroy(&full);
+  queueDestroy(&empty);
+  free(map.routes);
+  free(map.indexes);
+  closeCapture(&capture);
+  RIB_free(rtab);
+  return ret;
+}
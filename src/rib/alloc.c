@@ -0,0 +1,337 @@
+/**
+ *   librib - alloc.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "alloc.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define ALLOC_HEADER 64
+#define ALLOC_HUGEPAGE_SIZE (2 * 1024 * 1024)
+#define ALLOC_MAX_CPUS 4096
+#define ALLOC_NODE_REFRESH 1024
+
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+
+typedef enum RIB_alloc_kind_t {
+  RIB_ALLOC_HEAP,
+  RIB_ALLOC_MMAP,
+  RIB_ALLOC_HUGETLB
+} RIB_alloc_kind_t;
+
+/**
+ * Header stored before each table block, needed to release it
+ */
+
+typedef struct RIB_alloc_header_t {
+  void* base;
+  size_t length;
+  RIB_alloc_kind_t kind;
+} RIB_alloc_header_t;
+
+static int numaNodes = 0;
+static short cpuNode[ALLOC_MAX_CPUS];
+
+static __thread int threadNode = -1;
+static __thread unsigned int threadLookups = 0;
+
+/**
+ * @function placeHeader
+ * @description write the allocation header at the beginning of a block and returns the table address
+ * @param void* base
+ * @param size_t length
+ * @param RIB_alloc_kind_t kind
+ * @returns void*
+ */
+
+static void* placeHeader(void* base, size_t length, RIB_alloc_kind_t kind) {
+  RIB_alloc_header_t* header = (RIB_alloc_header_t*) base;
+  header->base = base;
+  header->length = length;
+  header->kind = kind;
+  return (char*) base + ALLOC_HEADER;
+}
+
+#ifdef __linux__
+
+/**
+ * @function mapTable
+ * @description map an anonymous region for a table, backed by huge pages when possible (page aligned only with RIB_HUGEPAGES_NONE)
+ * @param size_t length
+ * @param RIB_hugepage_mode_t hugePages
+ * @returns void*: table address; NULL if mapping failed
+ */
+
+static void* mapTable(size_t length, RIB_hugepage_mode_t hugePages) {
+  if (hugePages == RIB_HUGEPAGES_NONE) {
+    void* base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return base != MAP_FAILED ? placeHeader(base, length, RIB_ALLOC_MMAP) : NULL;
+  }
+  const size_t hugeLength = (length + ALLOC_HUGEPAGE_SIZE - 1) & ~((size_t) ALLOC_HUGEPAGE_SIZE - 1);
+#ifdef MAP_HUGETLB
+  if (hugePages == RIB_HUGEPAGES_EXPLICIT) {
+    void* base = mmap(NULL, hugeLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (base != MAP_FAILED) {
+      return placeHeader(base, hugeLength, RIB_ALLOC_HUGETLB);
+    }
+    //No huge pages reserved: fall back to transparent huge pages
+  }
+#endif
+  //Map one more huge page to align the region on a huge page boundary
+  char* region = (char*) mmap(NULL, hugeLength + ALLOC_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region == MAP_FAILED) {
+    return NULL;
+  }
+  char* base = (char*) (((uintptr_t) region + ALLOC_HUGEPAGE_SIZE - 1) & ~((uintptr_t) ALLOC_HUGEPAGE_SIZE - 1));
+  if (base > region) {
+    munmap(region, (size_t) (base - region));
+  }
+  const size_t tail = (size_t) ((region + hugeLength + ALLOC_HUGEPAGE_SIZE) - (base + hugeLength));
+  if (tail > 0) {
+    munmap(base + hugeLength, tail);
+  }
+#ifdef MADV_HUGEPAGE
+  madvise(base, hugeLength, MADV_HUGEPAGE);
+#endif
+  return placeHeader(base, hugeLength, RIB_ALLOC_MMAP);
+}
+
+/**
+ * @function loadTopology
+ * @description read the number of numa nodes and the node of each cpu from sysfs (once)
+ */
+
+static void loadTopology(void) {
+  if (numaNodes > 0) {
+    return;
+  }
+  int nodes = 1;
+  for (int cpu = 0; cpu < ALLOC_MAX_CPUS; cpu++) {
+    cpuNode[cpu] = 0;
+  }
+  for (int node = 0; node < RIB_MAX_NUMA_NODES; node++) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    FILE* cpuList = fopen(path, "r");
+    if (cpuList == NULL) {
+      continue;
+    }
+    nodes = node + 1;
+    //Parse cpu list (e.g. 0-3,8-11)
+    int first;
+    while (fscanf(cpuList, "%d", &first) == 1) {
+      int last = first;
+      int separator = fgetc(cpuList);
+      if (separator == '-') {
+        if (fscanf(cpuList, "%d", &last) != 1) {
+          break;
+        }
+        separator = fgetc(cpuList);
+      }
+      for (int cpu = first; cpu <= last && cpu < ALLOC_MAX_CPUS; cpu++) {
+        if (cpu >= 0) {
+          cpuNode[cpu] = (short) node;
+        }
+      }
+      if (separator != ',') {
+        break;
+      }
+    }
+    fclose(cpuList);
+  }
+  numaNodes = nodes;
+}
+
+#endif
+
+/**
+ * @function RIB_table_alloc
+ * @description allocate a zeroed, 64 bytes aligned block for a lookup table
+ * @param size_t size
+ * @param RIB_hugepage_mode_t hugePages: tables smaller than half huge page are always allocated on the heap
+ * @returns void*: NULL if allocation failed
+ */
+
+void* RIB_table_alloc(size_t size, RIB_hugepage_mode_t hugePages) {
+  const size_t length = size + ALLOC_HEADER;
+#ifdef __linux__
+  if (hugePages != RIB_HUGEPAGES_NONE && length >= ALLOC_HUGEPAGE_SIZE / 2) {
+    void* table = mapTable(length, hugePages);
+    if (table != NULL) {
+      return table;
+    }
+  }
+#endif
+  const size_t heapLength = (length + ALLOC_HEADER - 1) & ~((size_t) ALLOC_HEADER - 1);
+  void* base = aligned_alloc(ALLOC_HEADER, heapLength);
+  if (base == NULL) {
+    return NULL;
+  }
+  memset(base, 0x00, heapLength);
+  return placeHeader(base, heapLength, RIB_ALLOC_HEAP);
+}
+
+/**
+ * @function RIB_table_free
+ * @description release a block allocated with RIB_table_alloc; NULL is allowed
+ * @param void* table
+ */
+
+void RIB_table_free(void* table) {
+  if (table == NULL) {
+    return;
+  }
+  RIB_alloc_header_t* header = (RIB_alloc_header_t*) ((char*) table - ALLOC_HEADER);
+  if (header->kind == RIB_ALLOC_HEAP) {
+    free(header->base);
+  }
+#ifdef __linux__
+  else {
+    munmap(header->base, header->length);
+  }
+#endif
+}
+
+/**
+ * @function RIB_table_is_huge
+ * @description returns whether a table has been mapped for huge pages (explicit or transparent)
+ * @param const void* table
+ * @returns int
+ */
+
+int RIB_table_is_huge(const void* table) {
+  if (table == NULL) {
+    return 0;
+  }
+  const RIB_alloc_header_t* header = (const RIB_alloc_header_t*) ((const char*) table - ALLOC_HEADER);
+  return header->kind != RIB_ALLOC_HEAP;
+}
+
+/**
+ * @function RIB_numa_nodes
+ * @description returns the number of numa nodes of the system
+ * @returns int
+ */
+
+int RIB_numa_nodes(void) {
+#ifdef __linux__
+  loadTopology();
+  return numaNodes;
+#else
+  return 1;
+#endif
+}
+
+/**
+ * @function RIB_replicas_build
+ * @description copy a read-only table to memory bound to each numa node; does nothing on single node systems
+ * @param RIB_replicas_t* replicas
+ * @param const void* table
+ * @param size_t size
+ * @param RIB_hugepage_mode_t hugePages
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_replicas_build(RIB_replicas_t* replicas, const void* table, size_t size, RIB_hugepage_mode_t hugePages) {
+  memset(replicas, 0x00, sizeof(RIB_replicas_t));
+  replicas->size = size;
+  replicas->nodes = RIB_numa_nodes();
+  if (replicas->nodes < 2 || table == NULL) {
+    return RIB_NO_ERROR;
+  }
+#ifdef __linux__
+  for (int node = 0; node < replicas->nodes; node++) {
+    //Replicas are always mapped, so they can be bound before being filled (the header page is moved)
+    void* replica = mapTable(size + ALLOC_HEADER, hugePages);
+    if (replica == NULL) {
+      RIB_replicas_free(replicas);
+      return RIB_BAD_ALLOC;
+    }
+    RIB_alloc_header_t* header = (RIB_alloc_header_t*) ((char*) replica - ALLOC_HEADER);
+    unsigned long nodeMask[RIB_MAX_NUMA_NODES / (8 * sizeof(unsigned long))] = {0};
+    nodeMask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    syscall(SYS_mbind, header->base, header->length, MPOL_BIND, nodeMask, RIB_MAX_NUMA_NODES + 1, MPOL_MF_MOVE);
+    memcpy(replica, table, size);
+    replicas->replica[node] = replica;
+  }
+#endif
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_replicas_local
+ * @description returns the replica on the numa node of the calling thread
+ * @param const RIB_replicas_t* replicas
+ * @param const void* fallback: returned if there is no local replica
+ * @returns const void*
+ */
+
+const void* RIB_replicas_local(const RIB_replicas_t* replicas, const void* fallback) {
+  if (replicas->nodes < 2) {
+    return fallback;
+  }
+#ifdef __linux__
+  //Threads may migrate: refresh the cached node once in a while
+  if (threadNode < 0 || ++threadLookups >= ALLOC_NODE_REFRESH) {
+    const int cpu = sched_getcpu();
+    threadNode = (cpu >= 0 && cpu < ALLOC_MAX_CPUS) ? cpuNode[cpu] : 0;
+    threadLookups = 0;
+  }
+  if (threadNode < RIB_MAX_NUMA_NODES && replicas->replica[threadNode] != NULL) {
+    return replicas->replica[threadNode];
+  }
+#endif
+  return fallback;
+}
+
+/**
+ * @function RIB_replicas_free
+ * @description free all the replicas of a table
+ * @param RIB_replicas_t* replicas
+ */
+
+void RIB_replicas_free(RIB_replicas_t* replicas) {
+  for (int node = 0; node < RIB_MAX_NUMA_NODES; node++) {
+    RIB_table_free(replicas->replica[node]);
+    replicas->replica[node] = NULL;
+  }
+  replicas->nodes = 0;
+}
@@ -0,0 +1,56 @@
+/**
+ *   librib - alloc.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef RIB_ALLOC_H
+#define RIB_ALLOC_H
+
+#include <rib/rib.h>
+
+#define RIB_MAX_NUMA_NODES 64
+
+/**
+ * Allocation of large read-only lookup tables.
+ * Tables can be backed by huge pages (explicit or transparent) to reduce TLB misses,
+ * and replicated on each NUMA node so that lookups read node-local memory.
+ * Every block is 64 bytes aligned.
+ */
+
+// Data types
+
+typedef struct RIB_replicas_t {
+  void* replica[RIB_MAX_NUMA_NODES]; //Replica of the table for each node; NULL where not replicated
+  size_t size;
+  int nodes;
+} RIB_replicas_t;
+
+// Functions
+
+void* RIB_table_alloc(size_t size, RIB_hugepage_mode_t hugePages);
+void RIB_table_free(void* table);
+int RIB_table_is_huge(const void* table);
+int RIB_numa_nodes(void);
+RIB_ret_code_t RIB_replicas_build(RIB_replicas_t* replicas, const void* table, size_t size, RIB_hugepage_mode_t hugePages);
+const void* RIB_replicas_local(const RIB_replicas_t* replicas, const void* fallback);
+void RIB_replicas_free(RIB_replicas_t* replicas);
+
+#endif
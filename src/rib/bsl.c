@@ -0,0 +1,341 @@
+/**
+ *   librib - bsl.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include "alloc.h"
+#include "bsl.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BSL_ALIGN 64
+#define BSL_BLOOM_BITS_PER_ENTRY 16
+
+/**
+ * @function nextPowerOfTwo
+ * @description returns the smallest power of two greater or equal than the provided value
+ * @param uint64_t
+ * @returns uint64_t
+ */
+
+static uint64_t nextPowerOfTwo(uint64_t value) {
+  uint64_t power = 1;
+  while (power < value) {
+    power <<= 1;
+  }
+  return power;
+}
+
+/**
+ * @function levelEntries
+ * @description returns the entries of the provided level
+ * @param const RIB_bsl_t*
+ * @param uint32_t level
+ * @returns RIB_bsl_entry_t*
+ */
+
+static inline RIB_bsl_entry_t* levelEntries(const RIB_bsl_t* table, uint32_t level) {
+  return (RIB_bsl_entry_t*) ((char*) table + table->level[level].offset);
+}
+
+/**
+ * @function bloomSet
+ * @description set the bloom filter bits for the provided hash
+ * @param RIB_bsl_t*
+ * @param uint64_t hash
+ */
+
+static void bloomSet(RIB_bsl_t* table, uint64_t hash) {
+  uint64_t* bits = (uint64_t*) ((char*) table + table->bloomOffset);
+  uint64_t bit = hash & table->bloomMask;
+  bits[bit >> 6] |= (uint64_t) 1 << (bit & 63);
+  bit = (hash >> 32) & table->bloomMask;
+  bits[bit >> 6] |= (uint64_t) 1 << (bit & 63);
+}
+
+/**
+ * @function bloomTest
+ * @description returns whether the bloom filter may contain the provided hash
+ * @param const RIB_bsl_t*
+ * @param uint64_t hash
+ * @returns int: 0 if the hash is surely not in the table
+ */
+
+static inline int bloomTest(const RIB_bsl_t* table, uint64_t hash) {
+  const uint64_t* bits = (const uint64_t*) ((const char*) table + table->bloomOffset);
+  uint64_t bit = hash & table->bloomMask;
+  if ((bits[bit >> 6] & ((uint64_t) 1 << (bit & 63))) == 0) {
+    return 0;
+  }
+  bit = (hash >> 32) & table->bloomMask;
+  return (bits[bit >> 6] & ((uint64_t) 1 << (bit & 63))) != 0;
+}
+
+/**
+ * @function levelFind
+ * @description find the slot of the provided key in a level; returns the first free slot if the key is not in the level
+ * @param const RIB_bsl_t*
+ * @param uint32_t level
+ * @param const RIB_prefix_t* key (already masked to the level length)
+ * @param uint64_t hash
+ * @returns RIB_bsl_entry_t*
+ */
+
+static inline RIB_bsl_entry_t* levelFind(const RIB_bsl_t* table, uint32_t level, const RIB_prefix_t* key, uint64_t hash) {
+  RIB_bsl_entry_t* entries = levelEntries(table, level);
+  const uint32_t mask = table->level[level].mask;
+  uint32_t slot = (uint32_t) hash & mask;
+  while (entries[slot].flags != RIB_BSL_EMPTY) {
+    if (entries[slot].hi == key->hi && entries[slot].lo == key->lo) {
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return &entries[slot];
+}
+
+/**
+ * @function RIB_bsl_build
+ * @description build a binary search on prefix lengths table from the routes of the provided ip version
+ * @param Route** routes
+ * @param size_t entries
+ * @param int ipv
+ * @param int bloomFilter: if not 0, a bloom filter is used to skip empty probes
+ * @param RIB_hugepage_mode_t hugePages
+ * @param RIB_bsl_t** table: built table; NULL if there are no routes for ipv
+ * @param Route*** nexthops: routes referenced by the table entries
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_bsl_build(Route** routes, size_t entries, int ipv, int bloomFilter, RIB_hugepage_mode_t hugePages, RIB_bsl_t** table, Route*** nexthops) {
+  *table = NULL;
+  *nexthops = NULL;
+  //Collect prefixes of the requested family
+  RIB_prefix_t* prefixes = (RIB_prefix_t*) malloc(sizeof(RIB_prefix_t) * (entries + 1));
+  Route** tableRoutes = (Route**) malloc(sizeof(Route*) * (entries + 1));
+  if (prefixes == NULL || tableRoutes == NULL) {
+    free(prefixes);
+    free(tableRoutes);
+    return RIB_BAD_ALLOC;
+  }
+  size_t count = 0;
+  int present[129] = {0};
+  for (size_t i = 0; i < entries; i++) {
+    if (routes[i]->ipv != ipv || RIB_prefix_from_route(routes[i], &prefixes[count]) != 0) {
+      continue;
+    }
+    present[prefixes[count].length] = 1;
+    tableRoutes[count++] = routes[i];
+  }
+  if (count == 0) {
+    free(prefixes);
+    free(tableRoutes);
+    return RIB_NO_ERROR;
+  }
+  //Sort populated lengths
+  uint32_t lengths[129];
+  int position[129];
+  uint32_t levels = 0;
+  for (int l = 0; l <= 128; l++) {
+    position[l] = -1;
+    if (present[l]) {
+      position[l] = (int) levels;
+      lengths[levels++] = (uint32_t) l;
+    }
+  }
+  //Count the entries of each level (prefix + markers on its binary search path)
+  uint64_t levelCount[129] = {0};
+  for (size_t i = 0; i < count; i++) {
+    const int target = position[prefixes[i].length];
+    int lo = 0;
+    int hi = (int) levels - 1;
+    while (lo <= hi) {
+      const int mid = (lo + hi) / 2;
+      levelCount[mid]++;
+      if (mid == target) {
+        break;
+      } else if (mid < target) {
+        lo = mid + 1;
+      } else {
+        hi = mid - 1;
+      }
+    }
+  }
+  //Compute layout
+  uint64_t size = (sizeof(RIB_bsl_t) + BSL_ALIGN - 1) & ~((uint64_t) BSL_ALIGN - 1);
+  uint64_t offsets[129];
+  uint64_t totalEntries = 0;
+  for (uint32_t l = 0; l < levels; l++) {
+    const uint64_t capacity = nextPowerOfTwo(levelCount[l] * 2);
+    offsets[l] = size;
+    levelCount[l] = capacity;
+    totalEntries += capacity;
+    size += (capacity * sizeof(RIB_bsl_entry_t) + BSL_ALIGN - 1) & ~((uint64_t) BSL_ALIGN - 1);
+  }
+  uint64_t bloomBits = 0;
+  uint64_t bloomOffset = size;
+  if (bloomFilter) {
+    bloomBits = nextPowerOfTwo(totalEntries / 2 * BSL_BLOOM_BITS_PER_ENTRY);
+    if (bloomBits < 512) {
+      bloomBits = 512;
+    }
+    size += bloomBits / 8;
+  }
+  RIB_bsl_t* newTable = (RIB_bsl_t*) RIB_table_alloc(size, hugePages);
+  if (newTable == NULL) {
+    free(prefixes);
+    free(tableRoutes);
+    return RIB_BAD_ALLOC;
+  }
+  newTable->size = size;
+  newTable->levels = levels;
+  newTable->routes = (uint32_t) count;
+  newTable->bloomMask = bloomBits > 0 ? bloomBits - 1 : 0;
+  newTable->bloomOffset = bloomOffset;
+  for (uint32_t l = 0; l < levels; l++) {
+    newTable->level[l].length = lengths[l];
+    newTable->level[l].mask = (uint32_t) (levelCount[l] - 1);
+    newTable->level[l].offset = offsets[l];
+  }
+  //Insert prefixes; in case of duplicates the first route wins
+  for (size_t i = 0; i < count; i++) {
+    RIB_prefix_t* key = &prefixes[i];
+    RIB_bsl_entry_t* entry = levelFind(newTable, (uint32_t) position[key->length], key, RIB_prefix_hash(key));
+    if (entry->flags & RIB_BSL_PREFIX) {
+      continue;
+    }
+    entry->hi = key->hi;
+    entry->lo = key->lo;
+    entry->bmp = (uint32_t) i;
+    entry->flags |= RIB_BSL_PREFIX;
+  }
+  //Insert markers on the binary search path of each prefix
+  for (size_t i = 0; i < count; i++) {
+    const int target = position[prefixes[i].length];
+    int lo = 0;
+    int hi = (int) levels - 1;
+    while (lo <= hi) {
+      const int mid = (lo + hi) / 2;
+      if (mid >= target) {
+        //Search goes left (or it is the prefix itself): no marker needed
+        if (mid == target) {
+          break;
+        }
+        hi = mid - 1;
+        continue;
+      }
+      RIB_prefix_t marker = prefixes[i];
+      RIB_prefix_mask(&marker, (int) lengths[mid]);
+      RIB_bsl_entry_t* entry = levelFind(newTable, (uint32_t) mid, &marker, RIB_prefix_hash(&marker));
+      if (entry->flags == RIB_BSL_EMPTY) {
+        entry->hi = marker.hi;
+        entry->lo = marker.lo;
+        entry->bmp = RIB_BSL_NONE;
+      }
+      entry->flags |= RIB_BSL_MARKER;
+      lo = mid + 1;
+    }
+  }
+  //Precompute the best matching prefix of markers which are not prefixes themselves
+  for (uint32_t l = 0; l < levels; l++) {
+    RIB_bsl_entry_t* levelEntry = levelEntries(newTable, l);
+    for (uint64_t s = 0; s < levelCount[l]; s++) {
+      RIB_bsl_entry_t* entry = &levelEntry[s];
+      if (entry->flags != RIB_BSL_MARKER) {
+        continue;
+      }
+      for (int shorter = (int) l - 1; shorter >= 0; shorter--) {
+        RIB_prefix_t key = {entry->hi, entry->lo, (int) lengths[l]};
+        RIB_prefix_mask(&key, (int) lengths[shorter]);
+        RIB_bsl_entry_t* candidate = levelFind(newTable, (uint32_t) shorter, &key, RIB_prefix_hash(&key));
+        if (candidate->flags & RIB_BSL_PREFIX) {
+          entry->bmp = candidate->bmp;
+          break;
+        }
+      }
+    }
+  }
+  //Fill bloom filter
+  if (bloomFilter) {
+    for (uint32_t l = 0; l < levels; l++) {
+      RIB_bsl_entry_t* levelEntry = levelEntries(newTable, l);
+      for (uint64_t s = 0; s < levelCount[l]; s++) {
+        if (levelEntry[s].flags != RIB_BSL_EMPTY) {
+          RIB_prefix_t key = {levelEntry[s].hi, levelEntry[s].lo, (int) lengths[l]};
+          bloomSet(newTable, RIB_prefix_hash(&key));
+        }
+      }
+    }
+  }
+  free(prefixes);
+  *table = newTable;
+  *nexthops = tableRoutes;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_bsl_lookup
+ * @description find the longest prefix matching the provided address
+ * @param const RIB_bsl_t* table
+ * @param const RIB_prefix_t* address
+ * @returns uint32_t: index of the matched route; RIB_BSL_NONE if there is no match
+ */
+
+uint32_t RIB_bsl_lookup(const RIB_bsl_t* table, const RIB_prefix_t* address) {
+  uint32_t best = RIB_BSL_NONE;
+  if (table == NULL) {
+    return best;
+  }
+  int lo = 0;
+  int hi = (int) table->levels - 1;
+  while (lo <= hi) {
+    const int mid = (lo + hi) / 2;
+    RIB_prefix_t key = *address;
+    RIB_prefix_mask(&key, (int) table->level[mid].length);
+    const uint64_t hash = RIB_prefix_hash(&key);
+    //Skip the probe if the bloom filter says the key can't be there
+    if (table->bloomMask != 0 && !bloomTest(table, hash)) {
+      hi = mid - 1;
+      continue;
+    }
+    const RIB_bsl_entry_t* entry = levelFind(table, (uint32_t) mid, &key, hash);
+    if (entry->flags != RIB_BSL_EMPTY) {
+      if (entry->bmp != RIB_BSL_NONE) {
+        best = entry->bmp;
+      }
+      lo = mid + 1;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return best;
+}
+
+/**
+ * @function RIB_bsl_free
+ * @description free a binary search on prefix lengths table
+ * @param RIB_bsl_t*
+ */
+
+void RIB_bsl_free(RIB_bsl_t* table) {
+  RIB_table_free(table);
+}
@@ -0,0 +1,77 @@
+/**
+ *   librib - bsl.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef RIB_BSL_H
+#define RIB_BSL_H
+
+#include "prefix.h"
+
+#include <rib/rib.h>
+
+#include <stdint.h>
+
+/**
+ * Binary search on prefix lengths (Waldvogel et al.)
+ * The table keeps an hash table for each populated prefix length; markers are inserted on the
+ * binary search path of each prefix and carry the best matching prefix, so a lookup takes
+ * about log2(#lengths) hash probes.
+ * The whole table is stored in a single block; entries reference routes by index.
+ */
+
+#define RIB_BSL_NONE 0xFFFFFFFF
+
+#define RIB_BSL_EMPTY 0x00
+#define RIB_BSL_PREFIX 0x01
+#define RIB_BSL_MARKER 0x02
+
+// Data types
+
+typedef struct RIB_bsl_entry_t {
+  uint64_t hi;
+  uint64_t lo;
+  uint32_t bmp;   //Index of the best matching prefix; RIB_BSL_NONE if there is none
+  uint32_t flags; //RIB_BSL_PREFIX and/or RIB_BSL_MARKER; RIB_BSL_EMPTY if the slot is free
+} RIB_bsl_entry_t;
+
+typedef struct RIB_bsl_level_t {
+  uint32_t length;
+  uint32_t mask;   //Hash table capacity - 1
+  uint64_t offset; //Offset of the level entries from the beginning of the table
+} RIB_bsl_level_t;
+
+typedef struct RIB_bsl_t {
+  uint64_t size;        //Size of the table in bytes
+  uint32_t levels;
+  uint32_t routes;
+  uint64_t bloomMask;   //Bloom filter bits - 1; 0 if the bloom filter is disabled
+  uint64_t bloomOffset;
+  RIB_bsl_level_t level[129];
+} RIB_bsl_t;
+
+// Functions
+
+RIB_ret_code_t RIB_bsl_build(Route** routes, size_t entries, int ipv, int bloomFilter, RIB_hugepage_mode_t hugePages, RIB_bsl_t** table, Route*** nexthops);
+uint32_t RIB_bsl_lookup(const RIB_bsl_t* table, const RIB_prefix_t* address);
+void RIB_bsl_free(RIB_bsl_t* table);
+
+#endif
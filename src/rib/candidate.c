@@ -0,0 +1,249 @@
+/**
+ *   librib - candidate.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include "candidate.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @function better
+ * @description returns whether a candidate is preferred to another one
+ * @param const RIB_candidate_t*
+ * @param const RIB_candidate_t*
+ * @returns int
+ */
+
+static inline int better(const RIB_candidate_t* a, const RIB_candidate_t* b) {
+  if (a->distance != b->distance) {
+    return a->distance < b->distance;
+  }
+  if (a->metric != b->metric) {
+    return a->metric < b->metric;
+  }
+  return a->sequence < b->sequence;
+}
+
+/**
+ * @function place
+ * @description store a candidate in a position of the heap
+ * @param RIB_candidates_t*
+ * @param RIB_candidate_t*
+ * @param size_t position
+ */
+
+static inline void place(RIB_candidates_t* candidates, RIB_candidate_t* candidate, size_t position) {
+  candidates->heap[position] = candidate;
+  candidate->position = position;
+}
+
+/**
+ * @function siftUp
+ * @description move a candidate up in the heap until its parent is better
+ * @param RIB_candidates_t*
+ * @param size_t position
+ */
+
+static void siftUp(RIB_candidates_t* candidates, size_t position) {
+  RIB_candidate_t* candidate = candidates->heap[position];
+  while (position > 0) {
+    size_t parent = (position - 1) / 2;
+    if (!better(candidate, candidates->heap[parent])) {
+      break;
+    }
+    place(candidates, candidates->heap[parent], position);
+    position = parent;
+  }
+  place(candidates, candidate, position);
+}
+
+/**
+ * @function siftDown
+ * @description move a candidate down in the heap until it's better than its children
+ * @param RIB_candidates_t*
+ * @param size_t position
+ */
+
+static void siftDown(RIB_candidates_t* candidates, size_t position) {
+  RIB_candidate_t* candidate = candidates->heap[position];
+  for (;;) {
+    size_t child = position * 2 + 1;
+    if (child >= candidates->count) {
+      break;
+    }
+    if (child + 1 < candidates->count && better(candidates->heap[child + 1], candidates->heap[child])) {
+      child++;
+    }
+    if (!better(candidates->heap[child], candidate)) {
+      break;
+    }
+    place(candidates, candidates->heap[child], position);
+    position = child;
+  }
+  place(candidates, candidate, position);
+}
+
+/**
+ * @function findCandidate
+ * @description find the candidate of a source
+ * @param const RIB_candidates_t*
+ * @param int distance
+ * @returns RIB_candidate_t*: NULL if the source has no candidate
+ */
+
+static RIB_candidate_t* findCandidate(const RIB_candidates_t* candidates, int distance) {
+  //Prefixes have a handful of sources at most
+  for (size_t i = 0; i < candidates->count; i++) {
+    if (candidates->heap[i]->distance == distance) {
+      return candidates->heap[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @function freeCandidate
+ * @description free a candidate
+ * @param RIB_candidate_t*
+ */
+
+static void freeCandidate(RIB_candidate_t* candidate) {
+  free(candidate->gateway);
+  free(candidate->iface);
+  free(candidate);
+}
+
+/**
+ * @function RIB_candidates_create
+ * @description allocate an empty set of candidates
+ * @param RIB_candidates_t** candidates
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_candidates_create(RIB_candidates_t** candidates) {
+  *candidates = (RIB_candidates_t*) calloc(1, sizeof(RIB_candidates_t));
+  return *candidates != NULL ? RIB_NO_ERROR : RIB_BAD_ALLOC;
+}
+
+/**
+ * @function RIB_candidates_free
+ * @description free a set of candidates; NULL is allowed
+ * @param RIB_candidates_t* candidates
+ */
+
+void RIB_candidates_free(RIB_candidates_t* candidates) {
+  if (candidates == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < candidates->count; i++) {
+    freeCandidate(candidates->heap[i]);
+  }
+  free(candidates->heap);
+  free(candidates);
+}
+
+/**
+ * @function RIB_candidates_set
+ * @description add the candidate of a source, or replace it if the source has already one
+ * @param RIB_candidates_t* candidates
+ * @param int distance: admin distance of the source
+ * @param int metric
+ * @param const char* gateway: formatted gateway
+ * @param const char* iface
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_candidates_set(RIB_candidates_t* candidates, int distance, int metric, const char* gateway, const char* iface) {
+  char* newGateway = strdup(gateway);
+  char* newIface = strdup(iface);
+  if (newGateway == NULL || newIface == NULL) {
+    free(newGateway);
+    free(newIface);
+    return RIB_BAD_ALLOC;
+  }
+  RIB_candidate_t* candidate = findCandidate(candidates, distance);
+  if (candidate != NULL) {
+    free(candidate->gateway);
+    free(candidate->iface);
+    candidate->gateway = newGateway;
+    candidate->iface = newIface;
+    const int oldMetric = candidate->metric;
+    candidate->metric = metric;
+    if (metric < oldMetric) {
+      siftUp(candidates, candidate->position);
+    } else if (metric > oldMetric) {
+      siftDown(candidates, candidate->position);
+    }
+    return RIB_NO_ERROR;
+  }
+  if (candidates->count == candidates->size) {
+    size_t size = candidates->size > 0 ? candidates->size * 2 : 4;
+    RIB_candidate_t** heap = (RIB_candidate_t**) realloc(candidates->heap, sizeof(RIB_candidate_t*) * size);
+    if (heap == NULL) {
+      free(newGateway);
+      free(newIface);
+      return RIB_BAD_ALLOC;
+    }
+    candidates->heap = heap;
+    candidates->size = size;
+  }
+  candidate = (RIB_candidate_t*) malloc(sizeof(RIB_candidate_t));
+  if (candidate == NULL) {
+    free(newGateway);
+    free(newIface);
+    return RIB_BAD_ALLOC;
+  }
+  candidate->distance = distance;
+  candidate->metric = metric;
+  candidate->gateway = newGateway;
+  candidate->iface = newIface;
+  candidate->sequence = candidates->sequence++;
+  place(candidates, candidate, candidates->count++);
+  siftUp(candidates, candidate->position);
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_candidates_withdraw
+ * @description remove the candidate of a source
+ * @param RIB_candidates_t* candidates
+ * @param int distance: admin distance of the source
+ * @returns int: 0 if removed; 1 if the source has no candidate
+ */
+
+int RIB_candidates_withdraw(RIB_candidates_t* candidates, int distance) {
+  RIB_candidate_t* candidate = findCandidate(candidates, distance);
+  if (candidate == NULL) {
+    return 1;
+  }
+  const size_t position = candidate->position;
+  RIB_candidate_t* last = candidates->heap[--candidates->count];
+  freeCandidate(candidate);
+  if (position == candidates->count) {
+    return 0;
+  }
+  place(candidates, last, position);
+  siftUp(candidates, position);
+  siftDown(candidates, last->position);
+  return 0;
+}
@@ -0,0 +1,73 @@
+/**
+ *   librib - candidate.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef RIB_CANDIDATE_H
+#define RIB_CANDIDATE_H
+
+#include <rib/rib.h>
+
+#include <stdint.h>
+
+/**
+ * Candidate routes of a prefix, fed by different sources (static, OSPF, BGP...).
+ * Candidates are kept in a binary min heap ordered by (admin distance, metric); ties are won by the older candidate,
+ * so that an equal path never replaces the active one. Each source has its own admin distance, which identifies its candidate.
+ */
+
+// Data types
+
+typedef struct RIB_candidate_t {
+  int distance;
+  int metric;
+  char* gateway; //Formatted
+  char* iface;
+  uint64_t sequence; //Insertion order, to break ties
+  size_t position;   //Position in the heap
+} RIB_candidate_t;
+
+typedef struct RIB_candidates_t {
+  RIB_candidate_t** heap;
+  size_t count;
+  size_t size;
+  uint64_t sequence;
+} RIB_candidates_t;
+
+// Functions
+
+RIB_ret_code_t RIB_candidates_create(RIB_candidates_t** candidates);
+void RIB_candidates_free(RIB_candidates_t* candidates);
+RIB_ret_code_t RIB_candidates_set(RIB_candidates_t* candidates, int distance, int metric, const char* gateway, const char* iface);
+int RIB_candidates_withdraw(RIB_candidates_t* candidates, int distance);
+
+/**
+ * @function RIB_candidates_best
+ * @description returns the best candidate
+ * @param const RIB_candidates_t*
+ * @returns const RIB_candidate_t*: NULL if there are no candidates
+ */
+
+static inline const RIB_candidate_t* RIB_candidates_best(const RIB_candidates_t* candidates) {
+  return candidates->count > 0 ? candidates->heap[0] : NULL;
+}
+
+#endif
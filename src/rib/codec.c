@@ -0,0 +1,687 @@
+/**
+ *   librib - codec.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+
+#include "codec.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RIB_CODEC_HEADER 8
+#define RIB_CODEC_MIN_SLOTS 1024
+
+/**
+ * @function crcInit
+ * @description fill the lookup table of the CRC-32 (IEEE 802.3, reflected)
+ * @param uint32_t* table: 256 entries
+ */
+
+static void crcInit(uint32_t* table) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1)));
+    }
+    table[i] = crc;
+  }
+}
+
+/**
+ * @function crcUpdate
+ * @description continue a CRC-32 over a buffer
+ * @param const uint32_t* table
+ * @param uint32_t crc: value returned by the previous call; 0 to start
+ * @param const unsigned char* data
+ * @param size_t length
+ * @returns uint32_t
+ */
+
+static uint32_t crcUpdate(const uint32_t* table, uint32_t crc, const unsigned char* data, size_t length) {
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+/**
+ * @function reserve
+ * @description make room for more bytes in a buffer
+ * @param RIB_buffer_t* buffer
+ * @param size_t extra
+ * @returns int: 0 if succeeded
+ */
+
+static int reserve(RIB_buffer_t* buffer, size_t extra) {
+  if (buffer->length + extra <= buffer->size) {
+    return 0;
+  }
+  size_t size = buffer->size > 0 ? buffer->size : 4096;
+  while (size < buffer->length + extra) {
+    size *= 2;
+  }
+  unsigned char* data = (unsigned char*) realloc(buffer->data, size);
+  if (data == NULL) {
+    return 1;
+  }
+  buffer->data = data;
+  buffer->size = size;
+  return 0;
+}
+
+/**
+ * @function putVarint
+ * @description append a 128 bits unsigned number, 7 bits per byte (least significant first); room must be reserved (19 bytes)
+ * @param RIB_buffer_t* buffer
+ * @param uint64_t hi
+ * @param uint64_t lo
+ */
+
+static inline void putVarint(RIB_buffer_t* buffer, uint64_t hi, uint64_t lo) {
+  unsigned char* ptr = buffer->data + buffer->length;
+  while (hi != 0 || lo >= 0x80) {
+    *ptr++ = (unsigned char) (lo | 0x80);
+    lo = (lo >> 7) | (hi << 57);
+    hi >>= 7;
+  }
+  *ptr++ = (unsigned char) lo;
+  buffer->length = ptr - buffer->data;
+}
+
+/**
+ * @function getVarint
+ * @description read a 128 bits unsigned number written by putVarint
+ * @param const RIB_buffer_t* buffer
+ * @param size_t* position: moved after the number
+ * @param uint64_t* hi (may be NULL if the number must fit in 64 bits)
+ * @param uint64_t* lo
+ * @returns int: 0 if succeeded; 1 if the number is truncated or too large
+ */
+
+static inline int getVarint(const RIB_buffer_t* buffer, size_t* position, uint64_t* hi, uint64_t* lo) {
+  uint64_t high = 0;
+  uint64_t low = 0;
+  const int maxShift = hi != NULL ? 127 : 63;
+  for (int shift = 0; shift <= maxShift; shift += 7) {
+    if (*position >= buffer->length) {
+      return 1;
+    }
+    const uint64_t byte = buffer->data[(*position)++];
+    const uint64_t bits = byte & 0x7F;
+    if (shift < 64) {
+      low |= bits << shift;
+      high |= shift > 57 ? bits >> (64 - shift) : 0;
+    } else {
+      high |= bits << (shift - 64);
+    }
+    if ((byte & 0x80) == 0) {
+      if (hi != NULL) {
+        *hi = high;
+      } else if (high != 0) {
+        return 1;
+      }
+      *lo = low;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @function writeBlock
+ * @description write a block with its CRC; the payload is the concatenation of head and body
+ * @param FILE* stream
+ * @param const uint32_t* crcTable
+ * @param RIB_block_type_t type
+ * @param const unsigned char* head
+ * @param size_t headLength
+ * @param const unsigned char* body (may be NULL)
+ * @param size_t bodyLength
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t writeBlock(FILE* stream, const uint32_t* crcTable, RIB_block_type_t type, const unsigned char* head, size_t headLength, const unsigned char* body, size_t bodyLength) {
+  const uint32_t length = (uint32_t) (headLength + bodyLength);
+  uint32_t crc = crcUpdate(crcTable, 0, head, headLength);
+  if (bodyLength > 0) {
+    crc = crcUpdate(crcTable, crc, body, bodyLength);
+  }
+  const unsigned char header[5] = {(unsigned char) type, length & 0xFF, (length >> 8) & 0xFF, (length >> 16) & 0xFF, length >> 24};
+  const unsigned char trailer[4] = {crc & 0xFF, (crc >> 8) & 0xFF, (crc >> 16) & 0xFF, crc >> 24};
+  if (fwrite(header, 1, sizeof(header), stream) != sizeof(header) || fwrite(head, 1, headLength, stream) != headLength ||
+      (bodyLength > 0 && fwrite(body, 1, bodyLength, stream) != bodyLength) || fwrite(trailer, 1, sizeof(trailer), stream) != sizeof(trailer)) {
+    return RIB_IO_ERROR;
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function nexthopHash
+ * @description FNV-1a hash of a next hop
+ * @param const unsigned char* gateway: 16 bytes
+ * @param const char* iface
+ * @returns uint64_t
+ */
+
+static uint64_t nexthopHash(const unsigned char* gateway, const char* iface) {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (int i = 0; i < 16; i++) {
+    hash = (hash ^ gateway[i]) * 0x100000001B3ULL;
+  }
+  for (const char* ptr = iface; *ptr != '\0'; ptr++) {
+    hash = (hash ^ (unsigned char) *ptr) * 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+/**
+ * @function growNexthops
+ * @description make room for one more next hop in a dictionary
+ * @param RIB_codec_nexthop_t** nexthops
+ * @param size_t count
+ * @param size_t* size
+ * @returns int: 0 if succeeded
+ */
+
+static int growNexthops(RIB_codec_nexthop_t** nexthops, size_t count, size_t* size) {
+  if (count < *size) {
+    return 0;
+  }
+  const size_t newSize = *size > 0 ? *size * 2 : 64;
+  RIB_codec_nexthop_t* grown = (RIB_codec_nexthop_t*) realloc(*nexthops, sizeof(RIB_codec_nexthop_t) * newSize);
+  if (grown == NULL) {
+    return 1;
+  }
+  *nexthops = grown;
+  *size = newSize;
+  return 0;
+}
+
+/**
+ * @function rehash
+ * @description double the hash table of the encoder dictionary
+ * @param RIB_encoder_t* encoder
+ * @returns int: 0 if succeeded
+ */
+
+static int rehash(RIB_encoder_t* encoder) {
+  const size_t slotCount = (encoder->slotMask + 1) * 2;
+  size_t* slots = (size_t*) calloc(slotCount, sizeof(size_t));
+  if (slots == NULL) {
+    return 1;
+  }
+  for (size_t i = 0; i < encoder->nexthopCount; i++) {
+    const RIB_codec_nexthop_t* nexthop = &encoder->nexthops[i];
+    size_t slot = nexthopHash(nexthop->gateway, nexthop->iface) & (slotCount - 1);
+    while (slots[slot] != 0) {
+      slot = (slot + 1) & (slotCount - 1);
+    }
+    slots[slot] = i + 1;
+  }
+  free(encoder->slots);
+  encoder->slots = slots;
+  encoder->slotMask = slotCount - 1;
+  return 0;
+}
+
+/**
+ * @function nexthopNumber
+ * @description returns the number of a next hop in the encoder dictionary, adding it if needed
+ * @param RIB_encoder_t* encoder
+ * @param const char* gateway
+ * @param const char* iface
+ * @param size_t* number
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t nexthopNumber(RIB_encoder_t* encoder, const char* gateway, const char* iface, size_t* number) {
+  unsigned char address[16] = {0};
+  const int ipv = strchr(gateway, ':') != NULL ? 6 : 4;
+  if (inet_pton(ipv == 6 ? AF_INET6 : AF_INET, gateway, address) != 1) {
+    return RIB_INVALID_ADDRESS;
+  }
+  const uint64_t hash = nexthopHash(address, iface);
+  size_t slot = hash & encoder->slotMask;
+  while (encoder->slots[slot] != 0) {
+    const RIB_codec_nexthop_t* nexthop = &encoder->nexthops[encoder->slots[slot] - 1];
+    if (nexthop->ipv == ipv && memcmp(nexthop->gateway, address, 16) == 0 && strcmp(nexthop->iface, iface) == 0) {
+      *number = encoder->slots[slot] - 1;
+      return RIB_NO_ERROR;
+    }
+    slot = (slot + 1) & encoder->slotMask;
+  }
+  if (growNexthops(&encoder->nexthops, encoder->nexthopCount, &encoder->nexthopSize) != 0) {
+    return RIB_BAD_ALLOC;
+  }
+  RIB_codec_nexthop_t* nexthop = &encoder->nexthops[encoder->nexthopCount];
+  if ((nexthop->iface = strdup(iface)) == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  memcpy(nexthop->gateway, address, 16);
+  nexthop->ipv = ipv;
+  encoder->slots[slot] = ++encoder->nexthopCount;
+  *number = encoder->nexthopCount - 1;
+  //Keep the load factor below 1/2
+  if (encoder->nexthopCount * 2 > encoder->slotMask && rehash(encoder) != 0) {
+    return RIB_BAD_ALLOC;
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function flushRoutes
+ * @description write the next hops added since the last block, then the current routes block
+ * @param RIB_encoder_t* encoder
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t flushRoutes(RIB_encoder_t* encoder) {
+  if (encoder->blockRoutes == 0) {
+    return RIB_NO_ERROR;
+  }
+  RIB_buffer_t head = {NULL, 0, 0};
+  RIB_ret_code_t rc = RIB_NO_ERROR;
+  if (encoder->written < encoder->nexthopCount) {
+    const size_t count = encoder->nexthopCount - encoder->written;
+    if (reserve(&head, 19) != 0) {
+      return RIB_BAD_ALLOC;
+    }
+    putVarint(&head, 0, count);
+    for (size_t i = encoder->written; i < encoder->nexthopCount && rc == RIB_NO_ERROR; i++) {
+      const RIB_codec_nexthop_t* nexthop = &encoder->nexthops[i];
+      const size_t ifaceLength = strlen(nexthop->iface);
+      const size_t addressLength = nexthop->ipv == 6 ? 16 : 4;
+      if (reserve(&head, 1 + addressLength + 19 + ifaceLength) != 0) {
+        rc = RIB_BAD_ALLOC;
+        break;
+      }
+      head.data[head.length++] = (unsigned char) nexthop->ipv;
+      memcpy(head.data + head.length, nexthop->gateway, addressLength);
+      head.length += addressLength;
+      putVarint(&head, 0, ifaceLength);
+      memcpy(head.data + head.length, nexthop->iface, ifaceLength);
+      head.length += ifaceLength;
+    }
+    if (rc == RIB_NO_ERROR) {
+      rc = writeBlock(encoder->stream, encoder->crcTable, RIB_BLOCK_NEXTHOPS, head.data, head.length, NULL, 0);
+    }
+    encoder->written = encoder->nexthopCount;
+  }
+  if (rc == RIB_NO_ERROR) {
+    head.length = 0;
+    if (reserve(&head, 20) != 0) {
+      rc = RIB_BAD_ALLOC;
+    } else {
+      head.data[head.length++] = (unsigned char) encoder->blockIpv;
+      putVarint(&head, 0, encoder->blockRoutes);
+      rc = writeBlock(encoder->stream, encoder->crcTable, RIB_BLOCK_ROUTES, head.data, head.length, encoder->routes.data, encoder->routes.length);
+    }
+  }
+  free(head.data);
+  encoder->routes.length = 0;
+  encoder->blockRoutes = 0;
+  return rc;
+}
+
+/**
+ * @function RIB_encoder_open
+ * @description start writing a routing table to a stream
+ * @param FILE* stream
+ * @param RIB_encoder_t** encoder
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_encoder_open(FILE* stream, RIB_encoder_t** encoder) {
+  *encoder = (RIB_encoder_t*) calloc(1, sizeof(RIB_encoder_t));
+  if (*encoder == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  (*encoder)->stream = stream;
+  (*encoder)->slots = (size_t*) calloc(RIB_CODEC_MIN_SLOTS, sizeof(size_t));
+  if ((*encoder)->slots == NULL) {
+    free(*encoder);
+    *encoder = NULL;
+    return RIB_BAD_ALLOC;
+  }
+  (*encoder)->slotMask = RIB_CODEC_MIN_SLOTS - 1;
+  crcInit((*encoder)->crcTable);
+  const unsigned char header[RIB_CODEC_HEADER] = {'R', 'I', 'B', 'T', RIB_CODEC_VERSION, 0, 0, 0};
+  if (fwrite(header, 1, sizeof(header), stream) != sizeof(header)) {
+    free((*encoder)->slots);
+    free(*encoder);
+    *encoder = NULL;
+    return RIB_IO_ERROR;
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_encoder_add
+ * @description encode a route; routes should be added in prefix order (e.g. with RIB_iter_walk) for the best compression
+ * @param RIB_encoder_t* encoder
+ * @param const Route* route
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_encoder_add(RIB_encoder_t* encoder, const Route* route) {
+  RIB_prefix_t prefix;
+  if (RIB_prefix_from_route(route, &prefix) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  RIB_ret_code_t rc;
+  //Deltas are unsigned: a route out of order starts a new block
+  const int outOfOrder = prefix.hi < encoder->previous.hi || (prefix.hi == encoder->previous.hi && prefix.lo < encoder->previous.lo);
+  if (encoder->blockRoutes > 0 && (route->ipv != encoder->blockIpv || outOfOrder || encoder->blockRoutes == RIB_CODEC_BLOCK_ROUTES)) {
+    if ((rc = flushRoutes(encoder)) != RIB_NO_ERROR) {
+      return rc;
+    }
+  }
+  size_t nexthop;
+  if ((rc = nexthopNumber(encoder, route->gateway, route->iface, &nexthop)) != RIB_NO_ERROR) {
+    return rc;
+  }
+  if (encoder->blockRoutes == 0) {
+    encoder->blockIpv = route->ipv;
+    encoder->previous.hi = 0;
+    encoder->previous.lo = 0;
+  }
+  if (reserve(&encoder->routes, 1 + 19 + 10 + 10) != 0) {
+    return RIB_BAD_ALLOC;
+  }
+  RIB_buffer_t* routes = &encoder->routes;
+  routes->data[routes->length++] = (unsigned char) prefix.length;
+  if (route->ipv == 4) {
+    putVarint(routes, 0, (prefix.hi - encoder->previous.hi) >> 32);
+  } else {
+    const uint64_t lo = prefix.lo - encoder->previous.lo;
+    putVarint(routes, prefix.hi - encoder->previous.hi - (prefix.lo < encoder->previous.lo), lo);
+  }
+  putVarint(routes, 0, nexthop);
+  const int64_t metric = route->metric;
+  putVarint(routes, 0, ((uint64_t) metric << 1) ^ (uint64_t) (metric >> 63));
+  encoder->previous = prefix;
+  encoder->blockRoutes++;
+  encoder->total++;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_encoder_close
+ * @description write the pending routes and the end of the table, then free the encoder (the stream is not closed)
+ * @param RIB_encoder_t* encoder
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_encoder_close(RIB_encoder_t* encoder) {
+  RIB_ret_code_t rc = flushRoutes(encoder);
+  if (rc == RIB_NO_ERROR) {
+    unsigned char data[19];
+    RIB_buffer_t end = {data, 0, sizeof(data)};
+    putVarint(&end, 0, encoder->total);
+    rc = writeBlock(encoder->stream, encoder->crcTable, RIB_BLOCK_END, end.data, end.length, NULL, 0);
+  }
+  if (rc == RIB_NO_ERROR && fflush(encoder->stream) != 0) {
+    rc = RIB_IO_ERROR;
+  }
+  for (size_t i = 0; i < encoder->nexthopCount; i++) {
+    free(encoder->nexthops[i].iface);
+  }
+  free(encoder->nexthops);
+  free(encoder->slots);
+  free(encoder->routes.data);
+  free(encoder);
+  return rc;
+}
+
+/**
+ * @function RIB_decoder_open
+ * @description start reading a routing table from a stream
+ * @param FILE* stream
+ * @param RIB_decoder_t** decoder
+ * @returns RIB_ret_code_t: RIB_IO_ERROR if the stream doesn't contain a routing table
+ */
+
+RIB_ret_code_t RIB_decoder_open(FILE* stream, RIB_decoder_t** decoder) {
+  unsigned char header[RIB_CODEC_HEADER];
+  *decoder = NULL;
+  if (fread(header, 1, sizeof(header), stream) != sizeof(header) || memcmp(header, RIB_CODEC_MAGIC, 4) != 0 || header[4] != RIB_CODEC_VERSION) {
+    return RIB_IO_ERROR;
+  }
+  *decoder = (RIB_decoder_t*) calloc(1, sizeof(RIB_decoder_t));
+  if (*decoder == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  (*decoder)->stream = stream;
+  crcInit((*decoder)->crcTable);
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function formatIpv4
+ * @description write an ipv4 address in dotted notation (faster than inet_ntop on the decoding path)
+ * @param uint32_t address
+ * @param char* buffer: at least INET_ADDRSTRLEN bytes
+ */
+
+static void formatIpv4(uint32_t address, char* buffer) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    unsigned int octet = (address >> shift) & 0xFF;
+    if (octet >= 100) {
+      *buffer++ = (char) ('0' + octet / 100);
+      octet %= 100;
+      *buffer++ = (char) ('0' + octet / 10);
+    } else if (octet >= 10) {
+      *buffer++ = (char) ('0' + octet / 10);
+    }
+    *buffer++ = (char) ('0' + octet % 10);
+    *buffer++ = shift > 0 ? '.' : '\0';
+  }
+}
+
+/**
+ * @function readNexthops
+ * @description add the next hops of a block to the decoder dictionary
+ * @param RIB_decoder_t* decoder
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t readNexthops(RIB_decoder_t* decoder) {
+  const RIB_buffer_t* block = &decoder->block;
+  size_t position = 0;
+  uint64_t count;
+  if (getVarint(block, &position, NULL, &count) != 0) {
+    return RIB_IO_ERROR;
+  }
+  for (uint64_t i = 0; i < count; i++) {
+    if (growNexthops(&decoder->nexthops, decoder->nexthopCount, &decoder->nexthopSize) != 0) {
+      return RIB_BAD_ALLOC;
+    }
+    RIB_codec_nexthop_t* nexthop = &decoder->nexthops[decoder->nexthopCount];
+    if (position >= block->length || (block->data[position] != 4 && block->data[position] != 6)) {
+      return RIB_IO_ERROR;
+    }
+    nexthop->ipv = block->data[position++];
+    const size_t addressLength = nexthop->ipv == 6 ? 16 : 4;
+    uint64_t ifaceLength;
+    if (position + addressLength > block->length) {
+      return RIB_IO_ERROR;
+    }
+    memcpy(nexthop->gateway, block->data + position, addressLength);
+    position += addressLength;
+    if (getVarint(block, &position, NULL, &ifaceLength) != 0 || ifaceLength > block->length - position) {
+      return RIB_IO_ERROR;
+    }
+    if ((nexthop->iface = (char*) malloc(ifaceLength + 1)) == NULL) {
+      return RIB_BAD_ALLOC;
+    }
+    memcpy(nexthop->iface, block->data + position, ifaceLength);
+    nexthop->iface[ifaceLength] = '\0';
+    position += ifaceLength;
+    inet_ntop(nexthop->ipv == 6 ? AF_INET6 : AF_INET, nexthop->gateway, nexthop->address, sizeof(nexthop->address));
+    decoder->nexthopCount++;
+  }
+  return position == block->length ? RIB_NO_ERROR : RIB_IO_ERROR;
+}
+
+/**
+ * @function readBlock
+ * @description read the next block and check its CRC
+ * @param RIB_decoder_t* decoder
+ * @param RIB_block_type_t* type
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t readBlock(RIB_decoder_t* decoder, RIB_block_type_t* type) {
+  unsigned char header[5];
+  unsigned char trailer[4];
+  if (fread(header, 1, sizeof(header), decoder->stream) != sizeof(header)) {
+    return RIB_IO_ERROR;
+  }
+  const uint32_t length = header[1] | ((uint32_t) header[2] << 8) | ((uint32_t) header[3] << 16) | ((uint32_t) header[4] << 24);
+  if (length > RIB_CODEC_MAX_BLOCK) {
+    return RIB_IO_ERROR;
+  }
+  decoder->block.length = 0;
+  if (reserve(&decoder->block, length) != 0) {
+    return RIB_BAD_ALLOC;
+  }
+  if (fread(decoder->block.data, 1, length, decoder->stream) != length || fread(trailer, 1, sizeof(trailer), decoder->stream) != sizeof(trailer)) {
+    return RIB_IO_ERROR;
+  }
+  decoder->block.length = length;
+  const uint32_t crc = trailer[0] | ((uint32_t) trailer[1] << 8) | ((uint32_t) trailer[2] << 16) | ((uint32_t) trailer[3] << 24);
+  if (crcUpdate(decoder->crcTable, 0, decoder->block.data, length) != crc) {
+    return RIB_IO_ERROR;
+  }
+  *type = (RIB_block_type_t) header[0];
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_decoder_next
+ * @description decode the next route; strings of the route are valid until the next call
+ * @param RIB_decoder_t* decoder
+ * @param RIB_decoded_route_t* route
+ * @param int* end: set to 1 at the end of the table
+ * @returns RIB_ret_code_t: RIB_IO_ERROR if the file is truncated or corrupted
+ */
+
+RIB_ret_code_t RIB_decoder_next(RIB_decoder_t* decoder, RIB_decoded_route_t* route, int* end) {
+  *end = 0;
+  RIB_ret_code_t rc;
+  while (decoder->blockRoutes == 0) {
+    if (decoder->block.length != decoder->position) {
+      return RIB_IO_ERROR;
+    }
+    RIB_block_type_t type;
+    if ((rc = readBlock(decoder, &type)) != RIB_NO_ERROR) {
+      return rc;
+    }
+    decoder->position = decoder->block.length;
+    if (type == RIB_BLOCK_NEXTHOPS) {
+      if ((rc = readNexthops(decoder)) != RIB_NO_ERROR) {
+        return rc;
+      }
+    } else if (type == RIB_BLOCK_ROUTES) {
+      uint64_t count;
+      size_t position = 1;
+      if (decoder->block.length < 1 || (decoder->block.data[0] != 4 && decoder->block.data[0] != 6) ||
+          getVarint(&decoder->block, &position, NULL, &count) != 0 || count == 0) {
+        return RIB_IO_ERROR;
+      }
+      decoder->blockIpv = decoder->block.data[0];
+      decoder->blockRoutes = count;
+      decoder->position = position;
+      decoder->previous.hi = 0;
+      decoder->previous.lo = 0;
+    } else if (type == RIB_BLOCK_END) {
+      uint64_t total;
+      size_t position = 0;
+      if (getVarint(&decoder->block, &position, NULL, &total) != 0 || total != decoder->total) {
+        return RIB_IO_ERROR;
+      }
+      *end = 1;
+      return RIB_NO_ERROR;
+    } else {
+      return RIB_IO_ERROR;
+    }
+  }
+  const RIB_buffer_t* block = &decoder->block;
+  const int ipv = decoder->blockIpv;
+  if (decoder->position >= block->length) {
+    return RIB_IO_ERROR;
+  }
+  RIB_prefix_t prefix;
+  prefix.length = block->data[decoder->position++];
+  uint64_t hi;
+  uint64_t lo;
+  uint64_t nexthop;
+  uint64_t metric;
+  if (prefix.length > RIB_prefix_max_length(ipv) || getVarint(block, &decoder->position, ipv == 6 ? &hi : NULL, &lo) != 0 ||
+      getVarint(block, &decoder->position, NULL, &nexthop) != 0 || getVarint(block, &decoder->position, NULL, &metric) != 0 ||
+      nexthop >= decoder->nexthopCount) {
+    return RIB_IO_ERROR;
+  }
+  if (ipv == 4) {
+    prefix.hi = decoder->previous.hi + (lo << 32);
+    prefix.lo = 0;
+  } else {
+    prefix.lo = decoder->previous.lo + lo;
+    prefix.hi = decoder->previous.hi + hi + (prefix.lo < lo);
+  }
+  decoder->previous = prefix;
+  decoder->blockRoutes--;
+  decoder->total++;
+  if (ipv == 4) {
+    formatIpv4((uint32_t) (prefix.hi >> 32), route->destination);
+    formatIpv4(prefix.length == 0 ? 0 : ~((uint32_t) 0) << (32 - prefix.length), route->netmask);
+  } else {
+    unsigned char address[16];
+    RIB_prefix_to_bytes(&prefix, ipv, address);
+    inet_ntop(AF_INET6, address, route->destination, sizeof(route->destination));
+    snprintf(route->netmask, sizeof(route->netmask), "%d", prefix.length);
+  }
+  route->ipv = ipv;
+  route->gateway = decoder->nexthops[nexthop].address;
+  route->iface = decoder->nexthops[nexthop].iface;
+  route->metric = (int) ((metric >> 1) ^ (0 - (metric & 1)));
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_decoder_free
+ * @description free a decoder (the stream is not closed); NULL is allowed
+ * @param RIB_decoder_t* decoder
+ */
+
+void RIB_decoder_free(RIB_decoder_t* decoder) {
+  if (decoder == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < decoder->nexthopCount; i++) {
+    free(decoder->nexthops[i].iface);
+  }
+  free(decoder->nexthops);
+  free(decoder->block.data);
+  free(decoder);
+}
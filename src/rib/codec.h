@@ -0,0 +1,124 @@
+/**
+ *   librib - codec.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+
+#ifndef RIB_CODEC_H
+#define RIB_CODEC_H
+
+#include "prefix.h"
+
+#include <rib/rib.h>
+
+#include <arpa/inet.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Binary routing table format
+ * File header: "RIBT", version (1 byte), 3 reserved bytes.
+ * Then a sequence of blocks: type (1 byte), payload length (4 bytes LE), payload, CRC-32 of the payload (4 bytes LE).
+ * - RIB_BLOCK_NEXTHOPS: count (varint), then for each next hop family (1 byte), gateway (4 or 16 bytes),
+ *   iface length (varint) and iface. Next hops are numbered in order of appearance in the file.
+ * - RIB_BLOCK_ROUTES: family (1 byte), count (varint), then for each route prefix length (1 byte),
+ *   network address delta from the previous route of the block (varint, 32 or 128 bits), next hop number (varint)
+ *   and metric (zigzag varint). Routes of a block are sorted by network address.
+ * - RIB_BLOCK_END: number of routes in the file (varint).
+ * The next hops used by a routes block are written before it, so the file can be decoded in a single pass.
+ */
+
+#define RIB_CODEC_MAGIC "RIBT"
+#define RIB_CODEC_VERSION 1
+#define RIB_CODEC_BLOCK_ROUTES 4096   //Max routes in a block
+#define RIB_CODEC_MAX_BLOCK 16777216  //Max payload length accepted by the decoder
+
+// Data types
+
+typedef enum RIB_block_type_t {
+  RIB_BLOCK_NEXTHOPS = 1,
+  RIB_BLOCK_ROUTES = 2,
+  RIB_BLOCK_END = 3
+} RIB_block_type_t;
+
+typedef struct RIB_buffer_t {
+  unsigned char* data;
+  size_t length;
+  size_t size;
+} RIB_buffer_t;
+
+typedef struct RIB_codec_nexthop_t {
+  unsigned char gateway[16];
+  int ipv;
+  char* iface;
+  char address[INET6_ADDRSTRLEN]; //Gateway in text form (decoder)
+} RIB_codec_nexthop_t;
+
+typedef struct RIB_encoder_t {
+  FILE* stream;
+  uint32_t crcTable[256];
+  RIB_codec_nexthop_t* nexthops; //Dictionary
+  size_t nexthopCount;
+  size_t nexthopSize;
+  size_t* slots;                 //Hash table of the dictionary (index + 1; 0 if empty)
+  size_t slotMask;
+  size_t written;                //Next hops already written to the file
+  RIB_buffer_t routes;           //Payload of the current routes block
+  size_t blockRoutes;
+  int blockIpv;
+  RIB_prefix_t previous;         //Last prefix of the block
+  size_t total;
+} RIB_encoder_t;
+
+typedef struct RIB_decoded_route_t {
+  int ipv;
+  char destination[INET6_ADDRSTRLEN];
+  char netmask[INET6_ADDRSTRLEN]; //Netmask for ipv4, prefix length for ipv6
+  const char* gateway;
+  const char* iface;
+  int metric;
+} RIB_decoded_route_t;
+
+typedef struct RIB_decoder_t {
+  FILE* stream;
+  uint32_t crcTable[256];
+  RIB_codec_nexthop_t* nexthops;
+  size_t nexthopCount;
+  size_t nexthopSize;
+  RIB_buffer_t block;            //Payload of the current routes block
+  size_t position;
+  size_t blockRoutes;            //Routes left in the block
+  int blockIpv;
+  RIB_prefix_t previous;
+  size_t total;
+} RIB_decoder_t;
+
+// Functions
+
+RIB_ret_code_t RIB_encoder_open(FILE* stream, RIB_encoder_t** encoder);
+RIB_ret_code_t RIB_encoder_add(RIB_encoder_t* encoder, const Route* route);
+RIB_ret_code_t RIB_encoder_close(RIB_encoder_t* encoder);
+RIB_ret_code_t RIB_decoder_open(FILE* stream, RIB_decoder_t** decoder);
+RIB_ret_code_t RIB_decoder_next(RIB_decoder_t* decoder, RIB_decoded_route_t* route, int* end);
+void RIB_decoder_free(RIB_decoder_t* decoder);
+
+#endif
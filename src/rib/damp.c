@@ -0,0 +1,324 @@
+/**
+ *   librib - damp.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include "damp.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define RIB_DAMP_WHEEL_TICKS 64 //Wheel ticks per half life
+
+/**
+ * Arguments of the wheel callback
+ */
+
+typedef struct RIB_damp_advance_t {
+  RIB_damp_t* damp;
+  uint64_t now;
+  RIB_damp_release_cb reuse;
+  void* context;
+  size_t reused;
+} RIB_damp_advance_t;
+
+/**
+ * @function decay
+ * @description apply the decay of the penalty since the last update
+ * @param const RIB_damp_t*
+ * @param RIB_damp_record_t*
+ * @param uint64_t now
+ */
+
+static void decay(const RIB_damp_t* damp, RIB_damp_record_t* record, uint64_t now) {
+  if (now <= record->updated) {
+    return;
+  }
+  record->penalty *= exp2(-(double) (now - record->updated) / (double) damp->params.halfLife);
+  record->updated = now;
+}
+
+/**
+ * @function reached
+ * @description returns whether a penalty has decayed to a threshold (allowing for rounding errors)
+ * @param double penalty
+ * @param double threshold
+ * @returns int
+ */
+
+static inline int reached(double penalty, double threshold) {
+  return penalty <= threshold * (1.0 + 1e-9);
+}
+
+/**
+ * @function scheduleRecord
+ * @description schedule the timer of a record when its penalty decays to the reuse threshold (suppressed)
+ *              or to half of it, when the record is forgotten
+ * @param RIB_damp_t*
+ * @param RIB_damp_record_t*
+ */
+
+static void scheduleRecord(RIB_damp_t* damp, RIB_damp_record_t* record) {
+  const double threshold = record->suppressed ? (double) damp->params.reuse : (double) damp->params.reuse / 2.0;
+  uint64_t delay = 0;
+  if (!reached(record->penalty, threshold)) {
+    delay = (uint64_t) ceil(log2(record->penalty / threshold) * (double) damp->params.halfLife);
+  }
+  RIB_wheel_schedule(&damp->wheel, &record->timer, record->updated + delay);
+}
+
+/**
+ * @function forget
+ * @description remove a record
+ * @param RIB_damp_t*
+ * @param RIB_damp_record_t*
+ */
+
+static void forget(RIB_damp_t* damp, RIB_damp_record_t* record) {
+  RIB_wheel_cancel(&damp->wheel, &record->timer);
+  RIB_ptree_remove(&damp->trees[record->ipv == 6 ? 1 : 0], &record->prefix);
+  free(record);
+}
+
+/**
+ * @function releaseRecords
+ * @description remove all the records, handing their held routes to the release callback
+ * @param RIB_damp_t*
+ * @param RIB_damp_release_cb release
+ * @param void* context
+ */
+
+static void releaseRecords(RIB_damp_t* damp, RIB_damp_release_cb release, void* context) {
+  for (size_t i = 0; i < 2; i++) {
+    RIB_ptree_t* tree = &damp->trees[i];
+    for (RIB_ptnode_t* node = tree->root; node != NULL; node = RIB_ptree_next(node, tree->root)) {
+      RIB_damp_record_t* record = (RIB_damp_record_t*) node->value;
+      if (record == NULL) {
+        continue;
+      }
+      if (record->held != NULL) {
+        release(record->held, context);
+      }
+      free(record);
+    }
+    RIB_ptree_clear(tree);
+  }
+}
+
+/**
+ * @function RIB_damp_create
+ * @description create the dampening state
+ * @param const RIB_dampening_t* params
+ * @param uint64_t now: milliseconds
+ * @param RIB_damp_t** damp
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_damp_create(const RIB_dampening_t* params, uint64_t now, RIB_damp_t** damp) {
+  *damp = (RIB_damp_t*) malloc(sizeof(RIB_damp_t));
+  if (*damp == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  RIB_ptree_init(&(*damp)->trees[0]);
+  RIB_ptree_init(&(*damp)->trees[1]);
+  RIB_wheel_init(&(*damp)->wheel, params->halfLife / RIB_DAMP_WHEEL_TICKS, now);
+  RIB_damp_configure(*damp, params, now);
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_damp_configure
+ * @description change the dampening parameters; the timers of the records are rescheduled
+ * @param RIB_damp_t*
+ * @param const RIB_dampening_t* params
+ * @param uint64_t now: milliseconds
+ */
+
+void RIB_damp_configure(RIB_damp_t* damp, const RIB_dampening_t* params, uint64_t now) {
+  damp->params = *params;
+  damp->ceiling = (double) params->reuse * exp2((double) params->maxSuppress / (double) params->halfLife);
+  for (size_t i = 0; i < 2; i++) {
+    RIB_ptree_t* tree = &damp->trees[i];
+    for (RIB_ptnode_t* node = tree->root; node != NULL; node = RIB_ptree_next(node, tree->root)) {
+      RIB_damp_record_t* record = (RIB_damp_record_t*) node->value;
+      if (record != NULL) {
+        decay(damp, record, now);
+        if (record->penalty > damp->ceiling) {
+          record->penalty = damp->ceiling;
+        }
+        scheduleRecord(damp, record);
+      }
+    }
+  }
+}
+
+/**
+ * @function RIB_damp_clear
+ * @description forget all the records
+ * @param RIB_damp_t*
+ * @param RIB_damp_release_cb release: called for each held route
+ * @param void* context: passed to the callback
+ */
+
+void RIB_damp_clear(RIB_damp_t* damp, RIB_damp_release_cb release, void* context) {
+  releaseRecords(damp, release, context);
+  RIB_wheel_init(&damp->wheel, damp->wheel.resolution, damp->wheel.tick * damp->wheel.resolution);
+}
+
+/**
+ * @function RIB_damp_free
+ * @description free the dampening state
+ * @param RIB_damp_t*
+ * @param RIB_damp_release_cb release: called for each held route
+ * @param void* context: passed to the callback
+ */
+
+void RIB_damp_free(RIB_damp_t* damp, RIB_damp_release_cb release, void* context) {
+  if (damp == NULL) {
+    return;
+  }
+  releaseRecords(damp, release, context);
+  free(damp);
+}
+
+/**
+ * @function RIB_damp_find
+ * @description returns the record of a prefix
+ * @param const RIB_damp_t*
+ * @param int ipv
+ * @param const RIB_prefix_t* prefix
+ * @returns RIB_damp_record_t*: NULL if the prefix has no penalty
+ */
+
+RIB_damp_record_t* RIB_damp_find(const RIB_damp_t* damp, int ipv, const RIB_prefix_t* prefix) {
+  RIB_ptnode_t* node = RIB_ptree_find(&damp->trees[ipv == 6 ? 1 : 0], prefix);
+  return node != NULL ? (RIB_damp_record_t*) node->value : NULL;
+}
+
+/**
+ * @function RIB_damp_penalize
+ * @description add the flap penalty to a prefix, suppressing it if the penalty exceeds the suppress threshold
+ * @param RIB_damp_t*
+ * @param int ipv
+ * @param const RIB_prefix_t* prefix
+ * @param uint64_t now: milliseconds
+ * @param RIB_damp_record_t** record: record of the prefix (may be NULL)
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_damp_penalize(RIB_damp_t* damp, int ipv, const RIB_prefix_t* prefix, uint64_t now, RIB_damp_record_t** record) {
+  RIB_damp_record_t* thisRecord = RIB_damp_find(damp, ipv, prefix);
+  if (thisRecord == NULL) {
+    thisRecord = (RIB_damp_record_t*) malloc(sizeof(RIB_damp_record_t));
+    if (thisRecord == NULL) {
+      return RIB_BAD_ALLOC;
+    }
+    thisRecord->timer.scheduled = 0;
+    thisRecord->prefix = *prefix;
+    thisRecord->ipv = ipv;
+    thisRecord->penalty = 0;
+    thisRecord->updated = now;
+    thisRecord->suppressed = 0;
+    thisRecord->held = NULL;
+    RIB_ret_code_t rc = RIB_ptree_insert(&damp->trees[ipv == 6 ? 1 : 0], prefix, thisRecord);
+    if (rc != RIB_NO_ERROR) {
+      free(thisRecord);
+      return rc;
+    }
+  }
+  decay(damp, thisRecord, now);
+  thisRecord->penalty += damp->params.penalty;
+  if (thisRecord->penalty > damp->ceiling) {
+    thisRecord->penalty = damp->ceiling;
+  }
+  if (thisRecord->penalty >= damp->params.suppress) {
+    thisRecord->suppressed = 1;
+  }
+  scheduleRecord(damp, thisRecord);
+  if (record != NULL) {
+    *record = thisRecord;
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_damp_update
+ * @description decay the penalty of a record, lifting its suppression if it's below the reuse threshold
+ *              (the caller then owns the decision on the held route)
+ * @param RIB_damp_t*
+ * @param RIB_damp_record_t*
+ * @param uint64_t now: milliseconds
+ * @returns int: whether the prefix is suppressed
+ */
+
+int RIB_damp_update(RIB_damp_t* damp, RIB_damp_record_t* record, uint64_t now) {
+  decay(damp, record, now);
+  if (record->suppressed && reached(record->penalty, damp->params.reuse)) {
+    record->suppressed = 0;
+    scheduleRecord(damp, record);
+  }
+  return record->suppressed;
+}
+
+/**
+ * @function expired
+ * @description wheel callback: reuse or forget the record of an expired timer, or reschedule it
+ * @param RIB_timer_t* timer
+ * @param void* context: RIB_damp_advance_t*
+ */
+
+static void expired(RIB_timer_t* timer, void* context) {
+  RIB_damp_advance_t* advance = (RIB_damp_advance_t*) context;
+  RIB_damp_t* damp = advance->damp;
+  RIB_damp_record_t* record = (RIB_damp_record_t*) timer; //The timer is the first member
+  decay(damp, record, advance->now);
+  if (record->suppressed && reached(record->penalty, damp->params.reuse)) {
+    record->suppressed = 0;
+    advance->reused++;
+    if (record->held != NULL) {
+      Route* held = record->held;
+      record->held = NULL;
+      advance->reuse(held, advance->context);
+    }
+  }
+  if (!record->suppressed && reached(record->penalty, damp->params.reuse / 2.0)) {
+    forget(damp, record);
+  } else {
+    scheduleRecord(damp, record);
+  }
+}
+
+/**
+ * @function RIB_damp_advance
+ * @description process the records whose timer expired up to now: suppressed prefixes whose penalty decayed below the reuse threshold
+ *              are reused, handing their held route to the callback; records with a negligible penalty are forgotten
+ * @param RIB_damp_t*
+ * @param uint64_t now: milliseconds
+ * @param RIB_damp_release_cb reuse
+ * @param void* context: passed to the callback
+ * @returns size_t: number of reused prefixes
+ */
+
+size_t RIB_damp_advance(RIB_damp_t* damp, uint64_t now, RIB_damp_release_cb reuse, void* context) {
+  RIB_damp_advance_t advance = {damp, now, reuse, context, 0};
+  RIB_wheel_advance(&damp->wheel, now, expired, &advance);
+  return advance.reused;
+}
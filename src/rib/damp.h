@@ -0,0 +1,76 @@
+/**
+ *   librib - damp.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef RIB_DAMP_H
+#define RIB_DAMP_H
+
+#include "prefix.h"
+#include "ptree.h"
+#include "wheel.h"
+
+#include <rib/rib.h>
+
+#include <stdint.h>
+
+/**
+ * Route flap dampening (RFC 2439). Each withdrawal adds a penalty to its prefix, which decays exponentially
+ * with the configured half life; the decay is computed lazily from the time of the last update.
+ * When the penalty exceeds the suppress threshold, the prefix is suppressed: its advertisements are held
+ * out of the RIB until the penalty decays below the reuse threshold.
+ * Each record has a timer in a timing wheel, due when the prefix can be reused (or forgotten, if not suppressed),
+ * so that no periodic sweep over the records is needed.
+ */
+
+// Data types
+
+typedef struct RIB_damp_record_t {
+  RIB_timer_t timer; //Reuse (suppressed) or forget deadline
+  RIB_prefix_t prefix;
+  int ipv;
+  double penalty;    //Penalty at the time of the last update
+  uint64_t updated;  //Milliseconds
+  int suppressed;
+  Route* held;       //Last advertisement received while suppressed (NULL if none)
+} RIB_damp_record_t;
+
+typedef struct RIB_damp_t {
+  RIB_dampening_t params;
+  double ceiling; //Maximum penalty, so that a prefix isn't suppressed for longer than maxSuppress
+  RIB_ptree_t trees[2]; //Records by prefix, for each ip version
+  RIB_wheel_t wheel;
+} RIB_damp_t;
+
+typedef void (*RIB_damp_release_cb)(Route* held, void* context);
+
+// Functions
+
+RIB_ret_code_t RIB_damp_create(const RIB_dampening_t* params, uint64_t now, RIB_damp_t** damp);
+void RIB_damp_configure(RIB_damp_t* damp, const RIB_dampening_t* params, uint64_t now);
+void RIB_damp_clear(RIB_damp_t* damp, RIB_damp_release_cb release, void* context);
+void RIB_damp_free(RIB_damp_t* damp, RIB_damp_release_cb release, void* context);
+RIB_damp_record_t* RIB_damp_find(const RIB_damp_t* damp, int ipv, const RIB_prefix_t* prefix);
+RIB_ret_code_t RIB_damp_penalize(RIB_damp_t* damp, int ipv, const RIB_prefix_t* prefix, uint64_t now, RIB_damp_record_t** record);
+int RIB_damp_update(RIB_damp_t* damp, RIB_damp_record_t* record, uint64_t now);
+size_t RIB_damp_advance(RIB_damp_t* damp, uint64_t now, RIB_damp_release_cb reuse, void* context);
+
+#endif
@@ -0,0 +1,304 @@
+/**
+ *   librib - engine.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include "engine.h"
+
+#include <stdlib.h>
+
+typedef struct RIB_auto_engine_t {
+  RIB_engine_t* inner;
+  RIB_engine_type_t current;
+  size_t routes;
+} RIB_auto_engine_t;
+
+/**
+ * @function createEngine
+ * @description create an empty lookup engine of the provided concrete type
+ * @param RIB* rtab
+ * @param int ipv
+ * @param RIB_engine_type_t type
+ * @param RIB_engine_t** engine
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t createEngine(RIB* rtab, int ipv, RIB_engine_type_t type, RIB_engine_t** engine) {
+  switch (type) {
+    case RIB_ENGINE_TRIE:
+      return RIB_engine_trie_create(rtab, ipv, engine);
+    case RIB_ENGINE_COMPILED:
+      return RIB_engine_compiled_create(rtab, ipv, engine);
+    case RIB_ENGINE_RANGE:
+      return RIB_engine_range_create(rtab, ipv, engine);
+    case RIB_ENGINE_LINEAR:
+    default:
+      return RIB_engine_linear_create(rtab, ipv, engine);
+  }
+}
+
+/**
+ * @function RIB_engine_populate
+ * @description insert into the engine all the routes of its ip version stored in the owner RIB
+ * @param RIB_engine_t* engine
+ * @param const Route* exclude: route to skip (may be NULL)
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_engine_populate(RIB_engine_t* engine, const Route* exclude) {
+  RIB* rtab = engine->rtab;
+  for (size_t i = 0; i < rtab->entries; i++) {
+    Route* thisRoute = rtab->routes[i];
+    if (thisRoute->ipv != engine->ipv || thisRoute == exclude) {
+      continue;
+    }
+    RIB_ret_code_t rc = engine->ops->insert(engine, thisRoute);
+    if (rc != RIB_NO_ERROR && rc != RIB_DUP_RECORD) {
+      return rc;
+    }
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_engine_create
+ * @description create a lookup engine of the provided type, populated with the routes currently stored in the RIB
+ * @param RIB* rtab: owner of the engine
+ * @param int ipv
+ * @param RIB_engine_type_t type
+ * @param RIB_engine_t** engine
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_engine_create(RIB* rtab, int ipv, RIB_engine_type_t type, RIB_engine_t** engine) {
+  *engine = NULL;
+  if (type == RIB_ENGINE_AUTO) {
+    return RIB_engine_auto_create(rtab, ipv, engine);
+  }
+  RIB_ret_code_t rc = createEngine(rtab, ipv, type, engine);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  if ((rc = RIB_engine_populate(*engine, NULL)) != RIB_NO_ERROR) {
+    RIB_engine_destroy(*engine);
+    *engine = NULL;
+  }
+  return rc;
+}
+
+/**
+ * @function RIB_engine_destroy
+ * @description destroy an engine; NULL is allowed
+ * @param RIB_engine_t*
+ */
+
+void RIB_engine_destroy(RIB_engine_t* engine) {
+  if (engine != NULL) {
+    engine->ops->destroy(engine);
+  }
+}
+
+/**
+ * @function RIB_engine_lookup_batch
+ * @description generic batch lookup which performs a lookup for each address
+ * @param RIB_engine_t* engine
+ * @param const unsigned char* addresses
+ * @param size_t count
+ * @param Route** routes
+ */
+
+void RIB_engine_lookup_batch(RIB_engine_t* engine, const unsigned char* addresses, size_t count, Route** routes) {
+  const size_t addressSize = RIB_engine_address_size(engine->ipv);
+  for (size_t i = 0; i < count; i++) {
+    routes[i] = engine->ops->lookup(engine, addresses + (i * addressSize));
+  }
+}
+
+/**
+ * @function RIB_engine_ready
+ * @description generic prepare of the engines which are updated by insert and remove, so they have nothing to rebuild
+ * @param RIB_engine_t* engine
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_engine_ready(RIB_engine_t* engine) {
+  (void) engine;
+  return RIB_NO_ERROR;
+}
+
+// Auto engine
+
+/**
+ * @function autoSelect
+ * @description returns the engine type to use for the provided number of routes
+ * @param RIB_engine_t* engine
+ * @param size_t routes
+ * @returns RIB_engine_type_t
+ */
+
+static RIB_engine_type_t autoSelect(RIB_engine_t* engine, size_t routes) {
+  const RIB_auto_engine_t* data = (const RIB_auto_engine_t*) engine->data;
+  size_t threshold = engine->rtab->options.autoLinearThreshold;
+  //Hysteresis: don't go back to linear scan until the table is half the threshold
+  if (data->current != RIB_ENGINE_LINEAR) {
+    threshold /= 2;
+  }
+  if (routes <= threshold) {
+    return RIB_ENGINE_LINEAR;
+  }
+  return engine->ipv == 6 ? RIB_ENGINE_COMPILED : RIB_ENGINE_TRIE;
+}
+
+/**
+ * @function autoSwitch
+ * @description replace the inner engine with a new engine of the provided type, populated from the RIB
+ * @param RIB_engine_t* engine
+ * @param RIB_engine_type_t type
+ * @param const Route* exclude
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t autoSwitch(RIB_engine_t* engine, RIB_engine_type_t type, const Route* exclude) {
+  RIB_auto_engine_t* data = (RIB_auto_engine_t*) engine->data;
+  RIB_engine_t* inner;
+  RIB_ret_code_t rc = createEngine(engine->rtab, engine->ipv, type, &inner);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  if ((rc = RIB_engine_populate(inner, exclude)) != RIB_NO_ERROR) {
+    RIB_engine_destroy(inner);
+    return rc;
+  }
+  RIB_engine_destroy(data->inner);
+  data->inner = inner;
+  data->current = type;
+  return RIB_NO_ERROR;
+}
+
+static RIB_ret_code_t autoInsert(RIB_engine_t* engine, Route* route) {
+  RIB_auto_engine_t* data = (RIB_auto_engine_t*) engine->data;
+  const RIB_engine_type_t type = autoSelect(engine, data->routes + 1);
+  RIB_ret_code_t rc;
+  if (type != data->current) {
+    //The route is already stored in the RIB, so it is inserted while populating the new engine
+    rc = autoSwitch(engine, type, NULL);
+  } else {
+    rc = data->inner->ops->insert(data->inner, route);
+  }
+  if (rc == RIB_NO_ERROR) {
+    data->routes++;
+  }
+  return rc;
+}
+
+static RIB_ret_code_t autoRemove(RIB_engine_t* engine, Route* route) {
+  RIB_auto_engine_t* data = (RIB_auto_engine_t*) engine->data;
+  const RIB_engine_type_t type = autoSelect(engine, data->routes > 0 ? data->routes - 1 : 0);
+  RIB_ret_code_t rc;
+  if (type != data->current) {
+    rc = autoSwitch(engine, type, route);
+  } else {
+    rc = data->inner->ops->remove(data->inner, route);
+    //The inner engine may not have it if it has been populated after the route left the RIB (e.g. reload sweep)
+    rc = rc == RIB_NOT_EXISTS ? RIB_NO_ERROR : rc;
+  }
+  if (rc == RIB_NO_ERROR && data->routes > 0) {
+    data->routes--;
+  }
+  return rc;
+}
+
+static RIB_ret_code_t autoPrepare(RIB_engine_t* engine) {
+  RIB_engine_t* inner = ((RIB_auto_engine_t*) engine->data)->inner;
+  return inner->ops->prepare(inner);
+}
+
+static Route* autoLookup(RIB_engine_t* engine, const unsigned char* address) {
+  RIB_engine_t* inner = ((RIB_auto_engine_t*) engine->data)->inner;
+  return inner->ops->lookup(inner, address);
+}
+
+static void autoLookupBatch(RIB_engine_t* engine, const unsigned char* addresses, size_t count, Route** routes) {
+  RIB_engine_t* inner = ((RIB_auto_engine_t*) engine->data)->inner;
+  inner->ops->lookup_batch(inner, addresses, count, routes);
+}
+
+static size_t autoMemoryUsage(const RIB_engine_t* engine) {
+  const RIB_engine_t* inner = ((const RIB_auto_engine_t*) engine->data)->inner;
+  return sizeof(RIB_engine_t) + sizeof(RIB_auto_engine_t) + inner->ops->memory_usage(inner);
+}
+
+static void autoDestroy(RIB_engine_t* engine) {
+  RIB_auto_engine_t* data = (RIB_auto_engine_t*) engine->data;
+  RIB_engine_destroy(data->inner);
+  free(data);
+  free(engine);
+}
+
+static const RIB_engine_ops_t autoOps = {
+  "auto",
+  autoInsert,
+  autoRemove,
+  autoPrepare,
+  autoLookup,
+  autoLookupBatch,
+  autoMemoryUsage,
+  autoDestroy
+};
+
+/**
+ * @function RIB_engine_auto_create
+ * @description create an engine which switches between linear scan, trie and compiled table based on table size and ip version
+ * @param RIB* rtab
+ * @param int ipv
+ * @param RIB_engine_t** engine: engine populated with the routes stored in the RIB
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_engine_auto_create(RIB* rtab, int ipv, RIB_engine_t** engine) {
+  *engine = (RIB_engine_t*) malloc(sizeof(RIB_engine_t));
+  RIB_auto_engine_t* data = (RIB_auto_engine_t*) malloc(sizeof(RIB_auto_engine_t));
+  if (*engine == NULL || data == NULL) {
+    free(*engine);
+    free(data);
+    *engine = NULL;
+    return RIB_BAD_ALLOC;
+  }
+  (*engine)->ops = &autoOps;
+  (*engine)->rtab = rtab;
+  (*engine)->ipv = ipv;
+  (*engine)->data = data;
+  data->inner = NULL;
+  data->current = RIB_ENGINE_LINEAR;
+  data->routes = 0;
+  for (size_t i = 0; i < rtab->entries; i++) {
+    if (rtab->routes[i]->ipv == ipv) {
+      data->routes++;
+    }
+  }
+  RIB_ret_code_t rc = autoSwitch(*engine, autoSelect(*engine, data->routes), NULL);
+  if (rc != RIB_NO_ERROR) {
+    free(data);
+    free(*engine);
+    *engine = NULL;
+  }
+  return rc;
+}
@@ -0,0 +1,54 @@
+/**
+ *   librib - engine.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef RIB_ENGINE_H
+#define RIB_ENGINE_H
+
+#include <rib/rib.h>
+
+// Functions
+
+RIB_ret_code_t RIB_engine_create(RIB* rtab, int ipv, RIB_engine_type_t type, RIB_engine_t** engine);
+RIB_ret_code_t RIB_engine_populate(RIB_engine_t* engine, const Route* exclude);
+void RIB_engine_destroy(RIB_engine_t* engine);
+void RIB_engine_lookup_batch(RIB_engine_t* engine, const unsigned char* addresses, size_t count, Route** routes);
+RIB_ret_code_t RIB_engine_ready(RIB_engine_t* engine);
+
+RIB_ret_code_t RIB_engine_linear_create(RIB* rtab, int ipv, RIB_engine_t** engine);
+RIB_ret_code_t RIB_engine_trie_create(RIB* rtab, int ipv, RIB_engine_t** engine);
+RIB_ret_code_t RIB_engine_compiled_create(RIB* rtab, int ipv, RIB_engine_t** engine);
+RIB_ret_code_t RIB_engine_range_create(RIB* rtab, int ipv, RIB_engine_t** engine);
+RIB_ret_code_t RIB_engine_auto_create(RIB* rtab, int ipv, RIB_engine_t** engine);
+
+/**
+ * @function RIB_engine_address_size
+ * @description returns the size in bytes of an address for the provided ip version
+ * @param int ipv
+ * @returns size_t
+ */
+
+static inline size_t RIB_engine_address_size(int ipv) {
+  return ipv == 6 ? 16 : 4;
+}
+
+#endif
@@ -0,0 +1,169 @@
+/**
+ *   librib - engine_compiled.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include "alloc.h"
+#include "bsl.h"
+#include "engine.h"
+
+#include <stdlib.h>
+
+/**
+ * Compiled engine: binary search on prefix lengths table, rebuilt from the RIB by prepare or by the first lookup after a change
+ */
+
+typedef struct RIB_compiled_engine_t {
+  RIB_bsl_t* table;
+  RIB_replicas_t replicas; //Per numa node copies of table
+  Route** nexthops;
+  int dirty;
+} RIB_compiled_engine_t;
+
+/**
+ * @function compile
+ * @description rebuild the lookup table from the routes stored in the RIB
+ * @param RIB_engine_t*
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t compile(RIB_engine_t* engine) {
+  RIB_compiled_engine_t* data = (RIB_compiled_engine_t*) engine->data;
+  RIB_replicas_free(&data->replicas);
+  RIB_bsl_free(data->table);
+  free(data->nexthops);
+  data->table = NULL;
+  data->nexthops = NULL;
+  RIB_ret_code_t rc = RIB_bsl_build(engine->rtab->routes, engine->rtab->entries, engine->ipv, engine->rtab->options.bloomFilter, engine->rtab->options.hugePages, &data->table, &data->nexthops);
+  if (rc == RIB_NO_ERROR && engine->rtab->options.numaReplicas && data->table != NULL) {
+    //Without replicas lookups read the table on its own node
+    RIB_replicas_build(&data->replicas, data->table, data->table->size, engine->rtab->options.hugePages);
+  }
+  if (rc == RIB_NO_ERROR) {
+    data->dirty = 0;
+  }
+  return rc;
+}
+
+static RIB_ret_code_t compiledInsert(RIB_engine_t* engine, Route* route) {
+  (void) route;
+  ((RIB_compiled_engine_t*) engine->data)->dirty = 1;
+  return RIB_NO_ERROR;
+}
+
+static RIB_ret_code_t compiledRemove(RIB_engine_t* engine, Route* route) {
+  (void) route;
+  ((RIB_compiled_engine_t*) engine->data)->dirty = 1;
+  return RIB_NO_ERROR;
+}
+
+static RIB_ret_code_t compiledPrepare(RIB_engine_t* engine) {
+  return ((RIB_compiled_engine_t*) engine->data)->dirty ? compile(engine) : RIB_NO_ERROR;
+}
+
+static Route* compiledLookup(RIB_engine_t* engine, const unsigned char* address) {
+  RIB_compiled_engine_t* data = (RIB_compiled_engine_t*) engine->data;
+  if (data->dirty && compile(engine) != RIB_NO_ERROR) {
+    return NULL;
+  }
+  RIB_prefix_t key;
+  RIB_prefix_from_bytes(address, engine->ipv, &key);
+  const RIB_bsl_t* table = (const RIB_bsl_t*) RIB_replicas_local(&data->replicas, data->table);
+  const uint32_t match = RIB_bsl_lookup(table, &key);
+  return match != RIB_BSL_NONE ? data->nexthops[match] : NULL;
+}
+
+static void compiledLookupBatch(RIB_engine_t* engine, const unsigned char* addresses, size_t count, Route** routes) {
+  RIB_compiled_engine_t* data = (RIB_compiled_engine_t*) engine->data;
+  if (data->dirty && compile(engine) != RIB_NO_ERROR) {
+    for (size_t i = 0; i < count; i++) {
+      routes[i] = NULL;
+    }
+    return;
+  }
+  RIB_engine_lookup_batch(engine, addresses, count, routes);
+}
+
+static size_t compiledMemoryUsage(const RIB_engine_t* engine) {
+  const RIB_compiled_engine_t* data = (const RIB_compiled_engine_t*) engine->data;
+  size_t usage = sizeof(RIB_engine_t) + sizeof(RIB_compiled_engine_t);
+  if (data->table != NULL) {
+    usage += data->table->size + (data->table->routes * sizeof(Route*));
+    for (int node = 0; node < RIB_MAX_NUMA_NODES; node++) {
+      if (data->replicas.replica[node] != NULL) {
+        usage += data->table->size;
+      }
+    }
+  }
+  return usage;
+}
+
+static void compiledDestroy(RIB_engine_t* engine) {
+  RIB_compiled_engine_t* data = (RIB_compiled_engine_t*) engine->data;
+  RIB_replicas_free(&data->replicas);
+  RIB_bsl_free(data->table);
+  free(data->nexthops);
+  free(data);
+  free(engine);
+}
+
+static const RIB_engine_ops_t compiledOps = {
+  "compiled",
+  compiledInsert,
+  compiledRemove,
+  compiledPrepare,
+  compiledLookup,
+  compiledLookupBatch,
+  compiledMemoryUsage,
+  compiledDestroy
+};
+
+/**
+ * @function RIB_engine_compiled_create
+ * @description create an empty compiled table engine
+ * @param RIB* rtab
+ * @param int ipv
+ * @param RIB_engine_t** engine
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_engine_compiled_create(RIB* rtab, int ipv, RIB_engine_t** engine) {
+  *engine = (RIB_engine_t*) malloc(sizeof(RIB_engine_t));
+  RIB_compiled_engine_t* data = (RIB_compiled_engine_t*) malloc(sizeof(RIB_compiled_engine_t));
+  if (*engine == NULL || data == NULL) {
+    free(*engine);
+    free(data);
+    *engine = NULL;
+    return RIB_BAD_ALLOC;
+  }
+  data->table = NULL;
+  data->replicas.nodes = 0;
+  for (int node = 0; node < RIB_MAX_NUMA_NODES; node++) {
+    data->replicas.replica[node] = NULL;
+  }
+  data->nexthops = NULL;
+  data->dirty = 1;
+  (*engine)->ops = &compiledOps;
+  (*engine)->rtab = rtab;
+  (*engine)->ipv = ipv;
+  (*engine)->data = data;
+  return RIB_NO_ERROR;
+}
@@ -0,0 +1,151 @@
+/**
+ *   librib - engine_linear.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include "engine.h"
+#include "prefix.h"
+
+#include <stdlib.h>
+
+/**
+ * Linear engine: scans all the prefixes comparing the masked address
+ */
+
+typedef struct RIB_linear_entry_t {
+  RIB_prefix_t prefix;
+  uint64_t maskHi;
+  uint64_t maskLo;
+  Route* route;
+} RIB_linear_entry_t;
+
+typedef struct RIB_linear_engine_t {
+  RIB_linear_entry_t* entries;
+  size_t count;
+  size_t capacity;
+} RIB_linear_engine_t;
+
+static RIB_ret_code_t linearInsert(RIB_engine_t* engine, Route* route) {
+  RIB_linear_engine_t* data = (RIB_linear_engine_t*) engine->data;
+  RIB_prefix_t prefix;
+  if (RIB_prefix_from_route(route, &prefix) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  if (data->count == data->capacity) {
+    const size_t capacity = data->capacity == 0 ? 16 : data->capacity * 2;
+    RIB_linear_entry_t* entries = (RIB_linear_entry_t*) realloc(data->entries, sizeof(RIB_linear_entry_t) * capacity);
+    if (entries == NULL) {
+      return RIB_BAD_ALLOC;
+    }
+    data->entries = entries;
+    data->capacity = capacity;
+  }
+  RIB_linear_entry_t* entry = &data->entries[data->count++];
+  RIB_prefix_t mask = {~((uint64_t) 0), ~((uint64_t) 0), 0};
+  RIB_prefix_mask(&mask, prefix.length);
+  entry->prefix = prefix;
+  entry->maskHi = mask.hi;
+  entry->maskLo = mask.lo;
+  entry->route = route;
+  return RIB_NO_ERROR;
+}
+
+static RIB_ret_code_t linearRemove(RIB_engine_t* engine, Route* route) {
+  RIB_linear_engine_t* data = (RIB_linear_engine_t*) engine->data;
+  for (size_t i = 0; i < data->count; i++) {
+    if (data->entries[i].route == route) {
+      //Keep insertion order, so the first inserted route wins among duplicates
+      for (size_t j = i + 1; j < data->count; j++) {
+        data->entries[j - 1] = data->entries[j];
+      }
+      data->count--;
+      return RIB_NO_ERROR;
+    }
+  }
+  return RIB_NOT_EXISTS;
+}
+
+static Route* linearLookup(RIB_engine_t* engine, const unsigned char* address) {
+  const RIB_linear_engine_t* data = (const RIB_linear_engine_t*) engine->data;
+  RIB_prefix_t key;
+  RIB_prefix_from_bytes(address, engine->ipv, &key);
+  const RIB_linear_entry_t* best = NULL;
+  for (size_t i = 0; i < data->count; i++) {
+    const RIB_linear_entry_t* entry = &data->entries[i];
+    if ((key.hi & entry->maskHi) == entry->prefix.hi && (key.lo & entry->maskLo) == entry->prefix.lo) {
+      if (best == NULL || best->prefix.length < entry->prefix.length) {
+        best = entry;
+      }
+    }
+  }
+  return best != NULL ? best->route : NULL;
+}
+
+static size_t linearMemoryUsage(const RIB_engine_t* engine) {
+  const RIB_linear_engine_t* data = (const RIB_linear_engine_t*) engine->data;
+  return sizeof(RIB_engine_t) + sizeof(RIB_linear_engine_t) + (data->capacity * sizeof(RIB_linear_entry_t));
+}
+
+static void linearDestroy(RIB_engine_t* engine) {
+  RIB_linear_engine_t* data = (RIB_linear_engine_t*) engine->data;
+  free(data->entries);
+  free(data);
+  free(engine);
+}
+
+static const RIB_engine_ops_t linearOps = {
+  "linear",
+  linearInsert,
+  linearRemove,
+  RIB_engine_ready,
+  linearLookup,
+  RIB_engine_lookup_batch,
+  linearMemoryUsage,
+  linearDestroy
+};
+
+/**
+ * @function RIB_engine_linear_create
+ * @description create an empty linear scan engine
+ * @param RIB* rtab
+ * @param int ipv
+ * @param RIB_engine_t** engine
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_engine_linear_create(RIB* rtab, int ipv, RIB_engine_t** engine) {
+  *engine = (RIB_engine_t*) malloc(sizeof(RIB_engine_t));
+  RIB_linear_engine_t* data = (RIB_linear_engine_t*) malloc(sizeof(RIB_linear_engine_t));
+  if (*engine == NULL || data == NULL) {
+    free(*engine);
+    free(data);
+    *engine = NULL;
+    return RIB_BAD_ALLOC;
+  }
+  data->entries = NULL;
+  data->count = 0;
+  data->capacity = 0;
+  (*engine)->ops = &linearOps;
+  (*engine)->rtab = rtab;
+  (*engine)->ipv = ipv;
+  (*engine)->data = data;
+  return RIB_NO_ERROR;
+}
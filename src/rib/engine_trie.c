@@ -0,0 +1,107 @@
+/**
+ *   librib - engine_trie.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include "engine.h"
+#include "ptree.h"
+
+#include <stdlib.h>
+
+/**
+ * Trie engine: path compressed binary trie, updated incrementally
+ */
+
+static RIB_ret_code_t trieInsert(RIB_engine_t* engine, Route* route) {
+  RIB_prefix_t prefix;
+  if (RIB_prefix_from_route(route, &prefix) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  return RIB_ptree_insert((RIB_ptree_t*) engine->data, &prefix, route);
+}
+
+static RIB_ret_code_t trieRemove(RIB_engine_t* engine, Route* route) {
+  RIB_ptree_t* tree = (RIB_ptree_t*) engine->data;
+  RIB_prefix_t prefix;
+  if (RIB_prefix_from_route(route, &prefix) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  RIB_ptnode_t* node = RIB_ptree_find(tree, &prefix);
+  if (node == NULL || node->route != route) {
+    return RIB_NOT_EXISTS;
+  }
+  RIB_ptree_remove_node(tree, node);
+  return RIB_NO_ERROR;
+}
+
+static Route* trieLookup(RIB_engine_t* engine, const unsigned char* address) {
+  RIB_prefix_t key;
+  RIB_prefix_from_bytes(address, engine->ipv, &key);
+  return RIB_ptree_match((const RIB_ptree_t*) engine->data, &key);
+}
+
+static size_t trieMemoryUsage(const RIB_engine_t* engine) {
+  const RIB_ptree_t* tree = (const RIB_ptree_t*) engine->data;
+  return sizeof(RIB_engine_t) + sizeof(RIB_ptree_t) + (tree->nodes * sizeof(RIB_ptnode_t));
+}
+
+static void trieDestroy(RIB_engine_t* engine) {
+  RIB_ptree_clear((RIB_ptree_t*) engine->data);
+  free(engine->data);
+  free(engine);
+}
+
+static const RIB_engine_ops_t trieOps = {
+  "trie",
+  trieInsert,
+  trieRemove,
+  RIB_engine_ready,
+  trieLookup,
+  RIB_engine_lookup_batch,
+  trieMemoryUsage,
+  trieDestroy
+};
+
+/**
+ * @function RIB_engine_trie_create
+ * @description create an empty trie engine
+ * @param RIB* rtab
+ * @param int ipv
+ * @param RIB_engine_t** engine
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_engine_trie_create(RIB* rtab, int ipv, RIB_engine_t** engine) {
+  *engine = (RIB_engine_t*) malloc(sizeof(RIB_engine_t));
+  RIB_ptree_t* tree = (RIB_ptree_t*) malloc(sizeof(RIB_ptree_t));
+  if (*engine == NULL || tree == NULL) {
+    free(*engine);
+    free(tree);
+    *engine = NULL;
+    return RIB_BAD_ALLOC;
+  }
+  RIB_ptree_init(tree);
+  (*engine)->ops = &trieOps;
+  (*engine)->rtab = rtab;
+  (*engine)->ipv = ipv;
+  (*engine)->data = tree;
+  return RIB_NO_ERROR;
+}
@@ -0,0 +1,642 @@
+/**
+ *   librib - fib.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include <rib/fib.h>
+
+#include "bsl.h"
+#include "prefix.h"
+#include "range.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FIB_MAGIC 0x42494652 //RFIB
+#define FIB_VERSION 1
+#define FIB_ALIGN 64
+#define FIB_NAME_MAX 256
+#define FIB_NO_STRING 0xFFFFFFFF
+#define FIB_NO_ROUTE 0xFFFFFFFF
+
+/**
+ * Control object: holds the generation of the current table
+ */
+
+typedef struct RIB_fib_control_t {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t generation; //Accessed atomically; 0 if nothing has been published yet
+} RIB_fib_control_t;
+
+/**
+ * Table object header; all offsets are from the beginning of the object
+ */
+
+typedef struct RIB_fib_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t generation;
+  uint64_t size;
+  uint64_t ipv4Offset;       //Range table; 0 if there are no ipv4 routes
+  uint64_t ipv6Offset;       //Binary search on prefix lengths table; 0 if there are no ipv6 routes
+  uint64_t ipv4RoutesOffset; //Routes indexed by the ipv4 table next hops
+  uint64_t ipv6RoutesOffset; //Routes indexed by the ipv6 table next hops
+  uint64_t stringsOffset;
+  uint32_t ipv4Routes;
+  uint32_t ipv6Routes;
+} RIB_fib_header_t;
+
+/**
+ * Route stored in the table object; strings are offsets in the strings section
+ */
+
+typedef struct RIB_fib_record_t {
+  uint32_t destination;
+  uint32_t netmask;
+  uint32_t gateway;
+  uint32_t iface;
+  int32_t prefixLength;
+  int32_t metric;
+  int32_t ipv;
+} RIB_fib_record_t;
+
+/**
+ * Strings section builder; equal strings are stored once
+ */
+
+typedef struct RIB_fib_strings_t {
+  char* data;
+  size_t length;
+  size_t capacity;
+  uint32_t* slots; //Open addressing hash table of offsets
+  size_t mask;
+} RIB_fib_strings_t;
+
+struct RIB_fib_t {
+  char name[FIB_NAME_MAX];
+  const RIB_fib_control_t* control;
+  const unsigned char* table;
+  size_t size;
+  uint64_t generation;
+};
+
+/**
+ * @function alignOffset
+ * @description round an offset up to the section alignment
+ * @param uint64_t
+ * @returns uint64_t
+ */
+
+static inline uint64_t alignOffset(uint64_t offset) {
+  return (offset + FIB_ALIGN - 1) & ~((uint64_t) FIB_ALIGN - 1);
+}
+
+/**
+ * @function objectName
+ * @description format the name of a shared memory object; generation 0 is the control object
+ * @param char* buffer (FIB_NAME_MAX bytes)
+ * @param const char* name
+ * @param uint64_t generation
+ * @returns int: 0 if the name is too long
+ */
+
+static int objectName(char* buffer, const char* name, uint64_t generation) {
+  const char* separator = name[0] == '/' ? "" : "/";
+  int length;
+  if (generation == 0) {
+    length = snprintf(buffer, FIB_NAME_MAX, "%s%s", separator, name);
+  } else {
+    length = snprintf(buffer, FIB_NAME_MAX, "%s%s.%llu", separator, name, (unsigned long long) generation);
+  }
+  return length > 0 && length < FIB_NAME_MAX;
+}
+
+/**
+ * @function hashString
+ * @description FNV-1a hash of a string
+ * @param const char*
+ * @returns uint64_t
+ */
+
+static uint64_t hashString(const char* str) {
+  uint64_t h = 0xCBF29CE484222325ULL;
+  for (; *str != 0x00; str++) {
+    h = (h ^ (unsigned char) *str) * 0x100000001B3ULL;
+  }
+  return h;
+}
+
+/**
+ * @function internString
+ * @description store a string in the strings section, if not already stored
+ * @param RIB_fib_strings_t*
+ * @param const char* str
+ * @param uint32_t* offset: FIB_NO_STRING for NULL strings
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t internString(RIB_fib_strings_t* strings, const char* str, uint32_t* offset) {
+  if (str == NULL) {
+    *offset = FIB_NO_STRING;
+    return RIB_NO_ERROR;
+  }
+  size_t slot = hashString(str) & strings->mask;
+  while (strings->slots[slot] != FIB_NO_STRING) {
+    if (strcmp(strings->data + strings->slots[slot], str) == 0) {
+      *offset = strings->slots[slot];
+      return RIB_NO_ERROR;
+    }
+    slot = (slot + 1) & strings->mask;
+  }
+  const size_t length = strlen(str) + 1;
+  if (strings->length + length >= FIB_NO_STRING) {
+    return RIB_BAD_ALLOC;
+  }
+  if (strings->length + length > strings->capacity) {
+    size_t capacity = strings->capacity * 2;
+    while (capacity < strings->length + length) {
+      capacity *= 2;
+    }
+    char* data = (char*) realloc(strings->data, capacity);
+    if (data == NULL) {
+      return RIB_BAD_ALLOC;
+    }
+    strings->data = data;
+    strings->capacity = capacity;
+  }
+  memcpy(strings->data + strings->length, str, length);
+  *offset = (uint32_t) strings->length;
+  strings->slots[slot] = *offset;
+  strings->length += length;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function serializeRoutes
+ * @description convert next hop routes into records
+ * @param RIB_fib_strings_t*
+ * @param Route** routes
+ * @param size_t count
+ * @param RIB_fib_record_t** records
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t serializeRoutes(RIB_fib_strings_t* strings, Route** routes, size_t count, RIB_fib_record_t** records) {
+  *records = NULL;
+  if (count == 0) {
+    return RIB_NO_ERROR;
+  }
+  *records = (RIB_fib_record_t*) malloc(sizeof(RIB_fib_record_t) * count);
+  if (*records == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  for (size_t i = 0; i < count; i++) {
+    const Route* route = routes[i];
+    RIB_fib_record_t* record = &(*records)[i];
+    RIB_ret_code_t rc;
+    if ((rc = internString(strings, route->destination, &record->destination)) != RIB_NO_ERROR ||
+        (rc = internString(strings, route->netmask, &record->netmask)) != RIB_NO_ERROR ||
+        (rc = internString(strings, route->gateway, &record->gateway)) != RIB_NO_ERROR ||
+        (rc = internString(strings, route->iface, &record->iface)) != RIB_NO_ERROR) {
+      free(*records);
+      *records = NULL;
+      return rc;
+    }
+    record->prefixLength = route->prefixLength;
+    record->metric = route->metric;
+    record->ipv = route->ipv;
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_fib_publish
+ * @description compile the RIB lookup tables and publish them as a new generation of the shared memory FIB <name>
+ * @param RIB* rtab
+ * @param const char* name
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_fib_publish(RIB* rtab, const char* name) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  char controlName[FIB_NAME_MAX];
+  char tableName[FIB_NAME_MAX];
+  if (name == NULL || !objectName(controlName, name, 0)) {
+    return RIB_INVALID_ADDRESS;
+  }
+  //Compile tables
+  RIB_range_t* ipv4Table = NULL;
+  RIB_bsl_t* ipv6Table = NULL;
+  Route** ipv4Nexthops = NULL;
+  Route** ipv6Nexthops = NULL;
+  RIB_fib_record_t* ipv4Records = NULL;
+  RIB_fib_record_t* ipv6Records = NULL;
+  RIB_fib_strings_t strings;
+  strings.length = 0;
+  strings.capacity = 4096;
+  strings.mask = 1;
+  while (strings.mask < rtab->entries * 8 + 64) {
+    strings.mask <<= 1;
+  }
+  strings.data = (char*) malloc(strings.capacity);
+  strings.slots = (uint32_t*) malloc(sizeof(uint32_t) * strings.mask);
+  strings.mask--;
+  RIB_ret_code_t rc = RIB_BAD_ALLOC;
+  if (strings.data == NULL || strings.slots == NULL) {
+    goto cleanup;
+  }
+  memset(strings.slots, 0xFF, sizeof(uint32_t) * (strings.mask + 1));
+  if ((rc = RIB_range_build(rtab->routes, rtab->entries, RIB_HUGEPAGES_NONE, &ipv4Table, &ipv4Nexthops)) != RIB_NO_ERROR) {
+    goto cleanup;
+  }
+  if ((rc = RIB_bsl_build(rtab->routes, rtab->entries, 6, rtab->options.bloomFilter, RIB_HUGEPAGES_NONE, &ipv6Table, &ipv6Nexthops)) != RIB_NO_ERROR) {
+    goto cleanup;
+  }
+  const uint32_t ipv4Routes = ipv4Table != NULL ? ipv4Table->routes : 0;
+  const uint32_t ipv6Routes = ipv6Table != NULL ? ipv6Table->routes : 0;
+  if ((rc = serializeRoutes(&strings, ipv4Nexthops, ipv4Routes, &ipv4Records)) != RIB_NO_ERROR) {
+    goto cleanup;
+  }
+  if ((rc = serializeRoutes(&strings, ipv6Nexthops, ipv6Routes, &ipv6Records)) != RIB_NO_ERROR) {
+    goto cleanup;
+  }
+  //Layout
+  RIB_fib_header_t header;
+  memset(&header, 0x00, sizeof(RIB_fib_header_t));
+  header.magic = FIB_MAGIC;
+  header.version = FIB_VERSION;
+  header.ipv4Routes = ipv4Routes;
+  header.ipv6Routes = ipv6Routes;
+  uint64_t size = alignOffset(sizeof(RIB_fib_header_t));
+  if (ipv4Table != NULL) {
+    header.ipv4Offset = size;
+    size = alignOffset(size + ipv4Table->size);
+  }
+  if (ipv6Table != NULL) {
+    header.ipv6Offset = size;
+    size = alignOffset(size + ipv6Table->size);
+  }
+  header.ipv4RoutesOffset = size;
+  size = alignOffset(size + sizeof(RIB_fib_record_t) * ipv4Routes);
+  header.ipv6RoutesOffset = size;
+  size = alignOffset(size + sizeof(RIB_fib_record_t) * ipv6Routes);
+  header.stringsOffset = size;
+  size += strings.length;
+  header.size = size;
+  //Open control object
+  rc = RIB_IO_ERROR;
+  int controlFd = shm_open(controlName, O_RDWR | O_CREAT, 0644);
+  if (controlFd == -1) {
+    goto cleanup;
+  }
+  struct stat controlStat;
+  if (fstat(controlFd, &controlStat) != 0 || ((size_t) controlStat.st_size < sizeof(RIB_fib_control_t) && ftruncate(controlFd, sizeof(RIB_fib_control_t)) != 0)) {
+    close(controlFd);
+    goto cleanup;
+  }
+  RIB_fib_control_t* control = (RIB_fib_control_t*) mmap(NULL, sizeof(RIB_fib_control_t), PROT_READ | PROT_WRITE, MAP_SHARED, controlFd, 0);
+  close(controlFd);
+  if (control == MAP_FAILED) {
+    goto cleanup;
+  }
+  control->magic = FIB_MAGIC;
+  control->version = FIB_VERSION;
+  const uint64_t previous = __atomic_load_n(&control->generation, __ATOMIC_ACQUIRE);
+  header.generation = previous + 1;
+  //Write the new table object
+  int tableFd = -1;
+  if (objectName(tableName, name, header.generation)) {
+    shm_unlink(tableName); //Left over by a writer which crashed before publishing it
+    tableFd = shm_open(tableName, O_RDWR | O_CREAT | O_EXCL, 0644);
+  }
+  if (tableFd == -1) {
+    munmap(control, sizeof(RIB_fib_control_t));
+    goto cleanup;
+  }
+  unsigned char* table = MAP_FAILED;
+  if (ftruncate(tableFd, (off_t) size) == 0) {
+    table = (unsigned char*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, tableFd, 0);
+  }
+  close(tableFd);
+  if (table == MAP_FAILED) {
+    shm_unlink(tableName);
+    munmap(control, sizeof(RIB_fib_control_t));
+    goto cleanup;
+  }
+  memcpy(table, &header, sizeof(RIB_fib_header_t));
+  if (ipv4Table != NULL) {
+    memcpy(table + header.ipv4Offset, ipv4Table, ipv4Table->size);
+  }
+  if (ipv6Table != NULL) {
+    memcpy(table + header.ipv6Offset, ipv6Table, ipv6Table->size);
+  }
+  if (ipv4Routes > 0) {
+    memcpy(table + header.ipv4RoutesOffset, ipv4Records, sizeof(RIB_fib_record_t) * ipv4Routes);
+  }
+  if (ipv6Routes > 0) {
+    memcpy(table + header.ipv6RoutesOffset, ipv6Records, sizeof(RIB_fib_record_t) * ipv6Routes);
+  }
+  memcpy(table + header.stringsOffset, strings.data, strings.length);
+  munmap(table, size);
+  //Switch readers to the new generation; they may keep the previous object mapped after it is unlinked
+  __atomic_store_n(&control->generation, header.generation, __ATOMIC_RELEASE);
+  munmap(control, sizeof(RIB_fib_control_t));
+  if (previous > 0 && objectName(tableName, name, previous)) {
+    shm_unlink(tableName);
+  }
+  rc = RIB_NO_ERROR;
+
+cleanup:
+  RIB_range_free(ipv4Table);
+  RIB_bsl_free(ipv6Table);
+  free(ipv4Nexthops);
+  free(ipv6Nexthops);
+  free(ipv4Records);
+  free(ipv6Records);
+  free(strings.data);
+  free(strings.slots);
+  return rc;
+}
+
+/**
+ * @function RIB_fib_unlink
+ * @description remove the shared memory objects of the FIB <name>; readers which have it mapped can still use it
+ * @param const char* name
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_fib_unlink(const char* name) {
+  char objName[FIB_NAME_MAX];
+  if (name == NULL || !objectName(objName, name, 0)) {
+    return RIB_INVALID_ADDRESS;
+  }
+  int controlFd = shm_open(objName, O_RDONLY, 0);
+  if (controlFd == -1) {
+    return RIB_NOT_EXISTS;
+  }
+  RIB_fib_control_t* control = (RIB_fib_control_t*) mmap(NULL, sizeof(RIB_fib_control_t), PROT_READ, MAP_SHARED, controlFd, 0);
+  close(controlFd);
+  if (control != MAP_FAILED) {
+    const uint64_t generation = __atomic_load_n(&control->generation, __ATOMIC_ACQUIRE);
+    munmap(control, sizeof(RIB_fib_control_t));
+    char tableName[FIB_NAME_MAX];
+    if (generation > 0 && objectName(tableName, name, generation)) {
+      shm_unlink(tableName);
+    }
+  }
+  shm_unlink(objName);
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_fib_open
+ * @description map the current table of the shared memory FIB <name>
+ * @param RIB_fib_t** fib
+ * @param const char* name
+ * @returns RIB_ret_code_t: RIB_NOT_EXISTS if nothing has been published yet
+ */
+
+RIB_ret_code_t RIB_fib_open(RIB_fib_t** fib, const char* name) {
+  *fib = NULL;
+  RIB_fib_t* newFib = (RIB_fib_t*) malloc(sizeof(RIB_fib_t));
+  if (newFib == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  if (name == NULL || !objectName(newFib->name, name, 0)) {
+    free(newFib);
+    return RIB_INVALID_ADDRESS;
+  }
+  //Keep the name without the leading slash, since objectName adds it
+  memmove(newFib->name, newFib->name + 1, strlen(newFib->name));
+  newFib->table = NULL;
+  newFib->size = 0;
+  newFib->generation = 0;
+  char controlName[FIB_NAME_MAX];
+  objectName(controlName, newFib->name, 0);
+  int controlFd = shm_open(controlName, O_RDONLY, 0);
+  if (controlFd == -1) {
+    free(newFib);
+    return errno == ENOENT ? RIB_NOT_EXISTS : RIB_IO_ERROR;
+  }
+  struct stat controlStat;
+  void* control = MAP_FAILED;
+  if (fstat(controlFd, &controlStat) == 0 && (size_t) controlStat.st_size >= sizeof(RIB_fib_control_t)) {
+    control = mmap(NULL, sizeof(RIB_fib_control_t), PROT_READ, MAP_SHARED, controlFd, 0);
+  }
+  close(controlFd);
+  if (control == MAP_FAILED) {
+    free(newFib);
+    return RIB_IO_ERROR;
+  }
+  newFib->control = (const RIB_fib_control_t*) control;
+  RIB_ret_code_t rc = RIB_fib_refresh(newFib, NULL);
+  if (rc != RIB_NO_ERROR) {
+    RIB_fib_close(newFib);
+    return rc;
+  }
+  *fib = newFib;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_fib_refresh
+ * @description map the current table if a new generation has been published.
+ * Routes returned by previous lookups are no more valid after an update.
+ * @param RIB_fib_t* fib
+ * @param int* updated: set to 1 if a new table has been mapped; can be NULL
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_fib_refresh(RIB_fib_t* fib, int* updated) {
+  if (updated != NULL) {
+    *updated = 0;
+  }
+  if (fib == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  uint64_t generation = __atomic_load_n(&fib->control->generation, __ATOMIC_ACQUIRE);
+  if (generation == fib->generation) {
+    return fib->table != NULL ? RIB_NO_ERROR : RIB_NOT_EXISTS;
+  }
+  for (;;) {
+    char tableName[FIB_NAME_MAX];
+    objectName(tableName, fib->name, generation);
+    int tableFd = shm_open(tableName, O_RDONLY, 0);
+    if (tableFd == -1) {
+      //The writer may have published another generation and removed this one in the meanwhile
+      const uint64_t current = __atomic_load_n(&fib->control->generation, __ATOMIC_ACQUIRE);
+      if (current == generation) {
+        return fib->table != NULL ? RIB_NO_ERROR : RIB_NOT_EXISTS;
+      }
+      generation = current;
+      continue;
+    }
+    struct stat tableStat;
+    void* table = MAP_FAILED;
+    if (fstat(tableFd, &tableStat) == 0 && (size_t) tableStat.st_size >= sizeof(RIB_fib_header_t)) {
+      table = mmap(NULL, (size_t) tableStat.st_size, PROT_READ, MAP_SHARED, tableFd, 0);
+    }
+    close(tableFd);
+    if (table == MAP_FAILED) {
+      return RIB_IO_ERROR;
+    }
+    const RIB_fib_header_t* header = (const RIB_fib_header_t*) table;
+    if (header->magic != FIB_MAGIC || header->version != FIB_VERSION || header->generation != generation || header->size > (uint64_t) tableStat.st_size) {
+      munmap(table, (size_t) tableStat.st_size);
+      return RIB_IO_ERROR;
+    }
+    if (fib->table != NULL) {
+      munmap((void*) fib->table, fib->size);
+    }
+    fib->table = (const unsigned char*) table;
+    fib->size = (size_t) tableStat.st_size;
+    fib->generation = generation;
+    if (updated != NULL) {
+      *updated = 1;
+    }
+    return RIB_NO_ERROR;
+  }
+}
+
+/**
+ * @function fillRoute
+ * @description point route fields to the record strings
+ * @param const RIB_fib_t* fib
+ * @param uint64_t recordsOffset
+ * @param uint32_t index
+ * @param RIB_fib_route_t* route
+ */
+
+static void fillRoute(const RIB_fib_t* fib, uint64_t recordsOffset, uint32_t index, RIB_fib_route_t* route) {
+  const RIB_fib_header_t* header = (const RIB_fib_header_t*) fib->table;
+  const RIB_fib_record_t* record = (const RIB_fib_record_t*) (fib->table + recordsOffset) + index;
+  const char* strings = (const char*) fib->table + header->stringsOffset;
+  route->destination = record->destination != FIB_NO_STRING ? strings + record->destination : NULL;
+  route->netmask = record->netmask != FIB_NO_STRING ? strings + record->netmask : NULL;
+  route->gateway = record->gateway != FIB_NO_STRING ? strings + record->gateway : NULL;
+  route->iface = record->iface != FIB_NO_STRING ? strings + record->iface : NULL;
+  route->prefixLength = record->prefixLength;
+  route->metric = record->metric;
+  route->ipv = record->ipv;
+}
+
+/**
+ * @function RIB_fib_match_address
+ * @description find the matching route for an address in network byte order (4 bytes for ipv4, 16 for ipv6)
+ * @param RIB_fib_t* fib
+ * @param int ipv
+ * @param const unsigned char* address
+ * @param RIB_fib_route_t* route: strings point to the shared table
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_fib_match_address(RIB_fib_t* fib, int ipv, const unsigned char* address, RIB_fib_route_t* route) {
+  if (fib == NULL || fib->table == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  const RIB_fib_header_t* header = (const RIB_fib_header_t*) fib->table;
+  uint32_t match;
+  uint64_t recordsOffset;
+  if (ipv == 4) {
+    if (header->ipv4Offset == 0) {
+      return RIB_NO_MATCH;
+    }
+    const uint32_t hostAddress = ((uint32_t) address[0] << 24) | ((uint32_t) address[1] << 16) | ((uint32_t) address[2] << 8) | (uint32_t) address[3];
+    match = RIB_range_lookup((const RIB_range_t*) (fib->table + header->ipv4Offset), hostAddress);
+    match = match != RIB_RANGE_NONE ? match : FIB_NO_ROUTE;
+    recordsOffset = header->ipv4RoutesOffset;
+  } else if (ipv == 6) {
+    if (header->ipv6Offset == 0) {
+      return RIB_NO_MATCH;
+    }
+    RIB_prefix_t key;
+    RIB_prefix_from_bytes(address, 6, &key);
+    match = RIB_bsl_lookup((const RIB_bsl_t*) (fib->table + header->ipv6Offset), &key);
+    match = match != RIB_BSL_NONE ? match : FIB_NO_ROUTE;
+    recordsOffset = header->ipv6RoutesOffset;
+  } else {
+    return RIB_INVALID_ADDRESS;
+  }
+  if (match == FIB_NO_ROUTE) {
+    return RIB_NO_MATCH;
+  }
+  fillRoute(fib, recordsOffset, match, route);
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_fib_match
+ * @description find the matching route for the provided destination address (ipv4 or ipv6)
+ * @param RIB_fib_t* fib
+ * @param const char* destination
+ * @param RIB_fib_route_t* route: strings point to the shared table
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_fib_match(RIB_fib_t* fib, const char* destination, RIB_fib_route_t* route) {
+  unsigned char address[16];
+  if (destination == NULL) {
+    return RIB_INVALID_ADDRESS;
+  }
+  if (inet_pton(AF_INET, destination, address) == 1) {
+    return RIB_fib_match_address(fib, 4, address, route);
+  } else if (inet_pton(AF_INET6, destination, address) == 1) {
+    return RIB_fib_match_address(fib, 6, address, route);
+  }
+  return RIB_INVALID_ADDRESS;
+}
+
+/**
+ * @function RIB_fib_generation
+ * @description returns the generation of the mapped table
+ * @param const RIB_fib_t* fib
+ * @returns uint64_t
+ */
+
+uint64_t RIB_fib_generation(const RIB_fib_t* fib) {
+  return fib != NULL ? fib->generation : 0;
+}
+
+/**
+ * @function RIB_fib_close
+ * @description unmap the FIB
+ * @param RIB_fib_t* fib
+ */
+
+void RIB_fib_close(RIB_fib_t* fib) {
+  if (fib == NULL) {
+    return;
+  }
+  if (fib->table != NULL) {
+    munmap((void*) fib->table, fib->size);
+  }
+  munmap((void*) fib->control, sizeof(RIB_fib_control_t));
+  free(fib);
+}
@@ -0,0 +1,185 @@
+/**
+ *   librib - hits.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "hits.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+__thread size_t RIB_hits_thread = 0;
+
+static size_t threads = 0;
+
+/**
+ * @function shardSize
+ * @description returns the size in bytes of a shard, rounded up to whole cache lines
+ * @param size_t capacity
+ * @returns size_t
+ */
+
+static inline size_t shardSize(size_t capacity) {
+  size_t size = sizeof(uint64_t) * (capacity > 0 ? capacity : 1);
+  return (size + RIB_HITS_LINE - 1) & ~((size_t) RIB_HITS_LINE - 1);
+}
+
+/**
+ * @function RIB_hits_create
+ * @description allocate zeroed hit counters
+ * @param size_t shards: number of shards (usually the number of lookup threads)
+ * @param size_t capacity: route slots
+ * @param RIB_hits_t** hits
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_hits_create(size_t shards, size_t capacity, RIB_hits_t** hits) {
+  *hits = (RIB_hits_t*) malloc(sizeof(RIB_hits_t));
+  if (*hits == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  (*hits)->shards = shards;
+  (*hits)->capacity = 0;
+  (*hits)->counters = (uint64_t**) calloc(shards, sizeof(uint64_t*));
+  if ((*hits)->counters == NULL || RIB_hits_reserve(*hits, capacity) != RIB_NO_ERROR) {
+    RIB_hits_free(*hits);
+    *hits = NULL;
+    return RIB_BAD_ALLOC;
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_hits_free
+ * @description free hit counters; NULL is allowed
+ * @param RIB_hits_t* hits
+ */
+
+void RIB_hits_free(RIB_hits_t* hits) {
+  if (hits == NULL) {
+    return;
+  }
+  if (hits->counters != NULL) {
+    for (size_t i = 0; i < hits->shards; i++) {
+      free(hits->counters[i]);
+    }
+    free(hits->counters);
+  }
+  free(hits);
+}
+
+/**
+ * @function RIB_hits_reserve
+ * @description make room for the provided number of route slots; new counters are zero.
+ *              It must not run concurrently with lookups
+ * @param RIB_hits_t* hits
+ * @param size_t capacity
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_hits_reserve(RIB_hits_t* hits, size_t capacity) {
+  if (capacity <= hits->capacity && hits->capacity > 0) {
+    return RIB_NO_ERROR;
+  }
+  //Grow geometrically, since a slot is reserved for each added route
+  size_t newCapacity = hits->capacity > 0 ? hits->capacity : RIB_HITS_LINE / sizeof(uint64_t);
+  while (newCapacity < capacity) {
+    newCapacity *= 2;
+  }
+  for (size_t i = 0; i < hits->shards; i++) {
+    uint64_t* counters = (uint64_t*) aligned_alloc(RIB_HITS_LINE, shardSize(newCapacity));
+    if (counters == NULL) {
+      return RIB_BAD_ALLOC;
+    }
+    memset(counters, 0, shardSize(newCapacity));
+    if (hits->counters[i] != NULL) {
+      memcpy(counters, hits->counters[i], sizeof(uint64_t) * hits->capacity);
+      free(hits->counters[i]);
+    }
+    hits->counters[i] = counters;
+  }
+  hits->capacity = newCapacity;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_hits_sum
+ * @description sum the shards of a route slot; it may run concurrently with lookups
+ * @param const RIB_hits_t* hits
+ * @param size_t slot
+ * @returns uint64_t
+ */
+
+uint64_t RIB_hits_sum(const RIB_hits_t* hits, size_t slot) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < hits->shards; i++) {
+    sum += __atomic_load_n(&hits->counters[i][slot], __ATOMIC_RELAXED);
+  }
+  return sum;
+}
+
+/**
+ * @function RIB_hits_move
+ * @description move the counters of a route to a new slot (the counters of the previous route in the slot are discarded);
+ *              it must not run concurrently with lookups
+ * @param RIB_hits_t* hits
+ * @param size_t from
+ * @param size_t to
+ */
+
+void RIB_hits_move(RIB_hits_t* hits, size_t from, size_t to) {
+  if (from == to) {
+    return;
+  }
+  for (size_t i = 0; i < hits->shards; i++) {
+    hits->counters[i][to] = hits->counters[i][from];
+    hits->counters[i][from] = 0;
+  }
+}
+
+/**
+ * @function RIB_hits_clear
+ * @description zero the counters of a range of slots; it must not run concurrently with lookups
+ * @param RIB_hits_t* hits
+ * @param size_t slot: first slot
+ * @param size_t count
+ */
+
+void RIB_hits_clear(RIB_hits_t* hits, size_t slot, size_t count) {
+  for (size_t i = 0; i < hits->shards; i++) {
+    memset(&hits->counters[i][slot], 0, sizeof(uint64_t) * count);
+  }
+}
+
+/**
+ * @function RIB_hits_assign
+ * @description assign a shard to the current thread; threads get consecutive shards
+ * @returns size_t: shard of the thread + 1
+ */
+
+size_t RIB_hits_assign(void) {
+  RIB_hits_thread = __atomic_add_fetch(&threads, 1, __ATOMIC_RELAXED);
+  return RIB_hits_thread;
+}
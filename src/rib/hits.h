@@ -0,0 +1,76 @@
+/**
+ *   librib - hits.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+
+#ifndef RIB_HITS_H
+#define RIB_HITS_H
+
+#include <rib/rib.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Route hit counters. Each lookup thread increments the counters of its own shard, indexed by route slot;
+ * shards are separate cache line aligned arrays, so threads never write the same cache line and
+ * increments are plain loads and stores (no locked read-modify-write). Counts are exact as long as
+ * there are no more lookup threads than shards; threads sharing a shard may lose some increments.
+ * Shards are only summed by the readers, never reset while lookups are running.
+ */
+
+#define RIB_HITS_LINE 64 //Cache line size
+
+// Data types
+
+typedef struct RIB_hits_t {
+  size_t shards;
+  size_t capacity;     //Counters in each shard
+  uint64_t** counters; //Counters of each shard, by route slot
+} RIB_hits_t;
+
+extern __thread size_t RIB_hits_thread; //Shard of the current thread + 1; 0 if not assigned yet
+
+// Functions
+
+RIB_ret_code_t RIB_hits_create(size_t shards, size_t capacity, RIB_hits_t** hits);
+void RIB_hits_free(RIB_hits_t* hits);
+RIB_ret_code_t RIB_hits_reserve(RIB_hits_t* hits, size_t capacity);
+uint64_t RIB_hits_sum(const RIB_hits_t* hits, size_t slot);
+void RIB_hits_move(RIB_hits_t* hits, size_t from, size_t to);
+void RIB_hits_clear(RIB_hits_t* hits, size_t slot, size_t count);
+size_t RIB_hits_assign(void);
+
+/**
+ * @function RIB_hits_count
+ * @description count a lookup hit of the route in the provided slot, in the shard of the current thread
+ * @param RIB_hits_t* hits
+ * @param size_t slot
+ */
+
+static inline void RIB_hits_count(RIB_hits_t* hits, size_t slot) {
+  size_t thread = RIB_hits_thread != 0 ? RIB_hits_thread : RIB_hits_assign();
+  uint64_t* counter = &hits->counters[(thread - 1) % hits->shards][slot];
+  __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+}
+
+#endif
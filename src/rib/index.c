@@ -0,0 +1,849 @@
+/**
+ *   librib - index.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include "index.h"
+#include "trace.h"
+
+#include <rib/iputils.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RIB_GROUPS_MIN_SIZE 64
+
+/**
+ * @function groupHash
+ * @description FNV-1a hash of a group key
+ * @param const char* key
+ * @returns uint64_t
+ */
+
+static uint64_t groupHash(const char* key) {
+  uint64_t h = 0xCBF29CE484222325ULL;
+  for (const unsigned char* c = (const unsigned char*) key; *c != 0; c++) {
+    h ^= *c;
+    h *= 0x100000001B3ULL;
+  }
+  return h;
+}
+
+/**
+ * @function findGroup
+ * @description find the group of a key
+ * @param const RIB_groups_t*
+ * @param const char* key
+ * @returns RIB_group_t*: NULL if there is no route with this key
+ */
+
+static RIB_group_t* findGroup(const RIB_groups_t* groups, const char* key) {
+  if (groups->size == 0) {
+    return NULL;
+  }
+  RIB_group_t* group = groups->buckets[groupHash(key) & (groups->size - 1)];
+  while (group != NULL && strcmp(group->key, key) != 0) {
+    group = group->next;
+  }
+  return group;
+}
+
+/**
+ * @function invalidate
+ * @description invalidate the cached resolution of a gateway group and of all the groups resolved through it
+ * @param RIB_group_t*
+ */
+
+static void invalidate(RIB_group_t* group) {
+  if (!group->resolved) {
+    return;
+  }
+  group->resolved = 0;
+  group->connected = NULL;
+  if (group->via != NULL) {
+    if (group->prevDependent != NULL) {
+      group->prevDependent->nextDependent = group->nextDependent;
+    } else {
+      group->via->dependents = group->nextDependent;
+    }
+    if (group->nextDependent != NULL) {
+      group->nextDependent->prevDependent = group->prevDependent;
+    }
+    group->via = NULL;
+    group->prevDependent = NULL;
+    group->nextDependent = NULL;
+  }
+  while (group->dependents != NULL) {
+    invalidate(group->dependents);
+  }
+}
+
+/**
+ * @function invalidatePrefix
+ * @description invalidate the cached resolution of all the gateways contained in a prefix
+ * @param RIB_index_t*
+ * @param int ipv
+ * @param const RIB_prefix_t* prefix
+ */
+
+static void invalidatePrefix(RIB_index_t* index, int ipv, const RIB_prefix_t* prefix) {
+  RIB_ptnode_t* top = RIB_ptree_subtree(&index->gateways[ipv == 6 ? 1 : 0], prefix);
+  for (RIB_ptnode_t* node = top; node != NULL; node = RIB_ptree_next(node, top)) {
+    if (node->value != NULL) {
+      invalidate((RIB_group_t*) node->value);
+    }
+  }
+}
+
+/**
+ * @function getGroup
+ * @description find the group of a key, creating it if it doesn't exist
+ * @param RIB_index_t*
+ * @param RIB_index_by_t by
+ * @param const char* key
+ * @returns RIB_group_t*: NULL if allocation failed
+ */
+
+static RIB_group_t* getGroup(RIB_index_t* index, RIB_index_by_t by, const char* key) {
+  RIB_groups_t* groups = &index->by[by];
+  RIB_group_t* group = findGroup(groups, key);
+  if (group != NULL) {
+    return group;
+  }
+  if (groups->groups >= groups->size) {
+    //Grow to keep one group per bucket on average
+    size_t size = groups->size > 0 ? groups->size * 2 : RIB_GROUPS_MIN_SIZE;
+    RIB_group_t** buckets = (RIB_group_t**) calloc(size, sizeof(RIB_group_t*));
+    if (buckets == NULL) {
+      return NULL;
+    }
+    for (size_t i = 0; i < groups->size; i++) {
+      RIB_group_t* thisGroup = groups->buckets[i];
+      while (thisGroup != NULL) {
+        RIB_group_t* next = thisGroup->next;
+        size_t bucket = groupHash(thisGroup->key) & (size - 1);
+        thisGroup->next = buckets[bucket];
+        buckets[bucket] = thisGroup;
+        thisGroup = next;
+      }
+    }
+    free(groups->buckets);
+    groups->buckets = buckets;
+    groups->size = size;
+  }
+  group = (RIB_group_t*) calloc(1, sizeof(RIB_group_t));
+  if (group == NULL) {
+    return NULL;
+  }
+  group->key = strdup(key);
+  if (group->key == NULL) {
+    free(group);
+    return NULL;
+  }
+  //Gateways are tracked by address; the ones which can't be parsed are never resolved
+  if (by == RIB_BY_GATEWAY && isValidIpAddress(key, &group->ipv) == 0 && RIB_prefix_from_address(key, group->ipv, &group->address) == 0) {
+    RIB_ret_code_t rc = RIB_ptree_insert(&index->gateways[group->ipv == 6 ? 1 : 0], &group->address, group);
+    if (rc == RIB_BAD_ALLOC) {
+      free(group->key);
+      free(group);
+      return NULL;
+    } else if (rc != RIB_NO_ERROR) {
+      group->ipv = 0;
+    }
+  } else {
+    group->ipv = 0;
+  }
+  size_t bucket = groupHash(key) & (groups->size - 1);
+  group->next = groups->buckets[bucket];
+  groups->buckets[bucket] = group;
+  groups->groups++;
+  return group;
+}
+
+/**
+ * @function dropGroup
+ * @description remove an empty group from the reverse index and free it
+ * @param RIB_index_t*
+ * @param RIB_index_by_t by
+ * @param RIB_group_t*
+ */
+
+static void dropGroup(RIB_index_t* index, RIB_index_by_t by, RIB_group_t* group) {
+  RIB_groups_t* groups = &index->by[by];
+  RIB_group_t** link = &groups->buckets[groupHash(group->key) & (groups->size - 1)];
+  while (*link != group) {
+    link = &(*link)->next;
+  }
+  *link = group->next;
+  groups->groups--;
+  if (by == RIB_BY_GATEWAY) {
+    invalidate(group);
+    if (group->ipv != 0) {
+      RIB_ptree_t* tree = &index->gateways[group->ipv == 6 ? 1 : 0];
+      RIB_ptnode_t* node = RIB_ptree_find(tree, &group->address);
+      if (node != NULL && node->value == group) {
+        RIB_ptree_remove_node(tree, node);
+      }
+    }
+  }
+  free(group->key);
+  free(group);
+}
+
+/**
+ * @function clearGroups
+ * @description free all the groups of a reverse index
+ * @param RIB_groups_t*
+ */
+
+static void clearGroups(RIB_groups_t* groups) {
+  for (size_t i = 0; i < groups->size; i++) {
+    RIB_group_t* group = groups->buckets[i];
+    while (group != NULL) {
+      RIB_group_t* next = group->next;
+      free(group->key);
+      free(group);
+      group = next;
+    }
+  }
+  free(groups->buckets);
+  groups->buckets = NULL;
+  groups->size = 0;
+  groups->groups = 0;
+}
+
+/**
+ * @function isConnected
+ * @description returns whether a route stored in the index is directly connected (unspecified gateway)
+ * @param Route*
+ * @returns int
+ */
+
+static inline int isConnected(Route* route) {
+  const RIB_group_t* gateway = RIB_entry_of(route)->group[RIB_BY_GATEWAY];
+  return gateway != NULL && gateway->ipv != 0 && gateway->address.hi == 0 && gateway->address.lo == 0;
+}
+
+/**
+ * @function resolveGroup
+ * @description resolve a gateway to the directly connected route reaching it, following recursive next hops; the result is cached
+ * @param RIB_index_t*
+ * @param RIB_group_t*
+ * @returns Route*: NULL if the gateway is unreachable
+ */
+
+static Route* resolveGroup(RIB_index_t* index, RIB_group_t* group) {
+  if (group->resolved) {
+    return group->connected;
+  }
+  if (group->resolving || group->ipv == 0) {
+    //Next hops loop or gateway which can't be resolved
+    return NULL;
+  }
+  group->resolving = 1;
+  Route* connected = NULL;
+  RIB_group_t* via = NULL;
+  Route* first = RIB_ptree_match(RIB_index_tree(index, group->ipv), &group->address);
+  if (first != NULL) {
+    if (isConnected(first)) {
+      connected = first;
+    } else {
+      via = RIB_entry_of(first)->group[RIB_BY_GATEWAY];
+      connected = resolveGroup(index, via);
+    }
+  }
+  group->resolving = 0;
+  group->resolved = 1;
+  group->connected = connected;
+  group->via = via;
+  if (via != NULL) {
+    group->prevDependent = NULL;
+    group->nextDependent = via->dependents;
+    if (via->dependents != NULL) {
+      via->dependents->prevDependent = group;
+    }
+    via->dependents = group;
+  }
+  return connected;
+}
+
+/**
+ * @function linkEntry
+ * @description add an entry to a group
+ * @param RIB_group_t*
+ * @param RIB_index_by_t by
+ * @param RIB_entry_t*
+ */
+
+static void linkEntry(RIB_group_t* group, RIB_index_by_t by, RIB_entry_t* entry) {
+  entry->group[by] = group;
+  entry->prev[by] = NULL;
+  entry->next[by] = group->head;
+  if (group->head != NULL) {
+    group->head->prev[by] = entry;
+  }
+  group->head = entry;
+  group->routes++;
+}
+
+/**
+ * @function unlinkEntry
+ * @description remove an entry from its group; the group is freed when it gets empty
+ * @param RIB_index_t*
+ * @param RIB_index_by_t by
+ * @param RIB_entry_t*
+ */
+
+static void unlinkEntry(RIB_index_t* index, RIB_index_by_t by, RIB_entry_t* entry) {
+  RIB_group_t* group = entry->group[by];
+  if (group == NULL) {
+    return;
+  }
+  if (entry->prev[by] != NULL) {
+    entry->prev[by]->next[by] = entry->next[by];
+  } else {
+    group->head = entry->next[by];
+  }
+  if (entry->next[by] != NULL) {
+    entry->next[by]->prev[by] = entry->prev[by];
+  }
+  entry->group[by] = NULL;
+  entry->prev[by] = NULL;
+  entry->next[by] = NULL;
+  if (--group->routes == 0 && group->memberRoutes == 0) {
+    dropGroup(index, by, group);
+  }
+}
+
+/**
+ * @function memberKey
+ * @description returns the interface or the gateway of a next hop
+ * @param const RIB_nexthop_t*
+ * @param RIB_index_by_t by
+ * @returns const char*
+ */
+
+static inline const char* memberKey(const RIB_nexthop_t* nexthop, RIB_index_by_t by) {
+  return by == RIB_BY_IFACE ? nexthop->iface : nexthop->gateway;
+}
+
+/**
+ * @function unlinkMembers
+ * @description remove the links of the equal cost next hops of a route from their groups; the groups are freed when they get empty
+ * @param RIB_index_t*
+ * @param RIB_member_t* members
+ * @param size_t count
+ */
+
+static void unlinkMembers(RIB_index_t* index, RIB_member_t* members, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    RIB_member_t* member = &members[i];
+    for (int by = RIB_BY_IFACE; by <= RIB_BY_GATEWAY; by++) {
+      RIB_group_t* group = member->group[by];
+      if (group == NULL) {
+        continue;
+      }
+      if (member->prev[by] != NULL) {
+        member->prev[by]->next[by] = member->next[by];
+      } else {
+        group->members = member->next[by];
+      }
+      if (member->next[by] != NULL) {
+        member->next[by]->prev[by] = member->prev[by];
+      }
+      member->group[by] = NULL;
+      if (--group->memberRoutes == 0 && group->routes == 0) {
+        dropGroup(index, (RIB_index_by_t) by, group);
+      }
+    }
+  }
+}
+
+/**
+ * @function linkMembers
+ * @description add the equal cost next hops of a route to the groups of their interfaces and gateways;
+ *              the route is added once to each group, even if more next hops go through its key
+ * @param RIB_index_t*
+ * @param RIB_entry_t*
+ * @param const RIB_nhgroup_t* group
+ * @param RIB_member_t* members: group->count links
+ * @returns RIB_ret_code_t: RIB_BAD_ALLOC if a group couldn't be created (nothing is linked)
+ */
+
+static RIB_ret_code_t linkMembers(RIB_index_t* index, RIB_entry_t* entry, const RIB_nhgroup_t* group, RIB_member_t* members) {
+  for (size_t i = 0; i < group->count; i++) {
+    members[i].entry = entry;
+    members[i].group[RIB_BY_IFACE] = NULL;
+    members[i].group[RIB_BY_GATEWAY] = NULL;
+  }
+  for (size_t i = 0; i < group->count; i++) {
+    for (int by = RIB_BY_IFACE; by <= RIB_BY_GATEWAY; by++) {
+      const char* key = memberKey(&group->members[i], (RIB_index_by_t) by);
+      int duplicate = 0;
+      for (size_t j = 0; j < i && !duplicate; j++) {
+        duplicate = strcmp(memberKey(&group->members[j], (RIB_index_by_t) by), key) == 0;
+      }
+      if (duplicate) {
+        continue;
+      }
+      RIB_group_t* keyGroup = getGroup(index, (RIB_index_by_t) by, key);
+      if (keyGroup == NULL) {
+        unlinkMembers(index, members, i + 1);
+        return RIB_BAD_ALLOC;
+      }
+      RIB_member_t* member = &members[i];
+      member->group[by] = keyGroup;
+      member->prev[by] = NULL;
+      member->next[by] = keyGroup->members;
+      if (keyGroup->members != NULL) {
+        keyGroup->members->prev[by] = member;
+      }
+      keyGroup->members = member;
+      keyGroup->memberRoutes++;
+    }
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function unlinkRoute
+ * @description remove a route from the reverse index
+ * @param RIB_index_t*
+ * @param Route*
+ */
+
+static void unlinkRoute(RIB_index_t* index, Route* route) {
+  RIB_entry_t* entry = RIB_entry_of(route);
+  unlinkEntry(index, RIB_BY_IFACE, entry);
+  unlinkEntry(index, RIB_BY_GATEWAY, entry);
+  if (entry->members != NULL) {
+    unlinkMembers(index, entry->members, entry->nexthops->count);
+    free(entry->members);
+    entry->members = NULL;
+  }
+}
+
+/**
+ * @function RIB_index_create
+ * @description allocate an empty index
+ * @param RIB_index_t** index
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_index_create(RIB_index_t** index) {
+  *index = (RIB_index_t*) malloc(sizeof(RIB_index_t));
+  if (*index == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  RIB_ptree_init(&(*index)->trees[0]);
+  RIB_ptree_init(&(*index)->trees[1]);
+  memset((*index)->by, 0, sizeof((*index)->by));
+  RIB_ptree_init(&(*index)->gateways[0]);
+  RIB_ptree_init(&(*index)->gateways[1]);
+  if (RIB_nhtable_create(&(*index)->nexthops) != RIB_NO_ERROR) {
+    free(*index);
+    *index = NULL;
+    return RIB_BAD_ALLOC;
+  }
+  (*index)->damp = NULL;
+  (*index)->sharedNexthops = 0;
+  (*index)->expiries = NULL;
+  (*index)->sources = NULL;
+  (*index)->hits = NULL;
+  (*index)->generation = 0;
+  (*index)->reloading = 0;
+  (*index)->bulk = 0;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_index_clear
+ * @description remove all the prefixes from the index (routes are not freed) and end the reload or the bulk load in progress
+ * @param RIB_index_t* index
+ */
+
+void RIB_index_clear(RIB_index_t* index) {
+  RIB_ptree_clear(&index->trees[0]);
+  RIB_ptree_clear(&index->trees[1]);
+  clearGroups(&index->by[RIB_BY_IFACE]);
+  clearGroups(&index->by[RIB_BY_GATEWAY]);
+  RIB_ptree_clear(&index->gateways[0]);
+  RIB_ptree_clear(&index->gateways[1]);
+  if (index->expiries != NULL) {
+    RIB_wheel_init(index->expiries, index->expiries->resolution, index->expiries->tick * index->expiries->resolution);
+  }
+  if (index->hits != NULL) {
+    RIB_hits_clear(index->hits, 0, index->hits->capacity);
+  }
+  index->generation = 0;
+  index->reloading = 0;
+  index->bulk = 0;
+}
+
+/**
+ * @function RIB_index_free
+ * @description free the index (routes are not freed, next hop groups are freed by the routes which use them,
+ *              the dampening state and the source specific routes are freed by the RIB); NULL is allowed
+ * @param RIB_index_t* index
+ */
+
+void RIB_index_free(RIB_index_t* index) {
+  if (index == NULL) {
+    return;
+  }
+  RIB_index_clear(index);
+  if (!index->sharedNexthops) {
+    RIB_nhtable_free(index->nexthops);
+  }
+  free(index->expiries);
+  RIB_hits_free(index->hits);
+  free(index);
+}
+
+/**
+ * @function RIB_index_insert
+ * @description index a route by its prefix
+ * @param RIB_index_t* index
+ * @param Route* route
+ * @returns RIB_ret_code_t: RIB_DUP_RECORD if the prefix is already indexed
+ */
+
+RIB_ret_code_t RIB_index_insert(RIB_index_t* index, Route* route) {
+  RIB_TRACE_BEGIN(start);
+  RIB_prefix_t prefix;
+  if (RIB_prefix_from_route(route, &prefix) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  RIB_ptree_t* tree = RIB_index_tree(index, route->ipv);
+  RIB_ret_code_t rc = RIB_ptree_insert(tree, &prefix, route);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  RIB_entry_t* entry = RIB_entry_of(route);
+  RIB_group_t* iface = getGroup(index, RIB_BY_IFACE, route->iface);
+  RIB_group_t* gateway = iface != NULL ? getGroup(index, RIB_BY_GATEWAY, route->gateway) : NULL;
+  if (gateway == NULL) {
+    if (iface != NULL && iface->routes == 0 && iface->memberRoutes == 0) {
+      dropGroup(index, RIB_BY_IFACE, iface);
+    }
+    RIB_ptree_remove(tree, &prefix);
+    return RIB_BAD_ALLOC;
+  }
+  linkEntry(iface, RIB_BY_IFACE, entry);
+  linkEntry(gateway, RIB_BY_GATEWAY, entry);
+  //Equal cost next hops
+  entry->members = NULL;
+  if (entry->nexthops != NULL) {
+    RIB_member_t* members = (RIB_member_t*) malloc(sizeof(RIB_member_t) * entry->nexthops->count);
+    rc = members != NULL ? linkMembers(index, entry, entry->nexthops, members) : RIB_BAD_ALLOC;
+    if (rc != RIB_NO_ERROR) {
+      free(members);
+      unlinkRoute(index, route);
+      RIB_ptree_remove(tree, &prefix);
+      return rc;
+    }
+    entry->members = members;
+  }
+  invalidatePrefix(index, route->ipv, &prefix);
+  RIB_TRACE_END(RIB_TRACE_INDEX_INSERT, start, route->ipv, &prefix);
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_index_remove
+ * @description remove a route from the index
+ * @param RIB_index_t* index
+ * @param Route* route
+ */
+
+void RIB_index_remove(RIB_index_t* index, Route* route) {
+  RIB_TRACE_BEGIN(start);
+  RIB_prefix_t prefix;
+  if (RIB_prefix_from_route(route, &prefix) != 0) {
+    return;
+  }
+  RIB_ptree_t* tree = RIB_index_tree(index, route->ipv);
+  RIB_ptnode_t* node = RIB_ptree_find(tree, &prefix);
+  if (node != NULL && node->route == route) {
+    RIB_ptree_remove_node(tree, node);
+    unlinkRoute(index, route);
+    invalidatePrefix(index, route->ipv, &prefix);
+  }
+  RIB_TRACE_END(RIB_TRACE_INDEX_REMOVE, start, route->ipv, &prefix);
+}
+
+/**
+ * @function RIB_index_find
+ * @description returns the route with exactly the provided prefix
+ * @param const RIB_index_t* index
+ * @param int ipv
+ * @param const RIB_prefix_t* prefix
+ * @returns Route*: NULL if not found
+ */
+
+Route* RIB_index_find(const RIB_index_t* index, int ipv, const RIB_prefix_t* prefix) {
+  const RIB_ptnode_t* node = RIB_ptree_find(&index->trees[ipv == 6 ? 1 : 0], prefix);
+  return node != NULL ? node->route : NULL;
+}
+
+/**
+ * @function RIB_index_find_address
+ * @description returns the route stored first in the RIB among the ones whose network address is exactly the provided address (any length)
+ * @param const RIB_index_t* index
+ * @param int ipv
+ * @param const RIB_prefix_t* address: full length address
+ * @returns Route*: NULL if not found
+ */
+
+Route* RIB_index_find_address(const RIB_index_t* index, int ipv, const RIB_prefix_t* address) {
+  Route* first = NULL;
+  //All the candidates lay on the path of the address
+  const RIB_ptnode_t* node = index->trees[ipv == 6 ? 1 : 0].root;
+  while (node != NULL) {
+    RIB_prefix_t masked = *address;
+    RIB_prefix_mask(&masked, node->prefix.length);
+    if (masked.hi != node->prefix.hi || masked.lo != node->prefix.lo) {
+      break;
+    }
+    if (node->route != NULL && node->prefix.hi == address->hi && node->prefix.lo == address->lo) {
+      if (first == NULL || RIB_entry_of(node->route)->slot < RIB_entry_of(first)->slot) {
+        first = node->route;
+      }
+    }
+    if (node->prefix.length >= address->length) {
+      break;
+    }
+    node = node->child[RIB_prefix_bit(address, node->prefix.length)];
+  }
+  return first;
+}
+
+/**
+ * @function RIB_index_detach
+ * @description remove from the index a prefix and all its more specifics in a single operation
+ * @param RIB_index_t* index
+ * @param int ipv
+ * @param const RIB_prefix_t* prefix
+ * @param Route*** routes: array of the removed routes, to be freed by the caller (NULL if there are none)
+ * @param size_t* count: number of removed routes
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_index_detach(RIB_index_t* index, int ipv, const RIB_prefix_t* prefix, Route*** routes, size_t* count) {
+  *routes = NULL;
+  *count = 0;
+  RIB_ptree_t* tree = RIB_index_tree(index, ipv);
+  RIB_ptnode_t* top = RIB_ptree_subtree(tree, prefix);
+  if (top == NULL) {
+    return RIB_NO_ERROR;
+  }
+  size_t entries = 0;
+  for (RIB_ptnode_t* node = top; node != NULL; node = RIB_ptree_next(node, top)) {
+    entries += node->route != NULL;
+  }
+  if (entries > 0) {
+    *routes = (Route**) malloc(sizeof(Route*) * entries);
+    if (*routes == NULL) {
+      return RIB_BAD_ALLOC;
+    }
+    for (RIB_ptnode_t* node = top; node != NULL; node = RIB_ptree_next(node, top)) {
+      if (node->route != NULL) {
+        unlinkRoute(index, node->route);
+        (*routes)[(*count)++] = node->route;
+      }
+    }
+  }
+  RIB_ptree_prune(tree, top);
+  invalidatePrefix(index, ipv, prefix);
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_index_group
+ * @description get the routes using an interface or a gateway
+ * @param const RIB_index_t* index
+ * @param RIB_index_by_t by
+ * @param const char* key: interface or formatted gateway address
+ * @param Route*** routes: array of the routes, to be freed by the caller (NULL if there are none)
+ * @param size_t* count
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_index_group(const RIB_index_t* index, RIB_index_by_t by, const char* key, Route*** routes, size_t* count) {
+  *routes = NULL;
+  *count = 0;
+  const RIB_group_t* group = findGroup(&index->by[by], key);
+  if (group == NULL || group->routes == 0) {
+    return RIB_NO_ERROR;
+  }
+  *routes = (Route**) malloc(sizeof(Route*) * group->routes);
+  if (*routes == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  for (RIB_entry_t* entry = group->head; entry != NULL; entry = entry->next[by]) {
+    (*routes)[(*count)++] = &entry->route;
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_index_members
+ * @description get the routes with an equal cost next hop through an interface or a gateway (routes without
+ *              equal cost next hops are only in RIB_index_group)
+ * @param const RIB_index_t* index
+ * @param RIB_index_by_t by
+ * @param const char* key: interface or formatted gateway address
+ * @param Route*** routes: array of the routes, once each, to be freed by the caller (NULL if there are none)
+ * @param size_t* count
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_index_members(const RIB_index_t* index, RIB_index_by_t by, const char* key, Route*** routes, size_t* count) {
+  *routes = NULL;
+  *count = 0;
+  const RIB_group_t* group = findGroup(&index->by[by], key);
+  if (group == NULL || group->memberRoutes == 0) {
+    return RIB_NO_ERROR;
+  }
+  *routes = (Route**) malloc(sizeof(Route*) * group->memberRoutes);
+  if (*routes == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  for (const RIB_member_t* member = group->members; member != NULL; member = member->next[by]) {
+    (*routes)[(*count)++] = &member->entry->route;
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_index_set_nexthops
+ * @description replace the equal cost next hops of a route stored in the index; the new links are added before
+ *              the old ones are removed, so the groups of the next hops kept by the route aren't created again
+ * @param RIB_index_t* index
+ * @param Route* route
+ * @param RIB_nhgroup_t* group: referenced next hop group, taken on success (NULL if the route has only its gateway)
+ * @param RIB_member_t* members: group->count links, taken on success (NULL if group is NULL)
+ * @returns RIB_ret_code_t: RIB_BAD_ALLOC if a group couldn't be created (the route is left untouched)
+ */
+
+RIB_ret_code_t RIB_index_set_nexthops(RIB_index_t* index, Route* route, RIB_nhgroup_t* group, RIB_member_t* members) {
+  RIB_entry_t* entry = RIB_entry_of(route);
+  if (group != NULL) {
+    RIB_ret_code_t rc = linkMembers(index, entry, group, members);
+    if (rc != RIB_NO_ERROR) {
+      return rc;
+    }
+  }
+  if (entry->members != NULL) {
+    unlinkMembers(index, entry->members, entry->nexthops->count);
+    free(entry->members);
+  }
+  RIB_nhgroup_release(entry->nexthops);
+  entry->nexthops = group;
+  entry->members = members;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_index_resolve
+ * @description resolve the next hop of a route stored in the index to a directly connected route (routes with the unspecified gateway)
+ * @param RIB_index_t* index
+ * @param Route* route
+ * @returns Route*: the route itself if it's directly connected; NULL if the next hop is unreachable
+ */
+
+Route* RIB_index_resolve(RIB_index_t* index, Route* route) {
+  if (isConnected(route)) {
+    return route;
+  }
+  RIB_group_t* gateway = RIB_entry_of(route)->group[RIB_BY_GATEWAY];
+  return gateway != NULL ? resolveGroup(index, gateway) : NULL;
+}
+
+/**
+ * @function RIB_index_rekey
+ * @description move all the routes of a group to another key (the routes attributes must be changed by the caller);
+ *              the equal cost next hops through the key are left to RIB_index_set_nexthops
+ * @param RIB_index_t* index
+ * @param RIB_index_by_t by
+ * @param const char* key
+ * @param const char* newKey
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_index_rekey(RIB_index_t* index, RIB_index_by_t by, const char* key, const char* newKey) {
+  RIB_group_t* group = findGroup(&index->by[by], key);
+  if (group == NULL || strcmp(key, newKey) == 0) {
+    return RIB_NO_ERROR;
+  }
+  RIB_group_t* newGroup = getGroup(index, by, newKey);
+  if (newGroup == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  //getGroup may have rehashed, but groups are never moved
+  while (group->head != NULL) {
+    RIB_entry_t* entry = group->head;
+    group->head = entry->next[by];
+    linkEntry(newGroup, by, entry);
+    //Resolutions through this route change with its next hop
+    RIB_prefix_t prefix;
+    if (by == RIB_BY_GATEWAY && RIB_prefix_from_route(&entry->route, &prefix) == 0) {
+      invalidatePrefix(index, entry->route.ipv, &prefix);
+    }
+  }
+  group->routes = 0;
+  if (group->memberRoutes == 0) {
+    dropGroup(index, by, group);
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_index_key
+ * @description get the prefix of a network address as provided to the RIB functions (netmask for ipv4, prefix length for ipv6)
+ * @param const char* networkAddr
+ * @param const char* netmask
+ * @param int ipv
+ * @param RIB_prefix_t* prefix
+ * @returns int: 0 if succeeded; 1 if the address is invalid or it is not a network address
+ */
+
+int RIB_index_key(const char* networkAddr, const char* netmask, int ipv, RIB_prefix_t* prefix) {
+  if (netmask == NULL || RIB_prefix_from_address(networkAddr, ipv, prefix) != 0) {
+    return 1;
+  }
+  int length;
+  if (ipv == 4) {
+    if (isValidIpAddress(netmask, NULL) != 0) {
+      return 1;
+    }
+    length = getCIDRnetmask(netmask);
+  } else {
+    length = atoi(netmask);
+    length = length - (length % 8);
+  }
+  if (length < 0 || length > RIB_prefix_max_length(ipv)) {
+    return 1;
+  }
+  const RIB_prefix_t address = *prefix;
+  RIB_prefix_mask(prefix, length);
+  return prefix->hi != address.hi || prefix->lo != address.lo;
+}
@@ -0,0 +1,177 @@
+/**
+ *   librib - index.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef RIB_INDEX_H
+#define RIB_INDEX_H
+
+#include "candidate.h"
+#include "damp.h"
+#include "hits.h"
+#include "nexthop.h"
+#include "ptree.h"
+#include "srcdst.h"
+#include "wheel.h"
+
+#include <rib/rib.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Prefix index of the RIB: one patricia tree for each ip version, used for exact lookups
+ * (duplicate check, find, delete, update) without scanning the routes, and a reverse index from
+ * interfaces and gateways to their routes and to the routes with an equal cost next hop through them.
+ * Gateway groups also cache the resolution of the gateway to a directly connected route, invalidated
+ * when a prefix covering the gateway changes.
+ * Routes are allocated as RIB entries, which carry the bookkeeping of the RIB; since the Route is the
+ * first member, a Route* stored in the RIB can be converted to its entry.
+ */
+
+// Data types
+
+typedef enum RIB_index_by_t {
+  RIB_BY_IFACE = 0,
+  RIB_BY_GATEWAY = 1
+} RIB_index_by_t;
+
+/**
+ * Link of an equal cost next hop of a route in the groups of its interface and of its gateway
+ */
+
+typedef struct RIB_member_t {
+  struct RIB_entry_t* entry;
+  struct RIB_group_t* group[2]; //NULL if a previous member of the route has the same key
+  struct RIB_member_t* prev[2];
+  struct RIB_member_t* next[2];
+} RIB_member_t;
+
+/**
+ * Routes sharing the same interface or gateway, linked through their entries
+ */
+
+typedef struct RIB_group_t {
+  char* key;
+  struct RIB_entry_t* head;
+  size_t routes;
+  RIB_member_t* members;  //Routes with an equal cost next hop through the key, once each
+  size_t memberRoutes;
+  struct RIB_group_t* next; //Next group in the same bucket
+  //Next hop resolution cache (gateway groups only)
+  RIB_prefix_t address;
+  int ipv;
+  int resolved;                   //Whether the cache is valid
+  int resolving;                  //Loop detection
+  Route* connected;               //Directly connected route reaching the gateway (NULL if unreachable)
+  struct RIB_group_t* via;        //Gateway group the resolution depends on (recursive next hop)
+  struct RIB_group_t* dependents; //Groups resolved through this one
+  struct RIB_group_t* prevDependent;
+  struct RIB_group_t* nextDependent;
+} RIB_group_t;
+
+typedef struct RIB_groups_t {
+  RIB_group_t** buckets;
+  size_t size; //Number of buckets (power of 2)
+  size_t groups;
+} RIB_groups_t;
+
+typedef struct RIB_entry_t {
+  Route route;         //Must be the first member
+  uint64_t generation; //Reload generation in which the route has been added or refreshed
+  size_t slot;         //Position in rtab->routes
+  //Reverse index links, by RIB_index_by_t
+  RIB_group_t* group[2];
+  struct RIB_entry_t* prev[2];
+  struct RIB_entry_t* next[2];
+  RIB_nhgroup_t* nexthops; //Equal cost next hops; NULL if the route has only its gateway
+  RIB_member_t* members;   //Reverse index links of the next hops, one for each member of nexthops; NULL while not indexed
+  RIB_candidates_t* candidates; //Candidate routes of the prefix; NULL if the route has been added with RIB_add
+  RIB_timer_t expiry;  //Deadline of the route (0 if it doesn't expire); scheduled while the route is stored
+} RIB_entry_t;
+
+typedef struct RIB_index_t {
+  RIB_ptree_t trees[2]; //IPv4 and IPv6 prefixes
+  RIB_groups_t by[2];   //Routes by interface and by gateway
+  RIB_ptree_t gateways[2]; //Gateway groups by address, to invalidate resolutions covered by a changed prefix
+  RIB_nhtable_t* nexthops; //Shared equal cost next hop groups
+  int sharedNexthops;   //Whether the next hop groups are owned by a VRF container
+  RIB_damp_t* damp;     //Route flap dampening state; NULL if disabled
+  RIB_wheel_t* expiries; //Deadlines of the routes added with a TTL; NULL until the first one
+  RIB_srcdst_t* sources; //Source specific routes; NULL until the first one
+  RIB_hits_t* hits;     //Lookup hit counters by route slot; NULL if disabled
+  uint64_t generation;  //Current reload generation
+  int reloading;
+  int bulk;             //Whether a bulk load is running (linear engines until RIB_bulk_end)
+} RIB_index_t;
+
+// Functions
+
+RIB_ret_code_t RIB_index_create(RIB_index_t** index);
+void RIB_index_clear(RIB_index_t* index);
+void RIB_index_free(RIB_index_t* index);
+RIB_ret_code_t RIB_index_insert(RIB_index_t* index, Route* route);
+void RIB_index_remove(RIB_index_t* index, Route* route);
+Route* RIB_index_find(const RIB_index_t* index, int ipv, const RIB_prefix_t* prefix);
+Route* RIB_index_find_address(const RIB_index_t* index, int ipv, const RIB_prefix_t* address);
+RIB_ret_code_t RIB_index_detach(RIB_index_t* index, int ipv, const RIB_prefix_t* prefix, Route*** routes, size_t* count);
+RIB_ret_code_t RIB_index_group(const RIB_index_t* index, RIB_index_by_t by, const char* key, Route*** routes, size_t* count);
+RIB_ret_code_t RIB_index_members(const RIB_index_t* index, RIB_index_by_t by, const char* key, Route*** routes, size_t* count);
+RIB_ret_code_t RIB_index_set_nexthops(RIB_index_t* index, Route* route, RIB_nhgroup_t* group, RIB_member_t* members);
+Route* RIB_index_resolve(RIB_index_t* index, Route* route);
+RIB_ret_code_t RIB_index_rekey(RIB_index_t* index, RIB_index_by_t by, const char* key, const char* newKey);
+int RIB_index_key(const char* networkAddr, const char* netmask, int ipv, RIB_prefix_t* prefix);
+
+/**
+ * @function RIB_index_tree
+ * @description returns the prefix tree for the provided ip version
+ * @param RIB_index_t*
+ * @param int ipv
+ * @returns RIB_ptree_t*
+ */
+
+static inline RIB_ptree_t* RIB_index_tree(RIB_index_t* index, int ipv) {
+  return &index->trees[ipv == 6 ? 1 : 0];
+}
+
+/**
+ * @function RIB_entry_of
+ * @description returns the RIB entry of a route stored in the RIB
+ * @param Route*
+ * @returns RIB_entry_t*
+ */
+
+static inline RIB_entry_t* RIB_entry_of(Route* route) {
+  return (RIB_entry_t*) route;
+}
+
+/**
+ * @function RIB_entry_of_expiry
+ * @description returns the RIB entry of an expiry timer
+ * @param RIB_timer_t*
+ * @returns RIB_entry_t*
+ */
+
+static inline RIB_entry_t* RIB_entry_of_expiry(RIB_timer_t* timer) {
+  return (RIB_entry_t*) ((char*) timer - offsetof(RIB_entry_t, expiry));
+}
+
+#endif
@@ -75,13 +75,14 @@ int getCIDRnetmask(const char *netmask) {
   char* tmpNetmask = (char*) malloc(sizeof(char) * (netmaskLen + 1));
   memcpy(tmpNetmask, netmask, netmaskLen);
   tmpNetmask[netmaskLen] = 0x00;
-  char* netmaskToken = strtok(tmpNetmask, ".");
+  char* savePtr;
+  char* netmaskToken = strtok_r(tmpNetmask, ".", &savePtr);
   int ipbytes[4];
   int cidrNetmask = 0;
   size_t i = 0;
   while (netmaskToken) {
     ipbytes[i++] = atoi(netmaskToken);
-    netmaskToken = strtok(NULL, ".");
+    netmaskToken = strtok_r(NULL, ".", &savePtr);
   }
   free(tmpNetmask);
   for (int i = 0; i < 4; i++) {
@@ -145,19 +146,20 @@ char* getIpv4NetworkAddress(const char* ipAddress, const char* netmask) {
   strcpy(tmpNetmask, netmask);
   //Get ip address tokens
   int ipBytes[4];
-  char* ipToken = strtok(tmpAddr, ".");
+  char* savePtr;
+  char* ipToken = strtok_r(tmpAddr, ".", &savePtr);
   size_t i = 0;
   while (ipToken) {
     ipBytes[i++] = atoi(ipToken);
-    ipToken = strtok(NULL, ".");
+    ipToken = strtok_r(NULL, ".", &savePtr);
   }
   //Get netmask tokens
   int netmaskBytes[4];
-  char* netmaskToken = strtok(tmpNetmask, ".");
+  char* netmaskToken = strtok_r(tmpNetmask, ".", &savePtr);
   i = 0;
   while (netmaskToken) {
     netmaskBytes[i++] = atoi(netmaskToken);
-    netmaskToken = strtok(NULL, ".");
+    netmaskToken = strtok_r(NULL, ".", &savePtr);
   }
   //Free tokens
   free(tmpAddr);
@@ -183,7 +185,8 @@ char* getIpv4NetworkAddress(const char* ipAddress, const char* netmask) {
 void formatIPv4Address(char** ipAddress) {
   size_t newAddrSize = 3; //3 dots
   int ipBytes[4];
-  char* ipToken = strtok(*ipAddress, ".");
+  char* savePtr;
+  char* ipToken = strtok_r(*ipAddress, ".", &savePtr);
   for (int i = 0; ipToken && i < 4; i++) {
     ipBytes[i] = atoi(ipToken);
     if (ipBytes[i] < 10) {
@@ -193,7 +196,7 @@ void formatIPv4Address(char** ipAddress) {
     } else {
       newAddrSize += 3;
     }
-    ipToken = strtok(NULL, ".");
+    ipToken = strtok_r(NULL, ".", &savePtr);
   }
   *ipAddress = (char*) realloc(*ipAddress, sizeof(char) * (newAddrSize + 1));
   sprintf(*ipAddress, "%d.%d.%d.%d", ipBytes[0], ipBytes[1], ipBytes[2], ipBytes[3]);
@@ -238,29 +241,11 @@ char* getIpv6NetworkAddress(const char* ipAddress, int prefixLength) {
   char* networkAddress;
   if (inet_pton(AF_INET6, ipAddress, &ipv6Addr) == 1) {
     networkAddress = (char*) malloc(sizeof(char) * (newAddrSize + 1));
-    int bytes = prefixLength / 8;
-    int putColumn = 0;
-    int addrIndex = 0;
-    int networkAddressPartSize = (bytes * 2) + (bytes / 2);
-    int i = 0;
-    while (i < networkAddressPartSize) {
-      char addrPart[3];
-      sprintf(addrPart, "%02x", ipv6Addr.s6_addr[addrIndex++]);
-      memcpy(networkAddress + i, addrPart, 2);
-      i += 2;
-      if (putColumn == 1 && i < newAddrSize ) {
-        networkAddress[i++] = ':';
-      }
-      putColumn = 1 - putColumn;
-    }
-    while (i < newAddrSize) {
-      memcpy(networkAddress + i, "00", 2);
-      i += 2;
-      if (putColumn && i + 1 < newAddrSize ) {
-        networkAddress[i++] = ':';
-      }
-      putColumn = 1 - putColumn;
+    //Clear host bytes
+    for (int i = (prefixLength < 0 ? 0 : prefixLength / 8); i < 16; i++) {
+      ipv6Addr.s6_addr[i] = 0x00;
     }
+    sprintf(networkAddress, "%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x", ipv6Addr.s6_addr[0], ipv6Addr.s6_addr[1], ipv6Addr.s6_addr[2], ipv6Addr.s6_addr[3], ipv6Addr.s6_addr[4], ipv6Addr.s6_addr[5], ipv6Addr.s6_addr[6], ipv6Addr.s6_addr[7], ipv6Addr.s6_addr[8], ipv6Addr.s6_addr[9], ipv6Addr.s6_addr[10], ipv6Addr.s6_addr[11], ipv6Addr.s6_addr[12], ipv6Addr.s6_addr[13], ipv6Addr.s6_addr[14], ipv6Addr.s6_addr[15]);
     return networkAddress;
   }
   return NULL;
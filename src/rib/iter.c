@@ -0,0 +1,233 @@
+/**
+ *   librib - iter.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include <rib/iputils.h>
+#include <rib/rib.h>
+
+#include "index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Iterators over the prefix index.
+ * An iterator is valid until the RIB is modified; a walk can be resumed after modifications through its cursor.
+ */
+
+typedef enum RIB_iter_mode_t {
+  RIB_ITER_WALK,    //Pre-order visit of a subtree (or the whole tree)
+  RIB_ITER_COVERING //Path from the root to the address
+} RIB_iter_mode_t;
+
+struct RIB_iter_t {
+  RIB_iter_mode_t mode;
+  int ipv;
+  RIB_ptnode_t* node;  //Next node to visit
+  RIB_ptnode_t* top;   //Root of the visited subtree; NULL for the whole tree
+  RIB_prefix_t key;    //Covering: address to match
+  RIB_prefix_t last;   //Prefix of the last returned route
+  int started;
+};
+
+/**
+ * @function newIter
+ * @description allocate an iterator
+ * @param RIB_iter_mode_t mode
+ * @param int ipv
+ * @param RIB_iter_t** iter
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t newIter(RIB_iter_mode_t mode, int ipv, RIB_iter_t** iter) {
+  *iter = (RIB_iter_t*) calloc(1, sizeof(RIB_iter_t));
+  if (*iter == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  (*iter)->mode = mode;
+  (*iter)->ipv = ipv;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_iter_more_specifics
+ * @description iterate over the routes contained in a prefix (the prefix itself included), in prefix order
+ * @param RIB* rtab
+ * @param const char* networkAddr
+ * @param const char* netmask/prefix char representation
+ * @param RIB_iter_t** iter
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_iter_more_specifics(RIB* rtab, const char* networkAddr, const char* netmask, RIB_iter_t** iter) {
+  *iter = NULL;
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  int ipVersion;
+  RIB_prefix_t prefix;
+  if (isValidIpAddress(networkAddr, &ipVersion) != 0 || RIB_index_key(networkAddr, netmask, ipVersion, &prefix) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  RIB_ret_code_t rc = newIter(RIB_ITER_WALK, ipVersion, iter);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  (*iter)->top = RIB_ptree_subtree(RIB_index_tree(rtab->index, ipVersion), &prefix);
+  (*iter)->node = (*iter)->top;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_iter_covering
+ * @description iterate over all the routes matching an address, from the shortest prefix to the longest one
+ * @param RIB* rtab
+ * @param const char* address
+ * @param RIB_iter_t** iter
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_iter_covering(RIB* rtab, const char* address, RIB_iter_t** iter) {
+  *iter = NULL;
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  int ipVersion;
+  RIB_prefix_t key;
+  if (isValidIpAddress(address, &ipVersion) != 0 || RIB_prefix_from_address(address, ipVersion, &key) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  key.length = RIB_prefix_max_length(ipVersion);
+  RIB_ret_code_t rc = newIter(RIB_ITER_COVERING, ipVersion, iter);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  (*iter)->key = key;
+  (*iter)->node = RIB_index_tree(rtab->index, ipVersion)->root;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_iter_walk
+ * @description iterate over all the routes of an ip version in prefix order, starting after the cursor position
+ * @param RIB* rtab
+ * @param int ipv
+ * @param const RIB_cursor_t* cursor: position returned by RIB_iter_cursor; NULL to start from the first route
+ * @param RIB_iter_t** iter
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_iter_walk(RIB* rtab, int ipv, const RIB_cursor_t* cursor, RIB_iter_t** iter) {
+  *iter = NULL;
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if ((ipv != 4 && ipv != 6) || (cursor != NULL && cursor->ipv != 0 && cursor->ipv != ipv)) {
+    return RIB_INVALID_ADDRESS;
+  }
+  RIB_ret_code_t rc = newIter(RIB_ITER_WALK, ipv, iter);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  RIB_ptree_t* tree = RIB_index_tree(rtab->index, ipv);
+  if (cursor != NULL && cursor->ipv != 0) {
+    RIB_prefix_t key;
+    RIB_prefix_from_bytes(cursor->address, ipv, &key);
+    RIB_prefix_mask(&key, cursor->prefixLength);
+    (*iter)->node = RIB_ptree_first_after(tree, &key);
+    (*iter)->last = key;
+    (*iter)->started = 1;
+  } else {
+    (*iter)->node = tree->root;
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_iter_next
+ * @description returns the next route of the iterator
+ * @param RIB_iter_t* iter
+ * @returns Route*: NULL at the end of the iteration
+ */
+
+Route* RIB_iter_next(RIB_iter_t* iter) {
+  if (iter == NULL) {
+    return NULL;
+  }
+  if (iter->mode == RIB_ITER_COVERING) {
+    while (iter->node != NULL) {
+      RIB_ptnode_t* node = iter->node;
+      RIB_prefix_t masked = iter->key;
+      RIB_prefix_mask(&masked, node->prefix.length);
+      if (masked.hi != node->prefix.hi || masked.lo != node->prefix.lo) {
+        iter->node = NULL;
+        break;
+      }
+      iter->node = node->prefix.length < iter->key.length ? node->child[RIB_prefix_bit(&iter->key, node->prefix.length)] : NULL;
+      if (node->route != NULL) {
+        iter->last = node->prefix;
+        iter->started = 1;
+        return node->route;
+      }
+    }
+    return NULL;
+  }
+  //Skip glue nodes
+  while (iter->node != NULL && iter->node->route == NULL) {
+    iter->node = RIB_ptree_next(iter->node, iter->top);
+  }
+  if (iter->node == NULL) {
+    return NULL;
+  }
+  Route* route = iter->node->route;
+  iter->last = iter->node->prefix;
+  iter->started = 1;
+  iter->node = RIB_ptree_next(iter->node, iter->top);
+  return route;
+}
+
+/**
+ * @function RIB_iter_cursor
+ * @description save the position of the iterator (after the last returned route), to resume a walk with RIB_iter_walk
+ * @param const RIB_iter_t* iter
+ * @param RIB_cursor_t* cursor
+ */
+
+void RIB_iter_cursor(const RIB_iter_t* iter, RIB_cursor_t* cursor) {
+  memset(cursor, 0x00, sizeof(RIB_cursor_t));
+  if (iter == NULL || !iter->started) {
+    return;
+  }
+  RIB_prefix_to_bytes(&iter->last, iter->ipv, cursor->address);
+  cursor->prefixLength = iter->last.length;
+  cursor->ipv = iter->ipv;
+}
+
+/**
+ * @function RIB_iter_free
+ * @description free an iterator; NULL is allowed
+ * @param RIB_iter_t* iter
+ */
+
+void RIB_iter_free(RIB_iter_t* iter) {
+  free(iter);
+}
@@ -0,0 +1,505 @@
+/**
+ *   librib - mrt.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+
+#include "mrt.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef WITH_BZIP2
+#include <bzlib.h>
+#endif
+
+#define RIB_MRT_BUFFER 131072
+
+/**
+ * @function getUint16
+ * @description read a 16 bits big endian number
+ * @param const unsigned char*
+ * @returns uint16_t
+ */
+
+static inline uint16_t getUint16(const unsigned char* data) {
+  return (uint16_t) ((data[0] << 8) | data[1]);
+}
+
+/**
+ * @function getUint32
+ * @description read a 32 bits big endian number
+ * @param const unsigned char*
+ * @returns uint32_t
+ */
+
+static inline uint32_t getUint32(const unsigned char* data) {
+  return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) | ((uint32_t) data[2] << 8) | data[3];
+}
+
+#ifdef WITH_BZIP2
+
+/**
+ * @function bzipRead
+ * @description read from a bzip2 file, following concatenated streams (e.g. written by pbzip2)
+ * @param RIB_mrt_reader_t* reader
+ * @param unsigned char* buffer
+ * @param size_t length
+ * @returns long: bytes read; 0 at the end of the file, -1 if the file is corrupted
+ */
+
+static long bzipRead(RIB_mrt_reader_t* reader, unsigned char* buffer, size_t length) {
+  while (reader->stream != NULL) {
+    int error;
+    const int read = BZ2_bzRead(&error, (BZFILE*) reader->stream, buffer, (int) length);
+    if (error == BZ_OK) {
+      return read;
+    }
+    if (error != BZ_STREAM_END) {
+      return -1;
+    }
+    //Start the next stream from the bytes read ahead by the previous one
+    void* unused;
+    int unusedLength;
+    char next[BZ_MAX_UNUSED];
+    BZ2_bzReadGetUnused(&error, (BZFILE*) reader->stream, &unused, &unusedLength);
+    memcpy(next, unused, unusedLength);
+    BZ2_bzReadClose(&error, (BZFILE*) reader->stream);
+    reader->stream = NULL;
+    int c;
+    if (unusedLength == 0 && (c = fgetc(reader->file)) != EOF) {
+      ungetc(c, reader->file);
+    }
+    if (unusedLength > 0 || !feof(reader->file)) {
+      reader->stream = BZ2_bzReadOpen(&error, reader->file, 0, 0, next, unusedLength);
+      if (error != BZ_OK) {
+        BZ2_bzReadClose(&error, (BZFILE*) reader->stream);
+        reader->stream = NULL;
+        return -1;
+      }
+    }
+    if (read > 0) {
+      return read;
+    }
+  }
+  return 0;
+}
+
+#endif
+
+/**
+ * @function readSome
+ * @description read up to length bytes from the file, decompressing them if needed
+ * @param RIB_mrt_reader_t* reader
+ * @param unsigned char* buffer
+ * @param size_t length
+ * @returns long: bytes read; 0 at the end of the file, -1 on error
+ */
+
+static long readSome(RIB_mrt_reader_t* reader, unsigned char* buffer, size_t length) {
+  switch (reader->compression) {
+#ifdef WITH_ZLIB
+    case RIB_MRT_GZIP: {
+      const int read = gzread((gzFile) reader->stream, buffer, (unsigned int) length);
+      int error = Z_OK;
+      //A truncated stream ends with Z_BUF_ERROR
+      if (read == 0) {
+        gzerror((gzFile) reader->stream, &error);
+      }
+      return error == Z_OK ? read : -1;
+    }
+#endif
+#ifdef WITH_BZIP2
+    case RIB_MRT_BZIP2:
+      return bzipRead(reader, buffer, length);
+#endif
+    default: {
+      const size_t read = fread(buffer, 1, length, reader->file);
+      return read > 0 || !ferror(reader->file) ? (long) read : -1;
+    }
+  }
+}
+
+/**
+ * @function readExact
+ * @description read exactly length bytes
+ * @param RIB_mrt_reader_t* reader
+ * @param unsigned char* buffer
+ * @param size_t length
+ * @returns int: 0 if succeeded; 1 if the file ended before the first byte; -1 if it is truncated or not readable
+ */
+
+static int readExact(RIB_mrt_reader_t* reader, unsigned char* buffer, size_t length) {
+  size_t total = 0;
+  while (total < length) {
+    const long read = readSome(reader, buffer + total, length - total);
+    if (read < 0) {
+      return -1;
+    }
+    if (read == 0) {
+      return total == 0 ? 1 : -1;
+    }
+    total += (size_t) read;
+  }
+  return 0;
+}
+
+/**
+ * @function RIB_mrt_open
+ * @description open an MRT file, plain or compressed with gzip or bzip2
+ * @param const char* filename
+ * @param RIB_mrt_reader_t** reader
+ * @returns RIB_ret_code_t: RIB_IO_ERROR if the file can't be opened; RIB_NOT_SUPPORTED if it is compressed and the library has been built without the decompressor
+ */
+
+RIB_ret_code_t RIB_mrt_open(const char* filename, RIB_mrt_reader_t** reader) {
+  FILE* file = fopen(filename, "rb");
+  if (file == NULL) {
+    return RIB_IO_ERROR;
+  }
+  unsigned char magic[3] = {0};
+  const size_t magicLength = fread(magic, 1, sizeof(magic), file);
+  RIB_mrt_compression_t compression = RIB_MRT_PLAIN;
+  if (magicLength >= 2 && magic[0] == 0x1F && magic[1] == 0x8B) {
+    compression = RIB_MRT_GZIP;
+  } else if (magicLength == 3 && memcmp(magic, "BZh", 3) == 0) {
+    compression = RIB_MRT_BZIP2;
+  }
+  rewind(file);
+  *reader = (RIB_mrt_reader_t*) calloc(1, sizeof(RIB_mrt_reader_t));
+  if (*reader == NULL) {
+    fclose(file);
+    return RIB_BAD_ALLOC;
+  }
+  (*reader)->compression = compression;
+  (*reader)->file = file;
+  RIB_ret_code_t rc = RIB_NO_ERROR;
+  if (compression == RIB_MRT_GZIP) {
+#ifdef WITH_ZLIB
+    //zlib reads through its own descriptor
+    (*reader)->stream = gzopen(filename, "rb");
+    if ((*reader)->stream == NULL) {
+      rc = RIB_IO_ERROR;
+    } else {
+      gzbuffer((gzFile) (*reader)->stream, RIB_MRT_BUFFER);
+    }
+#else
+    rc = RIB_NOT_SUPPORTED;
+#endif
+  } else if (compression == RIB_MRT_BZIP2) {
+#ifdef WITH_BZIP2
+    int error;
+    (*reader)->stream = BZ2_bzReadOpen(&error, file, 0, 0, NULL, 0);
+    if (error != BZ_OK) {
+      BZ2_bzReadClose(&error, (BZFILE*) (*reader)->stream);
+      (*reader)->stream = NULL;
+      rc = RIB_IO_ERROR;
+    }
+#else
+    rc = RIB_NOT_SUPPORTED;
+#endif
+  } else {
+    setvbuf(file, NULL, _IOFBF, RIB_MRT_BUFFER);
+  }
+  if (rc != RIB_NO_ERROR) {
+    RIB_mrt_close(*reader);
+    *reader = NULL;
+  }
+  return rc;
+}
+
+/**
+ * @function readPeers
+ * @description decode a PEER_INDEX_TABLE record
+ * @param RIB_mrt_reader_t* reader
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t readPeers(RIB_mrt_reader_t* reader) {
+  const unsigned char* data = reader->record;
+  const size_t length = reader->recordLength;
+  //Collector BGP ID, view name
+  if (length < 6) {
+    return RIB_IO_ERROR;
+  }
+  size_t position = 6 + getUint16(data + 4);
+  if (position + 2 > length) {
+    return RIB_IO_ERROR;
+  }
+  const size_t count = getUint16(data + position);
+  position += 2;
+  RIB_mrt_peer_t* peers = (RIB_mrt_peer_t*) calloc(count > 0 ? count : 1, sizeof(RIB_mrt_peer_t));
+  if (peers == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (position + 5 > length) {
+      free(peers);
+      return RIB_IO_ERROR;
+    }
+    //Bit 0: ipv6 address; bit 1: 4 bytes AS number
+    const unsigned char type = data[position];
+    const size_t addressLength = (type & 0x01) ? 16 : 4;
+    const size_t asLength = (type & 0x02) ? 4 : 2;
+    position += 5;
+    if (position + addressLength + asLength > length) {
+      free(peers);
+      return RIB_IO_ERROR;
+    }
+    peers[i].ipv = addressLength == 16 ? 6 : 4;
+    memcpy(peers[i].address, data + position, addressLength);
+    position += addressLength;
+    peers[i].as = asLength == 4 ? getUint32(data + position) : getUint16(data + position);
+    position += asLength;
+  }
+  free(reader->peers);
+  reader->peers = peers;
+  reader->peerCount = count;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function startRib
+ * @description decode the prefix of a RIB record; its entries are decoded by RIB_mrt_next
+ * @param RIB_mrt_reader_t* reader
+ * @param int ipv
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t startRib(RIB_mrt_reader_t* reader, int ipv) {
+  const unsigned char* data = reader->record;
+  //Sequence number, prefix length
+  if (reader->recordLength < 5) {
+    return RIB_IO_ERROR;
+  }
+  const int length = data[4];
+  const size_t prefixBytes = (size_t) (length + 7) / 8;
+  if (length > (ipv == 6 ? 128 : 32) || 5 + prefixBytes + 2 > reader->recordLength) {
+    return RIB_IO_ERROR;
+  }
+  memset(reader->prefix, 0, sizeof(reader->prefix));
+  memcpy(reader->prefix, data + 5, prefixBytes);
+  reader->ipv = ipv;
+  reader->length = length;
+  reader->entries = getUint16(data + 5 + prefixBytes);
+  reader->position = 5 + prefixBytes + 2;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function readAttributes
+ * @description get the next hop and the AS path length from the BGP path attributes of an entry
+ * @param const unsigned char* data
+ * @param size_t length
+ * @param RIB_mrt_entry_t* entry
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t readAttributes(const unsigned char* data, size_t length, RIB_mrt_entry_t* entry) {
+  unsigned char nexthop[16];
+  unsigned char mpNexthop[16];
+  int hasNexthop = 0;
+  int mpNexthopIpv = 0;
+  size_t position = 0;
+  while (position < length) {
+    if (position + 3 > length) {
+      return RIB_IO_ERROR;
+    }
+    const unsigned char flags = data[position];
+    const unsigned char type = data[position + 1];
+    size_t attributeLength;
+    //Extended length
+    if (flags & 0x10) {
+      if (position + 4 > length) {
+        return RIB_IO_ERROR;
+      }
+      attributeLength = getUint16(data + position + 2);
+      position += 4;
+    } else {
+      attributeLength = data[position + 2];
+      position += 3;
+    }
+    if (position + attributeLength > length) {
+      return RIB_IO_ERROR;
+    }
+    const unsigned char* value = data + position;
+    position += attributeLength;
+    if (type == 2) {
+      //AS_PATH: segments of 4 bytes AS numbers
+      size_t offset = 0;
+      while (offset + 2 <= attributeLength) {
+        const unsigned char segmentType = value[offset];
+        const size_t count = value[offset + 1];
+        offset += 2 + count * 4;
+        if (segmentType == 2) {
+          entry->pathLength += (int) count;
+        } else if (segmentType == 1 || segmentType == 4) {
+          entry->pathLength++;
+        }
+      }
+      if (offset != attributeLength) {
+        return RIB_IO_ERROR;
+      }
+    } else if (type == 3 && attributeLength == 4) {
+      memcpy(nexthop, value, 4);
+      hasNexthop = 1;
+    } else if (type == 14 && attributeLength > 0) {
+      //MP_REACH_NLRI: only the next hop in TABLE_DUMP_V2, but some writers dump the whole attribute
+      const unsigned char* address = value + 1;
+      size_t addressLength = value[0];
+      if (addressLength != attributeLength - 1 && attributeLength >= 4) {
+        address = value + 4;
+        addressLength = value[3];
+        if (4 + addressLength > attributeLength) {
+          return RIB_IO_ERROR;
+        }
+      } else if (1 + addressLength > attributeLength) {
+        return RIB_IO_ERROR;
+      }
+      //A link local address may follow the global one
+      if (addressLength == 16 || addressLength == 32) {
+        memcpy(mpNexthop, address, 16);
+        mpNexthopIpv = 6;
+      } else if (addressLength == 4) {
+        memcpy(mpNexthop, address, 4);
+        mpNexthopIpv = 4;
+      }
+    }
+  }
+  //NEXT_HOP is the next hop of ipv4 prefixes; ipv6 prefixes (and ipv4 prefixes with an ipv6 next hop) use MP_REACH_NLRI
+  if (hasNexthop && (entry->ipv == 4 || mpNexthopIpv == 0)) {
+    memcpy(entry->nexthop, nexthop, 4);
+    entry->nexthopIpv = 4;
+  } else if (mpNexthopIpv != 0) {
+    memcpy(entry->nexthop, mpNexthop, 16);
+    entry->nexthopIpv = mpNexthopIpv;
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_mrt_next
+ * @description decode the next RIB entry
+ * @param RIB_mrt_reader_t* reader
+ * @param RIB_mrt_entry_t* entry
+ * @param int* end: set to 1 at the end of the file
+ * @returns RIB_ret_code_t: RIB_IO_ERROR if the file is truncated or malformed
+ */
+
+RIB_ret_code_t RIB_mrt_next(RIB_mrt_reader_t* reader, RIB_mrt_entry_t* entry, int* end) {
+  RIB_ret_code_t rc;
+  *end = 0;
+  while (reader->entries == 0) {
+    unsigned char header[RIB_MRT_HEADER];
+    const int read = readExact(reader, header, sizeof(header));
+    if (read != 0) {
+      *end = read == 1;
+      return read == 1 ? RIB_NO_ERROR : RIB_IO_ERROR;
+    }
+    const uint16_t type = getUint16(header + 4);
+    const uint16_t subtype = getUint16(header + 6);
+    const uint32_t length = getUint32(header + 8);
+    if (length > RIB_MRT_MAX_RECORD) {
+      return RIB_IO_ERROR;
+    }
+    if (length > reader->recordSize) {
+      unsigned char* record = (unsigned char*) realloc(reader->record, length);
+      if (record == NULL) {
+        return RIB_BAD_ALLOC;
+      }
+      reader->record = record;
+      reader->recordSize = length;
+    }
+    //Records of the other types are read and skipped
+    if (length > 0 && readExact(reader, reader->record, length) != 0) {
+      return RIB_IO_ERROR;
+    }
+    reader->recordLength = length;
+    if (type != RIB_MRT_TABLE_DUMP_V2) {
+      continue;
+    }
+    if (subtype == RIB_MRT_PEER_INDEX_TABLE) {
+      if ((rc = readPeers(reader)) != RIB_NO_ERROR) {
+        return rc;
+      }
+    } else if (subtype == RIB_MRT_RIB_IPV4_UNICAST || subtype == RIB_MRT_RIB_IPV4_UNICAST_ADDPATH ||
+               subtype == RIB_MRT_RIB_IPV6_UNICAST || subtype == RIB_MRT_RIB_IPV6_UNICAST_ADDPATH) {
+      const int ipv = subtype == RIB_MRT_RIB_IPV6_UNICAST || subtype == RIB_MRT_RIB_IPV6_UNICAST_ADDPATH ? 6 : 4;
+      reader->addPath = subtype == RIB_MRT_RIB_IPV4_UNICAST_ADDPATH || subtype == RIB_MRT_RIB_IPV6_UNICAST_ADDPATH;
+      if ((rc = startRib(reader, ipv)) != RIB_NO_ERROR) {
+        return rc;
+      }
+    }
+  }
+  //Peer index, originated time, path identifier (ADD-PATH), attributes length
+  const unsigned char* data = reader->record + reader->position;
+  const size_t headerLength = reader->addPath ? 12 : 8;
+  if (reader->position + headerLength > reader->recordLength) {
+    return RIB_IO_ERROR;
+  }
+  const size_t attributesLength = getUint16(data + headerLength - 2);
+  if (reader->position + headerLength + attributesLength > reader->recordLength) {
+    return RIB_IO_ERROR;
+  }
+  memset(entry, 0, sizeof(RIB_mrt_entry_t));
+  entry->ipv = reader->ipv;
+  memcpy(entry->prefix, reader->prefix, sizeof(entry->prefix));
+  entry->length = reader->length;
+  entry->peer = getUint16(data);
+  entry->peerData = entry->peer < reader->peerCount ? &reader->peers[entry->peer] : NULL;
+  if ((rc = readAttributes(data + headerLength, attributesLength, entry)) != RIB_NO_ERROR) {
+    return rc;
+  }
+  reader->position += headerLength + attributesLength;
+  reader->entries--;
+  entry->last = reader->entries == 0;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_mrt_close
+ * @description close an MRT file; NULL is allowed
+ * @param RIB_mrt_reader_t* reader
+ */
+
+void RIB_mrt_close(RIB_mrt_reader_t* reader) {
+  if (reader == NULL) {
+    return;
+  }
+#ifdef WITH_ZLIB
+  if (reader->compression == RIB_MRT_GZIP && reader->stream != NULL) {
+    gzclose((gzFile) reader->stream);
+  }
+#endif
+#ifdef WITH_BZIP2
+  if (reader->compression == RIB_MRT_BZIP2 && reader->stream != NULL) {
+    int error;
+    BZ2_bzReadClose(&error, (BZFILE*) reader->stream);
+  }
+#endif
+  fclose(reader->file);
+  free(reader->record);
+  free(reader->peers);
+  free(reader);
+}
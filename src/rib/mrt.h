@@ -0,0 +1,104 @@
+/**
+ *   librib - mrt.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+
+#ifndef RIB_MRT_H
+#define RIB_MRT_H
+
+#include <rib/rib.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Streaming reader of MRT routing information export files (RFC 6396).
+ * Only the TABLE_DUMP_V2 records are decoded: PEER_INDEX_TABLE, RIB_IPV4_UNICAST, RIB_IPV6_UNICAST
+ * and their ADD-PATH variants (RFC 8050); the other records are skipped.
+ * Files compressed with gzip or bzip2 are detected by their magic number (WITH_ZLIB and WITH_BZIP2 builds).
+ */
+
+#define RIB_MRT_TABLE_DUMP_V2 13
+#define RIB_MRT_PEER_INDEX_TABLE 1
+#define RIB_MRT_RIB_IPV4_UNICAST 2
+#define RIB_MRT_RIB_IPV6_UNICAST 4
+#define RIB_MRT_RIB_IPV4_UNICAST_ADDPATH 8
+#define RIB_MRT_RIB_IPV6_UNICAST_ADDPATH 10
+
+#define RIB_MRT_HEADER 12
+#define RIB_MRT_MAX_RECORD 16777216 //Max record length accepted by the reader
+
+// Data types
+
+typedef enum RIB_mrt_compression_t {
+  RIB_MRT_PLAIN,
+  RIB_MRT_GZIP,
+  RIB_MRT_BZIP2
+} RIB_mrt_compression_t;
+
+typedef struct RIB_mrt_peer_t {
+  int ipv;
+  unsigned char address[16];
+  uint32_t as;
+} RIB_mrt_peer_t;
+
+/**
+ * RIB entry: the path of a peer to a prefix; the entries of a prefix are returned one after the other
+ */
+
+typedef struct RIB_mrt_entry_t {
+  int ipv;                   //Family of the prefix
+  unsigned char prefix[16];  //Network address, in network byte order
+  int length;                //Prefix length
+  uint16_t peer;             //Index in the peer table
+  const RIB_mrt_peer_t* peerData; //NULL if the file has no peer table or the index is out of it
+  int nexthopIpv;            //0 if the entry has no next hop
+  unsigned char nexthop[16];
+  int pathLength;            //Number of ASes in the AS path (an AS_SET counts as one)
+  int last;                  //Whether it is the last entry of the prefix
+} RIB_mrt_entry_t;
+
+typedef struct RIB_mrt_reader_t {
+  RIB_mrt_compression_t compression;
+  FILE* file;
+  void* stream;              //gzFile or BZFILE*
+  unsigned char* record;
+  size_t recordSize;
+  size_t recordLength;
+  size_t position;           //Next entry of the current RIB record
+  size_t entries;            //Entries left in the current RIB record
+  int ipv;
+  int addPath;
+  unsigned char prefix[16];
+  int length;
+  RIB_mrt_peer_t* peers;
+  size_t peerCount;
+} RIB_mrt_reader_t;
+
+// Functions
+
+RIB_ret_code_t RIB_mrt_open(const char* filename, RIB_mrt_reader_t** reader);
+RIB_ret_code_t RIB_mrt_next(RIB_mrt_reader_t* reader, RIB_mrt_entry_t* entry, int* end);
+void RIB_mrt_close(RIB_mrt_reader_t* reader);
+
+#endif
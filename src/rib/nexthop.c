@@ -0,0 +1,304 @@
+/**
+ *   librib - nexthop.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include "nexthop.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RIB_NHTABLE_MIN_SIZE 16
+
+/**
+ * @function keyHash
+ * @description FNV-1a hash of a string, with a seed
+ * @param const char* key
+ * @param uint64_t seed
+ * @returns uint64_t
+ */
+
+static uint64_t keyHash(const char* key, uint64_t seed) {
+  uint64_t h = 0xCBF29CE484222325ULL ^ seed;
+  for (const unsigned char* c = (const unsigned char*) key; *c != 0; c++) {
+    h ^= *c;
+    h *= 0x100000001B3ULL;
+  }
+  //Murmur3 finalizer, FNV alone has poor low bits for similar keys
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/**
+ * @function compareMembers
+ * @description qsort comparator of next hops (by gateway, then by interface)
+ * @param const void*
+ * @param const void*
+ * @returns int
+ */
+
+static int compareMembers(const void* a, const void* b) {
+  const RIB_nexthop_t* x = (const RIB_nexthop_t*) a;
+  const RIB_nexthop_t* y = (const RIB_nexthop_t*) b;
+  int cmp = strcmp(x->gateway, y->gateway);
+  return cmp != 0 ? cmp : strcmp(x->iface, y->iface);
+}
+
+/**
+ * @function membersKey
+ * @description get the canonical representation of a sorted set of members
+ * @param const RIB_nexthop_t* members
+ * @param size_t count
+ * @returns char*: NULL if allocation failed
+ */
+
+static char* membersKey(const RIB_nexthop_t* members, size_t count) {
+  size_t length = 1;
+  for (size_t i = 0; i < count; i++) {
+    length += strlen(members[i].gateway) + strlen(members[i].iface) + 2;
+  }
+  char* key = (char*) malloc(length);
+  if (key == NULL) {
+    return NULL;
+  }
+  char* ptr = key;
+  for (size_t i = 0; i < count; i++) {
+    ptr += sprintf(ptr, "%s%%%s ", members[i].gateway, members[i].iface);
+  }
+  *ptr = 0;
+  return key;
+}
+
+/**
+ * @function fillBuckets
+ * @description fill the bucket table of a group with Maglev: each member walks its own permutation of the buckets and takes the first free one, in turn
+ * @param RIB_nhgroup_t*
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t fillBuckets(RIB_nhgroup_t* group) {
+  size_t* offset = (size_t*) malloc(sizeof(size_t) * group->count * 3);
+  if (offset == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  size_t* skip = offset + group->count;
+  size_t* position = skip + group->count;
+  for (size_t i = 0; i < group->count; i++) {
+    //The permutation only depends on the member, so it doesn't change when other members come and go
+    char name[512];
+    snprintf(name, sizeof(name), "%s%%%s", group->members[i].gateway, group->members[i].iface);
+    offset[i] = keyHash(name, 0) % RIB_NHGROUP_BUCKETS;
+    skip[i] = keyHash(name, 0x9E3779B97F4A7C15ULL) % (RIB_NHGROUP_BUCKETS - 1) + 1;
+    position[i] = 0;
+  }
+  memset(group->buckets, 0xFF, sizeof(group->buckets));
+  size_t filled = 0;
+  while (filled < RIB_NHGROUP_BUCKETS) {
+    for (size_t i = 0; i < group->count && filled < RIB_NHGROUP_BUCKETS; i++) {
+      size_t bucket;
+      do {
+        bucket = (offset[i] + position[i]++ * skip[i]) % RIB_NHGROUP_BUCKETS;
+      } while (group->buckets[bucket] != 0xFF);
+      group->buckets[bucket] = (uint8_t) i;
+      filled++;
+    }
+  }
+  free(offset);
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function freeGroup
+ * @description free a next hop group
+ * @param RIB_nhgroup_t*
+ */
+
+static void freeGroup(RIB_nhgroup_t* group) {
+  for (size_t i = 0; i < group->count; i++) {
+    free((char*) group->members[i].gateway);
+    free((char*) group->members[i].iface);
+  }
+  free(group->members);
+  free(group->key);
+  free(group);
+}
+
+/**
+ * @function newGroup
+ * @description allocate a next hop group for a sorted set of members
+ * @param const RIB_nexthop_t* members
+ * @param size_t count
+ * @param char* key: ownership is taken
+ * @returns RIB_nhgroup_t*: NULL if allocation failed
+ */
+
+static RIB_nhgroup_t* newGroup(const RIB_nexthop_t* members, size_t count, char* key) {
+  RIB_nhgroup_t* group = (RIB_nhgroup_t*) calloc(1, sizeof(RIB_nhgroup_t));
+  if (group == NULL) {
+    free(key);
+    return NULL;
+  }
+  group->key = key;
+  group->members = (RIB_nexthop_t*) calloc(count, sizeof(RIB_nexthop_t));
+  if (group->members == NULL) {
+    freeGroup(group);
+    return NULL;
+  }
+  for (size_t i = 0; i < count; i++) {
+    group->members[i].gateway = strdup(members[i].gateway);
+    group->members[i].iface = strdup(members[i].iface);
+    group->count++;
+    if (group->members[i].gateway == NULL || group->members[i].iface == NULL) {
+      freeGroup(group);
+      return NULL;
+    }
+  }
+  if (fillBuckets(group) != RIB_NO_ERROR) {
+    freeGroup(group);
+    return NULL;
+  }
+  return group;
+}
+
+/**
+ * @function RIB_nhtable_create
+ * @description allocate an empty table of next hop groups
+ * @param RIB_nhtable_t** table
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_nhtable_create(RIB_nhtable_t** table) {
+  *table = (RIB_nhtable_t*) calloc(1, sizeof(RIB_nhtable_t));
+  return *table != NULL ? RIB_NO_ERROR : RIB_BAD_ALLOC;
+}
+
+/**
+ * @function RIB_nhtable_free
+ * @description free the table; groups still referenced are detached and freed by their last release; NULL is allowed
+ * @param RIB_nhtable_t* table
+ */
+
+void RIB_nhtable_free(RIB_nhtable_t* table) {
+  if (table == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < table->size; i++) {
+    for (RIB_nhgroup_t* group = table->buckets[i]; group != NULL; group = group->next) {
+      group->table = NULL;
+    }
+  }
+  free(table->buckets);
+  free(table);
+}
+
+/**
+ * @function RIB_nhgroup_get
+ * @description get the group with the provided members, creating it if it doesn't exist; a reference is taken
+ * @param RIB_nhtable_t* table
+ * @param const RIB_nexthop_t* members: formatted next hops, any order
+ * @param size_t count
+ * @param RIB_nhgroup_t** group
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_nhgroup_get(RIB_nhtable_t* table, const RIB_nexthop_t* members, size_t count, RIB_nhgroup_t** group) {
+  *group = NULL;
+  if (count == 0 || count > RIB_NHGROUP_MAX_MEMBERS) {
+    return RIB_INVALID_ADDRESS;
+  }
+  RIB_nexthop_t sorted[RIB_NHGROUP_MAX_MEMBERS];
+  memcpy(sorted, members, sizeof(RIB_nexthop_t) * count);
+  qsort(sorted, count, sizeof(RIB_nexthop_t), compareMembers);
+  char* key = membersKey(sorted, count);
+  if (key == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  const uint64_t hash = keyHash(key, 0);
+  if (table->size > 0) {
+    for (RIB_nhgroup_t* thisGroup = table->buckets[hash & (table->size - 1)]; thisGroup != NULL; thisGroup = thisGroup->next) {
+      if (strcmp(thisGroup->key, key) == 0) {
+        free(key);
+        thisGroup->refs++;
+        *group = thisGroup;
+        return RIB_NO_ERROR;
+      }
+    }
+  }
+  if (table->groups >= table->size) {
+    //Grow to keep one group per bucket on average
+    size_t size = table->size > 0 ? table->size * 2 : RIB_NHTABLE_MIN_SIZE;
+    RIB_nhgroup_t** buckets = (RIB_nhgroup_t**) calloc(size, sizeof(RIB_nhgroup_t*));
+    if (buckets == NULL) {
+      free(key);
+      return RIB_BAD_ALLOC;
+    }
+    for (size_t i = 0; i < table->size; i++) {
+      RIB_nhgroup_t* thisGroup = table->buckets[i];
+      while (thisGroup != NULL) {
+        RIB_nhgroup_t* next = thisGroup->next;
+        size_t bucket = keyHash(thisGroup->key, 0) & (size - 1);
+        thisGroup->next = buckets[bucket];
+        buckets[bucket] = thisGroup;
+        thisGroup = next;
+      }
+    }
+    free(table->buckets);
+    table->buckets = buckets;
+    table->size = size;
+  }
+  RIB_nhgroup_t* thisGroup = newGroup(sorted, count, key);
+  if (thisGroup == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  size_t bucket = hash & (table->size - 1);
+  thisGroup->next = table->buckets[bucket];
+  table->buckets[bucket] = thisGroup;
+  thisGroup->table = table;
+  thisGroup->refs = 1;
+  table->groups++;
+  *group = thisGroup;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_nhgroup_release
+ * @description release a reference to a group; the group is freed with its last reference; NULL is allowed
+ * @param RIB_nhgroup_t* group
+ */
+
+void RIB_nhgroup_release(RIB_nhgroup_t* group) {
+  if (group == NULL || --group->refs > 0) {
+    return;
+  }
+  RIB_nhtable_t* table = group->table;
+  if (table != NULL) {
+    RIB_nhgroup_t** link = &table->buckets[keyHash(group->key, 0) & (table->size - 1)];
+    while (*link != group) {
+      link = &(*link)->next;
+    }
+    *link = group->next;
+    table->groups--;
+  }
+  freeGroup(group);
+}
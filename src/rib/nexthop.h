@@ -0,0 +1,78 @@
+/**
+ *   librib - nexthop.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef RIB_NEXTHOP_H
+#define RIB_NEXTHOP_H
+
+#include <rib/rib.h>
+
+#include <stdint.h>
+
+#define RIB_NHGROUP_MAX_MEMBERS RIB_MAX_NEXTHOPS
+#define RIB_NHGROUP_BUCKETS 1021 //Prime, much larger than the members
+
+/**
+ * Equal cost multipath next hop groups.
+ * Groups are interned by their set of members, so all the prefixes with the same next hops share one group.
+ * Each group has a bucket table filled with Maglev consistent hashing: a flow hash selects a member in O(1),
+ * and removing a member only moves the flows which were using it (plus a few others).
+ */
+
+// Data types
+
+typedef struct RIB_nhgroup_t {
+  char* key;                      //Canonical representation of the members
+  RIB_nexthop_t* members;         //Sorted by gateway and interface
+  size_t count;
+  size_t refs;
+  uint8_t buckets[RIB_NHGROUP_BUCKETS]; //Member of each bucket
+  struct RIB_nhgroup_t* next;     //Next group in the same bucket of the table
+  struct RIB_nhtable_t* table;
+} RIB_nhgroup_t;
+
+typedef struct RIB_nhtable_t {
+  RIB_nhgroup_t** buckets;
+  size_t size; //Number of buckets (power of 2)
+  size_t groups;
+} RIB_nhtable_t;
+
+// Functions
+
+RIB_ret_code_t RIB_nhtable_create(RIB_nhtable_t** table);
+void RIB_nhtable_free(RIB_nhtable_t* table);
+RIB_ret_code_t RIB_nhgroup_get(RIB_nhtable_t* table, const RIB_nexthop_t* members, size_t count, RIB_nhgroup_t** group);
+void RIB_nhgroup_release(RIB_nhgroup_t* group);
+
+/**
+ * @function RIB_nhgroup_select
+ * @description select the member of a group for a flow
+ * @param const RIB_nhgroup_t*
+ * @param uint64_t flowHash
+ * @returns const RIB_nexthop_t*
+ */
+
+static inline const RIB_nexthop_t* RIB_nhgroup_select(const RIB_nhgroup_t* group, uint64_t flowHash) {
+  return &group->members[group->buckets[flowHash % RIB_NHGROUP_BUCKETS]];
+}
+
+#endif
@@ -0,0 +1,136 @@
+/**
+ *   librib - prefix.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include "prefix.h"
+
+#include <rib/iputils.h>
+
+#include <arpa/inet.h>
+#include <string.h>
+
+/**
+ * @function RIB_prefix_mask
+ * @description clear all the bits of the prefix after the provided length
+ * @param RIB_prefix_t*
+ * @param int length
+ */
+
+void RIB_prefix_mask(RIB_prefix_t* prefix, int length) {
+  if (length <= 0) {
+    prefix->hi = 0;
+    prefix->lo = 0;
+  } else if (length < 64) {
+    prefix->hi &= ~((uint64_t) 0) << (64 - length);
+    prefix->lo = 0;
+  } else if (length == 64) {
+    prefix->lo = 0;
+  } else if (length < 128) {
+    prefix->lo &= ~((uint64_t) 0) << (128 - length);
+  }
+  prefix->length = length;
+}
+
+/**
+ * @function RIB_prefix_from_bytes
+ * @description convert an address in network byte order (4 bytes for ipv4, 16 for ipv6) to its binary prefix representation
+ * @param const unsigned char* bytes
+ * @param int ipv
+ * @param RIB_prefix_t* prefix
+ */
+
+void RIB_prefix_from_bytes(const unsigned char* bytes, int ipv, RIB_prefix_t* prefix) {
+  prefix->hi = 0;
+  prefix->lo = 0;
+  if (ipv == 4) {
+    for (int i = 0; i < 4; i++) {
+      prefix->hi = (prefix->hi << 8) | bytes[i];
+    }
+    prefix->hi <<= 32;
+  } else {
+    for (int i = 0; i < 8; i++) {
+      prefix->hi = (prefix->hi << 8) | bytes[i];
+      prefix->lo = (prefix->lo << 8) | bytes[i + 8];
+    }
+  }
+  prefix->length = RIB_prefix_max_length(ipv);
+}
+
+/**
+ * @function RIB_prefix_to_bytes
+ * @description convert a binary prefix to an address in network byte order (4 bytes for ipv4, 16 for ipv6)
+ * @param const RIB_prefix_t* prefix
+ * @param int ipv
+ * @param unsigned char* bytes
+ */
+
+void RIB_prefix_to_bytes(const RIB_prefix_t* prefix, int ipv, unsigned char* bytes) {
+  const int size = ipv == 4 ? 4 : 16;
+  for (int i = 0; i < size; i++) {
+    if (i < 8) {
+      bytes[i] = (unsigned char) (prefix->hi >> (56 - (8 * i)));
+    } else {
+      bytes[i] = (unsigned char) (prefix->lo >> (56 - (8 * (i - 8))));
+    }
+  }
+}
+
+/**
+ * @function RIB_prefix_from_address
+ * @description parse an ip address string to its binary prefix representation (full length)
+ * @param const char* ipAddress
+ * @param int ipv
+ * @param RIB_prefix_t* prefix
+ * @returns int: 0 if succeeded
+ */
+
+int RIB_prefix_from_address(const char* ipAddress, int ipv, RIB_prefix_t* prefix) {
+  unsigned char bytes[16];
+  if (ipAddress == NULL) {
+    return 1;
+  }
+  if (inet_pton(ipv == 4 ? AF_INET : AF_INET6, ipAddress, bytes) != 1) {
+    return 1;
+  }
+  RIB_prefix_from_bytes(bytes, ipv, prefix);
+  return 0;
+}
+
+/**
+ * @function RIB_prefix_from_route
+ * @description get the binary prefix (network address and prefix length) of a route
+ * @param const Route* route
+ * @param RIB_prefix_t* prefix
+ * @returns int: 0 if succeeded
+ */
+
+int RIB_prefix_from_route(const Route* route, RIB_prefix_t* prefix) {
+  if (RIB_prefix_from_address(route->destination, route->ipv, prefix) != 0) {
+    return 1;
+  }
+  int length = route->ipv == 4 ? getCIDRnetmask(route->netmask) : route->prefixLength;
+  if (length < 0 || length > RIB_prefix_max_length(route->ipv)) {
+    return 1;
+  }
+  RIB_prefix_mask(prefix, length);
+  return 0;
+}
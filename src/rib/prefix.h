@@ -0,0 +1,115 @@
+/**
+ *   librib - prefix.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef RIB_PREFIX_H
+#define RIB_PREFIX_H
+
+#include <rib/route.h>
+
+#include <stdint.h>
+
+// Data types
+
+/**
+ * Binary representation of an address or a prefix used by the lookup structures.
+ * Both families are stored as a 128 bits number in host order (hi holds the most significant bits);
+ * IPv4 addresses take the 32 most significant bits of hi.
+ */
+
+typedef struct RIB_prefix_t {
+  uint64_t hi;
+  uint64_t lo;
+  int length;
+} RIB_prefix_t;
+
+// Functions
+
+int RIB_prefix_from_address(const char* ipAddress, int ipv, RIB_prefix_t* prefix);
+int RIB_prefix_from_route(const Route* route, RIB_prefix_t* prefix);
+void RIB_prefix_from_bytes(const unsigned char* bytes, int ipv, RIB_prefix_t* prefix);
+void RIB_prefix_to_bytes(const RIB_prefix_t* prefix, int ipv, unsigned char* bytes);
+void RIB_prefix_mask(RIB_prefix_t* prefix, int length);
+
+/**
+ * @function RIB_prefix_max_length
+ * @description returns the address length in bits for the provided ip version
+ * @param int ipv
+ * @returns int
+ */
+
+static inline int RIB_prefix_max_length(int ipv) {
+  return ipv == 6 ? 128 : 32;
+}
+
+/**
+ * @function RIB_prefix_bit
+ * @description returns the bit of the prefix at the provided position (0 is the most significant)
+ * @param const RIB_prefix_t*
+ * @param int position
+ * @returns int
+ */
+
+static inline int RIB_prefix_bit(const RIB_prefix_t* prefix, int position) {
+  if (position < 64) {
+    return (int) ((prefix->hi >> (63 - position)) & 1);
+  }
+  return (int) ((prefix->lo >> (127 - position)) & 1);
+}
+
+/**
+ * @function RIB_prefix_compare
+ * @description compare two prefixes in prefix order (by network address, then by length)
+ * @param const RIB_prefix_t*
+ * @param const RIB_prefix_t*
+ * @returns int: < 0 if a comes before b, 0 if they're equal, > 0 otherwise
+ */
+
+static inline int RIB_prefix_compare(const RIB_prefix_t* a, const RIB_prefix_t* b) {
+  if (a->hi != b->hi) {
+    return a->hi < b->hi ? -1 : 1;
+  }
+  if (a->lo != b->lo) {
+    return a->lo < b->lo ? -1 : 1;
+  }
+  return a->length - b->length;
+}
+
+/**
+ * @function RIB_prefix_hash
+ * @description returns a 64 bits hash of the prefix bits and its length
+ * @param const RIB_prefix_t*
+ * @returns uint64_t
+ */
+
+static inline uint64_t RIB_prefix_hash(const RIB_prefix_t* prefix) {
+  uint64_t h = prefix->hi ^ ((prefix->lo << 29) | (prefix->lo >> 35)) ^ ((uint64_t) prefix->length * 0x9E3779B97F4A7C15ULL);
+  //Murmur3 finalizer
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+#endif
@@ -0,0 +1,434 @@
+/**
+ *   librib - ptree.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include "ptree.h"
+
+#include <stdlib.h>
+
+/**
+ * @function commonLength
+ * @description returns the number of leading bits two prefixes have in common, up to limit
+ * @param const RIB_prefix_t*
+ * @param const RIB_prefix_t*
+ * @param int limit
+ * @returns int
+ */
+
+static int commonLength(const RIB_prefix_t* a, const RIB_prefix_t* b, int limit) {
+  int common;
+  const uint64_t hi = a->hi ^ b->hi;
+  if (hi != 0) {
+    common = __builtin_clzll(hi);
+  } else {
+    const uint64_t lo = a->lo ^ b->lo;
+    common = lo != 0 ? 64 + __builtin_clzll(lo) : 128;
+  }
+  return common < limit ? common : limit;
+}
+
+/**
+ * @function newNode
+ * @description allocate a new tree node
+ * @param RIB_ptree_t*
+ * @param const RIB_prefix_t*
+ * @param void* value
+ * @returns RIB_ptnode_t*
+ */
+
+static RIB_ptnode_t* newNode(RIB_ptree_t* tree, const RIB_prefix_t* prefix, void* value) {
+  RIB_ptnode_t* node = (RIB_ptnode_t*) malloc(sizeof(RIB_ptnode_t));
+  if (node == NULL) {
+    return NULL;
+  }
+  node->parent = NULL;
+  node->child[0] = NULL;
+  node->child[1] = NULL;
+  node->prefix = *prefix;
+  node->value = value;
+  tree->nodes++;
+  return node;
+}
+
+/**
+ * @function replaceChild
+ * @description replace the link from the parent of a node (or the root) with another node
+ * @param RIB_ptree_t*
+ * @param RIB_ptnode_t* parent
+ * @param RIB_ptnode_t* oldNode
+ * @param RIB_ptnode_t* newNode
+ */
+
+static void replaceChild(RIB_ptree_t* tree, RIB_ptnode_t* parent, RIB_ptnode_t* oldNode, RIB_ptnode_t* newNode) {
+  if (parent == NULL) {
+    tree->root = newNode;
+  } else if (parent->child[0] == oldNode) {
+    parent->child[0] = newNode;
+  } else {
+    parent->child[1] = newNode;
+  }
+  if (newNode != NULL) {
+    newNode->parent = parent;
+  }
+}
+
+/**
+ * @function RIB_ptree_init
+ * @description initialize an empty tree
+ * @param RIB_ptree_t*
+ */
+
+void RIB_ptree_init(RIB_ptree_t* tree) {
+  tree->root = NULL;
+  tree->nodes = 0;
+  tree->routes = 0;
+}
+
+/**
+ * @function RIB_ptree_clear
+ * @description free all the nodes of a tree (routes are not freed)
+ * @param RIB_ptree_t*
+ */
+
+void RIB_ptree_clear(RIB_ptree_t* tree) {
+  RIB_ptnode_t* node = tree->root;
+  //Iterative post order visit
+  while (node != NULL) {
+    if (node->child[0] != NULL) {
+      node = node->child[0];
+    } else if (node->child[1] != NULL) {
+      node = node->child[1];
+    } else {
+      RIB_ptnode_t* parent = node->parent;
+      if (parent != NULL) {
+        parent->child[parent->child[0] == node ? 0 : 1] = NULL;
+      }
+      free(node);
+      node = parent;
+    }
+  }
+  RIB_ptree_init(tree);
+}
+
+/**
+ * @function RIB_ptree_insert
+ * @description insert a route (or any other value) for the provided prefix
+ * @param RIB_ptree_t*
+ * @param const RIB_prefix_t* prefix
+ * @param void* value
+ * @returns RIB_ret_code_t: RIB_DUP_RECORD if the prefix has already a route
+ */
+
+RIB_ret_code_t RIB_ptree_insert(RIB_ptree_t* tree, const RIB_prefix_t* prefix, void* value) {
+  RIB_ptnode_t* parent = NULL;
+  RIB_ptnode_t* node = tree->root;
+  int bit = 0;
+  int common = 0;
+  while (node != NULL) {
+    const int limit = node->prefix.length < prefix->length ? node->prefix.length : prefix->length;
+    common = commonLength(&node->prefix, prefix, limit);
+    if (common < node->prefix.length) {
+      break;
+    }
+    //Node prefix contains the new prefix
+    if (node->prefix.length == prefix->length) {
+      if (node->route != NULL) {
+        return RIB_DUP_RECORD;
+      }
+      node->value = value;
+      tree->routes++;
+      return RIB_NO_ERROR;
+    }
+    parent = node;
+    bit = RIB_prefix_bit(prefix, node->prefix.length);
+    node = node->child[bit];
+  }
+  RIB_ptnode_t* leaf = newNode(tree, prefix, value);
+  if (leaf == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  if (node == NULL) {
+    //Append new leaf
+    if (parent == NULL) {
+      tree->root = leaf;
+    } else {
+      parent->child[bit] = leaf;
+      leaf->parent = parent;
+    }
+  } else if (common == prefix->length) {
+    //New prefix is an ancestor of node
+    replaceChild(tree, node->parent, node, leaf);
+    leaf->child[RIB_prefix_bit(&node->prefix, common)] = node;
+    node->parent = leaf;
+  } else {
+    //Prefixes diverge: add a glue node where they split
+    RIB_prefix_t gluePrefix = *prefix;
+    RIB_prefix_mask(&gluePrefix, common);
+    RIB_ptnode_t* glue = newNode(tree, &gluePrefix, NULL);
+    if (glue == NULL) {
+      free(leaf);
+      tree->nodes--;
+      return RIB_BAD_ALLOC;
+    }
+    replaceChild(tree, node->parent, node, glue);
+    glue->child[RIB_prefix_bit(prefix, common)] = leaf;
+    glue->child[RIB_prefix_bit(&node->prefix, common)] = node;
+    leaf->parent = glue;
+    node->parent = glue;
+  }
+  tree->routes++;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_ptree_find
+ * @description find the node with exactly the provided prefix
+ * @param const RIB_ptree_t*
+ * @param const RIB_prefix_t* prefix
+ * @returns RIB_ptnode_t*: NULL if the prefix is not in the tree
+ */
+
+RIB_ptnode_t* RIB_ptree_find(const RIB_ptree_t* tree, const RIB_prefix_t* prefix) {
+  RIB_ptnode_t* node = tree->root;
+  while (node != NULL && node->prefix.length <= prefix->length) {
+    if (commonLength(&node->prefix, prefix, node->prefix.length) < node->prefix.length) {
+      return NULL;
+    }
+    if (node->prefix.length == prefix->length) {
+      return node;
+    }
+    node = node->child[RIB_prefix_bit(prefix, node->prefix.length)];
+  }
+  return NULL;
+}
+
+/**
+ * @function RIB_ptree_remove_node
+ * @description remove the route from a node and free the nodes which are no more needed
+ * @param RIB_ptree_t*
+ * @param RIB_ptnode_t* node
+ */
+
+void RIB_ptree_remove_node(RIB_ptree_t* tree, RIB_ptnode_t* node) {
+  if (node->route != NULL) {
+    node->route = NULL;
+    tree->routes--;
+  }
+  //Remove node and glue parents while they're not needed to branch
+  while (node != NULL && node->route == NULL) {
+    RIB_ptnode_t* parent = node->parent;
+    if (node->child[0] != NULL && node->child[1] != NULL) {
+      return;
+    }
+    RIB_ptnode_t* child = node->child[0] != NULL ? node->child[0] : node->child[1];
+    replaceChild(tree, parent, node, child);
+    free(node);
+    tree->nodes--;
+    if (child != NULL) {
+      return;
+    }
+    node = parent;
+  }
+}
+
+/**
+ * @function RIB_ptree_remove
+ * @description remove the route for the provided prefix
+ * @param RIB_ptree_t*
+ * @param const RIB_prefix_t* prefix
+ * @returns Route*: removed route; NULL if the prefix is not in the tree
+ */
+
+Route* RIB_ptree_remove(RIB_ptree_t* tree, const RIB_prefix_t* prefix) {
+  RIB_ptnode_t* node = RIB_ptree_find(tree, prefix);
+  if (node == NULL || node->route == NULL) {
+    return NULL;
+  }
+  Route* route = node->route;
+  RIB_ptree_remove_node(tree, node);
+  return route;
+}
+
+/**
+ * @function RIB_ptree_match
+ * @description find the route with the longest prefix matching the provided address
+ * @param const RIB_ptree_t*
+ * @param const RIB_prefix_t* address
+ * @returns Route*: NULL if there is no match
+ */
+
+Route* RIB_ptree_match(const RIB_ptree_t* tree, const RIB_prefix_t* address) {
+  Route* best = NULL;
+  const RIB_ptnode_t* node = tree->root;
+  while (node != NULL && node->prefix.length <= address->length) {
+    if (commonLength(&node->prefix, address, node->prefix.length) < node->prefix.length) {
+      break;
+    }
+    if (node->route != NULL) {
+      best = node->route;
+    }
+    if (node->prefix.length == address->length) {
+      break;
+    }
+    node = node->child[RIB_prefix_bit(address, node->prefix.length)];
+  }
+  return best;
+}
+
+/**
+ * @function RIB_ptree_next
+ * @description returns the node which follows a node in a pre-order visit of the subtree rooted in top
+ * @param const RIB_ptnode_t* node
+ * @param const RIB_ptnode_t* top: root of the visited subtree; NULL to visit the whole tree
+ * @returns RIB_ptnode_t*: NULL at the end of the visit
+ */
+
+RIB_ptnode_t* RIB_ptree_next(const RIB_ptnode_t* node, const RIB_ptnode_t* top) {
+  if (node->child[0] != NULL) {
+    return node->child[0];
+  }
+  if (node->child[1] != NULL) {
+    return node->child[1];
+  }
+  //Go up until there is a right sibling to visit
+  while (node != top && node->parent != NULL) {
+    const RIB_ptnode_t* parent = node->parent;
+    if (parent->child[0] == node && parent->child[1] != NULL) {
+      return parent->child[1];
+    }
+    node = parent;
+  }
+  return NULL;
+}
+
+/**
+ * @function RIB_ptree_subtree
+ * @description returns the topmost node whose prefix is contained in the provided prefix (itself included)
+ * @param const RIB_ptree_t*
+ * @param const RIB_prefix_t* prefix
+ * @returns RIB_ptnode_t*: NULL if there is no such node
+ */
+
+RIB_ptnode_t* RIB_ptree_subtree(const RIB_ptree_t* tree, const RIB_prefix_t* prefix) {
+  RIB_ptnode_t* node = tree->root;
+  while (node != NULL) {
+    if (node->prefix.length >= prefix->length) {
+      return commonLength(&node->prefix, prefix, prefix->length) == prefix->length ? node : NULL;
+    }
+    if (commonLength(&node->prefix, prefix, node->prefix.length) < node->prefix.length) {
+      return NULL;
+    }
+    node = node->child[RIB_prefix_bit(prefix, node->prefix.length)];
+  }
+  return NULL;
+}
+
+/**
+ * @function lastAddress
+ * @description returns the prefix with all the host bits set (the highest address of a prefix), with length 128
+ * @param const RIB_prefix_t*
+ * @returns RIB_prefix_t
+ */
+
+static RIB_prefix_t lastAddress(const RIB_prefix_t* prefix) {
+  RIB_prefix_t last = *prefix;
+  if (prefix->length < 64) {
+    last.hi |= prefix->length == 0 ? ~((uint64_t) 0) : ~((uint64_t) 0) >> prefix->length;
+    last.lo = ~((uint64_t) 0);
+  } else if (prefix->length < 128) {
+    last.lo |= ~((uint64_t) 0) >> (prefix->length - 64);
+  }
+  last.length = 128;
+  return last;
+}
+
+/**
+ * @function firstAfter
+ * @description returns the first node of a subtree (pre-order) which comes after key; subtrees which come entirely before key are skipped
+ * @param RIB_ptnode_t* node
+ * @param const RIB_prefix_t* key
+ * @returns RIB_ptnode_t*
+ */
+
+static RIB_ptnode_t* firstAfter(RIB_ptnode_t* node, const RIB_prefix_t* key) {
+  if (node == NULL) {
+    return NULL;
+  }
+  if (RIB_prefix_compare(&node->prefix, key) > 0) {
+    return node;
+  }
+  const RIB_prefix_t last = lastAddress(&node->prefix);
+  if (RIB_prefix_compare(&last, key) <= 0) {
+    return NULL;
+  }
+  RIB_ptnode_t* next = firstAfter(node->child[0], key);
+  return next != NULL ? next : firstAfter(node->child[1], key);
+}
+
+/**
+ * @function RIB_ptree_first_after
+ * @description returns the first node which comes after the provided key in prefix order
+ * @param const RIB_ptree_t*
+ * @param const RIB_prefix_t* key
+ * @returns RIB_ptnode_t*: NULL if there are no nodes after key
+ */
+
+RIB_ptnode_t* RIB_ptree_first_after(const RIB_ptree_t* tree, const RIB_prefix_t* key) {
+  return firstAfter(tree->root, key);
+}
+
+/**
+ * @function RIB_ptree_prune
+ * @description remove a whole subtree from the tree and free its nodes (routes are not freed)
+ * @param RIB_ptree_t*
+ * @param RIB_ptnode_t* top: root of the subtree
+ */
+
+void RIB_ptree_prune(RIB_ptree_t* tree, RIB_ptnode_t* top) {
+  RIB_ptnode_t* parent = top->parent;
+  replaceChild(tree, parent, top, NULL);
+  top->parent = NULL;
+  //Free the detached subtree with an iterative post order visit
+  RIB_ptnode_t* node = top;
+  while (node != NULL) {
+    if (node->child[0] != NULL) {
+      node = node->child[0];
+    } else if (node->child[1] != NULL) {
+      node = node->child[1];
+    } else {
+      RIB_ptnode_t* up = node->parent;
+      if (up != NULL) {
+        up->child[up->child[0] == node ? 0 : 1] = NULL;
+      }
+      if (node->route != NULL) {
+        tree->routes--;
+      }
+      free(node);
+      tree->nodes--;
+      node = up;
+    }
+  }
+  //The parent may be a glue node which is no more needed
+  if (parent != NULL && parent->route == NULL) {
+    RIB_ptree_remove_node(tree, parent);
+  }
+}
@@ -0,0 +1,70 @@
+/**
+ *   librib - ptree.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef RIB_PTREE_H
+#define RIB_PTREE_H
+
+#include "prefix.h"
+
+#include <rib/rib.h>
+
+/**
+ * Path compressed binary trie (patricia tree) of prefixes.
+ * Each node holds a prefix; nodes without a route are glue nodes which only exist to branch.
+ * Trees of other objects store them in the value of the nodes.
+ * A pre-order visit returns the prefixes in prefix order (see RIB_prefix_compare).
+ */
+
+// Data types
+
+typedef struct RIB_ptnode_t {
+  struct RIB_ptnode_t* parent;
+  struct RIB_ptnode_t* child[2];
+  RIB_prefix_t prefix;
+  union {
+    Route* route; //NULL for glue nodes
+    void* value;  //Payload of trees which don't store routes
+  };
+} RIB_ptnode_t;
+
+typedef struct RIB_ptree_t {
+  RIB_ptnode_t* root;
+  size_t nodes;
+  size_t routes;
+} RIB_ptree_t;
+
+// Functions
+
+void RIB_ptree_init(RIB_ptree_t* tree);
+void RIB_ptree_clear(RIB_ptree_t* tree);
+RIB_ret_code_t RIB_ptree_insert(RIB_ptree_t* tree, const RIB_prefix_t* prefix, void* value);
+RIB_ptnode_t* RIB_ptree_find(const RIB_ptree_t* tree, const RIB_prefix_t* prefix);
+Route* RIB_ptree_remove(RIB_ptree_t* tree, const RIB_prefix_t* prefix);
+void RIB_ptree_remove_node(RIB_ptree_t* tree, RIB_ptnode_t* node);
+Route* RIB_ptree_match(const RIB_ptree_t* tree, const RIB_prefix_t* address);
+RIB_ptnode_t* RIB_ptree_next(const RIB_ptnode_t* node, const RIB_ptnode_t* top);
+RIB_ptnode_t* RIB_ptree_subtree(const RIB_ptree_t* tree, const RIB_prefix_t* prefix);
+RIB_ptnode_t* RIB_ptree_first_after(const RIB_ptree_t* tree, const RIB_prefix_t* key);
+void RIB_ptree_prune(RIB_ptree_t* tree, RIB_ptnode_t* top);
+
+#endif
@@ -0,0 +1,366 @@
+/**
+ *   librib - range.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include "alloc.h"
+#include "range.h"
+#include "prefix.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RANGE_X86
+#endif
+
+#define RANGE_ALIGN 64
+#define RANGE_BIAS 0x80000000
+
+typedef struct RIB_range_prefix_t {
+  uint32_t start;
+  uint32_t end;
+  int length;
+  uint32_t nexthop;
+} RIB_range_prefix_t;
+
+typedef struct RIB_range_builder_t {
+  uint32_t* starts;
+  uint32_t* nexthops;
+  size_t count;
+} RIB_range_builder_t;
+
+/**
+ * @function comparePrefixes
+ * @description sort prefixes by start address; less specific prefixes first
+ */
+
+static int comparePrefixes(const void* a, const void* b) {
+  const RIB_range_prefix_t* prefixA = (const RIB_range_prefix_t*) a;
+  const RIB_range_prefix_t* prefixB = (const RIB_range_prefix_t*) b;
+  if (prefixA->start != prefixB->start) {
+    return prefixA->start < prefixB->start ? -1 : 1;
+  }
+  if (prefixA->length != prefixB->length) {
+    return prefixA->length < prefixB->length ? -1 : 1;
+  }
+  //Keep RIB order between duplicates, so the first route wins
+  return prefixA->nexthop < prefixB->nexthop ? -1 : (prefixA->nexthop > prefixB->nexthop);
+}
+
+/**
+ * @function emitInterval
+ * @description append an interval to the builder, merging it with the previous one when possible
+ * @param RIB_range_builder_t*
+ * @param uint32_t start
+ * @param uint32_t nexthop
+ */
+
+static void emitInterval(RIB_range_builder_t* builder, uint32_t start, uint32_t nexthop) {
+  if (builder->count > 0) {
+    const size_t last = builder->count - 1;
+    if (builder->starts[last] == start) {
+      //A more specific prefix starting at the same address overrides the previous interval
+      builder->nexthops[last] = nexthop;
+      if (last > 0 && builder->nexthops[last - 1] == nexthop) {
+        builder->count--;
+      }
+      return;
+    }
+    if (builder->nexthops[last] == nexthop) {
+      return;
+    }
+  }
+  builder->starts[builder->count] = start;
+  builder->nexthops[builder->count] = nexthop;
+  builder->count++;
+}
+
+/**
+ * @function rankScalar
+ * @description returns the number of keys of a node less or equal than the provided (biased) key
+ * @param const int32_t* keys
+ * @param int32_t key
+ * @returns uint32_t
+ */
+
+static inline uint32_t rankScalar(const int32_t* keys, int32_t key) {
+  uint32_t rank = 0;
+  for (int i = 0; i < RIB_RANGE_FANOUT; i++) {
+    rank += keys[i] <= key;
+  }
+  return rank;
+}
+
+/**
+ * @function lookupScalar
+ * @description search the interval containing the provided (biased) key
+ * @param const RIB_range_t*
+ * @param int32_t key
+ * @returns uint32_t interval index
+ */
+
+static uint32_t lookupScalar(const RIB_range_t* table, int32_t key) {
+  uint32_t node = 0;
+  for (uint32_t level = 0; level < table->levels; level++) {
+    const int32_t* keys = (const int32_t*) ((const char*) table + table->levelOffset[level]) + (node * RIB_RANGE_FANOUT);
+    node = (node * RIB_RANGE_FANOUT) + rankScalar(keys, key) - 1;
+  }
+  return node;
+}
+
+#ifdef RANGE_X86
+
+/**
+ * @function lookupAvx2
+ * @description search the interval containing the provided (biased) key; each node is compared with two AVX2 compares
+ * @param const RIB_range_t*
+ * @param int32_t key
+ * @returns uint32_t interval index
+ */
+
+__attribute__((target("avx2")))
+static uint32_t lookupAvx2(const RIB_range_t* table, int32_t key) {
+  const __m256i value = _mm256_set1_epi32(key);
+  uint32_t node = 0;
+  for (uint32_t level = 0; level < table->levels; level++) {
+    const int32_t* keys = (const int32_t*) ((const char*) table + table->levelOffset[level]) + (node * RIB_RANGE_FANOUT);
+    const __m256i greaterLo = _mm256_cmpgt_epi32(_mm256_load_si256((const __m256i*) keys), value);
+    const __m256i greaterHi = _mm256_cmpgt_epi32(_mm256_load_si256((const __m256i*) (keys + 8)), value);
+    const unsigned int mask = (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(greaterLo)) | ((unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(greaterHi)) << 8);
+    node = (node * RIB_RANGE_FANOUT) + (RIB_RANGE_FANOUT - (uint32_t) __builtin_popcount(mask)) - 1;
+  }
+  return node;
+}
+
+#endif
+
+/**
+ * @function hasAvx2
+ * @description returns whether the cpu supports AVX2 (checked once)
+ * @returns int
+ */
+
+static int hasAvx2(void) {
+#ifdef RANGE_X86
+  static int avx2 = -1;
+  if (avx2 < 0) {
+    __builtin_cpu_init();
+    avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+  }
+  return avx2;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * @function RIB_range_build
+ * @description build a range table from the ipv4 routes
+ * @param Route** routes
+ * @param size_t entries
+ * @param RIB_hugepage_mode_t hugePages
+ * @param RIB_range_t** table: built table; NULL if there are no ipv4 routes
+ * @param Route*** nexthops: routes referenced by the table next hop indexes
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_range_build(Route** routes, size_t entries, RIB_hugepage_mode_t hugePages, RIB_range_t** table, Route*** nexthops) {
+  *table = NULL;
+  *nexthops = NULL;
+  RIB_range_prefix_t* prefixes = (RIB_range_prefix_t*) malloc(sizeof(RIB_range_prefix_t) * (entries + 1));
+  Route** tableRoutes = (Route**) malloc(sizeof(Route*) * (entries + 1));
+  if (prefixes == NULL || tableRoutes == NULL) {
+    free(prefixes);
+    free(tableRoutes);
+    return RIB_BAD_ALLOC;
+  }
+  //Collect ipv4 prefixes
+  size_t count = 0;
+  for (size_t i = 0; i < entries; i++) {
+    RIB_prefix_t prefix;
+    if (routes[i]->ipv != 4 || RIB_prefix_from_route(routes[i], &prefix) != 0) {
+      continue;
+    }
+    RIB_range_prefix_t* thisPrefix = &prefixes[count];
+    thisPrefix->start = (uint32_t) (prefix.hi >> 32);
+    thisPrefix->end = thisPrefix->start | (prefix.length == 0 ? 0xFFFFFFFF : (uint32_t) (0xFFFFFFFFULL >> prefix.length));
+    thisPrefix->length = prefix.length;
+    thisPrefix->nexthop = (uint32_t) count;
+    tableRoutes[count++] = routes[i];
+  }
+  if (count == 0) {
+    free(prefixes);
+    free(tableRoutes);
+    return RIB_NO_ERROR;
+  }
+  qsort(prefixes, count, sizeof(RIB_range_prefix_t), comparePrefixes);
+  //Expand prefixes into disjoint intervals; the stack holds the prefixes enclosing the current address
+  RIB_range_builder_t builder;
+  builder.starts = (uint32_t*) malloc(sizeof(uint32_t) * ((2 * count) + 1));
+  builder.nexthops = (uint32_t*) malloc(sizeof(uint32_t) * ((2 * count) + 1));
+  builder.count = 0;
+  RIB_range_prefix_t** stack = (RIB_range_prefix_t**) malloc(sizeof(RIB_range_prefix_t*) * (count + 1));
+  if (builder.starts == NULL || builder.nexthops == NULL || stack == NULL) {
+    free(builder.starts);
+    free(builder.nexthops);
+    free(stack);
+    free(prefixes);
+    free(tableRoutes);
+    return RIB_BAD_ALLOC;
+  }
+  size_t depth = 0;
+  emitInterval(&builder, 0, RIB_RANGE_NONE);
+  for (size_t i = 0; i < count; i++) {
+    RIB_range_prefix_t* thisPrefix = &prefixes[i];
+    if (i > 0 && thisPrefix->start == prefixes[i - 1].start && thisPrefix->length == prefixes[i - 1].length) {
+      continue;
+    }
+    while (depth > 0 && stack[depth - 1]->end < thisPrefix->start) {
+      const uint32_t resume = stack[depth - 1]->end + 1;
+      depth--;
+      emitInterval(&builder, resume, depth > 0 ? stack[depth - 1]->nexthop : RIB_RANGE_NONE);
+    }
+    emitInterval(&builder, thisPrefix->start, thisPrefix->nexthop);
+    stack[depth++] = thisPrefix;
+  }
+  while (depth > 0) {
+    const uint32_t end = stack[depth - 1]->end;
+    depth--;
+    if (end != 0xFFFFFFFF) {
+      emitInterval(&builder, end + 1, depth > 0 ? stack[depth - 1]->nexthop : RIB_RANGE_NONE);
+    }
+  }
+  free(stack);
+  free(prefixes);
+  //Compute tree shape (bottom up: level sizes in keys)
+  size_t levelKeys[RIB_RANGE_MAX_LEVELS];
+  uint32_t levels = 0;
+  size_t keys = builder.count;
+  do {
+    levelKeys[levels++] = keys;
+    keys = (keys + RIB_RANGE_FANOUT - 1) / RIB_RANGE_FANOUT;
+  } while (levelKeys[levels - 1] > RIB_RANGE_FANOUT);
+  //Compute layout (top down)
+  uint64_t size = (sizeof(RIB_range_t) + RANGE_ALIGN - 1) & ~((uint64_t) RANGE_ALIGN - 1);
+  uint64_t levelOffset[RIB_RANGE_MAX_LEVELS];
+  size_t levelSlots[RIB_RANGE_MAX_LEVELS];
+  for (uint32_t l = 0; l < levels; l++) {
+    const size_t levelNodes = (levelKeys[levels - 1 - l] + RIB_RANGE_FANOUT - 1) / RIB_RANGE_FANOUT;
+    levelSlots[l] = levelNodes * RIB_RANGE_FANOUT;
+    levelOffset[l] = size;
+    size += levelSlots[l] * sizeof(int32_t);
+  }
+  const uint64_t nexthopOffset = size;
+  size += builder.count * sizeof(uint32_t);
+  size = (size + RANGE_ALIGN - 1) & ~((uint64_t) RANGE_ALIGN - 1);
+  RIB_range_t* newTable = (RIB_range_t*) RIB_table_alloc(size, hugePages);
+  if (newTable == NULL) {
+    free(builder.starts);
+    free(builder.nexthops);
+    free(tableRoutes);
+    return RIB_BAD_ALLOC;
+  }
+  newTable->size = size;
+  newTable->intervals = (uint32_t) builder.count;
+  newTable->levels = levels;
+  newTable->routes = (uint32_t) count;
+  newTable->nexthopOffset = nexthopOffset;
+  //Fill leaves with the biased interval starts, then each upper level with the first key of each child node
+  for (int l = (int) levels - 1; l >= 0; l--) {
+    int32_t* levelKeysPtr = (int32_t*) ((char*) newTable + levelOffset[l]);
+    newTable->levelOffset[l] = levelOffset[l];
+    for (size_t k = 0; k < levelSlots[l]; k++) {
+      levelKeysPtr[k] = INT32_MAX;
+    }
+    if (l == (int) levels - 1) {
+      for (size_t k = 0; k < builder.count; k++) {
+        levelKeysPtr[k] = (int32_t) (builder.starts[k] ^ RANGE_BIAS);
+      }
+    } else {
+      const int32_t* childKeys = (const int32_t*) ((char*) newTable + levelOffset[l + 1]);
+      const size_t children = levelKeys[levels - 1 - l];
+      for (size_t k = 0; k < children; k++) {
+        levelKeysPtr[k] = childKeys[k * RIB_RANGE_FANOUT];
+      }
+    }
+  }
+  memcpy((char*) newTable + nexthopOffset, builder.nexthops, builder.count * sizeof(uint32_t));
+  free(builder.starts);
+  free(builder.nexthops);
+  *table = newTable;
+  *nexthops = tableRoutes;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_range_lookup
+ * @description find the next hop of the interval containing the provided address
+ * @param const RIB_range_t* table
+ * @param uint32_t address (host byte order)
+ * @returns uint32_t: next hop index; RIB_RANGE_NONE if there is no match
+ */
+
+uint32_t RIB_range_lookup(const RIB_range_t* table, uint32_t address) {
+  if (table == NULL) {
+    return RIB_RANGE_NONE;
+  }
+  uint32_t interval;
+  if (address == 0xFFFFFFFF) {
+    //Padding keys are equal to the biased broadcast address: it always falls in the last interval
+    interval = table->intervals - 1;
+  } else if (hasAvx2()) {
+#ifdef RANGE_X86
+    interval = lookupAvx2(table, (int32_t) (address ^ RANGE_BIAS));
+#else
+    interval = lookupScalar(table, (int32_t) (address ^ RANGE_BIAS));
+#endif
+  } else {
+    interval = lookupScalar(table, (int32_t) (address ^ RANGE_BIAS));
+  }
+  return ((const uint32_t*) ((const char*) table + table->nexthopOffset))[interval];
+}
+
+/**
+ * @function RIB_range_lookup_batch
+ * @description find the next hops of a batch of addresses; lookups are independent, so they overlap in the cpu pipeline
+ * @param const RIB_range_t* table
+ * @param const uint32_t* addresses (host byte order)
+ * @param size_t count
+ * @param uint32_t* results
+ */
+
+void RIB_range_lookup_batch(const RIB_range_t* table, const uint32_t* addresses, size_t count, uint32_t* results) {
+  for (size_t i = 0; i < count; i++) {
+    results[i] = RIB_range_lookup(table, addresses[i]);
+  }
+}
+
+/**
+ * @function RIB_range_free
+ * @description free a range table
+ * @param RIB_range_t*
+ */
+
+void RIB_range_free(RIB_range_t* table) {
+  RIB_table_free(table);
+}
@@ -0,0 +1,62 @@
+/**
+ *   librib - range.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef RIB_RANGE_H
+#define RIB_RANGE_H
+
+#include <rib/rib.h>
+
+#include <stdint.h>
+
+/**
+ * IPv4 range table
+ * Prefixes are expanded into disjoint address intervals, each one mapped to a next hop index.
+ * Interval starts are stored in a static 16-way search tree (B+ tree in implicit layout):
+ * each node is a cache line of 16 keys, so a lookup is one vector compare per level.
+ * The whole table is stored in a single block with offsets, so it can be moved or shared.
+ */
+
+#define RIB_RANGE_NONE 0xFFFFFFFF
+#define RIB_RANGE_FANOUT 16
+#define RIB_RANGE_MAX_LEVELS 8
+
+// Data types
+
+typedef struct RIB_range_t {
+  uint64_t size;          //Size of the table in bytes
+  uint32_t intervals;
+  uint32_t levels;
+  uint32_t routes;
+  uint32_t reserved;
+  uint64_t nexthopOffset; //Next hop index of each interval
+  uint64_t levelOffset[RIB_RANGE_MAX_LEVELS]; //Keys of each level; level 0 is the root
+} RIB_range_t;
+
+// Functions
+
+RIB_ret_code_t RIB_range_build(Route** routes, size_t entries, RIB_hugepage_mode_t hugePages, RIB_range_t** table, Route*** nexthops);
+uint32_t RIB_range_lookup(const RIB_range_t* table, uint32_t address);
+void RIB_range_lookup_batch(const RIB_range_t* table, const uint32_t* addresses, size_t count, uint32_t* results);
+void RIB_range_free(RIB_range_t* table);
+
+#endif
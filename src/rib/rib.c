@@ -24,8 +24,80 @@
 #include <rib/iputils.h>
 #include <rib/rib.h>
 
+#include "codec.h"
+#include "engine.h"
+#include "index.h"
+#include "mrt.h"
+#include "prefix.h"
+#include "trace.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#define RIB_AUTO_LINEAR_THRESHOLD 16
+
+#define RIB_DAMPENING_PENALTY 1000
+#define RIB_DAMPENING_SUPPRESS 2000
+#define RIB_DAMPENING_REUSE 750
+#define RIB_DAMPENING_HALF_LIFE 900000     //15 minutes
+#define RIB_DAMPENING_MAX_SUPPRESS 3600000 //60 minutes
+
+#define RIB_EXPIRY_RESOLUTION 10 //Milliseconds per tick of the expiry wheel
+
+/**
+ * @function getEngine
+ * @description returns the lookup engine for the provided ip version
+ * @param RIB*
+ * @param int ipv
+ * @returns RIB_engine_t*
+ */
+
+static inline RIB_engine_t* getEngine(RIB* rtab, int ipv) {
+  return rtab->engines[ipv == 6 ? 1 : 0];
+}
+
+/**
+ * @function resetEngines
+ * @description replace the lookup engines with new engines built from the routes stored in the RIB
+ * @param RIB*
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t resetEngines(RIB* rtab) {
+  RIB_ret_code_t rc;
+  RIB_engine_t* ipv4Engine;
+  RIB_engine_t* ipv6Engine;
+  if ((rc = RIB_engine_create(rtab, 4, rtab->options.ipv4Engine, &ipv4Engine)) != RIB_NO_ERROR) {
+    return rc;
+  }
+  if ((rc = RIB_engine_create(rtab, 6, rtab->options.ipv6Engine, &ipv6Engine)) != RIB_NO_ERROR) {
+    RIB_engine_destroy(ipv4Engine);
+    return rc;
+  }
+  RIB_engine_destroy(rtab->engines[0]);
+  RIB_engine_destroy(rtab->engines[1]);
+  rtab->engines[0] = ipv4Engine;
+  rtab->engines[1] = ipv6Engine;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_options_init
+ * @description initialize RIB options with default values
+ * @param RIB_options_t* options
+ */
+
+void RIB_options_init(RIB_options_t* options) {
+  options->ipv4Engine = RIB_ENGINE_AUTO;
+  options->ipv6Engine = RIB_ENGINE_AUTO;
+  options->bloomFilter = 0;
+  options->autoLinearThreshold = RIB_AUTO_LINEAR_THRESHOLD;
+  options->hugePages = RIB_HUGEPAGES_NONE;
+  options->numaReplicas = 0;
+}
 
 /**
  * @function RIB_init
@@ -35,14 +107,364 @@
  */
 
 RIB_ret_code_t RIB_init(RIB** rtab) {
+  return RIB_init_ex(rtab, NULL);
+}
+
+/**
+ * @function RIB_init_ex
+ * @description initialize a RIB data structure with the provided options; returns NULL if it fails
+ * @param RIB** rtab
+ * @param const RIB_options_t* options: NULL to use default options
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_init_ex(RIB** rtab, const RIB_options_t* options) {
   *rtab = (RIB*) malloc(sizeof(RIB));
-  if (rtab != NULL) {
-    (*rtab)->entries = 0;
-    (*rtab)->routes = NULL;
-    return RIB_NO_ERROR;
+  if (*rtab == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  (*rtab)->entries = 0;
+  (*rtab)->routes = NULL;
+  if (options != NULL) {
+    (*rtab)->options = *options;
+  } else {
+    RIB_options_init(&(*rtab)->options);
+  }
+  (*rtab)->engines[0] = NULL;
+  (*rtab)->engines[1] = NULL;
+  RIB_ret_code_t rc = RIB_index_create(&(*rtab)->index);
+  if (rc == RIB_NO_ERROR && (rc = resetEngines(*rtab)) != RIB_NO_ERROR) {
+    RIB_index_free((*rtab)->index);
+  }
+  if (rc != RIB_NO_ERROR) {
+    free(*rtab);
+    *rtab = NULL;
+  }
+  return rc;
+}
+
+/**
+ * @function freeRoute
+ * @description free a route allocated by the RIB and its attributes
+ * @param Route*
+ */
+
+static void freeRoute(Route* route) {
+  if (route == NULL) {
+    return;
+  }
+  free(route->destination);
+  free(route->netmask);
+  free(route->gateway);
+  free(route->iface);
+  RIB_nhgroup_release(RIB_entry_of(route)->nexthops);
+  free(RIB_entry_of(route)->members);
+  RIB_candidates_free(RIB_entry_of(route)->candidates);
+  free(RIB_entry_of(route));
+}
+
+/**
+ * @function newRoute
+ * @description allocate a route with normalized destination and formatted attributes
+ * @param const char* destination
+ * @param const char* netmask/prefix char representation
+ * @param const char* gateway
+ * @param const char* iface
+ * @param int metric
+ * @param int ipVersion
+ * @param Route** route
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t newRoute(const char* destination, const char* netmask, const char* gateway, const char* iface, int metric, int ipVersion, Route** route) {
+  *route = NULL;
+  //The gateway is formatted as an address of the destination family
+  int gatewayVersion;
+  if (isValidIpAddress(gateway, &gatewayVersion) != 0 || gatewayVersion != ipVersion) {
+    return RIB_INVALID_ADDRESS;
+  }
+  RIB_entry_t* entry = (RIB_entry_t*) calloc(1, sizeof(RIB_entry_t));
+  if (entry == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  Route* thisRoute = &entry->route;
+  //Allocate space for the new record
+  thisRoute->netmask = strdup(netmask);
+  thisRoute->gateway = strdup(gateway);
+  thisRoute->iface = strdup(iface);
+  if (thisRoute->netmask == NULL || thisRoute->gateway == NULL || thisRoute->iface == NULL) {
+    freeRoute(thisRoute);
+    return RIB_BAD_ALLOC;
+  }
+  //Convert destination to a real destination (it may be not if user provided us an ip address)
+  if (ipVersion == 4) {
+    thisRoute->destination = getIpv4NetworkAddress(destination, netmask);
+  } else {
+    thisRoute->prefixLength = atoi(netmask);
+    thisRoute->prefixLength = (thisRoute->prefixLength - (thisRoute->prefixLength % 8)); //Must be multiply of 8
+    thisRoute->destination = getIpv6NetworkAddress(destination, thisRoute->prefixLength);
+  }
+  if (thisRoute->destination == NULL) {
+    freeRoute(thisRoute);
+    return RIB_INVALID_ADDRESS;
+  }
+  thisRoute->metric = metric;
+  thisRoute->ipv = ipVersion;
+  //Format addresses
+  if (ipVersion == 4) {
+    formatIPv4Address(&thisRoute->destination);
+    formatIPv4Address(&thisRoute->netmask);
+    formatIPv4Address(&thisRoute->gateway);
+  } else {
+    formatIPv6Address(&thisRoute->destination);
+    formatIPv6Address(&thisRoute->gateway);
+  }
+  *route = thisRoute;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function swapAttributes
+ * @description exchange the attributes of two routes of the same ip version, next hops included (the RIB entry data is kept)
+ * @param Route* route
+ * @param Route* other
+ */
+
+static void swapAttributes(Route* route, Route* other) {
+  const Route tmp = *route;
+  route->destination = other->destination;
+  route->netmask = other->netmask;
+  route->prefixLength = other->prefixLength;
+  route->gateway = other->gateway;
+  route->iface = other->iface;
+  route->metric = other->metric;
+  other->destination = tmp.destination;
+  other->netmask = tmp.netmask;
+  other->prefixLength = tmp.prefixLength;
+  other->gateway = tmp.gateway;
+  other->iface = tmp.iface;
+  other->metric = tmp.metric;
+  RIB_nhgroup_t* nexthops = RIB_entry_of(route)->nexthops;
+  RIB_entry_of(route)->nexthops = RIB_entry_of(other)->nexthops;
+  RIB_entry_of(other)->nexthops = nexthops;
+}
+
+/**
+ * @function sameAttributes
+ * @description returns whether two routes for the same prefix have the same attributes
+ * @param const Route*
+ * @param const Route*
+ * @returns int
+ */
+
+static int sameAttributes(const Route* route, const Route* other) {
+  return route->metric == other->metric && strcmp(route->gateway, other->gateway) == 0 && strcmp(route->iface, other->iface) == 0 && strcmp(route->netmask, other->netmask) == 0;
+}
+
+/**
+ * @function replaceRoute
+ * @description replace the attributes of a route stored in the RIB with the ones of another route, which gets the old ones
+ * @param RIB*
+ * @param Route* route stored in the RIB
+ * @param Route* newAttributes
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t replaceRoute(RIB* rtab, Route* route, Route* newAttributes) {
+  RIB_engine_t* engine = getEngine(rtab, route->ipv);
+  engine->ops->remove(engine, route);
+  RIB_index_remove(rtab->index, route);
+  swapAttributes(route, newAttributes);
+  RIB_ret_code_t rc = RIB_index_insert(rtab->index, route);
+  if (rc != RIB_NO_ERROR) {
+    //Restore the previous attributes
+    swapAttributes(route, newAttributes);
+    RIB_index_insert(rtab->index, route);
+    engine->ops->insert(engine, route);
+    return rc;
+  }
+  return engine->ops->insert(engine, route);
+}
+
+/**
+ * @function takeSlot
+ * @description take a route out of the routes array, moving the last route into its slot
+ * @param RIB*
+ * @param Route*
+ */
+
+static void takeSlot(RIB* rtab, Route* route) {
+  size_t slot = RIB_entry_of(route)->slot;
+  rtab->entries--;
+  if (slot != rtab->entries) {
+    rtab->routes[slot] = rtab->routes[rtab->entries];
+    RIB_entry_of(rtab->routes[slot])->slot = slot;
+  }
+  //Hits of the taken route are discarded
+  if (rtab->index->hits != NULL) {
+    RIB_hits_move(rtab->index->hits, rtab->entries, slot);
+    RIB_hits_clear(rtab->index->hits, rtab->entries, 1);
+  }
+}
+
+/**
+ * @function shrinkRoutes
+ * @description shrink the routes array to the number of entries
+ * @param RIB*
+ */
+
+static void shrinkRoutes(RIB* rtab) {
+  if (rtab->entries == 0) {
+    free(rtab->routes);
+    rtab->routes = NULL;
   } else {
+    Route** routes = (Route**) realloc(rtab->routes, sizeof(Route*) * rtab->entries);
+    if (routes != NULL) {
+      rtab->routes = routes;
+    }
+  }
+}
+
+/**
+ * @function storeRoute
+ * @description store a new route in the routes array, the index and the lookup engine; the route is freed on failure
+ * @param RIB*
+ * @param Route*
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t storeRoute(RIB* rtab, Route* route) {
+  RIB_entry_of(route)->generation = rtab->index->generation;
+  RIB_entry_of(route)->slot = rtab->entries;
+  if (rtab->index->hits != NULL && RIB_hits_reserve(rtab->index->hits, rtab->entries + 1) != RIB_NO_ERROR) {
+    freeRoute(route);
     return RIB_BAD_ALLOC;
   }
+  //Allocate new route and store it into routing table
+  Route** routes = (Route**) realloc(rtab->routes, sizeof(Route*) * (rtab->entries + 1));
+  if (routes == NULL) {
+    freeRoute(route);
+    return RIB_BAD_ALLOC;
+  }
+  rtab->routes = routes;
+  rtab->routes[rtab->entries++] = route;
+  //Index new route
+  RIB_ret_code_t rc;
+  if ((rc = RIB_index_insert(rtab->index, route)) != RIB_NO_ERROR) {
+    rtab->entries--;
+    freeRoute(route);
+    return rc;
+  }
+  RIB_engine_t* engine = getEngine(rtab, route->ipv);
+  if ((rc = engine->ops->insert(engine, route)) != RIB_NO_ERROR) {
+    RIB_index_remove(rtab->index, route);
+    rtab->entries--;
+    freeRoute(route);
+    return rc;
+  }
+  RIB_timer_t* expiry = &RIB_entry_of(route)->expiry;
+  if (expiry->deadline != 0) {
+    RIB_wheel_schedule(rtab->index->expiries, expiry, expiry->deadline);
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function dropCandidates
+ * @description forget the candidates of a route, which is then managed as a route added with RIB_add
+ * @param Route*
+ */
+
+static void dropCandidates(Route* route) {
+  RIB_candidates_free(RIB_entry_of(route)->candidates);
+  RIB_entry_of(route)->candidates = NULL;
+}
+
+/**
+ * @function releaseRoute
+ * @description free a route removed from the RIB, cancelling its expiry
+ * @param RIB*
+ * @param Route*
+ */
+
+static void releaseRoute(RIB* rtab, Route* route) {
+  if (rtab->index->expiries != NULL) {
+    RIB_wheel_cancel(rtab->index->expiries, &RIB_entry_of(route)->expiry);
+  }
+  freeRoute(route);
+}
+
+/**
+ * @function removeRoute
+ * @description remove a route from the lookup engine, the index and the routes array, then free it
+ * @param RIB*
+ * @param Route*
+ */
+
+static void removeRoute(RIB* rtab, Route* route) {
+  RIB_engine_t* engine = getEngine(rtab, route->ipv);
+  engine->ops->remove(engine, route);
+  RIB_index_remove(rtab->index, route);
+  takeSlot(rtab, route);
+  releaseRoute(rtab, route);
+  shrinkRoutes(rtab);
+}
+
+/**
+ * @function findRouteKey
+ * @description find the route stored for a network address; the "*" netmask matches the first route with the provided destination
+ * @param RIB*
+ * @param const char* networkAddr
+ * @param const char* netmask
+ * @param int ipVersion
+ * @param RIB_prefix_t* prefix: key which has been looked up (left untouched if the address is invalid)
+ * @returns Route*: NULL if not found
+ */
+
+static Route* findRouteKey(RIB* rtab, const char* networkAddr, const char* netmask, int ipVersion, RIB_prefix_t* prefix) {
+  if (netmask == NULL) {
+    return NULL;
+  }
+  RIB_prefix_t key;
+  if (strcmp(netmask, "*") == 0) {
+    if (RIB_prefix_from_address(networkAddr, ipVersion, &key) != 0) {
+      return NULL;
+    }
+    *prefix = key;
+    return RIB_index_find_address(rtab->index, ipVersion, &key);
+  }
+  if (RIB_index_key(networkAddr, netmask, ipVersion, &key) != 0) {
+    return NULL;
+  }
+  *prefix = key;
+  return RIB_index_find(rtab->index, ipVersion, &key);
+}
+
+/**
+ * @function findRoute
+ * @description find the route stored for a network address (see findRouteKey)
+ * @param RIB*
+ * @param const char* networkAddr
+ * @param const char* netmask
+ * @param int ipVersion
+ * @returns Route*: NULL if not found
+ */
+
+static Route* findRoute(RIB* rtab, const char* networkAddr, const char* netmask, int ipVersion) {
+  RIB_prefix_t prefix;
+  return findRouteKey(rtab, networkAddr, netmask, ipVersion, &prefix);
+}
+
+/**
+ * @function discardRoute
+ * @description release callback: free a route held out of the RIB (suppressed or source specific)
+ * @param Route* held
+ * @param void* context: unused
+ */
+
+static void discardRoute(Route* held, void* context) {
+  (void) context;
+  freeRoute(held);
 }
 
 /**
@@ -59,392 +481,1661 @@ RIB_ret_code_t RIB_free(RIB* rtab) {
   //If routing table exists delete each entry and for each entry free char pointers
   if (rtab->routes != NULL) {
     for(size_t i = 0; i < rtab->entries; i++) {
-      Route* thisRoute = rtab->routes[i];
-      if (thisRoute != NULL) {
-        if (thisRoute->destination != NULL) {
-          free(thisRoute->destination);
-        }
-        if (thisRoute->netmask != NULL) {
-          free(thisRoute->netmask);
-        }
-        if (thisRoute->gateway != NULL) {
-          free(thisRoute->gateway);
-        }
-        if (thisRoute->iface != NULL) {
-          free(thisRoute->iface);
-        }
-        free(thisRoute);
-      }
+      freeRoute(rtab->routes[i]);
     }
     free(rtab->routes);
   }
-  free(rtab);
-  return RIB_NO_ERROR;
+  RIB_damp_free(rtab->index->damp, discardRoute, NULL);
+  RIB_srcdst_free(rtab->index->sources, discardRoute, NULL);
+  RIB_engine_destroy(rtab->engines[0]);
+  RIB_engine_destroy(rtab->engines[1]);
+  RIB_index_free(rtab->index);
+  free(rtab);
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function addRoute
+ * @description add new entry to the routing table, with an optional deadline (see RIB_add)
+ * @param RIB* routing table
+ * @param const char* destination
+ * @param const char* netmask/prefix char representation
+ * @param const char* gateway
+ * @param const char* iface
+ * @param int metric
+ * @param uint64_t deadline: time at which the route expires (0 if it doesn't expire)
+ * @param int* ipv: ip version of the route, for the tracepoint (may be NULL; left untouched if the route is invalid)
+ * @param RIB_prefix_t* traced: prefix of the route, for the tracepoint (may be NULL; left untouched if the route is invalid)
+ * @returns RIB_ret_code_t: 0 if add operation succeeded
+ */
+
+static RIB_ret_code_t addRoute(RIB* rtab, const char* destination, const char* netmask, const char* gateway, const char* iface, int metric, uint64_t deadline, int* ipv, RIB_prefix_t* traced) {
+  //Check whether provided addresses are valid and get ip version
+  int ipVersion;
+  if (isValidIpAddress(destination, &ipVersion) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  if (ipVersion == 4) {
+    if (isValidIpAddress(netmask, NULL) != 0) {
+      return RIB_INVALID_ADDRESS;
+    }
+  }
+  if (isValidIpAddress(gateway, NULL) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  if (ipVersion != 4 && ipVersion != 6) {
+    return RIB_INVALID_ADDRESS;
+  }
+  if (netmask == NULL || iface == NULL) {
+    return RIB_INVALID_ADDRESS;
+  }
+  Route* thisRoute;
+  RIB_ret_code_t rc = newRoute(destination, netmask, gateway, iface, metric, ipVersion, &thisRoute);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  RIB_entry_of(thisRoute)->expiry.deadline = deadline;
+  //check if an entry for provided destination already exists (the index is keyed by network address and prefix length)
+  RIB_prefix_t prefix;
+  if (RIB_prefix_from_route(thisRoute, &prefix) != 0) {
+    freeRoute(thisRoute);
+    return RIB_INVALID_ADDRESS;
+  }
+  if (ipv != NULL && traced != NULL) {
+    *ipv = ipVersion;
+    *traced = prefix;
+  }
+  Route* existing = RIB_index_find(rtab->index, ipVersion, &prefix);
+  if (existing != NULL) {
+    if (!rtab->index->reloading) {
+      freeRoute(thisRoute);
+      return RIB_INVALID_ADDRESS;
+    }
+    //Reloading: keep the route and apply only the changed attributes
+    RIB_entry_of(existing)->generation = rtab->index->generation;
+    if (!sameAttributes(existing, thisRoute)) {
+      rc = replaceRoute(rtab, existing, thisRoute);
+      dropCandidates(existing);
+    }
+    freeRoute(thisRoute);
+    //The deadline is refreshed as well
+    RIB_timer_t* expiry = &RIB_entry_of(existing)->expiry;
+    if (deadline != 0) {
+      RIB_wheel_schedule(rtab->index->expiries, expiry, deadline);
+    } else if (expiry->deadline != 0) {
+      RIB_wheel_cancel(rtab->index->expiries, expiry);
+      expiry->deadline = 0;
+    }
+    return rc;
+  }
+  RIB_damp_t* damp = rtab->index->damp;
+  RIB_damp_record_t* record = damp != NULL ? RIB_damp_find(damp, ipVersion, &prefix) : NULL;
+  if (record != NULL) {
+    //A suppressed prefix keeps only its last advertisement, which is added when the prefix is reused
+    int suppressed = RIB_damp_update(damp, record, RIB_clock());
+    freeRoute(record->held);
+    record->held = suppressed ? thisRoute : NULL;
+    if (suppressed) {
+      return RIB_NO_ERROR;
+    }
+  }
+  return storeRoute(rtab, thisRoute);
+}
+
+/**
+ * @function RIB_add
+ * @description add new entry to the routing table; while reloading, adding an existing prefix refreshes it (and updates its attributes if changed)
+ * @param RIB* routing table
+ * @param const char* destination
+ * @param const char* netmask/prefix char representation
+ * @param const char* gateway
+ * @param const char* iface
+ * @param int metric
+ * @returns RIB_ret_code_t: 0 if add operation succeeded
+ */
+
+RIB_ret_code_t RIB_add(RIB* rtab, const char* destination, const char* netmask, const char* gateway, const char* iface, int metric) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  int ipv = 0;
+  RIB_prefix_t prefix = {0, 0, 0};
+  RIB_TRACE_BEGIN(start);
+  RIB_ret_code_t rc = addRoute(rtab, destination, netmask, gateway, iface, metric, 0, &ipv, &prefix);
+  RIB_TRACE_END(RIB_TRACE_ADD, start, ipv, &prefix);
+  return rc;
+}
+
+/**
+ * @function RIB_add_with_ttl
+ * @description add a temporary route (e.g. a blackhole), which is deleted by RIB_expire once its TTL elapsed
+ * @param RIB* routing table
+ * @param const char* destination
+ * @param const char* netmask/prefix char representation
+ * @param const char* gateway
+ * @param const char* iface
+ * @param int metric
+ * @param uint64_t ttl: milliseconds from now (see RIB_clock)
+ * @returns RIB_ret_code_t: RIB_INVALID_ARGUMENT if the TTL is 0
+ */
+
+RIB_ret_code_t RIB_add_with_ttl(RIB* rtab, const char* destination, const char* netmask, const char* gateway, const char* iface, int metric, uint64_t ttl) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (ttl == 0) {
+    return RIB_INVALID_ARGUMENT;
+  }
+  const uint64_t now = RIB_clock();
+  if (rtab->index->expiries == NULL) {
+    rtab->index->expiries = (RIB_wheel_t*) malloc(sizeof(RIB_wheel_t));
+    if (rtab->index->expiries == NULL) {
+      return RIB_BAD_ALLOC;
+    }
+    RIB_wheel_init(rtab->index->expiries, RIB_EXPIRY_RESOLUTION, now);
+  }
+  int ipv = 0;
+  RIB_prefix_t prefix = {0, 0, 0};
+  RIB_TRACE_BEGIN(start);
+  RIB_ret_code_t rc = addRoute(rtab, destination, netmask, gateway, iface, metric, now + ttl, &ipv, &prefix);
+  RIB_TRACE_END(RIB_TRACE_ADD, start, ipv, &prefix);
+  return rc;
+}
+
+/**
+ * @function dampenWithdrawal
+ * @description delete a route (or the advertisement held for a suppressed prefix), penalizing its prefix
+ * @param RIB*
+ * @param Route* route: stored route; NULL if not found
+ * @param const char* networkAddr
+ * @param const char* netmask
+ * @param int ipVersion
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t dampenWithdrawal(RIB* rtab, Route* route, const char* networkAddr, const char* netmask, int ipVersion) {
+  RIB_damp_t* damp = rtab->index->damp;
+  RIB_prefix_t prefix;
+  if (route != NULL) {
+    if (RIB_prefix_from_route(route, &prefix) != 0) {
+      return RIB_INVALID_ADDRESS;
+    }
+  } else if (netmask == NULL || strcmp(netmask, "*") == 0 || RIB_index_key(networkAddr, netmask, ipVersion, &prefix) != 0) {
+    return RIB_NOT_EXISTS;
+  }
+  RIB_damp_record_t* record = RIB_damp_find(damp, ipVersion, &prefix);
+  if (route == NULL && (record == NULL || record->held == NULL)) {
+    return RIB_NOT_EXISTS;
+  }
+  //Withdrawing the advertisement of a suppressed prefix is a flap as well
+  RIB_ret_code_t rc = RIB_damp_penalize(damp, ipVersion, &prefix, RIB_clock(), &record);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  if (route != NULL) {
+    removeRoute(rtab, route);
+  }
+  freeRoute(record->held);
+  record->held = NULL;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function deleteRoute
+ * @description delete an entry from the routing table (see RIB_delete)
+ * @param RIB*
+ * @param const char* destination to remove
+ * @param const char* netmask
+ * @param int* ipv: ip version of the destination, for the tracepoint
+ * @param RIB_prefix_t* traced: prefix which has been looked up, for the tracepoint
+ * @returns RIB_ret_code_t: 0 if succeeded
+ */
+
+static RIB_ret_code_t deleteRoute(RIB* rtab, const char* destination, const char* netmask, int* ipv, RIB_prefix_t* traced) {
+  if (rtab->routes == NULL && rtab->index->damp == NULL) {
+    return RIB_NOT_EXISTS;
+  }
+  int ipVersion;
+  if (isValidIpAddress(destination, &ipVersion) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  *ipv = ipVersion;
+  Route* thisRoute = findRouteKey(rtab, destination, netmask, ipVersion, traced);
+  if (rtab->index->damp != NULL) {
+    return dampenWithdrawal(rtab, thisRoute, destination, netmask, ipVersion);
+  }
+  if (thisRoute == NULL) {
+    //Destination not found :(
+    return RIB_NOT_EXISTS;
+  }
+  removeRoute(rtab, thisRoute);
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_delete
+ * @description delete an entry from the routing table
+ * @param RIB*
+ * @param const char* destination to remove
+ * @param const char* netmask: "*" to delete the first route with the provided destination
+ * @returns RIB_ret_code_t: 0 if succeeded
+ */
+
+RIB_ret_code_t RIB_delete(RIB* rtab, const char* destination, const char* netmask) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  int ipv = 0;
+  RIB_prefix_t prefix = {0, 0, 0};
+  RIB_TRACE_BEGIN(start);
+  RIB_ret_code_t rc = deleteRoute(rtab, destination, netmask, &ipv, &prefix);
+  RIB_TRACE_END(RIB_TRACE_DELETE, start, ipv, &prefix);
+  return rc;
+}
+
+/**
+ * @function RIB_delete_subtree
+ * @description delete a prefix and all its more specifics (e.g. the routes covered by a withdrawn aggregate)
+ * @param RIB* rtab
+ * @param const char* networkAddr
+ * @param const char* netmask: netmask for ipv4, prefix length for ipv6
+ * @param size_t* removed: number of deleted routes (may be NULL)
+ * @returns RIB_ret_code_t: RIB_NOT_EXISTS if no route has been deleted
+ */
+
+RIB_ret_code_t RIB_delete_subtree(RIB* rtab, const char* networkAddr, const char* netmask, size_t* removed) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (removed != NULL) {
+    *removed = 0;
+  }
+  int ipVersion;
+  if (isValidIpAddress(networkAddr, &ipVersion) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  RIB_prefix_t prefix;
+  if (RIB_index_key(networkAddr, netmask, ipVersion, &prefix) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  Route** subtree;
+  size_t count;
+  RIB_ret_code_t rc = RIB_index_detach(rtab->index, ipVersion, &prefix, &subtree, &count);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  if (count == 0) {
+    return RIB_NOT_EXISTS;
+  }
+  //Take the routes out of the array before removing them from the engine, which may repopulate from it
+  for (size_t i = 0; i < count; i++) {
+    takeSlot(rtab, subtree[i]);
+  }
+  RIB_engine_t* engine = getEngine(rtab, ipVersion);
+  for (size_t i = 0; i < count; i++) {
+    engine->ops->remove(engine, subtree[i]);
+    releaseRoute(rtab, subtree[i]);
+  }
+  free(subtree);
+  shrinkRoutes(rtab);
+  if (removed != NULL) {
+    *removed = count;
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function routeNexthops
+ * @description get the equal cost next hops of a route, starting with its gateway
+ * @param const Route*
+ * @param RIB_nexthop_t* nexthops: room for RIB_MAX_NEXTHOPS next hops
+ * @returns size_t: number of next hops
+ */
+
+static size_t routeNexthops(const Route* route, RIB_nexthop_t* nexthops) {
+  const RIB_nhgroup_t* group = RIB_entry_of((Route*) route)->nexthops;
+  if (group == NULL) {
+    nexthops[0].gateway = route->gateway;
+    nexthops[0].iface = route->iface;
+    return 1;
+  }
+  memcpy(nexthops, group->members, sizeof(RIB_nexthop_t) * group->count);
+  //Members are sorted: move the gateway of the route first
+  for (size_t i = 1; i < group->count; i++) {
+    if (strcmp(nexthops[i].gateway, route->gateway) == 0 && strcmp(nexthops[i].iface, route->iface) == 0) {
+      nexthops[i] = nexthops[0];
+      nexthops[0] = group->members[i];
+      break;
+    }
+  }
+  return group->count;
+}
+
+/**
+ * @function setNexthops
+ * @description set the equal cost next hops of a route; the first one must be the gateway of the route
+ * @param RIB*
+ * @param Route*
+ * @param const RIB_nexthop_t* nexthops
+ * @param size_t count
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t setNexthops(RIB* rtab, Route* route, const RIB_nexthop_t* nexthops, size_t count) {
+  RIB_nhgroup_t* group = NULL;
+  if (count > 1) {
+    RIB_ret_code_t rc = RIB_nhgroup_get(rtab->index->nexthops, nexthops, count, &group);
+    if (rc != RIB_NO_ERROR) {
+      return rc;
+    }
+  }
+  if (strcmp(route->gateway, nexthops[0].gateway) == 0 && strcmp(route->iface, nexthops[0].iface) == 0) {
+    RIB_member_t* members = NULL;
+    if (group != NULL && (members = (RIB_member_t*) malloc(sizeof(RIB_member_t) * group->count)) == NULL) {
+      RIB_nhgroup_release(group);
+      return RIB_BAD_ALLOC;
+    }
+    RIB_ret_code_t rc = RIB_index_set_nexthops(rtab->index, route, group, members);
+    if (rc != RIB_NO_ERROR) {
+      free(members);
+      RIB_nhgroup_release(group);
+    }
+    return rc;
+  }
+  //The gateway changes: replace the route attributes, so that the reverse index follows
+  Route* newAttributes;
+  RIB_ret_code_t rc = newRoute(route->destination, route->netmask, nexthops[0].gateway, nexthops[0].iface, route->metric, route->ipv, &newAttributes);
+  if (rc != RIB_NO_ERROR) {
+    RIB_nhgroup_release(group);
+    return rc;
+  }
+  RIB_entry_of(newAttributes)->nexthops = group;
+  rc = replaceRoute(rtab, route, newAttributes);
+  freeRoute(newAttributes);
+  return rc;
+}
+
+/**
+ * @function RIB_delete_by_iface
+ * @description delete all the routes going through an interface (e.g. when the interface goes down);
+ *              routes with equal cost next hops through other interfaces only lose the next hops through it
+ * @param RIB* rtab
+ * @param const char* iface
+ * @param size_t* removed: number of deleted routes (may be NULL)
+ * @returns RIB_ret_code_t: RIB_NOT_EXISTS if no route goes through the interface
+ */
+
+RIB_ret_code_t RIB_delete_by_iface(RIB* rtab, const char* iface, size_t* removed) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (removed != NULL) {
+    *removed = 0;
+  }
+  if (iface == NULL) {
+    return RIB_NOT_EXISTS;
+  }
+  Route** affected;
+  size_t count;
+  RIB_ret_code_t rc = RIB_index_group(rtab->index, RIB_BY_IFACE, iface, &affected, &count);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  Route** users;
+  size_t userCount;
+  if ((rc = RIB_index_members(rtab->index, RIB_BY_IFACE, iface, &users, &userCount)) != RIB_NO_ERROR) {
+    free(affected);
+    return rc;
+  }
+  if (count == 0 && userCount == 0) {
+    return RIB_NOT_EXISTS;
+  }
+  //Drop the next hops through the interface; the routes left without next hops are deleted
+  size_t deleted = 0;
+  for (size_t i = 0; rc == RIB_NO_ERROR && i < count + userCount; i++) {
+    Route* thisRoute = i < count ? affected[i] : users[i - count];
+    if (i >= count && strcmp(thisRoute->iface, iface) == 0) {
+      //Already in the interface group
+      continue;
+    }
+    RIB_nexthop_t nexthops[RIB_MAX_NEXTHOPS];
+    const size_t total = routeNexthops(thisRoute, nexthops);
+    size_t kept = 0;
+    for (size_t j = 0; j < total; j++) {
+      if (strcmp(nexthops[j].iface, iface) != 0) {
+        nexthops[kept++] = nexthops[j];
+      }
+    }
+    if (kept == 0) {
+      //Only routes of the interface group (i < count) may be left without next hops
+      affected[deleted++] = thisRoute;
+    } else {
+      rc = setNexthops(rtab, thisRoute, nexthops, kept);
+    }
+  }
+  free(users);
+  //Take the routes out of the array before removing them from the engines, which may repopulate from it
+  for (size_t i = 0; i < deleted; i++) {
+    takeSlot(rtab, affected[i]);
+  }
+  for (size_t i = 0; i < deleted; i++) {
+    RIB_engine_t* engine = getEngine(rtab, affected[i]->ipv);
+    engine->ops->remove(engine, affected[i]);
+    RIB_index_remove(rtab->index, affected[i]);
+    releaseRoute(rtab, affected[i]);
+  }
+  free(affected);
+  shrinkRoutes(rtab);
+  if (removed != NULL) {
+    *removed = deleted;
+  }
+  return rc;
+}
+
+/**
+ * @function RIB_update_gateway_all
+ * @description replace a gateway with another one in all the routes using it, equal cost next hops included
+ * @param RIB* rtab
+ * @param const char* gateway
+ * @param const char* newGateway
+ * @param size_t* updated: number of updated routes (may be NULL)
+ * @returns RIB_ret_code_t: RIB_NOT_EXISTS if no route uses the gateway
+ */
+
+RIB_ret_code_t RIB_update_gateway_all(RIB* rtab, const char* gateway, const char* newGateway, size_t* updated) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (updated != NULL) {
+    *updated = 0;
+  }
+  int ipVersion;
+  int newIpVersion;
+  if (isValidIpAddress(gateway, &ipVersion) != 0 || isValidIpAddress(newGateway, &newIpVersion) != 0 || ipVersion != newIpVersion) {
+    return RIB_INVALID_ADDRESS;
+  }
+  //Gateways are stored formatted
+  char* key = strdup(gateway);
+  char* newKey = strdup(newGateway);
+  if (key == NULL || newKey == NULL) {
+    free(key);
+    free(newKey);
+    return RIB_BAD_ALLOC;
+  }
+  if (ipVersion == 4) {
+    formatIPv4Address(&key);
+    formatIPv4Address(&newKey);
+  } else {
+    formatIPv6Address(&key);
+    formatIPv6Address(&newKey);
+  }
+  Route** affected = NULL;
+  Route** users = NULL;
+  char** gateways = NULL;
+  RIB_nhgroup_t** groups = NULL;
+  RIB_member_t** links = NULL;
+  size_t count = 0;
+  size_t userCount = 0;
+  RIB_ret_code_t rc = RIB_index_group(rtab->index, RIB_BY_GATEWAY, key, &affected, &count);
+  if (rc == RIB_NO_ERROR) {
+    rc = RIB_index_members(rtab->index, RIB_BY_GATEWAY, key, &users, &userCount);
+  }
+  if (rc == RIB_NO_ERROR && count == 0 && userCount == 0) {
+    rc = RIB_NOT_EXISTS;
+  }
+  //Allocate all the new attributes first, so that a failure leaves the RIB untouched
+  if (rc == RIB_NO_ERROR && count > 0 && (gateways = (char**) calloc(count, sizeof(char*))) == NULL) {
+    rc = RIB_BAD_ALLOC;
+  }
+  for (size_t i = 0; rc == RIB_NO_ERROR && i < count; i++) {
+    if ((gateways[i] = strdup(newKey)) == NULL) {
+      rc = RIB_BAD_ALLOC;
+    }
+  }
+  if (rc == RIB_NO_ERROR && userCount > 0) {
+    groups = (RIB_nhgroup_t**) calloc(userCount, sizeof(RIB_nhgroup_t*));
+    links = (RIB_member_t**) calloc(userCount, sizeof(RIB_member_t*));
+    rc = groups != NULL && links != NULL ? RIB_NO_ERROR : RIB_BAD_ALLOC;
+  }
+  //Routes with equal cost next hops through the gateway get a group with the new gateway (NULL if it was already a member)
+  for (size_t i = 0; rc == RIB_NO_ERROR && i < userCount; i++) {
+    RIB_nexthop_t nexthops[RIB_MAX_NEXTHOPS];
+    const size_t total = routeNexthops(users[i], nexthops);
+    size_t members = 0;
+    for (size_t j = 0; j < total; j++) {
+      RIB_nexthop_t nexthop = nexthops[j];
+      if (strcmp(nexthop.gateway, key) == 0) {
+        nexthop.gateway = newKey;
+      }
+      int duplicate = 0;
+      for (size_t k = 0; k < members; k++) {
+        duplicate |= strcmp(nexthops[k].gateway, nexthop.gateway) == 0 && strcmp(nexthops[k].iface, nexthop.iface) == 0;
+      }
+      if (!duplicate) {
+        nexthops[members++] = nexthop;
+      }
+    }
+    if (members > 1 && (rc = RIB_nhgroup_get(rtab->index->nexthops, nexthops, members, &groups[i])) == RIB_NO_ERROR) {
+      links[i] = (RIB_member_t*) malloc(sizeof(RIB_member_t) * members);
+      rc = links[i] != NULL ? RIB_NO_ERROR : RIB_BAD_ALLOC;
+    }
+  }
+  if (rc == RIB_NO_ERROR && count > 0) {
+    rc = RIB_index_rekey(rtab->index, RIB_BY_GATEWAY, key, newKey);
+  }
+  size_t changed = count;
+  for (size_t i = 0; i < userCount; i++) {
+    //Routes using the gateway only as another next hop aren't in the gateway group
+    changed += strcmp(users[i]->gateway, key) != 0;
+  }
+  //The new next hops go through the groups of the interfaces of the old ones and through the new gateway group, which
+  //is created by the rekey or else by the first route: only the first route may fail, before anything changed
+  for (size_t i = 0; rc == RIB_NO_ERROR && i < userCount; i++) {
+    if ((rc = RIB_index_set_nexthops(rtab->index, users[i], groups[i], links[i])) == RIB_NO_ERROR) {
+      groups[i] = NULL;
+      links[i] = NULL;
+    }
+  }
+  if (rc == RIB_NO_ERROR) {
+    //Lookup engines only depend on the prefixes, so the routes are changed in place
+    for (size_t i = 0; i < count; i++) {
+      free(affected[i]->gateway);
+      affected[i]->gateway = gateways[i];
+      gateways[i] = NULL;
+    }
+    if (updated != NULL) {
+      *updated = changed;
+    }
+  }
+  if (gateways != NULL) {
+    for (size_t i = 0; i < count; i++) {
+      free(gateways[i]);
+    }
+    free(gateways);
+  }
+  if (groups != NULL) {
+    for (size_t i = 0; i < userCount; i++) {
+      RIB_nhgroup_release(groups[i]);
+    }
+    free(groups);
+  }
+  if (links != NULL) {
+    for (size_t i = 0; i < userCount; i++) {
+      free(links[i]);
+    }
+    free(links);
+  }
+  free(affected);
+  free(users);
+  free(key);
+  free(newKey);
+  return rc;
+}
+
+/**
+ * @function applyBestCandidate
+ * @description make the best candidate of a route active; the lookup engine and the index are touched only if the next hop changes
+ * @param RIB*
+ * @param Route*
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t applyBestCandidate(RIB* rtab, Route* route) {
+  const RIB_candidate_t* best = RIB_candidates_best(RIB_entry_of(route)->candidates);
+  if (strcmp(best->gateway, route->gateway) == 0 && strcmp(best->iface, route->iface) == 0) {
+    route->metric = best->metric;
+    return RIB_NO_ERROR;
+  }
+  Route* newAttributes;
+  RIB_ret_code_t rc = newRoute(route->destination, route->netmask, best->gateway, best->iface, best->metric, route->ipv, &newAttributes);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  rc = replaceRoute(rtab, route, newAttributes);
+  freeRoute(newAttributes);
+  return rc;
+}
+
+/**
+ * @function RIB_add_candidate
+ * @description add the candidate route of a source for a prefix, or replace the one it has already; the best candidate by admin distance and metric becomes the active route
+ * @param RIB* rtab
+ * @param const char* destination
+ * @param const char* netmask
+ * @param const char* gateway
+ * @param const char* iface
+ * @param int distance: admin distance of the source, which identifies its candidate (routes added with RIB_add have RIB_DEFAULT_DISTANCE)
+ * @param int metric
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_add_candidate(RIB* rtab, const char* destination, const char* netmask, const char* gateway, const char* iface, int distance, int metric) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  int ipVersion;
+  if (isValidIpAddress(destination, &ipVersion) != 0 || isValidIpAddress(gateway, NULL) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  if (netmask == NULL || iface == NULL || (ipVersion == 4 && isValidIpAddress(netmask, NULL) != 0)) {
+    return RIB_INVALID_ADDRESS;
+  }
+  Route* thisRoute;
+  RIB_ret_code_t rc = newRoute(destination, netmask, gateway, iface, metric, ipVersion, &thisRoute);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  RIB_prefix_t prefix;
+  if (RIB_prefix_from_route(thisRoute, &prefix) != 0) {
+    freeRoute(thisRoute);
+    return RIB_INVALID_ADDRESS;
+  }
+  Route* existing = RIB_index_find(rtab->index, ipVersion, &prefix);
+  RIB_candidates_t* candidates = existing != NULL ? RIB_entry_of(existing)->candidates : NULL;
+  if (candidates == NULL) {
+    if ((rc = RIB_candidates_create(&candidates)) != RIB_NO_ERROR) {
+      freeRoute(thisRoute);
+      return rc;
+    }
+    //A route added with RIB_add becomes the candidate of the default source
+    if (existing != NULL && (rc = RIB_candidates_set(candidates, RIB_DEFAULT_DISTANCE, existing->metric, existing->gateway, existing->iface)) != RIB_NO_ERROR) {
+      RIB_candidates_free(candidates);
+      freeRoute(thisRoute);
+      return rc;
+    }
+  }
+  rc = RIB_candidates_set(candidates, distance, thisRoute->metric, thisRoute->gateway, thisRoute->iface);
+  if (existing == NULL) {
+    //First candidate: the route is stored as is
+    RIB_entry_of(thisRoute)->candidates = candidates;
+    if (rc != RIB_NO_ERROR) {
+      freeRoute(thisRoute);
+      return rc;
+    }
+    return storeRoute(rtab, thisRoute);
+  }
+  freeRoute(thisRoute);
+  RIB_entry_of(existing)->candidates = candidates;
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  RIB_entry_of(existing)->generation = rtab->index->generation;
+  return applyBestCandidate(rtab, existing);
+}
+
+/**
+ * @function RIB_withdraw_candidate
+ * @description remove the candidate route of a source for a prefix; the next best candidate becomes the active route, and the route is deleted with its last candidate
+ * @param RIB* rtab
+ * @param const char* destination
+ * @param const char* netmask
+ * @param int distance: admin distance of the source
+ * @returns RIB_ret_code_t: RIB_NOT_EXISTS if the source has no candidate for the prefix
+ */
+
+RIB_ret_code_t RIB_withdraw_candidate(RIB* rtab, const char* destination, const char* netmask, int distance) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  int ipVersion;
+  if (isValidIpAddress(destination, &ipVersion) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  Route* thisRoute = findRoute(rtab, destination, netmask, ipVersion);
+  if (thisRoute == NULL) {
+    return RIB_NOT_EXISTS;
+  }
+  RIB_candidates_t* candidates = RIB_entry_of(thisRoute)->candidates;
+  if (candidates == NULL) {
+    //Route added with RIB_add
+    if (distance != RIB_DEFAULT_DISTANCE) {
+      return RIB_NOT_EXISTS;
+    }
+    removeRoute(rtab, thisRoute);
+    return RIB_NO_ERROR;
+  }
+  if (RIB_candidates_withdraw(candidates, distance) != 0) {
+    return RIB_NOT_EXISTS;
+  }
+  if (candidates->count == 0) {
+    removeRoute(rtab, thisRoute);
+    return RIB_NO_ERROR;
+  }
+  return applyBestCandidate(rtab, thisRoute);
+}
+
+/**
+ * @function sourceKey
+ * @description get the destination and source prefixes of a source specific route
+ * @param const char* destination
+ * @param const char* netmask
+ * @param const char* source
+ * @param const char* sourceNetmask
+ * @param int* ipVersion
+ * @param RIB_prefix_t* dstPrefix
+ * @param RIB_prefix_t* srcPrefix
+ * @returns int: 0 if the prefixes are valid network addresses of the same ip version
+ */
+
+static int sourceKey(const char* destination, const char* netmask, const char* source, const char* sourceNetmask, int* ipVersion, RIB_prefix_t* dstPrefix, RIB_prefix_t* srcPrefix) {
+  int srcVersion;
+  if (isValidIpAddress(destination, ipVersion) != 0 || isValidIpAddress(source, &srcVersion) != 0 || srcVersion != *ipVersion) {
+    return 1;
+  }
+  if (*ipVersion != 4 && *ipVersion != 6) {
+    return 1;
+  }
+  if (RIB_index_key(destination, netmask, *ipVersion, dstPrefix) != 0) {
+    return 1;
+  }
+  return RIB_index_key(source, sourceNetmask, *ipVersion, srcPrefix);
+}
+
+/**
+ * @function RIB_add_source_route
+ * @description add a source specific route, matched only by the packets coming from the source prefix (see RIB_match_source)
+ * @param RIB* rtab
+ * @param const char* destination: network address
+ * @param const char* netmask: netmask for ipv4, prefix length for ipv6
+ * @param const char* source: network address
+ * @param const char* sourceNetmask: netmask for ipv4, prefix length for ipv6
+ * @param const char* gateway
+ * @param const char* iface
+ * @param int metric
+ * @returns RIB_ret_code_t: RIB_DUP_RECORD if the (destination, source) pair has already a route
+ */
+
+RIB_ret_code_t RIB_add_source_route(RIB* rtab, const char* destination, const char* netmask, const char* source, const char* sourceNetmask, const char* gateway, const char* iface, int metric) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  int ipVersion;
+  RIB_prefix_t dstPrefix;
+  RIB_prefix_t srcPrefix;
+  if (sourceKey(destination, netmask, source, sourceNetmask, &ipVersion, &dstPrefix, &srcPrefix) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  if (isValidIpAddress(gateway, NULL) != 0 || iface == NULL) {
+    return RIB_INVALID_ADDRESS;
+  }
+  RIB_ret_code_t rc;
+  if (rtab->index->sources == NULL && (rc = RIB_srcdst_create(&rtab->index->sources)) != RIB_NO_ERROR) {
+    return rc;
+  }
+  Route* thisRoute;
+  if ((rc = newRoute(destination, netmask, gateway, iface, metric, ipVersion, &thisRoute)) != RIB_NO_ERROR) {
+    return rc;
+  }
+  if ((rc = RIB_srcdst_insert(rtab->index->sources, ipVersion, &dstPrefix, &srcPrefix, thisRoute)) != RIB_NO_ERROR) {
+    freeRoute(thisRoute);
+  }
+  return rc;
+}
+
+/**
+ * @function RIB_delete_source_route
+ * @description delete a source specific route
+ * @param RIB* rtab
+ * @param const char* destination
+ * @param const char* netmask
+ * @param const char* source
+ * @param const char* sourceNetmask
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_delete_source_route(RIB* rtab, const char* destination, const char* netmask, const char* source, const char* sourceNetmask) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  int ipVersion;
+  RIB_prefix_t dstPrefix;
+  RIB_prefix_t srcPrefix;
+  if (sourceKey(destination, netmask, source, sourceNetmask, &ipVersion, &dstPrefix, &srcPrefix) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  Route* thisRoute = rtab->index->sources != NULL ? RIB_srcdst_remove(rtab->index->sources, ipVersion, &dstPrefix, &srcPrefix) : NULL;
+  if (thisRoute == NULL) {
+    return RIB_NOT_EXISTS;
+  }
+  freeRoute(thisRoute);
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_add_nexthop
+ * @description add an equal cost next hop to a route
+ * @param RIB* rtab
+ * @param const char* destination
+ * @param const char* netmask
+ * @param const char* gateway
+ * @param const char* iface
+ * @returns RIB_ret_code_t: RIB_DUP_RECORD if the route has already this next hop; RIB_BAD_ALLOC if the route has already RIB_MAX_NEXTHOPS next hops;
+ *          RIB_INVALID_ADDRESS if the gateway isn't of the ip version of the destination
+ */
+
+RIB_ret_code_t RIB_add_nexthop(RIB* rtab, const char* destination, const char* netmask, const char* gateway, const char* iface) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  int ipVersion;
+  int gatewayVersion;
+  if (isValidIpAddress(destination, &ipVersion) != 0 || isValidIpAddress(gateway, &gatewayVersion) != 0 || gatewayVersion != ipVersion || iface == NULL) {
+    return RIB_INVALID_ADDRESS;
+  }
+  Route* thisRoute = findRoute(rtab, destination, netmask, ipVersion);
+  if (thisRoute == NULL) {
+    return RIB_NOT_EXISTS;
+  }
+  //Next hops are stored formatted as the gateways
+  char* formatted = strdup(gateway);
+  if (formatted == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  if (ipVersion == 4) {
+    formatIPv4Address(&formatted);
+  } else {
+    formatIPv6Address(&formatted);
+  }
+  RIB_nexthop_t nexthops[RIB_MAX_NEXTHOPS];
+  size_t count = routeNexthops(thisRoute, nexthops);
+  RIB_ret_code_t rc = RIB_NO_ERROR;
+  for (size_t i = 0; i < count; i++) {
+    if (strcmp(nexthops[i].gateway, formatted) == 0 && strcmp(nexthops[i].iface, iface) == 0) {
+      rc = RIB_DUP_RECORD;
+    }
+  }
+  if (rc == RIB_NO_ERROR && count == RIB_MAX_NEXTHOPS) {
+    rc = RIB_BAD_ALLOC;
+  }
+  if (rc == RIB_NO_ERROR) {
+    nexthops[count].gateway = formatted;
+    nexthops[count].iface = iface;
+    rc = setNexthops(rtab, thisRoute, nexthops, count + 1);
+  }
+  free(formatted);
+  return rc;
+}
+
+/**
+ * @function RIB_delete_nexthop
+ * @description remove an equal cost next hop from a route; if it's the gateway of the route, another next hop takes its place. The route is deleted with its last next hop
+ * @param RIB* rtab
+ * @param const char* destination
+ * @param const char* netmask
+ * @param const char* gateway
+ * @returns RIB_ret_code_t: RIB_NOT_EXISTS if the route or the next hop don't exist
+ */
+
+RIB_ret_code_t RIB_delete_nexthop(RIB* rtab, const char* destination, const char* netmask, const char* gateway) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  int ipVersion;
+  int gatewayVersion;
+  if (isValidIpAddress(destination, &ipVersion) != 0 || isValidIpAddress(gateway, &gatewayVersion) != 0 || gatewayVersion != ipVersion) {
+    return RIB_INVALID_ADDRESS;
+  }
+  Route* thisRoute = findRoute(rtab, destination, netmask, ipVersion);
+  if (thisRoute == NULL) {
+    return RIB_NOT_EXISTS;
+  }
+  char* formatted = strdup(gateway);
+  if (formatted == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  if (ipVersion == 4) {
+    formatIPv4Address(&formatted);
+  } else {
+    formatIPv6Address(&formatted);
+  }
+  RIB_nexthop_t nexthops[RIB_MAX_NEXTHOPS];
+  const size_t count = routeNexthops(thisRoute, nexthops);
+  size_t kept = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (strcmp(nexthops[i].gateway, formatted) != 0) {
+      nexthops[kept++] = nexthops[i];
+    }
+  }
+  free(formatted);
+  if (kept == count) {
+    return RIB_NOT_EXISTS;
+  }
+  if (kept == 0) {
+    removeRoute(rtab, thisRoute);
+    return RIB_NO_ERROR;
+  }
+  //If the gateway of the route has been removed, the first next hop left takes its place
+  return setNexthops(rtab, thisRoute, nexthops, kept);
+}
+
+/**
+ * @function RIB_get_nexthops
+ * @description get the equal cost next hops of a route; the first one is the gateway of the route. Strings are valid until the route is modified
+ * @param RIB* rtab
+ * @param const Route* route stored in the RIB
+ * @param RIB_nexthop_t* nexthops: room for RIB_MAX_NEXTHOPS next hops
+ * @param size_t* count
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_get_nexthops(RIB* rtab, const Route* route, RIB_nexthop_t* nexthops, size_t* count) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (route == NULL) {
+    return RIB_NOT_EXISTS;
+  }
+  *count = routeNexthops(route, nexthops);
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function updateRoute
+ * @description update a routing table entry (see RIB_update)
+ * @param RIB* rtab
+ * @param const char*
+ * @param const char*
+ * @param const char*
+ * @param const char*
+ * @param const char*
+ * @param int
+ * @param int* ipv: ip version of the route, for the tracepoint
+ * @param RIB_prefix_t* traced: prefix which has been looked up, for the tracepoint
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t updateRoute(RIB* rtab, const char* destination, const char* netmask, const char* newNetmask, const char* newGateway, const char* newIface, int newMetric, int* ipv, RIB_prefix_t* traced) {
+  if (rtab->routes == NULL) {
+    return RIB_NOT_EXISTS;
+  }
+  //Check if passed arguments are valid
+  int ipVersion;
+  if (isValidIpAddress(newNetmask, NULL) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  if (isValidIpAddress(newGateway, &ipVersion) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  if (newIface == NULL) {
+    return RIB_INVALID_ADDRESS;
+  }
+  *ipv = ipVersion;
+  Route* thisRoute = findRouteKey(rtab, destination, netmask, ipVersion, traced);
+  if (thisRoute == NULL || thisRoute->ipv != ipVersion) {
+    return RIB_NOT_EXISTS;
+  }
+  //Build the updated route; the destination follows the new netmask
+  Route* updatedRoute;
+  RIB_ret_code_t rc = newRoute(thisRoute->destination, newNetmask, newGateway, newIface, newMetric, ipVersion, &updatedRoute);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  RIB_prefix_t prefix;
+  if (RIB_prefix_from_route(updatedRoute, &prefix) != 0) {
+    freeRoute(updatedRoute);
+    return RIB_INVALID_ADDRESS;
+  }
+  Route* existing = RIB_index_find(rtab->index, ipVersion, &prefix);
+  if (existing != NULL && existing != thisRoute) {
+    freeRoute(updatedRoute);
+    return RIB_DUP_RECORD;
+  }
+  rc = replaceRoute(rtab, thisRoute, updatedRoute);
+  freeRoute(updatedRoute);
+  if (rc == RIB_NO_ERROR) {
+    dropCandidates(thisRoute);
+  }
+  return rc;
+}
+
+/**
+ * @function RIB_update
+ * @description update a routing table entry
+ * @param RIB* rtab
+ * @param const char*
+ * @param const char*
+ * @param const char*
+ * @param const char*
+ * @param const char*
+ * @param int
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_update(RIB* rtab, const char* destination, const char* netmask, const char* newNetmask, const char* newGateway, const char* newIface, int newMetric) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  int ipv = 0;
+  RIB_prefix_t prefix = {0, 0, 0};
+  RIB_TRACE_BEGIN(start);
+  RIB_ret_code_t rc = updateRoute(rtab, destination, netmask, newNetmask, newGateway, newIface, newMetric, &ipv, &prefix);
+  RIB_TRACE_END(RIB_TRACE_UPDATE, start, ipv, &prefix);
+  return rc;
+}
+
+/**
+ * @function RIB_clear
+ * @description clear Routing table entries
+ * @param RIB*
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_clear(RIB* rtab) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (rtab->index->damp != NULL) {
+    RIB_damp_clear(rtab->index->damp, discardRoute, NULL);
+  }
+  if (rtab->index->sources != NULL) {
+    RIB_srcdst_clear(rtab->index->sources, discardRoute, NULL);
+  }
+  //Delete each entry of the routing table
+  for(size_t i = 0; i < rtab->entries; i++) {
+    freeRoute(rtab->routes[i]);
+  }
+  free(rtab->routes);
+  rtab->routes = NULL;
+  rtab->entries = 0;
+  //A reload or a bulk load in progress is abandoned, so the configured engines are restored
+  RIB_index_clear(rtab->index);
+  return resetEngines(rtab);
+}
+
+/**
+ * @function RIB_reload_begin
+ * @description start a reload: all the routes are marked as stale; routes added before RIB_reload_end are kept (or refreshed if they already exist)
+ * @param RIB*
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_reload_begin(RIB* rtab) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  //Routes with an older generation are stale
+  rtab->index->generation++;
+  rtab->index->reloading = 1;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_reload_end
+ * @description end a reload, deleting the routes which haven't been added again since RIB_reload_begin
+ * @param RIB*
+ * @param size_t* removed: number of deleted routes (may be NULL)
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_reload_end(RIB* rtab, size_t* removed) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (removed != NULL) {
+    *removed = 0;
+  }
+  if (!rtab->index->reloading) {
+    return RIB_NO_ERROR;
+  }
+  rtab->index->reloading = 0;
+  size_t stale = 0;
+  for (size_t i = 0; i < rtab->entries; i++) {
+    stale += RIB_entry_of(rtab->routes[i])->generation != rtab->index->generation;
+  }
+  if (stale == 0) {
+    return RIB_NO_ERROR;
+  }
+  Route** staleRoutes = (Route**) malloc(sizeof(Route*) * stale);
+  if (staleRoutes == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  //Compact the routes array in a single pass, then remove stale routes from the engines and the index
+  size_t kept = 0;
+  stale = 0;
+  for (size_t i = 0; i < rtab->entries; i++) {
+    Route* thisRoute = rtab->routes[i];
+    if (RIB_entry_of(thisRoute)->generation != rtab->index->generation) {
+      staleRoutes[stale++] = thisRoute;
+    } else {
+      if (rtab->index->hits != NULL) {
+        RIB_hits_move(rtab->index->hits, i, kept);
+      }
+      RIB_entry_of(thisRoute)->slot = kept;
+      rtab->routes[kept++] = thisRoute;
+    }
+  }
+  if (rtab->index->hits != NULL) {
+    RIB_hits_clear(rtab->index->hits, kept, rtab->entries - kept);
+  }
+  rtab->entries = kept;
+  for (size_t i = 0; i < stale; i++) {
+    RIB_engine_t* engine = getEngine(rtab, staleRoutes[i]->ipv);
+    engine->ops->remove(engine, staleRoutes[i]);
+    RIB_index_remove(rtab->index, staleRoutes[i]);
+    releaseRoute(rtab, staleRoutes[i]);
+  }
+  free(staleRoutes);
+  shrinkRoutes(rtab);
+  if (removed != NULL) {
+    *removed = stale;
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * Routes collected by the expiry wheel callback
+ */
+
+typedef struct RIB_expired_t {
+  Route** routes;
+  size_t count;
+  size_t size;
+  RIB_wheel_t* wheel;
+  RIB_ret_code_t rc;
+} RIB_expired_t;
+
+/**
+ * @function collectExpired
+ * @description expiry wheel callback: collect the route of an expired timer
+ * @param RIB_timer_t* timer
+ * @param void* context: RIB_expired_t*
+ */
+
+static void collectExpired(RIB_timer_t* timer, void* context) {
+  RIB_expired_t* expired = (RIB_expired_t*) context;
+  if (expired->count == expired->size) {
+    size_t size = expired->size > 0 ? expired->size * 2 : 16;
+    Route** routes = (Route**) realloc(expired->routes, sizeof(Route*) * size);
+    if (routes == NULL) {
+      //Retry at the next expiry
+      RIB_wheel_schedule(expired->wheel, timer, timer->deadline);
+      expired->rc = RIB_BAD_ALLOC;
+      return;
+    }
+    expired->routes = routes;
+    expired->size = size;
+  }
+  expired->routes[expired->count++] = &RIB_entry_of_expiry(timer)->route;
+}
+
+/**
+ * @function RIB_expire
+ * @description delete the routes whose TTL elapsed; to be called periodically (the cost depends only on the number of expired routes)
+ * @param RIB*
+ * @param uint64_t now: current time (see RIB_clock); it must not go backwards between calls
+ * @param size_t* removed: number of deleted routes (may be NULL)
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_expire(RIB* rtab, uint64_t now, size_t* removed) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (removed != NULL) {
+    *removed = 0;
+  }
+  if (rtab->index->expiries == NULL) {
+    return RIB_NO_ERROR;
+  }
+  RIB_expired_t expired = {NULL, 0, 0, rtab->index->expiries, RIB_NO_ERROR};
+  RIB_wheel_advance(rtab->index->expiries, now, collectExpired, &expired);
+  //Take the routes out of the array before removing them from the engines, which may repopulate from it
+  for (size_t i = 0; i < expired.count; i++) {
+    takeSlot(rtab, expired.routes[i]);
+  }
+  for (size_t i = 0; i < expired.count; i++) {
+    RIB_engine_t* engine = getEngine(rtab, expired.routes[i]->ipv);
+    engine->ops->remove(engine, expired.routes[i]);
+    RIB_index_remove(rtab->index, expired.routes[i]);
+    freeRoute(expired.routes[i]);
+  }
+  free(expired.routes);
+  shrinkRoutes(rtab);
+  if (removed != NULL) {
+    *removed = expired.count;
+  }
+  return expired.rc;
+}
+
+/**
+ * @function RIB_bulk_begin
+ * @description start a bulk load: until RIB_bulk_end the routes are only appended to linear engines, so adding a route costs O(1).
+ *              Lookups stay correct during the bulk load, but they're slow
+ * @param RIB*
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_bulk_begin(RIB* rtab) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (rtab->index->bulk) {
+    return RIB_NO_ERROR;
+  }
+  RIB_ret_code_t rc;
+  RIB_engine_t* ipv4Engine;
+  RIB_engine_t* ipv6Engine;
+  if ((rc = RIB_engine_create(rtab, 4, RIB_ENGINE_LINEAR, &ipv4Engine)) != RIB_NO_ERROR) {
+    return rc;
+  }
+  if ((rc = RIB_engine_create(rtab, 6, RIB_ENGINE_LINEAR, &ipv6Engine)) != RIB_NO_ERROR) {
+    RIB_engine_destroy(ipv4Engine);
+    return rc;
+  }
+  RIB_engine_destroy(rtab->engines[0]);
+  RIB_engine_destroy(rtab->engines[1]);
+  rtab->engines[0] = ipv4Engine;
+  rtab->engines[1] = ipv6Engine;
+  rtab->index->bulk = 1;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_bulk_end
+ * @description end a bulk load, building the configured engines once from all the routes
+ * @param RIB*
+ * @returns RIB_ret_code_t: if the engines can't be built, the linear engines are kept
+ */
+
+RIB_ret_code_t RIB_bulk_end(RIB* rtab) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (!rtab->index->bulk) {
+    return RIB_NO_ERROR;
+  }
+  rtab->index->bulk = 0;
+  return resetEngines(rtab);
+}
+
+/**
+ * @function RIB_save
+ * @description write the routing table to a file in the compact binary format (see codec.h); only the primary next hop of each route is saved
+ * @param RIB*
+ * @param const char* filename
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_save(RIB* rtab, const char* filename) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  FILE* stream = fopen(filename, "wb");
+  if (stream == NULL) {
+    return RIB_IO_ERROR;
+  }
+  RIB_encoder_t* encoder;
+  RIB_ret_code_t rc = RIB_encoder_open(stream, &encoder);
+  if (rc != RIB_NO_ERROR) {
+    fclose(stream);
+    return rc;
+  }
+  //The walk returns the routes in prefix order, which keeps the deltas small
+  for (int ipv = 4; ipv <= 6 && rc == RIB_NO_ERROR; ipv += 2) {
+    RIB_iter_t* iter;
+    if ((rc = RIB_iter_walk(rtab, ipv, NULL, &iter)) != RIB_NO_ERROR) {
+      break;
+    }
+    Route* route;
+    while (rc == RIB_NO_ERROR && (route = RIB_iter_next(iter)) != NULL) {
+      rc = RIB_encoder_add(encoder, route);
+    }
+    RIB_iter_free(iter);
+  }
+  RIB_ret_code_t closeRc = RIB_encoder_close(encoder);
+  if (fclose(stream) != 0 && closeRc == RIB_NO_ERROR) {
+    closeRc = RIB_IO_ERROR;
+  }
+  return rc != RIB_NO_ERROR ? rc : closeRc;
+}
+
+/**
+ * @function RIB_load
+ * @description add the routes of a file written by RIB_save; the routes are added in a bulk load
+ * @param RIB*
+ * @param const char* filename
+ * @param size_t* loaded: number of added routes (may be NULL)
+ * @returns RIB_ret_code_t: RIB_IO_ERROR if the file is not readable or corrupted (the routes decoded before the error are kept)
+ */
+
+RIB_ret_code_t RIB_load(RIB* rtab, const char* filename, size_t* loaded) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (loaded != NULL) {
+    *loaded = 0;
+  }
+  FILE* stream = fopen(filename, "rb");
+  if (stream == NULL) {
+    return RIB_IO_ERROR;
+  }
+  RIB_decoder_t* decoder;
+  RIB_ret_code_t rc = RIB_decoder_open(stream, &decoder);
+  if (rc != RIB_NO_ERROR) {
+    fclose(stream);
+    return rc;
+  }
+  const int bulk = rtab->index->bulk;
+  if ((rc = RIB_bulk_begin(rtab)) == RIB_NO_ERROR) {
+    RIB_decoded_route_t route;
+    int end = 0;
+    while ((rc = RIB_decoder_next(decoder, &route, &end)) == RIB_NO_ERROR && !end) {
+      if ((rc = addRoute(rtab, route.destination, route.netmask, route.gateway, route.iface, route.metric, 0, NULL, NULL)) != RIB_NO_ERROR) {
+        break;
+      }
+      if (loaded != NULL) {
+        (*loaded)++;
+      }
+    }
+    //A bulk load started by the caller is ended by the caller
+    if (!bulk) {
+      RIB_ret_code_t endRc = RIB_bulk_end(rtab);
+      rc = rc != RIB_NO_ERROR ? rc : endRc;
+    }
+  }
+  RIB_decoder_free(decoder);
+  fclose(stream);
+  return rc;
+}
+
+/**
+ * @function RIB_mrt_options_init
+ * @description initialize MRT import options with default values
+ * @param RIB_mrt_options_t* options
+ */
+
+void RIB_mrt_options_init(RIB_mrt_options_t* options) {
+  options->peer = RIB_MRT_BEST_PEER;
+  options->iface = NULL;
+}
+
+/**
+ * @function addMrtRoute
+ * @description add the route of an MRT RIB entry
+ * @param RIB*
+ * @param const RIB_mrt_entry_t* entry
+ * @param const char* iface: NULL to name the interface after the peer index
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t addMrtRoute(RIB* rtab, const RIB_mrt_entry_t* entry, const char* iface) {
+  char destination[INET6_ADDRSTRLEN];
+  char netmask[INET6_ADDRSTRLEN];
+  char gateway[INET6_ADDRSTRLEN];
+  char peerIface[16];
+  inet_ntop(entry->ipv == 6 ? AF_INET6 : AF_INET, entry->prefix, destination, sizeof(destination));
+  inet_ntop(entry->nexthopIpv == 6 ? AF_INET6 : AF_INET, entry->nexthop, gateway, sizeof(gateway));
+  if (entry->ipv == 4) {
+    const uint32_t mask = htonl(entry->length == 0 ? 0 : ~((uint32_t) 0) << (32 - entry->length));
+    inet_ntop(AF_INET, &mask, netmask, sizeof(netmask));
+  } else {
+    snprintf(netmask, sizeof(netmask), "%d", entry->length);
+  }
+  if (iface == NULL) {
+    snprintf(peerIface, sizeof(peerIface), "peer%u", entry->peer);
+    iface = peerIface;
+  }
+  return addRoute(rtab, destination, netmask, gateway, iface, entry->pathLength, 0, NULL, NULL);
+}
+
+/**
+ * @function RIB_load_mrt
+ * @description add the unicast routes of an MRT TABLE_DUMP_V2 file (RFC 6396), plain or compressed with gzip or bzip2; the routes are added in a bulk load.
+ *              For each prefix a single path is added, whose metric is its AS path length.
+ *              Prefixes rejected by the table (e.g. ipv6 prefixes which collide once rounded to a multiple of 8 bits) are skipped
+ * @param RIB*
+ * @param const char* filename
+ * @param const RIB_mrt_options_t* options: NULL for the default options
+ * @param size_t* loaded: number of added routes (may be NULL)
+ * @returns RIB_ret_code_t: RIB_IO_ERROR if the file is not readable or malformed; RIB_NOT_SUPPORTED if the decompressor is not built in
+ */
+
+RIB_ret_code_t RIB_load_mrt(RIB* rtab, const char* filename, const RIB_mrt_options_t* options, size_t* loaded) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (loaded != NULL) {
+    *loaded = 0;
+  }
+  RIB_mrt_options_t defaults;
+  if (options == NULL) {
+    RIB_mrt_options_init(&defaults);
+    options = &defaults;
+  }
+  RIB_mrt_reader_t* reader;
+  RIB_ret_code_t rc = RIB_mrt_open(filename, &reader);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  const int bulk = rtab->index->bulk;
+  if ((rc = RIB_bulk_begin(rtab)) == RIB_NO_ERROR) {
+    RIB_mrt_entry_t entry;
+    RIB_mrt_entry_t selected;
+    int hasSelected = 0;
+    int end = 0;
+    while ((rc = RIB_mrt_next(reader, &entry, &end)) == RIB_NO_ERROR && !end) {
+      //Pick the path of the requested peer, or the shortest AS path
+      if (entry.nexthopIpv != 0 && (options->peer == RIB_MRT_BEST_PEER ? !hasSelected || entry.pathLength < selected.pathLength : entry.peer == options->peer)) {
+        selected = entry;
+        hasSelected = 1;
+      }
+      if (!entry.last || !hasSelected) {
+        continue;
+      }
+      hasSelected = 0;
+      rc = addMrtRoute(rtab, &selected, options->iface);
+      if (rc == RIB_NO_ERROR && loaded != NULL) {
+        (*loaded)++;
+      } else if (rc != RIB_NO_ERROR && rc != RIB_INVALID_ADDRESS) {
+        break;
+      }
+      rc = RIB_NO_ERROR;
+    }
+    if (!bulk) {
+      RIB_ret_code_t endRc = RIB_bulk_end(rtab);
+      rc = rc != RIB_NO_ERROR ? rc : endRc;
+    }
+  }
+  RIB_mrt_close(reader);
+  return rc;
+}
+
+/**
+ * @function RIB_dampening_init
+ * @description initialize route flap dampening parameters with the default values (RFC 2439)
+ * @param RIB_dampening_t* params
+ */
+
+void RIB_dampening_init(RIB_dampening_t* params) {
+  params->penalty = RIB_DAMPENING_PENALTY;
+  params->suppress = RIB_DAMPENING_SUPPRESS;
+  params->reuse = RIB_DAMPENING_REUSE;
+  params->halfLife = RIB_DAMPENING_HALF_LIFE;
+  params->maxSuppress = RIB_DAMPENING_MAX_SUPPRESS;
+}
+
+/**
+ * Context of the callback adding back held routes
+ */
+
+typedef struct RIB_reinstate_t {
+  RIB* rtab;
+  RIB_ret_code_t rc; //Set if a route can't be added
+} RIB_reinstate_t;
+
+/**
+ * @function reinstateRoute
+ * @description dampening release callback: add a held route to the RIB
+ * @param Route* held
+ * @param void* context: RIB_reinstate_t*
+ */
+
+static void reinstateRoute(Route* held, void* context) {
+  RIB* rtab = ((RIB_reinstate_t*) context)->rtab;
+  RIB_prefix_t prefix;
+  //A route added in the meantime (e.g. a candidate) wins over the held advertisement
+  if (RIB_prefix_from_route(held, &prefix) != 0 || RIB_index_find(rtab->index, held->ipv, &prefix) != NULL) {
+    freeRoute(held);
+    return;
+  }
+  RIB_ret_code_t rc = storeRoute(rtab, held);
+  if (rc != RIB_NO_ERROR) {
+    ((RIB_reinstate_t*) context)->rc = rc;
+  }
+}
+
+/**
+ * @function RIB_set_dampening
+ * @description enable route flap dampening, or change its parameters; withdrawals made with RIB_delete penalize their prefix,
+ *              and routes added for a suppressed prefix are held out of the RIB until RIB_reuse adds them back
+ * @param RIB*
+ * @param const RIB_dampening_t* params: NULL to disable dampening (held routes are added back)
+ * @returns RIB_ret_code_t: RIB_INVALID_ARGUMENT if the parameters are inconsistent
+ */
+
+RIB_ret_code_t RIB_set_dampening(RIB* rtab, const RIB_dampening_t* params) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  RIB_index_t* index = rtab->index;
+  if (params == NULL) {
+    RIB_reinstate_t context = {rtab, RIB_NO_ERROR};
+    RIB_damp_free(index->damp, reinstateRoute, &context);
+    index->damp = NULL;
+    return context.rc;
+  }
+  if (params->penalty <= 0 || params->reuse <= 0 || params->suppress <= params->reuse || params->halfLife == 0) {
+    return RIB_INVALID_ARGUMENT;
+  }
+  if (index->damp != NULL) {
+    RIB_damp_configure(index->damp, params, RIB_clock());
+    return RIB_NO_ERROR;
+  }
+  return RIB_damp_create(params, RIB_clock(), &index->damp);
+}
+
+/**
+ * @function RIB_reuse
+ * @description add back the routes of the suppressed prefixes whose penalty decayed below the reuse threshold;
+ *              to be called periodically (the cost depends only on the number of expired timers)
+ * @param RIB*
+ * @param uint64_t now: current time (see RIB_clock); it must not go backwards between calls
+ * @param size_t* reused: number of reused prefixes (may be NULL)
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_reuse(RIB* rtab, uint64_t now, size_t* reused) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  size_t count = 0;
+  RIB_reinstate_t context = {rtab, RIB_NO_ERROR};
+  if (rtab->index->damp != NULL) {
+    count = RIB_damp_advance(rtab->index->damp, now, reinstateRoute, &context);
+  }
+  if (reused != NULL) {
+    *reused = count;
+  }
+  return context.rc;
 }
 
 /**
- * @function RIB_add
- * @description add new entry to the routing table
- * @param RIB* routing table
- * @param const char* destination
- * @param const char* netmask/prefix char representation
- * @param const char* gateway
- * @param const char* iface
- * @param int metric
- * @returns RIB_ret_code_t: 0 if add operation succeeded
+ * @function RIB_get_dampening
+ * @description get the dampening state of a prefix
+ * @param RIB*
+ * @param const char* networkAddr
+ * @param const char* netmask: netmask for ipv4, prefix length for ipv6
+ * @param int* penalty: current penalty (may be NULL)
+ * @param int* suppressed: whether the prefix is suppressed (may be NULL)
+ * @returns RIB_ret_code_t: RIB_NOT_EXISTS if dampening is disabled or the prefix has no penalty
  */
 
-RIB_ret_code_t RIB_add(RIB* rtab, const char* destination, const char* netmask, const char* gateway, const char* iface, int metric) {
+RIB_ret_code_t RIB_get_dampening(RIB* rtab, const char* networkAddr, const char* netmask, int* penalty, int* suppressed) {
   if (rtab == NULL) {
     return RIB_UNINITIALIZED_RIB;
   }
-  //Check whether provided addresses are valid and get ip version
   int ipVersion;
-  if (isValidIpAddress(destination, &ipVersion) != 0) {
-    return RIB_INVALID_ADDRESS;
-  }
-  if (ipVersion == 4) {
-    if (isValidIpAddress(netmask, NULL) != 0) {
-      return RIB_INVALID_ADDRESS;
-    }
-  }
-  if (isValidIpAddress(gateway, NULL) != 0) {
-    return RIB_INVALID_ADDRESS;
-  }
-  if (ipVersion != 4 && ipVersion != 6) {
+  RIB_prefix_t prefix;
+  if (isValidIpAddress(networkAddr, &ipVersion) != 0 || netmask == NULL || RIB_index_key(networkAddr, netmask, ipVersion, &prefix) != 0) {
     return RIB_INVALID_ADDRESS;
   }
-  //check if an entry for provided destination already exists
-  for (size_t i = 0; i < rtab->entries; i++) {
-    Route* thisRoute = rtab->routes[i];
-    if (ipVersion == 4 && thisRoute->ipv == 4) {
-      if (compareIPv4Addresses(thisRoute->destination, destination) == 0 && compareIPv4Addresses(thisRoute->netmask, netmask) == 0) {
-        return RIB_INVALID_ADDRESS;
-      }
-    } else if (ipVersion == 6 && thisRoute->ipv == 6) {
-      int thisPrefix = atoi(netmask);
-      thisPrefix = (thisPrefix - (thisPrefix % 8));
-      if (compareIPv6Addresses(thisRoute->destination, destination) == 0 && thisRoute->prefixLength == thisPrefix) {
-        return RIB_INVALID_ADDRESS;
-      }
-    }
-  }
-  //Allocate new route struct
-  Route* newRoute = (Route*) malloc(sizeof(Route));
-  //Allocate space for the new record
-  newRoute->netmask = (char*) malloc(sizeof(char) * (strlen(netmask) + 1));
-  if (newRoute->netmask == NULL) {
-    free(newRoute);
-    return RIB_BAD_ALLOC;
-  }
-  newRoute->gateway = (char*) malloc(sizeof(char) * (strlen(gateway) + 1));
-  if (newRoute->netmask == NULL) {
-    free(newRoute->netmask);
-    free(newRoute);
-    return RIB_BAD_ALLOC;
+  RIB_damp_t* damp = rtab->index->damp;
+  RIB_damp_record_t* record = damp != NULL ? RIB_damp_find(damp, ipVersion, &prefix) : NULL;
+  if (record == NULL) {
+    return RIB_NOT_EXISTS;
   }
-  newRoute->iface = (char*) malloc(sizeof(char) * (strlen(iface) + 1));
-  if (newRoute->iface == NULL) {
-    free(newRoute->netmask);
-    free(newRoute->gateway);
-    free(newRoute);
-    return RIB_BAD_ALLOC;
+  int isSuppressed = RIB_damp_update(damp, record, RIB_clock());
+  if (penalty != NULL) {
+    *penalty = (int) (record->penalty + 0.5);
   }
-  //Convert destination to a real destination (it may be not if user provided us an ip address)
-  if (ipVersion == 4) {
-    newRoute->destination = getIpv4NetworkAddress(destination, netmask);
-    if (newRoute->destination == NULL) {
-      free(newRoute->netmask);
-      free(newRoute->gateway);
-      free(newRoute);
-    }
-  } else if (ipVersion == 6) {
-    newRoute->prefixLength = atoi(netmask);
-    newRoute->prefixLength = (newRoute->prefixLength - (newRoute->prefixLength % 8)); //Must be multiply of 8
-    newRoute->destination = getIpv6NetworkAddress(destination, newRoute->prefixLength);
-    if (newRoute->destination == NULL) {
-      free(newRoute->netmask);
-      free(newRoute->gateway);
-      free(newRoute);
-    }
-  }
-  //Copy to new route struct the attributes passed as arguments
-  strcpy(newRoute->netmask, netmask);
-  strcpy(newRoute->gateway, gateway);
-  strcpy(newRoute->iface, iface);
-  newRoute->metric = metric;
-  newRoute->ipv = ipVersion;
-  //Format addresses
-  if (newRoute->ipv == 4) {
-    formatIPv4Address(&newRoute->destination);
-    formatIPv4Address(&newRoute->netmask);
-    formatIPv4Address(&newRoute->gateway);
-  } else if (newRoute->ipv == 6) {
-    formatIPv6Address(&newRoute->destination);
-    formatIPv6Address(&newRoute->gateway);
-  }
-  //Increment entries
-  rtab->entries++;
-  //Allocate new route and store it into routing table
-  rtab->routes = (Route**) realloc(rtab->routes, sizeof(Route*) * rtab->entries);
-  if (rtab->routes == NULL) {
-    free(newRoute);
-    return RIB_BAD_ALLOC;
+  if (suppressed != NULL) {
+    *suppressed = isSuppressed;
   }
-  rtab->routes[rtab->entries - 1] = newRoute;
   return RIB_NO_ERROR;
 }
 
 /**
- * @function RIB_delete
- * @description delete an entry from the routing table
+ * @function RIB_set_bloom_filter
+ * @description enable or disable the bloom filter used by the compiled lookup tables to skip empty prefix lengths
  * @param RIB*
- * @param const char* destination to remove
- * @returns RIB_ret_code_t: 0 if succeeded
+ * @param int enabled
+ * @returns RIB_ret_code_t
  */
 
-RIB_ret_code_t RIB_delete(RIB* rtab, const char* destination, const char* netmask) {
+RIB_ret_code_t RIB_set_bloom_filter(RIB* rtab, int enabled) {
   if (rtab == NULL) {
     return RIB_UNINITIALIZED_RIB;
   }
-  if (rtab->routes == NULL) {
-    return RIB_NOT_EXISTS;
-  }
-  int ipVersion;
-  if (isValidIpAddress(destination, &ipVersion) != 0) {
-    return RIB_INVALID_ADDRESS;
-  }
-  //Iterate over routing table to find the destination to remove
-  for (size_t i = 0; i < rtab->entries; i++) {
-    Route* thisRoute = rtab->routes[i];
-    if (thisRoute->ipv == 4 && ipVersion == 4) {
-      if (compareIPv4Addresses(thisRoute->destination, destination) == 0 && (compareIPv4Addresses(thisRoute->netmask, netmask) == 0 || strcmp(netmask, "*") == 0)) {
-        //We found it!
-        size_t currIndex = i;
-        //Delete element
-        if (thisRoute != NULL) {
-          if (thisRoute->destination != NULL) {
-            free(thisRoute->destination);
-          }
-          if (thisRoute->netmask != NULL) {
-            free(thisRoute->netmask);
-          }
-          if (thisRoute->gateway != NULL) {
-            free(thisRoute->gateway);
-          }
-          if (thisRoute->iface != NULL) {
-            free(thisRoute->iface);
-          }
-          free(thisRoute);
-        }
-        //Decrement entries
-        rtab->entries--;
-        //Now we need to shift all elements after the current one by one position back
-        for (size_t j = currIndex; j < rtab->entries; j++) {
-          rtab->routes[j] = rtab->routes[j + 1];
-        }
-        //Reallocate routes
-        rtab->routes = (Route**) realloc(rtab->routes, sizeof(Route*) * rtab->entries);
-        if (rtab->routes == NULL && rtab->entries > 0) {
-          return RIB_BAD_ALLOC;
-        }
-        return RIB_NO_ERROR;
-      }
-    } else if (thisRoute->ipv == 6 && ipVersion == 6) {
-      int thisPrefix = atoi(netmask);
-      thisPrefix = (thisPrefix - (thisPrefix % 8));
-      if (compareIPv6Addresses(thisRoute->destination, destination) == 0 && thisRoute->prefixLength == thisPrefix) {
-        //We found it!
-        size_t currIndex = i;
-        //Delete element
-        if (thisRoute != NULL) {
-          if (thisRoute->destination != NULL) {
-            free(thisRoute->destination);
-          }
-          if (thisRoute->netmask != NULL) {
-            free(thisRoute->netmask);
-          }
-          if (thisRoute->gateway != NULL) {
-            free(thisRoute->gateway);
-          }
-          if (thisRoute->iface != NULL) {
-            free(thisRoute->iface);
-          }
-          free(thisRoute);
-        }
-        //Decrement entries
-        rtab->entries--;
-        //Now we need to shift all elements after the current one by one position back
-        for (size_t j = currIndex; j < rtab->entries; j++) {
-          rtab->routes[j] = rtab->routes[j + 1];
-        }
-        //Reallocate routes
-        rtab->routes = (Route**) realloc(rtab->routes, sizeof(Route*) * rtab->entries);
-        if (rtab->routes == NULL && rtab->entries > 0) {
-          return RIB_BAD_ALLOC;
-        }
-        return RIB_NO_ERROR;
-      }
-    }
+  if ((enabled != 0) != (rtab->options.bloomFilter != 0)) {
+    rtab->options.bloomFilter = enabled != 0;
+    return resetEngines(rtab);
   }
-  //Destination not found :(
-  return RIB_NOT_EXISTS;
+  return RIB_NO_ERROR;
 }
 
 /**
- * @function RIB_update
- * @description update a routing table entry
- * @param RIB* rtab
- * @param const char*
- * @param const char*
- * @param const char*
- * @param const char*
- * @param const char*
- * @param int
+ * @function RIB_set_hit_counters
+ * @description enable or disable the lookup hit counters of the routes; the counters are reset.
+ *              Lookup threads count hits in their own shard, so shards should be at least the number of lookup threads
+ * @param RIB*
+ * @param size_t shards: 0 to disable the counters
  * @returns RIB_ret_code_t
  */
 
-RIB_ret_code_t RIB_update(RIB* rtab, const char* destination, const char* netmask, const char* newNetmask, const char* newGateway, const char* newIface, int newMetric) {
+RIB_ret_code_t RIB_set_hit_counters(RIB* rtab, size_t shards) {
   if (rtab == NULL) {
     return RIB_UNINITIALIZED_RIB;
   }
-  if (rtab->routes == NULL) {
-    return RIB_NOT_EXISTS;
-  }
-  //Check if passed arguments are valid
-  int ipVersion;
-  if (isValidIpAddress(newNetmask, NULL) != 0) {
-    return RIB_INVALID_ADDRESS;
-  }
-  if (isValidIpAddress(newGateway, &ipVersion) != 0) {
-    return RIB_INVALID_ADDRESS;
-  }
-  //Iterate over routing table to find the destination to update
-  for (size_t i = 0; i < rtab->entries; i++) {
-    Route* thisRoute = rtab->routes[i];
-    if (thisRoute->ipv == 4 && ipVersion == 4) {
-      if (compareIPv4Addresses(thisRoute->destination, destination) == 0 && compareIPv4Addresses(thisRoute->netmask, netmask) == 0) {
-        //We found it
-        //Allocate space for the new record
-        thisRoute->netmask = (char*) realloc(thisRoute->netmask, sizeof(char) * (strlen(newNetmask) + 1));
-        if (thisRoute->netmask == NULL) {
-          free(thisRoute->destination);
-          free(thisRoute->gateway);
-          free(thisRoute->iface);
-          free(thisRoute);
-          return RIB_BAD_ALLOC;
-        }
-        thisRoute->gateway = (char*) realloc(thisRoute->gateway, sizeof(char) * (strlen(newGateway) + 1));
-        if (thisRoute->netmask == NULL) {
-          free(thisRoute->destination);
-          free(thisRoute->netmask);
-          free(thisRoute->iface);
-          free(thisRoute);
-          return RIB_BAD_ALLOC;
-        }
-        thisRoute->iface = (char*) realloc(thisRoute->iface, sizeof(char) * (strlen(newIface) + 1));
-        if (thisRoute->iface == NULL) {
-          free(thisRoute->destination);
-          free(thisRoute->netmask);
-          free(thisRoute->gateway);
-          free(thisRoute);
-          return RIB_BAD_ALLOC;
-        }
-        thisRoute->metric = newMetric;
-        thisRoute->ipv = ipVersion;
-        //Copy to new route struct the attributes passed as arguments
-        strcpy(thisRoute->netmask, newNetmask);
-        strcpy(thisRoute->gateway, newGateway);
-        strcpy(thisRoute->iface, newIface);
-        //Format addresses
-        formatIPv4Address(&thisRoute->netmask);
-        formatIPv4Address(&thisRoute->gateway);
-        return RIB_NO_ERROR;
-      }
-    } else if (thisRoute->ipv == 6 && ipVersion == 6) {
-      int thisPrefix = atoi(netmask);
-      thisPrefix = (thisPrefix - (thisPrefix % 8));
-      if (compareIPv6Addresses(thisRoute->destination, destination) == 0 && thisRoute->prefixLength == thisPrefix) {
-        //We found it
-        //Allocate space for the new record
-        thisRoute->netmask = (char*) realloc(thisRoute->netmask, sizeof(char) * (strlen(newNetmask) + 1));
-        if (thisRoute->netmask == NULL) {
-          free(thisRoute->destination);
-          free(thisRoute->gateway);
-          free(thisRoute->iface);
-          free(thisRoute);
-          return RIB_BAD_ALLOC;
-        }
-        thisRoute->gateway = (char*) realloc(thisRoute->gateway, sizeof(char) * (strlen(newGateway) + 1));
-        if (thisRoute->netmask == NULL) {
-          free(thisRoute->destination);
-          free(thisRoute->netmask);
-          free(thisRoute->iface);
-          free(thisRoute);
-          return RIB_BAD_ALLOC;
-        }
-        thisRoute->iface = (char*) realloc(thisRoute->iface, sizeof(char) * (strlen(newIface) + 1));
-        if (thisRoute->iface == NULL) {
-          free(thisRoute->destination);
-          free(thisRoute->netmask);
-          free(thisRoute->gateway);
-          free(thisRoute);
-          return RIB_BAD_ALLOC;
-        }
-        thisRoute->metric = newMetric;
-        thisRoute->ipv = ipVersion;
-        //Copy to new route struct the attributes passed as arguments
-        strcpy(thisRoute->netmask, newNetmask);
-        strcpy(thisRoute->gateway, newGateway);
-        strcpy(thisRoute->iface, newIface);
-        //Format addresses
-        if (thisRoute->ipv == 6) {
-          thisRoute->prefixLength = atoi(thisRoute->netmask);
-        }
-        formatIPv6Address(&thisRoute->gateway);
-        return RIB_NO_ERROR;
-      }
+  RIB_hits_t* hits = NULL;
+  if (shards > 0) {
+    RIB_ret_code_t rc = RIB_hits_create(shards, rtab->entries, &hits);
+    if (rc != RIB_NO_ERROR) {
+      return rc;
     }
   }
-  return RIB_NOT_EXISTS;
+  RIB_hits_free(rtab->index->hits);
+  rtab->index->hits = hits;
+  return RIB_NO_ERROR;
 }
 
 /**
- * @function RIB_clear
- * @description clear Routing table entries
+ * @function RIB_collect_hits
+ * @description fold the hit counter shards of each route; it may run concurrently with lookups
  * @param RIB*
- * @returns RIB_ret_code_t
+ * @param uint64_t* hits: lookup hits of each route, in the order of rtab->routes (rtab->entries counters)
+ * @returns RIB_ret_code_t: RIB_NOT_EXISTS if hit counters are disabled
  */
 
-RIB_ret_code_t RIB_clear(RIB* rtab) {
+RIB_ret_code_t RIB_collect_hits(RIB* rtab, uint64_t* hits) {
   if (rtab == NULL) {
     return RIB_UNINITIALIZED_RIB;
   }
-  if (rtab->routes == NULL) {
-    return RIB_NO_ERROR;
+  if (rtab->index->hits == NULL) {
+    return RIB_NOT_EXISTS;
   }
-  //Delete each entry of the routing table
-  for(size_t i = 0; i < rtab->entries; i++) {
-    Route* thisRoute = rtab->routes[i];
-    if (thisRoute != NULL) {
-      if (thisRoute->destination != NULL) {
-        free(thisRoute->destination);
-      }
-      if (thisRoute->netmask != NULL) {
-        free(thisRoute->netmask);
-      }
-      if (thisRoute->gateway != NULL) {
-        free(thisRoute->gateway);
-      }
-      if (thisRoute->iface != NULL) {
-        free(thisRoute->iface);
-      }
-      free(thisRoute);
-    }
+  for (size_t i = 0; i < rtab->entries; i++) {
+    hits[i] = RIB_hits_sum(rtab->index->hits, i);
   }
-  free(rtab->routes);
-  rtab->routes = NULL;
-  rtab->entries = 0;
   return RIB_NO_ERROR;
 }
 
@@ -468,23 +2159,12 @@ RIB_ret_code_t RIB_find(RIB* rtab, const char* networkAddr, const char* netmask,
   if (isValidIpAddress(networkAddr, &ipVersion) != 0) {
     return RIB_INVALID_ADDRESS;
   }
-  for (size_t i = 0; i < rtab->entries; i++) {
-    Route* thisRoute = rtab->routes[i];
-    if (thisRoute->ipv == 4 && ipVersion == 4) {
-      if (compareIPv4Addresses(thisRoute->destination, networkAddr) == 0 && (compareIPv4Addresses(thisRoute->netmask, netmask) == 0 || strcmp(netmask, "*") == 0)) {
-        *route = thisRoute;
-        return RIB_NO_ERROR;
-      }
-    } else if (thisRoute->ipv == 6 && ipVersion == 6) {
-      int thisPrefix = atoi(netmask);
-      thisPrefix = (thisPrefix - (thisPrefix % 8));
-      if (compareIPv6Addresses(thisRoute->destination, networkAddr) == 0 && thisRoute->prefixLength == thisPrefix) {
-        *route = thisRoute;
-        return RIB_NO_ERROR;
-      }
-    }
+  Route* thisRoute = findRoute(rtab, networkAddr, netmask, ipVersion);
+  if (thisRoute == NULL) {
+    return RIB_NO_MATCH;
   }
-  return RIB_NO_MATCH;
+  *route = thisRoute;
+  return RIB_NO_ERROR;
 }
 
 /**
@@ -522,45 +2202,15 @@ RIB_ret_code_t RIB_match(RIB* rtab, const char* destination, Route** route) {
  */
 
 RIB_ret_code_t RIB_match_ipv4(RIB* rtab, const char* destination, Route** route) {
-  //Iterate over routing table in order to find a suitable route
+  unsigned char address[4];
   if (rtab == NULL) {
     return RIB_UNINITIALIZED_RIB;
   }
-  if (rtab->routes == NULL) {
-    return RIB_NO_MATCH;
-  }
   *route = NULL;
-  //Iterate over routing table
-  for (size_t i = 0; i < rtab->entries; i++) {
-    Route* thisRoute = rtab->routes[i];
-    //Find the network address with the provided address and check if they match
-    char* thisNetaddr = getIpv4NetworkAddress(destination, thisRoute->netmask);
-    //Check if they match
-    if (compareIPv4Addresses(thisNetaddr, thisRoute->destination) == 0) {
-      //They match! 
-      if (*route == NULL) {
-        //Set immediately this route as next hop
-        *route = thisRoute;
-      } else {
-        //Else check check Longest prefix match
-        if (getCIDRnetmask((*route)->netmask) < getCIDRnetmask(thisRoute->netmask)) {
-          *route = thisRoute;
-        }
-      }
-    }
-    free(thisNetaddr);
-  }
-  //check also 0.0.0.0 as destination if route is NULL
-  if (*route == NULL) {
-    const char default_address[8] = "0.0.0.0";
-    RIB_find(rtab, default_address, default_address, route);
-  }
-
-  if (*route == NULL) {
-    return RIB_NO_MATCH;
+  if (destination == NULL || inet_pton(AF_INET, destination, address) != 1) {
+    return RIB_INVALID_ADDRESS;
   }
-
-  return RIB_NO_ERROR;
+  return RIB_match_address(rtab, 4, address, route);
 }
 
 /**
@@ -573,45 +2223,251 @@ RIB_ret_code_t RIB_match_ipv4(RIB* rtab, const char* destination, Route** route)
  */
 
 RIB_ret_code_t RIB_match_ipv6(RIB* rtab, const char* destination, Route** route) {
-  //Iterate over routing table in order to find a suitable route
+  unsigned char address[16];
   if (rtab == NULL) {
     return RIB_UNINITIALIZED_RIB;
   }
-  if (rtab->routes == NULL) {
+  *route = NULL;
+  if (destination == NULL || inet_pton(AF_INET6, destination, address) != 1) {
+    return RIB_INVALID_ADDRESS;
+  }
+  return RIB_match_address(rtab, 6, address, route);
+}
+
+/**
+ * @function RIB_match_address
+ * @description find a matching route for the provided binary address using the lookup engine of its ip version
+ * @param RIB*
+ * @param int ipv
+ * @param const unsigned char* address in network byte order (4 bytes for ipv4, 16 for ipv6)
+ * @param Route* matched route; NULL if not found
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_match_address(RIB* rtab, int ipv, const unsigned char* address, Route** route) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (ipv != 4 && ipv != 6) {
+    return RIB_INVALID_ADDRESS;
+  }
+  RIB_TRACE_BEGIN(start);
+  RIB_engine_t* engine = getEngine(rtab, ipv);
+  *route = engine->ops->lookup(engine, address);
+#ifdef WITH_TRACE
+  const uint64_t end = RIB_trace_ticks();
+  RIB_prefix_t prefix;
+  RIB_prefix_from_bytes(address, ipv, &prefix);
+  RIB_trace_record(RIB_TRACE_MATCH, start, end, ipv, &prefix);
+#endif
+  if (*route == NULL) {
     return RIB_NO_MATCH;
   }
-  *route = NULL;
-  //Iterate over routing table
-  for (size_t i = 0; i < rtab->entries; i++) {
-    Route* thisRoute = rtab->routes[i];
-    //Find the network address with the provided address and check if they match
-    char* thisNetaddr = getIpv6NetworkAddress(destination, thisRoute->prefixLength);
-    //Check if they match
-    if (compareIPv6Addresses(thisNetaddr, thisRoute->destination) == 0) {
-      //They match! 
-      if (*route == NULL) {
-        //Set immediately this route as next hop
-        *route = thisRoute;
-      } else {
-        //Else check check Longest prefix match
-        if ((*route)->prefixLength < thisRoute->prefixLength) {
-          *route = thisRoute;
-        }
+  if (rtab->index->hits != NULL) {
+    RIB_hits_count(rtab->index->hits, RIB_entry_of(*route)->slot);
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_match_batch
+ * @description find the matching routes for a batch of binary addresses of the same ip version
+ * @param RIB*
+ * @param int ipv
+ * @param const unsigned char* addresses in network byte order, stored contiguously (4 bytes each for ipv4, 16 for ipv6)
+ * @param size_t count
+ * @param Route** routes: matched route for each address; NULL if not found
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_match_batch(RIB* rtab, int ipv, const unsigned char* addresses, size_t count, Route** routes) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (ipv != 4 && ipv != 6) {
+    return RIB_INVALID_ADDRESS;
+  }
+  RIB_engine_t* engine = getEngine(rtab, ipv);
+  engine->ops->lookup_batch(engine, addresses, count, routes);
+  if (rtab->index->hits != NULL) {
+    for (size_t i = 0; i < count; i++) {
+      if (routes[i] != NULL) {
+        RIB_hits_count(rtab->index->hits, RIB_entry_of(routes[i])->slot);
       }
     }
   }
-  //check also 0.0.0.0 as destination if route is NULL
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_match_flow
+ * @description find the matching route for the provided destination and select one of its equal cost next hops for a flow
+ * @param RIB*
+ * @param const char* destination
+ * @param uint64_t flowHash: hash of the flow (e.g. of its 5-tuple); packets of the same flow take the same next hop
+ * @param Route** route: matched route; NULL if not found
+ * @param RIB_nexthop_t* nexthop: selected next hop
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_match_flow(RIB* rtab, const char* destination, uint64_t flowHash, Route** route, RIB_nexthop_t* nexthop) {
+  RIB_ret_code_t rc = RIB_match(rtab, destination, route);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
   if (*route == NULL) {
-    const char default_address[39] = "0000:0000:0000:0000:0000:0000:0000:0000";
-    RIB_find(rtab, default_address, default_address, route);
+    return RIB_NOT_EXISTS;
+  }
+  const RIB_nhgroup_t* group = RIB_entry_of(*route)->nexthops;
+  if (group == NULL) {
+    nexthop->gateway = (*route)->gateway;
+    nexthop->iface = (*route)->iface;
+  } else {
+    *nexthop = *RIB_nhgroup_select(group, flowHash);
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_resolve
+ * @description resolve a next hop to the directly connected route reaching it (a route with the unspecified gateway, 0.0.0.0 or ::), following recursive next hops
+ * @param RIB*
+ * @param const char* gateway
+ * @param Route** connected: directly connected route; NULL if the next hop is unreachable
+ * @returns RIB_ret_code_t: RIB_NOT_EXISTS if the next hop is unreachable
+ */
+
+RIB_ret_code_t RIB_resolve(RIB* rtab, const char* gateway, Route** connected) {
+  *connected = NULL;
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  int ipVersion;
+  RIB_prefix_t address;
+  if (isValidIpAddress(gateway, &ipVersion) != 0 || RIB_prefix_from_address(gateway, ipVersion, &address) != 0) {
+    return RIB_INVALID_ADDRESS;
   }
+  Route* first = RIB_ptree_match(RIB_index_tree(rtab->index, ipVersion), &address);
+  if (first != NULL) {
+    *connected = RIB_index_resolve(rtab->index, first);
+  }
+  return *connected != NULL ? RIB_NO_ERROR : RIB_NOT_EXISTS;
+}
 
+/**
+ * @function RIB_match_resolved
+ * @description find the matching route for the provided destination and resolve its next hop to a directly connected route
+ * @param RIB*
+ * @param const char* destination
+ * @param Route** route: matched route; NULL if not found
+ * @param Route** connected: directly connected route reaching the next hop of the matched route (the route itself if it's directly connected)
+ * @returns RIB_ret_code_t: RIB_NOT_EXISTS if there is no match or the next hop is unreachable
+ */
+
+RIB_ret_code_t RIB_match_resolved(RIB* rtab, const char* destination, Route** route, Route** connected) {
+  *connected = NULL;
+  RIB_ret_code_t rc = RIB_match(rtab, destination, route);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
   if (*route == NULL) {
-    return RIB_NO_MATCH;
+    return RIB_NOT_EXISTS;
+  }
+  //Resolutions are cached for each gateway, so routes sharing the next hop are resolved once
+  *connected = RIB_index_resolve(rtab->index, *route);
+  return *connected != NULL ? RIB_NO_ERROR : RIB_NOT_EXISTS;
+}
+
+/**
+ * @function RIB_match_source
+ * @description find the route for a packet from source to destination: longest destination match, then longest source match;
+ *              the routes added with RIB_add have the default source (any), and source specific routes win over them on the same destination
+ * @param RIB*
+ * @param const char* destination
+ * @param const char* source
+ * @param Route** route: matched route; NULL if not found
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_match_source(RIB* rtab, const char* destination, const char* source, Route** route) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  *route = NULL;
+  int ipVersion;
+  int srcVersion;
+  if (isValidIpAddress(destination, &ipVersion) != 0 || isValidIpAddress(source, &srcVersion) != 0 || srcVersion != ipVersion) {
+    return RIB_INVALID_ADDRESS;
+  }
+  RIB_ret_code_t rc = RIB_match(rtab, destination, route);
+  if (rc != RIB_NO_ERROR && rc != RIB_NO_MATCH) {
+    return rc;
   }
+  RIB_prefix_t dstAddress;
+  RIB_prefix_t srcAddress;
+  if (rtab->index->sources == NULL || RIB_prefix_from_address(destination, ipVersion, &dstAddress) != 0 || RIB_prefix_from_address(source, ipVersion, &srcAddress) != 0) {
+    return rc;
+  }
+  int dstLength;
+  Route* sourceRoute = RIB_srcdst_lookup(rtab->index->sources, ipVersion, &dstAddress, &srcAddress, &dstLength);
+  if (sourceRoute != NULL) {
+    RIB_prefix_t prefix;
+    if (*route == NULL || RIB_prefix_from_route(*route, &prefix) != 0 || prefix.length <= dstLength) {
+      *route = sourceRoute;
+    }
+  }
+  return *route != NULL ? RIB_NO_ERROR : RIB_NO_MATCH;
+}
+
+/**
+ * @function RIB_engine_stats
+ * @description get name and memory usage of the lookup engine used for the provided ip version
+ * @param RIB*
+ * @param int ipv
+ * @param const char** name (may be NULL)
+ * @param size_t* memoryUsage in bytes (may be NULL)
+ * @returns RIB_ret_code_t
+ */
 
+RIB_ret_code_t RIB_engine_stats(RIB* rtab, int ipv, const char** name, size_t* memoryUsage) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (ipv != 4 && ipv != 6) {
+    return RIB_INVALID_ADDRESS;
+  }
+  RIB_engine_t* engine = getEngine(rtab, ipv);
+  if (name != NULL) {
+    *name = engine->ops->name;
+  }
+  if (memoryUsage != NULL) {
+    *memoryUsage = engine->ops->memory_usage(engine);
+  }
   return RIB_NO_ERROR;
-  return RIB_NO_MATCH;
+}
+
+/**
+ * @function RIB_prepare
+ * @description rebuild the lookup tables changed since the last lookup (compiled and range engines rebuild lazily),
+ *              so the following lookups only read the RIB and may run concurrently
+ * @param RIB*
+ * @returns RIB_ret_code_t: error of the first engine which couldn't rebuild its table (e.g. RIB_BAD_ALLOC); then the lookups
+ *                          would rebuild it, so they must not run concurrently until RIB_prepare succeeds
+ */
+
+RIB_ret_code_t RIB_prepare(RIB* rtab) {
+  if (rtab == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  RIB_ret_code_t rc = RIB_NO_ERROR;
+  for (int i = 0; i < 2; i++) {
+    RIB_engine_t* engine = rtab->engines[i];
+    RIB_ret_code_t engineRc = engine->ops->prepare(engine);
+    if (rc == RIB_NO_ERROR) {
+      rc = engineRc;
+    }
+  }
+  return rc;
 }
 
 /**
@@ -636,7 +2492,25 @@ const char* RIB_get_error_msg(const RIB_ret_code_t err) {
       return "A route with the provided addresses doesn't exist in the routing table";
     case RIB_UNINITIALIZED_RIB:
       return "The RIB object is NULL or not correctly initialized";
+    case RIB_IO_ERROR:
+      return "It was not possible to read or write a file or a shared memory object";
+    case RIB_INVALID_ARGUMENT:
+      return "One of the arguments provided to the function is not valid";
+    case RIB_NOT_SUPPORTED:
+      return "The operation is not supported by this build of the library";
     default:
       return "Uknown error";
   }
 }
+
+/**
+ * @function RIB_clock
+ * @description returns the time of a monotonic clock in milliseconds, as used by route flap dampening
+ * @returns uint64_t
+ */
+
+uint64_t RIB_clock(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000 + (uint64_t) now.tv_nsec / 1000000;
+}
@@ -0,0 +1,299 @@
+/**
+ *   librib - srcdst.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include "srcdst.h"
+
+#include <stdlib.h>
+
+/**
+ * @function getTree
+ * @description returns the destination trie for the provided ip version
+ * @param const RIB_srcdst_t*
+ * @param int ipv
+ * @returns RIB_ptree_t*
+ */
+
+static inline RIB_ptree_t* getTree(const RIB_srcdst_t* table, int ipv) {
+  return (RIB_ptree_t*) &table->trees[ipv == 6 ? 1 : 0];
+}
+
+/**
+ * @function freeNode
+ * @description free a destination and its routes
+ * @param RIB_srcdst_node_t*
+ * @param RIB_srcdst_release_cb release: called for each route (may be NULL)
+ * @param void* context
+ */
+
+static void freeNode(RIB_srcdst_node_t* node, RIB_srcdst_release_cb release, void* context) {
+  for (RIB_ptnode_t* src = node->own.root; src != NULL; src = RIB_ptree_next(src, node->own.root)) {
+    RIB_srcroute_t* srcRoute = (RIB_srcroute_t*) src->value;
+    if (srcRoute != NULL) {
+      if (release != NULL) {
+        release(srcRoute->route, context);
+      }
+      free(srcRoute);
+    }
+  }
+  RIB_ptree_clear(&node->own);
+  RIB_ptree_clear(&node->pruned);
+  free(node);
+}
+
+/**
+ * @function prune
+ * @description rebuild the pruned source trie of a destination from its routes and the pruned trie of the closest covering destination
+ * @param RIB_ptnode_t* dst: destination node
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t prune(RIB_ptnode_t* dst) {
+  RIB_srcdst_node_t* node = (RIB_srcdst_node_t*) dst->value;
+  RIB_ptree_clear(&node->pruned);
+  const RIB_ptnode_t* parent = dst->parent;
+  while (parent != NULL && parent->value == NULL) {
+    parent = parent->parent;
+  }
+  RIB_ret_code_t rc;
+  if (parent != NULL) {
+    const RIB_ptree_t* inherited = &((RIB_srcdst_node_t*) parent->value)->pruned;
+    for (RIB_ptnode_t* src = inherited->root; src != NULL; src = RIB_ptree_next(src, inherited->root)) {
+      if (src->value != NULL && (rc = RIB_ptree_insert(&node->pruned, &src->prefix, src->value)) != RIB_NO_ERROR) {
+        return rc;
+      }
+    }
+  }
+  //Routes of the destination win over the inherited ones with the same source
+  for (RIB_ptnode_t* src = node->own.root; src != NULL; src = RIB_ptree_next(src, node->own.root)) {
+    if (src->value == NULL) {
+      continue;
+    }
+    RIB_ptnode_t* existing = RIB_ptree_find(&node->pruned, &src->prefix);
+    if (existing != NULL && existing->value != NULL) {
+      existing->value = src->value;
+    } else if ((rc = RIB_ptree_insert(&node->pruned, &src->prefix, src->value)) != RIB_NO_ERROR) {
+      return rc;
+    }
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function pruneSubtree
+ * @description rebuild the pruned source tries of the destinations covered by a prefix (covering destinations first)
+ * @param RIB_ptree_t* tree
+ * @param const RIB_prefix_t* prefix
+ * @returns RIB_ret_code_t
+ */
+
+static RIB_ret_code_t pruneSubtree(RIB_ptree_t* tree, const RIB_prefix_t* prefix) {
+  RIB_ptnode_t* top = RIB_ptree_subtree(tree, prefix);
+  RIB_ret_code_t rc = RIB_NO_ERROR;
+  //Pre-order visit: a destination is rebuilt after the destinations covering it
+  for (RIB_ptnode_t* dst = top; dst != NULL && rc == RIB_NO_ERROR; dst = RIB_ptree_next(dst, top)) {
+    if (dst->value != NULL) {
+      rc = prune(dst);
+    }
+  }
+  return rc;
+}
+
+/**
+ * @function RIB_srcdst_create
+ * @description allocate an empty table of source specific routes
+ * @param RIB_srcdst_t** table
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_srcdst_create(RIB_srcdst_t** table) {
+  *table = (RIB_srcdst_t*) malloc(sizeof(RIB_srcdst_t));
+  if (*table == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  RIB_ptree_init(&(*table)->trees[0]);
+  RIB_ptree_init(&(*table)->trees[1]);
+  (*table)->routes = 0;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_srcdst_clear
+ * @description remove all the routes
+ * @param RIB_srcdst_t* table
+ * @param RIB_srcdst_release_cb release: called for each route
+ * @param void* context: passed to the callback
+ */
+
+void RIB_srcdst_clear(RIB_srcdst_t* table, RIB_srcdst_release_cb release, void* context) {
+  for (size_t i = 0; i < 2; i++) {
+    RIB_ptree_t* tree = &table->trees[i];
+    for (RIB_ptnode_t* dst = tree->root; dst != NULL; dst = RIB_ptree_next(dst, tree->root)) {
+      if (dst->value != NULL) {
+        freeNode((RIB_srcdst_node_t*) dst->value, release, context);
+      }
+    }
+    RIB_ptree_clear(tree);
+  }
+  table->routes = 0;
+}
+
+/**
+ * @function RIB_srcdst_free
+ * @description free the table; NULL is allowed
+ * @param RIB_srcdst_t* table
+ * @param RIB_srcdst_release_cb release: called for each route
+ * @param void* context: passed to the callback
+ */
+
+void RIB_srcdst_free(RIB_srcdst_t* table, RIB_srcdst_release_cb release, void* context) {
+  if (table == NULL) {
+    return;
+  }
+  RIB_srcdst_clear(table, release, context);
+  free(table);
+}
+
+/**
+ * @function RIB_srcdst_insert
+ * @description insert a route for a (destination, source) pair
+ * @param RIB_srcdst_t* table
+ * @param int ipv
+ * @param const RIB_prefix_t* destination
+ * @param const RIB_prefix_t* source
+ * @param Route* route
+ * @returns RIB_ret_code_t: RIB_DUP_RECORD if the pair has already a route
+ */
+
+RIB_ret_code_t RIB_srcdst_insert(RIB_srcdst_t* table, int ipv, const RIB_prefix_t* destination, const RIB_prefix_t* source, Route* route) {
+  RIB_ptree_t* tree = getTree(table, ipv);
+  RIB_ptnode_t* dst = RIB_ptree_find(tree, destination);
+  RIB_srcdst_node_t* node = dst != NULL ? (RIB_srcdst_node_t*) dst->value : NULL;
+  RIB_ret_code_t rc;
+  if (node == NULL) {
+    node = (RIB_srcdst_node_t*) malloc(sizeof(RIB_srcdst_node_t));
+    if (node == NULL) {
+      return RIB_BAD_ALLOC;
+    }
+    RIB_ptree_init(&node->own);
+    RIB_ptree_init(&node->pruned);
+    if ((rc = RIB_ptree_insert(tree, destination, node)) != RIB_NO_ERROR) {
+      free(node);
+      return rc;
+    }
+  }
+  RIB_srcroute_t* srcRoute = (RIB_srcroute_t*) malloc(sizeof(RIB_srcroute_t));
+  if (srcRoute == NULL) {
+    rc = RIB_BAD_ALLOC;
+  } else {
+    srcRoute->route = route;
+    srcRoute->source = *source;
+    srcRoute->dstLength = destination->length;
+    if ((rc = RIB_ptree_insert(&node->own, source, srcRoute)) != RIB_NO_ERROR) {
+      free(srcRoute);
+    }
+  }
+  if (rc != RIB_NO_ERROR) {
+    if (node->own.routes == 0) {
+      freeNode(node, NULL, NULL);
+      RIB_ptree_remove(tree, destination);
+    }
+    return rc;
+  }
+  table->routes++;
+  return pruneSubtree(tree, destination);
+}
+
+/**
+ * @function RIB_srcdst_remove
+ * @description remove the route of a (destination, source) pair
+ * @param RIB_srcdst_t* table
+ * @param int ipv
+ * @param const RIB_prefix_t* destination
+ * @param const RIB_prefix_t* source
+ * @returns Route*: the removed route, to be freed by the caller; NULL if not found
+ */
+
+Route* RIB_srcdst_remove(RIB_srcdst_t* table, int ipv, const RIB_prefix_t* destination, const RIB_prefix_t* source) {
+  RIB_ptree_t* tree = getTree(table, ipv);
+  RIB_ptnode_t* dst = RIB_ptree_find(tree, destination);
+  if (dst == NULL || dst->value == NULL) {
+    return NULL;
+  }
+  RIB_srcdst_node_t* node = (RIB_srcdst_node_t*) dst->value;
+  RIB_ptnode_t* src = RIB_ptree_find(&node->own, source);
+  if (src == NULL || src->value == NULL) {
+    return NULL;
+  }
+  RIB_srcroute_t* srcRoute = (RIB_srcroute_t*) src->value;
+  Route* route = srcRoute->route;
+  RIB_ptree_remove_node(&node->own, src);
+  free(srcRoute);
+  if (node->own.routes == 0) {
+    freeNode(node, NULL, NULL);
+    RIB_ptree_remove_node(tree, dst);
+  }
+  table->routes--;
+  pruneSubtree(tree, destination);
+  return route;
+}
+
+/**
+ * @function RIB_srcdst_lookup
+ * @description find the route with the longest destination match, then the longest source match
+ * @param const RIB_srcdst_t* table
+ * @param int ipv
+ * @param const RIB_prefix_t* destination: full length address
+ * @param const RIB_prefix_t* source: full length address
+ * @param int* dstLength: destination prefix length of the matched route
+ * @returns Route*: NULL if no route matches
+ */
+
+Route* RIB_srcdst_lookup(const RIB_srcdst_t* table, int ipv, const RIB_prefix_t* destination, const RIB_prefix_t* source, int* dstLength) {
+  const RIB_srcdst_node_t* node = (const RIB_srcdst_node_t*) (void*) RIB_ptree_match(getTree(table, ipv), destination);
+  if (node == NULL) {
+    return NULL;
+  }
+  //The pruned trie holds the most specific destination for each source: pick the longest destination along the source path
+  const RIB_srcroute_t* best = NULL;
+  const RIB_ptnode_t* src = node->pruned.root;
+  while (src != NULL && src->prefix.length <= source->length) {
+    RIB_prefix_t masked = *source;
+    RIB_prefix_mask(&masked, src->prefix.length);
+    if (masked.hi != src->prefix.hi || masked.lo != src->prefix.lo) {
+      break;
+    }
+    const RIB_srcroute_t* srcRoute = (const RIB_srcroute_t*) src->value;
+    if (srcRoute != NULL && (best == NULL || srcRoute->dstLength >= best->dstLength)) {
+      best = srcRoute;
+    }
+    if (src->prefix.length == source->length) {
+      break;
+    }
+    src = src->child[RIB_prefix_bit(source, src->prefix.length)];
+  }
+  if (best == NULL) {
+    return NULL;
+  }
+  *dstLength = best->dstLength;
+  return best->route;
+}
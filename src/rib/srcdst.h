@@ -0,0 +1,69 @@
+/**
+ *   librib - srcdst.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef RIB_SRCDST_H
+#define RIB_SRCDST_H
+
+#include "prefix.h"
+#include "ptree.h"
+
+#include <rib/rib.h>
+
+/**
+ * Source specific routes, keyed on (destination prefix, source prefix): a trie of destinations whose nodes
+ * hold a trie of sources. With set pruning, the source trie of each destination also holds the routes of the
+ * destinations covering it, so a lookup is a walk down the destination trie followed by a walk down a single
+ * source trie, without backtracking. The price is paid by the updates, which rebuild the pruned tries of the
+ * more specific destinations.
+ */
+
+// Data types
+
+typedef struct RIB_srcroute_t {
+  Route* route;
+  RIB_prefix_t source;
+  int dstLength;
+} RIB_srcroute_t;
+
+typedef struct RIB_srcdst_node_t {
+  RIB_ptree_t own;    //Routes of the destination, by source prefix
+  RIB_ptree_t pruned; //Routes of the destination and of the destinations covering it (the most specific one for each source)
+} RIB_srcdst_node_t;
+
+typedef struct RIB_srcdst_t {
+  RIB_ptree_t trees[2]; //RIB_srcdst_node_t by destination prefix, for each ip version
+  size_t routes;
+} RIB_srcdst_t;
+
+typedef void (*RIB_srcdst_release_cb)(Route* route, void* context);
+
+// Functions
+
+RIB_ret_code_t RIB_srcdst_create(RIB_srcdst_t** table);
+void RIB_srcdst_clear(RIB_srcdst_t* table, RIB_srcdst_release_cb release, void* context);
+void RIB_srcdst_free(RIB_srcdst_t* table, RIB_srcdst_release_cb release, void* context);
+RIB_ret_code_t RIB_srcdst_insert(RIB_srcdst_t* table, int ipv, const RIB_prefix_t* destination, const RIB_prefix_t* source, Route* route);
+Route* RIB_srcdst_remove(RIB_srcdst_t* table, int ipv, const RIB_prefix_t* destination, const RIB_prefix_t* source);
+Route* RIB_srcdst_lookup(const RIB_srcdst_t* table, int ipv, const RIB_prefix_t* destination, const RIB_prefix_t* source, int* dstLength);
+
+#endif
@@ -0,0 +1,180 @@
+/**
+ *   librib - trace.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+
+#include "trace.h"
+
+#include <rib/rib.h>
+
+#ifdef WITH_TRACE
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+__thread RIB_trace_ring_t* RIB_trace_thread_ring = NULL;
+
+static RIB_trace_ring_t* rings = NULL; //Ring buffers of all the threads
+static uint32_t threads = 0;
+static uint64_t originTicks = 0;      //Timestamp of the first event, to convert ticks to time
+static uint64_t originNanos = 0;
+
+static const char* opNames[] = {"RIB_add", "RIB_delete", "RIB_update", "RIB_match", "RIB_index_insert", "RIB_index_remove"};
+
+/**
+ * @function nanos
+ * @description returns the monotonic clock in nanoseconds
+ * @returns uint64_t
+ */
+
+static uint64_t nanos(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * @function RIB_trace_ring
+ * @description allocate the ring buffer of the current thread and register it; buffers live until the process exits,
+ *              so the events of terminated threads can be dumped as well
+ * @param uint64_t start: ticks at the beginning of the first event of the thread
+ * @returns RIB_trace_ring_t*: NULL if allocation failed
+ */
+
+RIB_trace_ring_t* RIB_trace_ring(uint64_t start) {
+  RIB_trace_ring_t* ring = (RIB_trace_ring_t*) malloc(sizeof(RIB_trace_ring_t));
+  if (ring == NULL) {
+    return NULL;
+  }
+  ring->head = 0;
+  ring->thread = __atomic_add_fetch(&threads, 1, __ATOMIC_RELAXED);
+  uint64_t none = 0;
+  if (__atomic_compare_exchange_n(&originTicks, &none, start, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    __atomic_store_n(&originNanos, nanos(), __ATOMIC_RELAXED);
+  }
+  ring->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+  RIB_trace_thread_ring = ring;
+  return ring;
+}
+
+/**
+ * @function ticksPerMicro
+ * @description measure the tick rate against the monotonic clock, since the first ring buffer has been created
+ * @returns double
+ */
+
+static double ticksPerMicro(void) {
+  const uint64_t ticks = __atomic_load_n(&originTicks, __ATOMIC_RELAXED);
+  const uint64_t origin = __atomic_load_n(&originNanos, __ATOMIC_RELAXED);
+  uint64_t elapsed;
+  //Wait for a measurable interval
+  while ((elapsed = nanos() - origin) < 1000000);
+  return (double) (RIB_trace_ticks() - ticks) * 1000.0 / (double) elapsed;
+}
+
+/**
+ * @function writeEvent
+ * @description write an event in the Chrome trace event format
+ * @param FILE* stream
+ * @param const RIB_trace_event_t* event
+ * @param uint32_t thread
+ * @param double rate: ticks per microsecond
+ * @param int first: whether it's the first event written
+ */
+
+static void writeEvent(FILE* stream, const RIB_trace_event_t* event, uint32_t thread, double rate, int first) {
+  char address[INET6_ADDRSTRLEN] = "";
+  if (event->ipv == 4 || event->ipv == 6) {
+    RIB_prefix_t prefix = {event->hi, event->lo, event->length};
+    unsigned char bytes[16];
+    RIB_prefix_to_bytes(&prefix, event->ipv, bytes);
+    inet_ntop(event->ipv == 6 ? AF_INET6 : AF_INET, bytes, address, sizeof(address));
+  }
+  //Events which were running when the first one has been recorded started before the origin
+  const double start = (double) (int64_t) (event->start - originTicks) / rate;
+  const double duration = (double) event->duration / rate;
+  fprintf(stream, "%s\n{\"name\":\"%s\",\"cat\":\"rib\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u,\"args\":{\"prefix\":\"%s/%d\"}}",
+          first ? "" : ",", opNames[event->op], start, duration, (int) getpid(), thread, address, event->length);
+}
+
+/**
+ * @function RIB_trace_dump
+ * @description write the events recorded by all the threads to a file in the Chrome trace event format (JSON);
+ *              it may run while other threads record events (events overwritten while dumping are skipped)
+ * @param const char* filename
+ * @returns RIB_ret_code_t: RIB_NOT_SUPPORTED if the library has been built without WITH_TRACE
+ */
+
+RIB_ret_code_t RIB_trace_dump(const char* filename) {
+  if (filename == NULL) {
+    return RIB_INVALID_ARGUMENT;
+  }
+  FILE* stream = fopen(filename, "w");
+  if (stream == NULL) {
+    return RIB_IO_ERROR;
+  }
+  RIB_trace_event_t* events = (RIB_trace_event_t*) malloc(sizeof(RIB_trace_event_t) * RIB_TRACE_EVENTS);
+  if (events == NULL) {
+    fclose(stream);
+    return RIB_BAD_ALLOC;
+  }
+  const double rate = __atomic_load_n(&rings, __ATOMIC_ACQUIRE) != NULL ? ticksPerMicro() : 1.0;
+  int first = 1;
+  fprintf(stream, "{\"traceEvents\":[");
+  for (RIB_trace_ring_t* ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+    const uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    const uint64_t tail = head > RIB_TRACE_EVENTS ? head - RIB_TRACE_EVENTS : 0;
+    for (uint64_t i = tail; i < head; i++) {
+      events[i - tail] = ring->events[i & (RIB_TRACE_EVENTS - 1)];
+    }
+    //The owner may have overwritten the oldest events (and be writing the next one) meanwhile
+    const uint64_t current = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    const uint64_t valid = current >= RIB_TRACE_EVENTS ? current - RIB_TRACE_EVENTS + 1 : 0;
+    for (uint64_t i = tail > valid ? tail : valid; i < head; i++) {
+      writeEvent(stream, &events[i - tail], ring->thread, rate, first);
+      first = 0;
+    }
+  }
+  fprintf(stream, "\n],\"displayTimeUnit\":\"ns\"}\n");
+  free(events);
+  return fclose(stream) == 0 ? RIB_NO_ERROR : RIB_IO_ERROR;
+}
+
+#else
+
+/**
+ * @function RIB_trace_dump
+ * @description write the events recorded by all the threads to a file in the Chrome trace event format (JSON)
+ * @param const char* filename
+ * @returns RIB_ret_code_t: RIB_NOT_SUPPORTED if the library has been built without WITH_TRACE
+ */
+
+RIB_ret_code_t RIB_trace_dump(const char* filename) {
+  (void) filename;
+  return RIB_NOT_SUPPORTED;
+}
+
+#endif
@@ -0,0 +1,137 @@
+/**
+ *   librib - trace.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+
+#ifndef RIB_TRACE_H
+#define RIB_TRACE_H
+
+#include "prefix.h"
+
+#include <stdint.h>
+
+/**
+ * Tracepoints of the RIB operations, compiled only with WITH_TRACE.
+ * Each thread records its events into its own ring buffer (the oldest events are overwritten), so recording
+ * takes no lock and no atomic read-modify-write; timestamps are TSC ticks on x86 and nanoseconds elsewhere.
+ * Without WITH_TRACE the tracepoints expand to nothing.
+ */
+
+#define RIB_TRACE_EVENTS 8192 //Events in each ring buffer (power of 2)
+
+// Data types
+
+typedef enum RIB_trace_op_t {
+  RIB_TRACE_ADD,
+  RIB_TRACE_DELETE,
+  RIB_TRACE_UPDATE,
+  RIB_TRACE_MATCH,
+  RIB_TRACE_INDEX_INSERT,
+  RIB_TRACE_INDEX_REMOVE
+} RIB_trace_op_t;
+
+typedef struct RIB_trace_event_t {
+  uint64_t start;    //Ticks
+  uint64_t hi;       //Prefix (see RIB_prefix_t)
+  uint64_t lo;
+  uint32_t duration; //Ticks
+  uint8_t op;
+  uint8_t ipv;
+  uint8_t length;
+} RIB_trace_event_t;
+
+typedef struct RIB_trace_ring_t {
+  uint64_t head;     //Events recorded so far; written only by the owner thread
+  uint32_t thread;
+  struct RIB_trace_ring_t* next;
+  RIB_trace_event_t events[RIB_TRACE_EVENTS];
+} RIB_trace_ring_t;
+
+#ifdef WITH_TRACE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+extern __thread RIB_trace_ring_t* RIB_trace_thread_ring; //NULL until the first event of the thread
+
+// Functions
+
+RIB_trace_ring_t* RIB_trace_ring(uint64_t start);
+
+/**
+ * @function RIB_trace_ticks
+ * @description returns the current timestamp in ticks
+ * @returns uint64_t
+ */
+
+static inline uint64_t RIB_trace_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+#endif
+}
+
+/**
+ * @function RIB_trace_record
+ * @description record an event into the ring buffer of the current thread
+ * @param RIB_trace_op_t op
+ * @param uint64_t start: ticks
+ * @param uint64_t end: ticks
+ * @param int ipv
+ * @param const RIB_prefix_t* prefix
+ */
+
+static inline void RIB_trace_record(RIB_trace_op_t op, uint64_t start, uint64_t end, int ipv, const RIB_prefix_t* prefix) {
+  RIB_trace_ring_t* ring = RIB_trace_thread_ring != NULL ? RIB_trace_thread_ring : RIB_trace_ring(start);
+  if (ring == NULL) {
+    return;
+  }
+  const uint64_t head = ring->head;
+  RIB_trace_event_t* event = &ring->events[head & (RIB_TRACE_EVENTS - 1)];
+  event->start = start;
+  event->hi = prefix->hi;
+  event->lo = prefix->lo;
+  event->duration = end - start > UINT32_MAX ? UINT32_MAX : (uint32_t) (end - start);
+  event->op = (uint8_t) op;
+  event->ipv = (uint8_t) ipv;
+  event->length = (uint8_t) prefix->length;
+  //Publish the event to the readers
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+#define RIB_TRACE_BEGIN(start) const uint64_t start = RIB_trace_ticks()
+#define RIB_TRACE_END(op, start, ipv, prefix) RIB_trace_record(op, start, RIB_trace_ticks(), ipv, prefix)
+
+#else
+
+#define RIB_TRACE_BEGIN(start)
+#define RIB_TRACE_END(op, start, ipv, prefix)
+
+#endif
+
+#endif
@@ -0,0 +1,279 @@
+/**
+ *   librib - vrf.c
+ *   Developed by Christian Visintin
+ * 
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include <rib/iputils.h>
+#include <rib/vrf.h>
+
+#include "index.h"
+#include "prefix.h"
+
+#include <arpa/inet.h>
+#include <stdlib.h>
+
+/**
+ * Table of a VRF
+ */
+
+typedef struct RIB_vrf_t {
+  RIB* rtab;         //NULL if the VRF doesn't exist
+  uint32_t base;     //Base VRF (RIB_VRF_NONE if none)
+  size_t dependents; //VRFs using this one as base
+} RIB_vrf_t;
+
+struct RIB_vrfs_t {
+  RIB_vrf_t* vrfs; //By ID
+  size_t size;
+  RIB_options_t options;
+  RIB_nhtable_t* nexthops; //Next hop groups shared by all the tables
+};
+
+/**
+ * @function getVrf
+ * @description returns the table of a VRF
+ * @param const RIB_vrfs_t*
+ * @param uint32_t vrfId
+ * @returns RIB_vrf_t*: NULL if the VRF doesn't exist
+ */
+
+static inline RIB_vrf_t* getVrf(const RIB_vrfs_t* vrfs, uint32_t vrfId) {
+  if (vrfId >= vrfs->size || vrfs->vrfs[vrfId].rtab == NULL) {
+    return NULL;
+  }
+  return &vrfs->vrfs[vrfId];
+}
+
+/**
+ * @function RIB_vrfs_init
+ * @description initialize an empty VRF container
+ * @param RIB_vrfs_t** vrfs
+ * @param const RIB_options_t* options: options of the tables; NULL to use default options
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_vrfs_init(RIB_vrfs_t** vrfs, const RIB_options_t* options) {
+  *vrfs = (RIB_vrfs_t*) malloc(sizeof(RIB_vrfs_t));
+  if (*vrfs == NULL) {
+    return RIB_BAD_ALLOC;
+  }
+  (*vrfs)->vrfs = NULL;
+  (*vrfs)->size = 0;
+  if (options != NULL) {
+    (*vrfs)->options = *options;
+  } else {
+    RIB_options_init(&(*vrfs)->options);
+  }
+  if (RIB_nhtable_create(&(*vrfs)->nexthops) != RIB_NO_ERROR) {
+    free(*vrfs);
+    *vrfs = NULL;
+    return RIB_BAD_ALLOC;
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_vrfs_free
+ * @description free a VRF container and all its tables; NULL is allowed
+ * @param RIB_vrfs_t* vrfs
+ */
+
+void RIB_vrfs_free(RIB_vrfs_t* vrfs) {
+  if (vrfs == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < vrfs->size; i++) {
+    RIB_free(vrfs->vrfs[i].rtab);
+  }
+  free(vrfs->vrfs);
+  //Tables release their groups when they're freed
+  RIB_nhtable_free(vrfs->nexthops);
+  free(vrfs);
+}
+
+/**
+ * @function RIB_vrf_create
+ * @description create the table of a VRF; the table is managed with the RIB functions, but it must not be freed with RIB_free
+ * @param RIB_vrfs_t* vrfs
+ * @param uint32_t vrfId: up to RIB_VRF_MAX_ID
+ * @param uint32_t baseId: VRF whose routes are looked up when the table has no better match; RIB_VRF_NONE if none
+ * @param RIB** rtab: table of the VRF (may be NULL)
+ * @returns RIB_ret_code_t: RIB_DUP_RECORD if the VRF exists, RIB_NOT_EXISTS if the base doesn't exist
+ */
+
+RIB_ret_code_t RIB_vrf_create(RIB_vrfs_t* vrfs, uint32_t vrfId, uint32_t baseId, RIB** rtab) {
+  if (vrfs == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  if (vrfId > RIB_VRF_MAX_ID) {
+    return RIB_INVALID_ARGUMENT;
+  }
+  if (getVrf(vrfs, vrfId) != NULL) {
+    return RIB_DUP_RECORD;
+  }
+  if (baseId != RIB_VRF_NONE && getVrf(vrfs, baseId) == NULL) {
+    return RIB_NOT_EXISTS;
+  }
+  if (vrfId >= vrfs->size) {
+    size_t size = vrfs->size > 0 ? vrfs->size : 16;
+    while (size <= vrfId) {
+      size *= 2;
+    }
+    RIB_vrf_t* tables = (RIB_vrf_t*) realloc(vrfs->vrfs, sizeof(RIB_vrf_t) * size);
+    if (tables == NULL) {
+      return RIB_BAD_ALLOC;
+    }
+    for (size_t i = vrfs->size; i < size; i++) {
+      tables[i].rtab = NULL;
+      tables[i].base = RIB_VRF_NONE;
+      tables[i].dependents = 0;
+    }
+    vrfs->vrfs = tables;
+    vrfs->size = size;
+  }
+  RIB* table;
+  RIB_ret_code_t rc = RIB_init_ex(&table, &vrfs->options);
+  if (rc != RIB_NO_ERROR) {
+    return rc;
+  }
+  //Share the next hop groups of the container
+  RIB_nhtable_free(table->index->nexthops);
+  table->index->nexthops = vrfs->nexthops;
+  table->index->sharedNexthops = 1;
+  vrfs->vrfs[vrfId].rtab = table;
+  vrfs->vrfs[vrfId].base = baseId;
+  vrfs->vrfs[vrfId].dependents = 0;
+  if (baseId != RIB_VRF_NONE) {
+    vrfs->vrfs[baseId].dependents++;
+  }
+  if (rtab != NULL) {
+    *rtab = table;
+  }
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_vrf_delete
+ * @description delete a VRF and its table
+ * @param RIB_vrfs_t* vrfs
+ * @param uint32_t vrfId
+ * @returns RIB_ret_code_t: RIB_INVALID_ARGUMENT if the VRF is the base of other VRFs
+ */
+
+RIB_ret_code_t RIB_vrf_delete(RIB_vrfs_t* vrfs, uint32_t vrfId) {
+  if (vrfs == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  RIB_vrf_t* vrf = getVrf(vrfs, vrfId);
+  if (vrf == NULL) {
+    return RIB_NOT_EXISTS;
+  }
+  if (vrf->dependents > 0) {
+    return RIB_INVALID_ARGUMENT;
+  }
+  if (vrf->base != RIB_VRF_NONE) {
+    vrfs->vrfs[vrf->base].dependents--;
+  }
+  RIB_free(vrf->rtab);
+  vrf->rtab = NULL;
+  vrf->base = RIB_VRF_NONE;
+  return RIB_NO_ERROR;
+}
+
+/**
+ * @function RIB_vrf_get
+ * @description get the table of a VRF
+ * @param RIB_vrfs_t* vrfs
+ * @param uint32_t vrfId
+ * @param RIB** rtab
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_vrf_get(RIB_vrfs_t* vrfs, uint32_t vrfId, RIB** rtab) {
+  if (vrfs == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  RIB_vrf_t* vrf = getVrf(vrfs, vrfId);
+  *rtab = vrf != NULL ? vrf->rtab : NULL;
+  return vrf != NULL ? RIB_NO_ERROR : RIB_NOT_EXISTS;
+}
+
+/**
+ * @function RIB_match_vrf
+ * @description find the matching route of a VRF for the provided destination (see RIB_match_vrf_address)
+ * @param RIB_vrfs_t* vrfs
+ * @param uint32_t vrfId
+ * @param const char* destination
+ * @param Route** route: matched route; NULL if not found
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_match_vrf(RIB_vrfs_t* vrfs, uint32_t vrfId, const char* destination, Route** route) {
+  unsigned char address[16];
+  int ipVersion;
+  *route = NULL;
+  if (isValidIpAddress(destination, &ipVersion) != 0) {
+    return RIB_INVALID_ADDRESS;
+  }
+  if (inet_pton(ipVersion == 6 ? AF_INET6 : AF_INET, destination, address) != 1) {
+    return RIB_INVALID_ADDRESS;
+  }
+  return RIB_match_vrf_address(vrfs, vrfId, ipVersion, address, route);
+}
+
+/**
+ * @function RIB_match_vrf_address
+ * @description find the matching route of a VRF for a binary address: the longest prefix match among the table of the VRF
+ *              and its bases; on the same prefix the route of the VRF wins over the base
+ * @param RIB_vrfs_t* vrfs
+ * @param uint32_t vrfId
+ * @param int ipv
+ * @param const unsigned char* address in network byte order
+ * @param Route** route: matched route; NULL if not found
+ * @returns RIB_ret_code_t
+ */
+
+RIB_ret_code_t RIB_match_vrf_address(RIB_vrfs_t* vrfs, uint32_t vrfId, int ipv, const unsigned char* address, Route** route) {
+  if (vrfs == NULL) {
+    return RIB_UNINITIALIZED_RIB;
+  }
+  *route = NULL;
+  const RIB_vrf_t* vrf = getVrf(vrfs, vrfId);
+  if (vrf == NULL) {
+    return RIB_NOT_EXISTS;
+  }
+  int bestLength = -1;
+  while (vrf != NULL && bestLength < RIB_prefix_max_length(ipv)) {
+    Route* match;
+    RIB_ret_code_t rc = RIB_match_address(vrf->rtab, ipv, address, &match);
+    if (rc == RIB_NO_ERROR) {
+      RIB_prefix_t prefix;
+      if (RIB_prefix_from_route(match, &prefix) == 0 && prefix.length > bestLength) {
+        *route = match;
+        bestLength = prefix.length;
+      }
+    } else if (rc != RIB_NO_MATCH) {
+      return rc;
+    }
+    vrf = vrf->base != RIB_VRF_NONE ? getVrf(vrfs, vrf->base) : NULL;
+  }
+  return *route != NULL ? RIB_NO_ERROR : RIB_NO_MATCH;
+}
@@ -0,0 +1,217 @@
+/**
+ *   librib - wheel.c
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#include "wheel.h"
+
+/**
+ * @function linkTimer
+ * @description add a timer to a slot
+ * @param RIB_timer_t** slot
+ * @param RIB_timer_t* timer
+ */
+
+static void linkTimer(RIB_timer_t** slot, RIB_timer_t* timer) {
+  timer->prev = NULL;
+  timer->next = *slot;
+  if (*slot != NULL) {
+    (*slot)->prev = timer;
+  }
+  *slot = timer;
+}
+
+/**
+ * @function placeTimer
+ * @description store a timer in the lowest level covering its deadline
+ * @param RIB_wheel_t*
+ * @param RIB_timer_t*
+ */
+
+static void placeTimer(RIB_wheel_t* wheel, RIB_timer_t* timer) {
+  uint64_t tick = timer->deadline / wheel->resolution;
+  //Expired timers fire at the next advance
+  if (tick < wheel->tick) {
+    tick = wheel->tick;
+  }
+  const uint64_t delta = tick - wheel->tick;
+  unsigned int level = 0;
+  while (level < RIB_WHEEL_LEVELS - 1 && delta >> (RIB_WHEEL_BITS * (level + 1)) != 0) {
+    level++;
+  }
+  if (delta >> (RIB_WHEEL_BITS * RIB_WHEEL_LEVELS) != 0) {
+    //Out of range: park in the farthest slot, it's placed again when cascaded
+    tick = wheel->tick + (((uint64_t) 1 << (RIB_WHEEL_BITS * RIB_WHEEL_LEVELS)) - 1);
+  }
+  timer->level = level;
+  timer->slot = (unsigned int) ((tick >> (RIB_WHEEL_BITS * level)) & (RIB_WHEEL_SLOTS - 1));
+  linkTimer(&wheel->slots[level][timer->slot], timer);
+  wheel->counts[level]++;
+}
+
+/**
+ * @function cascade
+ * @description move the timers of a slot of an upper level to the lower levels
+ * @param RIB_wheel_t*
+ * @param unsigned int level
+ * @param unsigned int slot
+ */
+
+static void cascade(RIB_wheel_t* wheel, unsigned int level, unsigned int slot) {
+  RIB_timer_t* timer = wheel->slots[level][slot];
+  wheel->slots[level][slot] = NULL;
+  while (timer != NULL) {
+    RIB_timer_t* next = timer->next;
+    wheel->counts[level]--;
+    placeTimer(wheel, timer);
+    timer = next;
+  }
+}
+
+/**
+ * @function RIB_wheel_init
+ * @description initialize an empty wheel
+ * @param RIB_wheel_t* wheel
+ * @param uint64_t resolution: milliseconds per tick
+ * @param uint64_t now: current time in milliseconds
+ */
+
+void RIB_wheel_init(RIB_wheel_t* wheel, uint64_t resolution, uint64_t now) {
+  for (size_t level = 0; level < RIB_WHEEL_LEVELS; level++) {
+    for (size_t i = 0; i < RIB_WHEEL_SLOTS; i++) {
+      wheel->slots[level][i] = NULL;
+    }
+    wheel->counts[level] = 0;
+  }
+  wheel->resolution = resolution > 0 ? resolution : 1;
+  wheel->tick = now / wheel->resolution;
+  wheel->timers = 0;
+}
+
+/**
+ * @function RIB_wheel_schedule
+ * @description schedule a timer (a scheduled timer is moved to the new deadline)
+ * @param RIB_wheel_t* wheel
+ * @param RIB_timer_t* timer
+ * @param uint64_t deadline: milliseconds
+ */
+
+void RIB_wheel_schedule(RIB_wheel_t* wheel, RIB_timer_t* timer, uint64_t deadline) {
+  RIB_wheel_cancel(wheel, timer);
+  timer->deadline = deadline;
+  placeTimer(wheel, timer);
+  timer->scheduled = 1;
+  wheel->timers++;
+}
+
+/**
+ * @function RIB_wheel_cancel
+ * @description cancel a timer; nothing happens if it's not scheduled
+ * @param RIB_wheel_t* wheel
+ * @param RIB_timer_t* timer
+ */
+
+void RIB_wheel_cancel(RIB_wheel_t* wheel, RIB_timer_t* timer) {
+  if (!timer->scheduled) {
+    return;
+  }
+  if (timer->prev != NULL) {
+    timer->prev->next = timer->next;
+  } else {
+    wheel->slots[timer->level][timer->slot] = timer->next;
+  }
+  if (timer->next != NULL) {
+    timer->next->prev = timer->prev;
+  }
+  timer->prev = NULL;
+  timer->next = NULL;
+  timer->scheduled = 0;
+  wheel->counts[timer->level]--;
+  wheel->timers--;
+}
+
+/**
+ * @function RIB_wheel_advance
+ * @description fire the timers which expired up to now; callbacks are invoked once the wheel has been advanced,
+ *              so they can schedule and cancel timers
+ * @param RIB_wheel_t* wheel
+ * @param uint64_t now: milliseconds
+ * @param RIB_timer_cb expired
+ * @param void* context: passed to the callback
+ * @returns size_t: number of fired timers
+ */
+
+size_t RIB_wheel_advance(RIB_wheel_t* wheel, uint64_t now, RIB_timer_cb expired, void* context) {
+  const uint64_t last = now / wheel->resolution;
+  RIB_timer_t* fired = NULL;
+  size_t count = 0;
+  //The current tick is visited again by the next advance, since its timers may not be expired yet
+  while (wheel->tick <= last && wheel->timers > 0) {
+    const uint64_t tick = wheel->tick;
+    //Cascade the upper levels whose slot begins at this tick
+    for (unsigned int level = 1; level < RIB_WHEEL_LEVELS; level++) {
+      if ((tick & (((uint64_t) 1 << (RIB_WHEEL_BITS * level)) - 1)) != 0) {
+        break;
+      }
+      cascade(wheel, level, (unsigned int) ((tick >> (RIB_WHEEL_BITS * level)) & (RIB_WHEEL_SLOTS - 1)));
+    }
+    RIB_timer_t** slot = &wheel->slots[0][tick & (RIB_WHEEL_SLOTS - 1)];
+    RIB_timer_t* timer = *slot;
+    *slot = NULL;
+    while (timer != NULL) {
+      RIB_timer_t* next = timer->next;
+      if (timer->deadline <= now) {
+        timer->scheduled = 0;
+        wheel->counts[0]--;
+        wheel->timers--;
+        timer->next = fired;
+        fired = timer;
+        count++;
+      } else {
+        linkTimer(slot, timer);
+      }
+      timer = next;
+    }
+    if (tick == last) {
+      break;
+    }
+    //Skip the ticks until the next slot of the lowest level holding timers
+    unsigned int level = 0;
+    while (level < RIB_WHEEL_LEVELS - 1 && wheel->counts[level] == 0) {
+      level++;
+    }
+    const uint64_t span = (uint64_t) 1 << (RIB_WHEEL_BITS * level);
+    uint64_t next = level == 0 ? tick + 1 : (tick | (span - 1)) + 1;
+    wheel->tick = next < last ? next : last;
+  }
+  if (wheel->tick < last) {
+    wheel->tick = last;
+  }
+  //Fire in deadline order is not guaranteed; callbacks run after the wheel is consistent
+  while (fired != NULL) {
+    RIB_timer_t* next = fired->next;
+    fired->prev = NULL;
+    fired->next = NULL;
+    expired(fired, context);
+    fired = next;
+  }
+  return count;
+}
@@ -0,0 +1,71 @@
+/**
+ *   librib - wheel.h
+ *   Developed by Christian Visintin
+ *
+ * MIT License
+ * Copyright (c) 2019 Christian Visintin
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+**/
+
+#ifndef RIB_WHEEL_H
+#define RIB_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RIB_WHEEL_BITS 8
+#define RIB_WHEEL_SLOTS (1 << RIB_WHEEL_BITS) //Slots of each level
+#define RIB_WHEEL_LEVELS 4
+
+/**
+ * Hierarchical timing wheel: level 0 has a slot for each of the next 256 ticks, each upper level has a slot
+ * for 256 slots of the level below. A timer is stored in the lowest level which covers its deadline, and it is
+ * cascaded to the lower levels when the wheel reaches its slot. Scheduling and cancelling a timer are O(1),
+ * and each timer is cascaded at most once per level; advancing the wheel skips the ticks of empty levels.
+ * Deadlines beyond the last level are parked in its farthest slot and placed again when they're cascaded.
+ * Timers are intrusive: they are embedded in the objects they belong to.
+ */
+
+// Data types
+
+typedef struct RIB_timer_t {
+  struct RIB_timer_t* prev;
+  struct RIB_timer_t* next;
+  uint64_t deadline; //Milliseconds
+  unsigned int level;
+  unsigned int slot;
+  int scheduled;
+} RIB_timer_t;
+
+typedef struct RIB_wheel_t {
+  RIB_timer_t* slots[RIB_WHEEL_LEVELS][RIB_WHEEL_SLOTS];
+  size_t counts[RIB_WHEEL_LEVELS]; //Timers of each level
+  uint64_t resolution; //Milliseconds per tick
+  uint64_t tick;       //Current tick (the first one visited by the next advance)
+  size_t timers;
+} RIB_wheel_t;
+
+typedef void (*RIB_timer_cb)(RIB_timer_t* timer, void* context);
+
+// Functions
+
+void RIB_wheel_init(RIB_wheel_t* wheel, uint64_t resolution, uint64_t now);
+void RIB_wheel_schedule(RIB_wheel_t* wheel, RIB_timer_t* timer, uint64_t deadline);
+void RIB_wheel_cancel(RIB_wheel_t* wheel, RIB_timer_t* timer);
+size_t RIB_wheel_advance(RIB_wheel_t* wheel, uint64_t now, RIB_timer_cb expired, void* context);
+
+#endif
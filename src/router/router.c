@@ -21,15 +21,43 @@
  * SOFTWARE.
 **/
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #define PROGRAM_NAME "router"
 #define PROGRAM_VERSION "1.0.0"
-#define USAGE PROGRAM_NAME " <routingTableFile>"
+#define USAGE PROGRAM_NAME " <routingTableFile> [--watch] [--listen <socketPath>] [--port <tcpPort>] [--threads <n>]"
 
+#include <rib/fib.h>
 #include <rib/rib.h>
 
+#include <errno.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <unistd.h>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <endian.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
 
 #define CMD_QUT "QUIT"
 #define CMD_HLP "HELP"
@@ -42,17 +70,96 @@
 #define CMD_DMP "DUMP"
 #define CMD_CMT "COMMIT"
 #define CMD_RLB "ROLLBACK"
+#define CMD_PUB "PUBLISH"
+#define CMD_WDR "WITHDRAW"
+#define CMD_IFD "IFDOWN"
+#define CMD_NHP "NEXTHOP"
+#define CMD_RSL "RESOLVE"
+#define CMD_APT "ADDPATH"
+#define CMD_DPT "DELPATH"
+#define CMD_FLW "FLOW"
+#define CMD_OFR "OFFER"
+#define CMD_RTR "RETRACT"
+#define CMD_DMN "DAMPEN"
+#define CMD_PNL "PENALTY"
+#define CMD_TTL "ADDTTL"
+#define CMD_ASR "ADDSRC"
+#define CMD_DSR "DELSRC"
+#define CMD_RFR "ROUTEFROM"
+#define CMD_TRC "TRACE"
+#define CMD_SAV "SAVE"
+#define CMD_LOD "LOAD"
+#define CMD_MRT "MRT"
 
 #define USAGE_QUIT "QUIT"
 #define USAGE_ADD "ADD <networkAddr> <netmask> <gateway> <iface> <metric> - add a new record in the routing table"
+#define USAGE_TTL "ADDTTL <networkAddr> <netmask> <gateway> <iface> <metric> <seconds> - add a record which is deleted once its TTL elapsed"
 #define USAGE_DEL "DELETE <networkAddr> <netmask/*> - delete a record in the routing table"
 #define USAGE_UPD "UPDATE <networkAddr> <netmask> <newNetmask> <newGateway> <newIface> <newMetric> - update a record in the routing table"
 #define USAGE_CLR "CLEAR - clear routing table"
 #define USAGE_SLT "SELECT <networkAddr> <netmask/*> - retrieve routing information for a network address"
 #define USAGE_ROT "ROUTE <destination> - find gateway for the provided destination"
-#define USAGE_DMP "DUMP - dump all the records in the routing table"
-#define USAGE_CMT "COMMIT - commit changes to the routing table"
+#define USAGE_DMP "DUMP [HITS | TOP <n>] - dump all the records in the routing table (with their lookup hits), or the <n> most looked up records"
+#define USAGE_CMT "COMMIT - commit changes to the routing table (in background)"
 #define USAGE_RLB "ROLLBACK - abort changes to the routing table"
+#define USAGE_PUB "PUBLISH <name> - publish the routing table to the shared memory FIB <name>"
+#define USAGE_WDR "WITHDRAW <networkAddr> <netmask> - delete a record and all its more specifics"
+#define USAGE_IFD "IFDOWN <iface> - delete all the records going through an interface"
+#define USAGE_NHP "NEXTHOP <gateway> <newGateway> - replace a gateway in all the records using it"
+#define USAGE_APT "ADDPATH <networkAddr> <netmask> <gateway> <iface> - add an equal cost next hop to a record"
+#define USAGE_DPT "DELPATH <networkAddr> <netmask> <gateway> - remove an equal cost next hop from a record"
+#define USAGE_FLW "FLOW <destination> <flowHash> - find the next hop for a flow to the provided destination"
+#define USAGE_OFR "OFFER <networkAddr> <netmask> <gateway> <iface> <distance> <metric> - add the candidate route of a source (admin distance)"
+#define USAGE_RTR "RETRACT <networkAddr> <netmask> <distance> - remove the candidate route of a source (admin distance)"
+#define USAGE_DMN "DAMPEN <ON/OFF> - enable (with the default parameters) or disable route flap dampening"
+#define USAGE_PNL "PENALTY <networkAddr> <netmask> - show the flap penalty of a prefix"
+#define USAGE_ASR "ADDSRC <networkAddr> <netmask> <source> <sourceNetmask> <gateway> <iface> <metric> - add a record matched only by packets from the source prefix"
+#define USAGE_DSR "DELSRC <networkAddr> <netmask> <source> <sourceNetmask> - delete a source specific record"
+#define USAGE_RFR "ROUTEFROM <destination> <source> - find gateway for the provided destination and source"
+#define USAGE_TRC "TRACE <file> - export the traced RIB operations to <file> (Chrome trace JSON); requires a WITH_TRACE build"
+#define USAGE_SAV "SAVE <file> - write the routing table to <file> in the compact binary format"
+#define USAGE_LOD "LOAD <file> - add the records of a file written with SAVE"
+#define USAGE_MRT "MRT <file> [peer] - add the records of an MRT TABLE_DUMP_V2 file (gzip and bzip2 allowed), from the best paths or from the paths of a peer"
+#define USAGE_RSL "RESOLVE <destination> - find the route for the provided destination and the directly connected route reaching its gateway"
+
+/**
+ * Stream the replies of the current thread are printed to; stdout if NULL.
+ * Server threads capture the reply of each request in a memory stream
+ */
+
+static __thread FILE* replyStream = NULL;
+
+/**
+ * Position of nextToken in the string being tokenized by the current thread
+ */
+
+static __thread char* tokenPosition = NULL;
+
+/**
+ * @function reply
+ * @description print (printf-like) the reply to a command to the reply stream of the current thread
+ * @param const char* format
+ */
+
+__attribute__((format(printf, 1, 2)))
+void reply(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  vfprintf(replyStream != NULL ? replyStream : stdout, format, args);
+  va_end(args);
+}
+
+/**
+ * @function nextToken
+ * @description strtok keeping its position per thread, since server commands run on several threads
+ * @param char* str: string to tokenize; NULL to continue with the current one
+ * @param const char* delim
+ * @returns char*
+ */
+
+char* nextToken(char* str, const char* delim) {
+  return strtok_r(str, delim, &tokenPosition);
+}
 
 typedef enum route_cmd_t {
   QUIT,
@@ -66,6 +173,26 @@ typedef enum route_cmd_t {
   DUMP,
   COMMIT,
   ROLLBACK,
+  PUBLISH,
+  WITHDRAW,
+  IFDOWN,
+  NEXTHOP,
+  RESOLVE,
+  ADDPATH,
+  DELPATH,
+  FLOW,
+  OFFER,
+  RETRACT,
+  DAMPEN,
+  PENALTY,
+  ADDTTL,
+  ADDSRC,
+  DELSRC,
+  ROUTEFROM,
+  TRACE,
+  SAVE,
+  LOAD,
+  MRT,
   UNKNOWN
 } route_cmd_t;
 
@@ -76,17 +203,37 @@ typedef enum route_cmd_t {
 
 void usage() {
 
-  printf("\t%s\n", USAGE_QUIT);
-  printf("\t%s\n", USAGE_ADD);
-  printf("\t%s\n", USAGE_DEL);
-  printf("\t%s\n", USAGE_UPD);
-  printf("\t%s\n", USAGE_CLR);
-  printf("\t%s\n", USAGE_SLT);
-  printf("\t%s\n", USAGE_ROT);
-  printf("\t%s\n", USAGE_DMP);
-  printf("\t%s\n", USAGE_CMT);
-  printf("\t%s\n", USAGE_RLB);
-  printf("\n");
+  reply("\t%s\n", USAGE_QUIT);
+  reply("\t%s\n", USAGE_ADD);
+  reply("\t%s\n", USAGE_DEL);
+  reply("\t%s\n", USAGE_UPD);
+  reply("\t%s\n", USAGE_CLR);
+  reply("\t%s\n", USAGE_SLT);
+  reply("\t%s\n", USAGE_ROT);
+  reply("\t%s\n", USAGE_DMP);
+  reply("\t%s\n", USAGE_CMT);
+  reply("\t%s\n", USAGE_RLB);
+  reply("\t%s\n", USAGE_PUB);
+  reply("\t%s\n", USAGE_WDR);
+  reply("\t%s\n", USAGE_IFD);
+  reply("\t%s\n", USAGE_NHP);
+  reply("\t%s\n", USAGE_RSL);
+  reply("\t%s\n", USAGE_APT);
+  reply("\t%s\n", USAGE_DPT);
+  reply("\t%s\n", USAGE_FLW);
+  reply("\t%s\n", USAGE_OFR);
+  reply("\t%s\n", USAGE_RTR);
+  reply("\t%s\n", USAGE_DMN);
+  reply("\t%s\n", USAGE_PNL);
+  reply("\t%s\n", USAGE_TTL);
+  reply("\t%s\n", USAGE_ASR);
+  reply("\t%s\n", USAGE_DSR);
+  reply("\t%s\n", USAGE_RFR);
+  reply("\t%s\n", USAGE_TRC);
+  reply("\t%s\n", USAGE_SAV);
+  reply("\t%s\n", USAGE_LOD);
+  reply("\t%s\n", USAGE_MRT);
+  reply("\n");
 
 }
 
@@ -116,6 +263,46 @@ route_cmd_t getCommand(char* commandStr) {
     return COMMIT;
   } else if (strcmp(commandStr, CMD_RLB) == 0) {
     return ROLLBACK;
+  } else if (strcmp(commandStr, CMD_PUB) == 0) {
+    return PUBLISH;
+  } else if (strcmp(commandStr, CMD_WDR) == 0) {
+    return WITHDRAW;
+  } else if (strcmp(commandStr, CMD_IFD) == 0) {
+    return IFDOWN;
+  } else if (strcmp(commandStr, CMD_NHP) == 0) {
+    return NEXTHOP;
+  } else if (strcmp(commandStr, CMD_RSL) == 0) {
+    return RESOLVE;
+  } else if (strcmp(commandStr, CMD_APT) == 0) {
+    return ADDPATH;
+  } else if (strcmp(commandStr, CMD_DPT) == 0) {
+    return DELPATH;
+  } else if (strcmp(commandStr, CMD_FLW) == 0) {
+    return FLOW;
+  } else if (strcmp(commandStr, CMD_OFR) == 0) {
+    return OFFER;
+  } else if (strcmp(commandStr, CMD_RTR) == 0) {
+    return RETRACT;
+  } else if (strcmp(commandStr, CMD_DMN) == 0) {
+    return DAMPEN;
+  } else if (strcmp(commandStr, CMD_PNL) == 0) {
+    return PENALTY;
+  } else if (strcmp(commandStr, CMD_TTL) == 0) {
+    return ADDTTL;
+  } else if (strcmp(commandStr, CMD_ASR) == 0) {
+    return ADDSRC;
+  } else if (strcmp(commandStr, CMD_DSR) == 0) {
+    return DELSRC;
+  } else if (strcmp(commandStr, CMD_RFR) == 0) {
+    return ROUTEFROM;
+  } else if (strcmp(commandStr, CMD_TRC) == 0) {
+    return TRACE;
+  } else if (strcmp(commandStr, CMD_SAV) == 0) {
+    return SAVE;
+  } else if (strcmp(commandStr, CMD_LOD) == 0) {
+    return LOAD;
+  } else if (strcmp(commandStr, CMD_MRT) == 0) {
+    return MRT;
   } else if (strcmp(commandStr, CMD_HLP) == 0) {
     return HELP;
   } else if (strcmp(commandStr, CMD_QUT) == 0) {
@@ -127,14 +314,14 @@ route_cmd_t getCommand(char* commandStr) {
 
 void printRoute(const Route* r) {
   if (r->ipv == 4) {
-    printf("%s\t%s\t%s\t%s\t%d\n", r->destination, r->netmask, r->gateway, r->iface, r->metric);
+    reply("%s\t%s\t%s\t%s\t%d\n", r->destination, r->netmask, r->gateway, r->iface, r->metric);
   } else if (r->ipv == 6) {
-    printf("%s\t%d\t%s\t%s\t%d\n", r->destination, r->prefixLength, r->gateway, r->iface, r->metric);
+    reply("%s\t%d\t%s\t%s\t%d\n", r->destination, r->prefixLength, r->gateway, r->iface, r->metric);
   }
 }
 
 RIB_ret_code_t command_add(RIB* rtab, char* argv) {
-  char* arg = strtok(argv, " ");
+  char* arg = nextToken(argv, " ");
   //Define data
   char* destination = NULL;
   char* netmask = NULL;
@@ -169,10 +356,10 @@ RIB_ret_code_t command_add(RIB* rtab, char* argv) {
         break;
       }
     }
-    arg = strtok(NULL, " ");
+    arg = nextToken(NULL, " ");
   }
   if (argIndex != 5) {
-    printf("%s\n", USAGE_ADD);
+    reply("%s\n", USAGE_ADD);
   }
   //Abort in case there are missing arguments
   if (destination == NULL) {
@@ -205,7 +392,7 @@ RIB_ret_code_t command_add(RIB* rtab, char* argv) {
 RIB_ret_code_t command_delete(RIB* rtab, char* argv) {
   char* destination = NULL;
   char* netmask = NULL;
-  char* arg = strtok(argv, " ");
+  char* arg = nextToken(argv, " ");
   const int args = 2;
   int argIndex;
   for (argIndex = 0; arg != NULL; argIndex++) {
@@ -221,10 +408,10 @@ RIB_ret_code_t command_delete(RIB* rtab, char* argv) {
         break;
       }
     }
-    arg = strtok(NULL, " ");
+    arg = nextToken(NULL, " ");
   }
   if (argIndex < args) {
-    printf("%s\n", USAGE_DEL);
+    reply("%s\n", USAGE_DEL);
   }
   if (destination == NULL) {
     return RIB_INVALID_ADDRESS;
@@ -241,7 +428,7 @@ RIB_ret_code_t command_delete(RIB* rtab, char* argv) {
 
 RIB_ret_code_t command_update(RIB* rtab, char* argv) {
   const int args = 6;
-  char* arg = strtok(argv, " ");
+  char* arg = nextToken(argv, " ");
   //Define data
   char* destination = NULL;
   char* netmask = NULL;
@@ -282,10 +469,10 @@ RIB_ret_code_t command_update(RIB* rtab, char* argv) {
         break;
       }
     }
-    arg = strtok(NULL, " ");
+    arg = nextToken(NULL, " ");
   }
   if (argIndex < args) {
-    printf("%s\n", USAGE_ADD);
+    reply("%s\n", USAGE_ADD);
   }
   //Abort in case there are missing arguments
   if (destination == NULL) {
@@ -330,7 +517,7 @@ RIB_ret_code_t command_clear(RIB* rtab, char* argv) {
 RIB_ret_code_t command_select(RIB* rtab, char* argv) {
   char* destination = NULL;
   char* netmask = NULL;
-  char* arg = strtok(argv, " ");
+  char* arg = nextToken(argv, " ");
   const int args = 2;
   int argIndex;
   for (argIndex = 0; arg != NULL; argIndex++) {
@@ -346,10 +533,10 @@ RIB_ret_code_t command_select(RIB* rtab, char* argv) {
         break;
       }
     }
-    arg = strtok(NULL, " ");
+    arg = nextToken(NULL, " ");
   }
   if (argIndex < args) {
-    printf("%s\n", USAGE_SLT);
+    reply("%s\n", USAGE_SLT);
   }
   if (destination == NULL) {
     return RIB_INVALID_ADDRESS;
@@ -371,7 +558,7 @@ RIB_ret_code_t command_select(RIB* rtab, char* argv) {
 RIB_ret_code_t  command_route(RIB* rtab, char* argv) {
   char* destination = argv;
   if (destination == NULL) {
-    printf("%s\n", USAGE_DEL);
+    reply("%s\n", USAGE_DEL);
   }
   Route* result = NULL;
   RIB_ret_code_t rc = RIB_match(rtab, destination, &result);
@@ -381,12 +568,342 @@ RIB_ret_code_t  command_route(RIB* rtab, char* argv) {
   return rc;
 }
 
+RIB_ret_code_t command_resolve(RIB* rtab, char* argv) {
+  char* destination = argv;
+  if (destination == NULL) {
+    reply("%s\n", USAGE_RSL);
+    return RIB_INVALID_ADDRESS;
+  }
+  Route* result = NULL;
+  Route* connected = NULL;
+  RIB_ret_code_t rc = RIB_match_resolved(rtab, destination, &result, &connected);
+  if (result != NULL) {
+    printRoute(result);
+  }
+  if (connected != NULL) {
+    printRoute(connected);
+  }
+  return rc;
+}
+
+RIB_ret_code_t command_addpath(RIB* rtab, char* argv) {
+  char* destination = argv != NULL ? nextToken(argv, " ") : NULL;
+  char* netmask = destination != NULL ? nextToken(NULL, " ") : NULL;
+  char* gateway = netmask != NULL ? nextToken(NULL, " ") : NULL;
+  char* iface = gateway != NULL ? nextToken(NULL, " ") : NULL;
+  if (iface == NULL) {
+    reply("%s\n", USAGE_APT);
+    return RIB_INVALID_ADDRESS;
+  }
+  return RIB_add_nexthop(rtab, destination, netmask, gateway, iface);
+}
+
+RIB_ret_code_t command_delpath(RIB* rtab, char* argv) {
+  char* destination = argv != NULL ? nextToken(argv, " ") : NULL;
+  char* netmask = destination != NULL ? nextToken(NULL, " ") : NULL;
+  char* gateway = netmask != NULL ? nextToken(NULL, " ") : NULL;
+  if (gateway == NULL) {
+    reply("%s\n", USAGE_DPT);
+    return RIB_INVALID_ADDRESS;
+  }
+  return RIB_delete_nexthop(rtab, destination, netmask, gateway);
+}
+
+RIB_ret_code_t command_flow(RIB* rtab, char* argv) {
+  char* destination = argv != NULL ? nextToken(argv, " ") : NULL;
+  char* flowHash = destination != NULL ? nextToken(NULL, " ") : NULL;
+  if (flowHash == NULL) {
+    reply("%s\n", USAGE_FLW);
+    return RIB_INVALID_ADDRESS;
+  }
+  Route* result = NULL;
+  RIB_nexthop_t nexthop;
+  RIB_ret_code_t rc = RIB_match_flow(rtab, destination, strtoull(flowHash, NULL, 0), &result, &nexthop);
+  if (rc == RIB_NO_ERROR) {
+    printRoute(result);
+    reply("NEXT HOP %s %s\n", nexthop.gateway, nexthop.iface);
+  }
+  return rc;
+}
+
+RIB_ret_code_t command_offer(RIB* rtab, char* argv) {
+  char* destination = argv != NULL ? nextToken(argv, " ") : NULL;
+  char* netmask = destination != NULL ? nextToken(NULL, " ") : NULL;
+  char* gateway = netmask != NULL ? nextToken(NULL, " ") : NULL;
+  char* iface = gateway != NULL ? nextToken(NULL, " ") : NULL;
+  char* distance = iface != NULL ? nextToken(NULL, " ") : NULL;
+  char* metric = distance != NULL ? nextToken(NULL, " ") : NULL;
+  if (metric == NULL) {
+    reply("%s\n", USAGE_OFR);
+    return RIB_INVALID_ADDRESS;
+  }
+  return RIB_add_candidate(rtab, destination, netmask, gateway, iface, atoi(distance), atoi(metric));
+}
+
+RIB_ret_code_t command_retract(RIB* rtab, char* argv) {
+  char* destination = argv != NULL ? nextToken(argv, " ") : NULL;
+  char* netmask = destination != NULL ? nextToken(NULL, " ") : NULL;
+  char* distance = netmask != NULL ? nextToken(NULL, " ") : NULL;
+  if (distance == NULL) {
+    reply("%s\n", USAGE_RTR);
+    return RIB_INVALID_ADDRESS;
+  }
+  return RIB_withdraw_candidate(rtab, destination, netmask, atoi(distance));
+}
+
+RIB_ret_code_t command_dampen(RIB* rtab, char* argv) {
+  if (argv != NULL && strcmp(argv, "ON") == 0) {
+    RIB_dampening_t params;
+    RIB_dampening_init(&params);
+    return RIB_set_dampening(rtab, &params);
+  } else if (argv != NULL && strcmp(argv, "OFF") == 0) {
+    return RIB_set_dampening(rtab, NULL);
+  }
+  reply("%s\n", USAGE_DMN);
+  return RIB_INVALID_ARGUMENT;
+}
+
+RIB_ret_code_t command_penalty(RIB* rtab, char* argv) {
+  char* destination = argv != NULL ? nextToken(argv, " ") : NULL;
+  char* netmask = destination != NULL ? nextToken(NULL, " ") : NULL;
+  if (netmask == NULL) {
+    reply("%s\n", USAGE_PNL);
+    return RIB_INVALID_ADDRESS;
+  }
+  int penalty;
+  int suppressed;
+  RIB_ret_code_t rc = RIB_get_dampening(rtab, destination, netmask, &penalty, &suppressed);
+  if (rc == RIB_NO_ERROR) {
+    reply("Penalty: %d%s\n", penalty, suppressed ? " (suppressed)" : "");
+  }
+  return rc;
+}
+
+RIB_ret_code_t command_addttl(RIB* rtab, char* argv) {
+  char* destination = argv != NULL ? nextToken(argv, " ") : NULL;
+  char* netmask = destination != NULL ? nextToken(NULL, " ") : NULL;
+  char* gateway = netmask != NULL ? nextToken(NULL, " ") : NULL;
+  char* iface = gateway != NULL ? nextToken(NULL, " ") : NULL;
+  char* metric = iface != NULL ? nextToken(NULL, " ") : NULL;
+  char* seconds = metric != NULL ? nextToken(NULL, " ") : NULL;
+  if (seconds == NULL) {
+    reply("%s\n", USAGE_TTL);
+    return RIB_INVALID_ADDRESS;
+  }
+  return RIB_add_with_ttl(rtab, destination, netmask, gateway, iface, atoi(metric), strtoull(seconds, NULL, 10) * 1000);
+}
+
+RIB_ret_code_t command_addsrc(RIB* rtab, char* argv) {
+  char* destination = argv != NULL ? nextToken(argv, " ") : NULL;
+  char* netmask = destination != NULL ? nextToken(NULL, " ") : NULL;
+  char* source = netmask != NULL ? nextToken(NULL, " ") : NULL;
+  char* sourceNetmask = source != NULL ? nextToken(NULL, " ") : NULL;
+  char* gateway = sourceNetmask != NULL ? nextToken(NULL, " ") : NULL;
+  char* iface = gateway != NULL ? nextToken(NULL, " ") : NULL;
+  char* metric = iface != NULL ? nextToken(NULL, " ") : NULL;
+  if (metric == NULL) {
+    reply("%s\n", USAGE_ASR);
+    return RIB_INVALID_ADDRESS;
+  }
+  return RIB_add_source_route(rtab, destination, netmask, source, sourceNetmask, gateway, iface, atoi(metric));
+}
+
+RIB_ret_code_t command_delsrc(RIB* rtab, char* argv) {
+  char* destination = argv != NULL ? nextToken(argv, " ") : NULL;
+  char* netmask = destination != NULL ? nextToken(NULL, " ") : NULL;
+  char* source = netmask != NULL ? nextToken(NULL, " ") : NULL;
+  char* sourceNetmask = source != NULL ? nextToken(NULL, " ") : NULL;
+  if (sourceNetmask == NULL) {
+    reply("%s\n", USAGE_DSR);
+    return RIB_INVALID_ADDRESS;
+  }
+  return RIB_delete_source_route(rtab, destination, netmask, source, sourceNetmask);
+}
+
+RIB_ret_code_t command_routefrom(RIB* rtab, char* argv) {
+  char* destination = argv != NULL ? nextToken(argv, " ") : NULL;
+  char* source = destination != NULL ? nextToken(NULL, " ") : NULL;
+  if (source == NULL) {
+    reply("%s\n", USAGE_RFR);
+    return RIB_INVALID_ADDRESS;
+  }
+  Route* result = NULL;
+  RIB_ret_code_t rc = RIB_match_source(rtab, destination, source, &result);
+  if (rc == RIB_NO_ERROR) {
+    printRoute(result);
+  }
+  return rc;
+}
+
+RIB_ret_code_t command_trace(char* argv) {
+  char* filename = argv != NULL ? nextToken(argv, " ") : NULL;
+  if (filename == NULL || strcmp(filename, CMD_TRC) == 0) {
+    reply("%s\n", USAGE_TRC);
+    return RIB_INVALID_ARGUMENT;
+  }
+  return RIB_trace_dump(filename);
+}
+
+RIB_ret_code_t command_save(RIB* rtab, char* argv) {
+  char* filename = argv != NULL ? nextToken(argv, " ") : NULL;
+  if (filename == NULL || strcmp(filename, CMD_SAV) == 0) {
+    reply("%s\n", USAGE_SAV);
+    return RIB_INVALID_ARGUMENT;
+  }
+  return RIB_save(rtab, filename);
+}
+
+RIB_ret_code_t command_load(RIB* rtab, char* argv) {
+  char* filename = argv != NULL ? nextToken(argv, " ") : NULL;
+  if (filename == NULL || strcmp(filename, CMD_LOD) == 0) {
+    reply("%s\n", USAGE_LOD);
+    return RIB_INVALID_ARGUMENT;
+  }
+  size_t loaded;
+  RIB_ret_code_t rc = RIB_load(rtab, filename, &loaded);
+  reply("Loaded %zu records\n", loaded);
+  return rc;
+}
+
+RIB_ret_code_t command_mrt(RIB* rtab, char* argv) {
+  char* filename = argv != NULL ? nextToken(argv, " ") : NULL;
+  char* peer = filename != NULL ? nextToken(NULL, " ") : NULL;
+  if (filename == NULL || strcmp(filename, CMD_MRT) == 0) {
+    reply("%s\n", USAGE_MRT);
+    return RIB_INVALID_ARGUMENT;
+  }
+  RIB_mrt_options_t options;
+  RIB_mrt_options_init(&options);
+  if (peer != NULL) {
+    options.peer = atoi(peer);
+  }
+  size_t loaded;
+  RIB_ret_code_t rc = RIB_load_mrt(rtab, filename, &options, &loaded);
+  reply("Loaded %zu records\n", loaded);
+  return rc;
+}
+
+/**
+ * Route with its lookup hits, to sort the routes by hits
+ */
+
+typedef struct route_hits_t {
+  const Route* route;
+  uint64_t hits;
+} route_hits_t;
+
+/**
+ * @function compareHits
+ * @description compare two routes by hits, in descending order
+ * @param const void* route_hits_t
+ * @param const void* route_hits_t
+ * @returns int
+ */
+
+int compareHits(const void* a, const void* b) {
+  const uint64_t hitsA = ((const route_hits_t*) a)->hits;
+  const uint64_t hitsB = ((const route_hits_t*) b)->hits;
+  return hitsA < hitsB ? 1 : (hitsA > hitsB ? -1 : 0);
+}
+
 RIB_ret_code_t  command_dump(RIB* rtab, char* argv) {
-  printf("Destination\tNetmask\t\tGateway\t\tIface\tMetric\n");
-  for (int i = 0; i < rtab->entries; i++) {
-    printRoute(rtab->routes[i]);
+  char* mode = argv != NULL ? nextToken(argv, " ") : NULL;
+  int withHits = mode != NULL && strcmp(mode, "HITS") == 0;
+  int top = mode != NULL && strcmp(mode, "TOP") == 0;
+  if (!withHits && !top) {
+    reply("Destination\tNetmask\t\tGateway\t\tIface\tMetric\n");
+    for (size_t i = 0; i < rtab->entries; i++) {
+      printRoute(rtab->routes[i]);
+    }
+    return RIB_NO_ERROR;
+  }
+  size_t count = rtab->entries;
+  if (top) {
+    char* countStr = nextToken(NULL, " ");
+    if (countStr == NULL || atoi(countStr) <= 0) {
+      reply("%s\n", USAGE_DMP);
+      return RIB_INVALID_ARGUMENT;
+    }
+    count = (size_t) atoi(countStr) < count ? (size_t) atoi(countStr) : count;
+  }
+  uint64_t* hits = (uint64_t*) malloc(sizeof(uint64_t) * (rtab->entries + 1));
+  route_hits_t* routes = (route_hits_t*) malloc(sizeof(route_hits_t) * (rtab->entries + 1));
+  if (hits == NULL || routes == NULL) {
+    free(hits);
+    free(routes);
+    return RIB_BAD_ALLOC;
+  }
+  RIB_ret_code_t rc = RIB_collect_hits(rtab, hits);
+  if (rc == RIB_NO_ERROR) {
+    for (size_t i = 0; i < rtab->entries; i++) {
+      routes[i].route = rtab->routes[i];
+      routes[i].hits = hits[i];
+    }
+    if (top) {
+      qsort(routes, rtab->entries, sizeof(route_hits_t), compareHits);
+    }
+    reply("Hits\tDestination\tNetmask\t\tGateway\t\tIface\tMetric\n");
+    for (size_t i = 0; i < count; i++) {
+      reply("%llu\t", (unsigned long long) routes[i].hits);
+      printRoute(routes[i].route);
+    }
+  }
+  free(hits);
+  free(routes);
+  return rc;
+}
+
+RIB_ret_code_t command_publish(RIB* rtab, char* argv) {
+  char* name = argv;
+  if (name == NULL) {
+    reply("%s\n", USAGE_PUB);
+    return RIB_INVALID_ADDRESS;
+  }
+  return RIB_fib_publish(rtab, name);
+}
+
+RIB_ret_code_t command_withdraw(RIB* rtab, char* argv) {
+  char* destination = argv != NULL ? nextToken(argv, " ") : NULL;
+  char* netmask = destination != NULL ? nextToken(NULL, " ") : NULL;
+  if (destination == NULL || netmask == NULL) {
+    reply("%s\n", USAGE_WDR);
+    return RIB_INVALID_ADDRESS;
+  }
+  size_t removed;
+  RIB_ret_code_t rc = RIB_delete_subtree(rtab, destination, netmask, &removed);
+  if (rc == RIB_NO_ERROR) {
+    reply("DELETED %zu ROUTES\n", removed);
+  }
+  return rc;
+}
+
+RIB_ret_code_t command_ifdown(RIB* rtab, char* argv) {
+  char* iface = argv != NULL ? nextToken(argv, " ") : NULL;
+  if (iface == NULL) {
+    reply("%s\n", USAGE_IFD);
+    return RIB_NOT_EXISTS;
+  }
+  size_t removed;
+  RIB_ret_code_t rc = RIB_delete_by_iface(rtab, iface, &removed);
+  if (rc == RIB_NO_ERROR) {
+    reply("DELETED %zu ROUTES\n", removed);
+  }
+  return rc;
+}
+
+RIB_ret_code_t command_nexthop(RIB* rtab, char* argv) {
+  char* gateway = argv != NULL ? nextToken(argv, " ") : NULL;
+  char* newGateway = gateway != NULL ? nextToken(NULL, " ") : NULL;
+  if (gateway == NULL || newGateway == NULL) {
+    reply("%s\n", USAGE_NHP);
+    return RIB_INVALID_ADDRESS;
   }
-  return RIB_NO_ERROR;
+  size_t updated;
+  RIB_ret_code_t rc = RIB_update_gateway_all(rtab, gateway, newGateway, &updated);
+  if (rc == RIB_NO_ERROR) {
+    reply("UPDATED %zu ROUTES\n", updated);
+  }
+  return rc;
 }
 
 /**
@@ -430,186 +947,2239 @@ int parseRoutingTable(RIB* rtab, char* filename) {
 }
 
 /**
- * @function commitRoutingTable
- * @description commit routing table changes to file
+ * @function reloadRoutingTable
+ * @description apply the routing table file to the passed RIB: routes which are still in the file are kept, the others are deleted
  * @param RIB*
  * @param char*
  * @returns int
  */
 
-int commitRoutingTable(RIB* rtab, char* filename) {
-  if (rtab == NULL) {
+int reloadRoutingTable(RIB* rtab, char* filename) {
+  if (RIB_reload_begin(rtab) != RIB_NO_ERROR) {
     return 1;
   }
-  FILE* filePtr;
-  filePtr = fopen(filename, "w");
-  if (!filePtr) {
-    printf("Could not open file %s\n", filename);
+  int ret = parseRoutingTable(rtab, filename);
+  size_t removed = 0;
+  if (RIB_reload_end(rtab, &removed) != RIB_NO_ERROR) {
     return 1;
   }
-  for (int i = 0; i < rtab->entries; i++) {
-    Route* currRoute = rtab->routes[i];
-    char line[256];
-    sprintf(line, "%s %s %s %s %d\n", currRoute->destination, currRoute->netmask, currRoute->gateway, currRoute->iface, currRoute->metric);
-    fwrite(&line, sizeof(char), strlen(line), filePtr);
-  }
-  fclose(filePtr);
-  return 0;
+  reply("DELETED %zu ROUTES\n", removed);
+  return ret;
 }
 
-int main(int argc, char* argv[]) {
+#ifdef __linux__
 
-  //Get command
-  if (argc < 2) {
-    printf("%s\n", USAGE);
-    return 1;
-  }
-  //Initialize routing table
-  RIB* rtab = NULL;
-  RIB_ret_code_t rc = RIB_init(&rtab);
-  if (rc != RIB_NO_ERROR) {
-    printf("COULD NOT INITIALIZE RIB!\n");
-    return rc;
+/**
+ * @function watchRoutingTable
+ * @description watch the directory of the routing table file for changes (editors usually replace the file)
+ * @param char* filename
+ * @returns int: inotify file descriptor; -1 if it failed
+ */
+
+int watchRoutingTable(char* filename) {
+  int inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotifyFd == -1) {
+    return -1;
   }
-  //Parse routing table
-  char* routingTableFile = argv[1];
-  if (parseRoutingTable(rtab, routingTableFile) != 0) {
-    printf("COULD NOT PARSE ROUTING TABLE!\n");
-    RIB_free(rtab);
-    return 1;
+  char* path = strdup(filename);
+  if (path == NULL || inotify_add_watch(inotifyFd, dirname(path), IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+    free(path);
+    close(inotifyFd);
+    return -1;
   }
+  free(path);
+  return inotifyFd;
+}
 
-  int quitCalled = 0;
+/**
+ * @function routingTableChanged
+ * @description consume pending inotify events and returns whether the routing table file has been written or replaced
+ * @param int inotifyFd
+ * @param char* filename
+ * @returns int
+ */
 
-  while (!quitCalled) {
-    size_t bufSize = 255;
-    char* inputLine = (char*) malloc(sizeof(char) * bufSize);
-    char* origInputLine = inputLine;
-    printf("> ");
-    size_t len = getline(&inputLine, &bufSize, stdin);
-    //remove CRLF
-    if (inputLine[len - 1] == 0x0a) {
-      inputLine[len - 1] = 0x00;
-    }
-    if (inputLine[len - 2] == 0x0d) {
-      inputLine[len - 2] = 0x00;
-    }
-    route_cmd_t command;
-    if (strchr(inputLine, ' ') == NULL) {
-      command = getCommand(inputLine);
-    } else {
-      char* commandStr = strtok(inputLine, " ");
-      inputLine = strtok(NULL, "");
-      command = getCommand(commandStr); 
-    }
-    switch (command) {
-      case UNKNOWN:
-      case HELP: {
-        usage();
-        break;
-      }
-      case QUIT: {
-        quitCalled = 1;
-        printf("CLOSING RIB...\n");
-        break;
-      }
-      case ADD: {
-        RIB_ret_code_t ret;
-        if ((ret = command_add(rtab, inputLine)) != RIB_NO_ERROR) {
-          printf("ERROR: %s\n", RIB_get_error_msg(ret));
-        } else {
-          printf("OK\n");
-        }
-        break;
-      }
-      case DELETE: {
-        RIB_ret_code_t ret;
-        if ((ret = command_delete(rtab, inputLine)) != RIB_NO_ERROR) {
-          printf("ERROR: %s\n", RIB_get_error_msg(ret));
-        } else {
-          printf("OK\n");
-        }
-        break;
-      }
-      case UPDATE: {
-        RIB_ret_code_t ret;
-        if ((ret = command_update(rtab, inputLine)) != RIB_NO_ERROR) {
-          printf("ERROR: %s\n", RIB_get_error_msg(ret));
-        } else {
-          printf("OK\n");
-        }
-        break;
-      }
-      case CLEAR: {
-        RIB_ret_code_t ret;
-        if ((ret = command_clear(rtab, inputLine)) != RIB_NO_ERROR) {
-          printf("ERROR: %s\n", RIB_get_error_msg(ret));
-        } else {
-          printf("OK\n");
-        }
-        break;
-      }
-      case SELECT: {
-        RIB_ret_code_t ret;
-        if ((ret = command_select(rtab, inputLine)) != RIB_NO_ERROR) {
-          printf("ERROR: %s\n", RIB_get_error_msg(ret));
-        } else {
-          printf("OK\n");
-        }
-        break;
-      }
-      case ROUTE: {
-        RIB_ret_code_t ret;
-        if ((ret = command_route(rtab, inputLine)) != RIB_NO_ERROR) {
-          printf("ERROR: %s\n", RIB_get_error_msg(ret));
-        } else {
-          printf("OK\n");
-        }
-        break;
-      }
-      case DUMP: {
-        RIB_ret_code_t ret;
-        if ((ret = command_dump(rtab, inputLine)) != RIB_NO_ERROR) {
-          printf("ERROR: %s\n", RIB_get_error_msg(ret));
-        } else {
-          printf("OK\n");
-        }
-        break;
-      }
-      case COMMIT: {
-        int ret;
-        if ((ret = commitRoutingTable(rtab, routingTableFile)) != 0 ) {
-          printf("ERROR: %s\n", RIB_get_error_msg(ret));
-        } else {
-          printf("OK\n");
-        }
-        break;
-      }
-      case ROLLBACK: {
-        RIB_free(rtab);
-        rc = RIB_init(&rtab);
-        if (rc != RIB_NO_ERROR) {
-          printf("ERROR: %d\n", -1);
-          return rc;
-        }
-        if (parseRoutingTable(rtab, routingTableFile) != 0) {
-          printf("ERROR: %d\n", -1);
-          RIB_free(rtab);
-          return 1;
-        }
-        printf("OK\n");
-        break;
+int routingTableChanged(int inotifyFd, char* filename) {
+  char* path = strdup(filename);
+  if (path == NULL) {
+    return 0;
+  }
+  const char* name = basename(path);
+  int changed = 0;
+  char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  ssize_t len;
+  while ((len = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+    for (char* ptr = buffer; ptr < buffer + len; ) {
+      const struct inotify_event* event = (const struct inotify_event*) ptr;
+      if (event->len > 0 && strcmp(event->name, name) == 0) {
+        changed = 1;
       }
+      ptr += sizeof(struct inotify_event) + event->len;
     }
-    free(origInputLine);
   }
+  free(path);
+  return changed;
+}
 
-  //Commit changes
-  int ret;
-  if ((ret = commitRoutingTable(rtab, routingTableFile)) != 0) {
-    printf("COMMIT FAILED (%d)\n", ret);
-  }
-  //Free RIB table
+#endif
+
+/**
+ * Consistent copy of the routing table, written to file by the committer.
+ * Strings of all the routes are copied in a single buffer.
+ */
+
+typedef struct snapshot_route_t {
+  const char* destination;
+  const char* netmask;
+  const char* gateway;
+  const char* iface;
+  int metric;
+} snapshot_route_t;
+
+typedef struct snapshot_t {
+  snapshot_route_t* routes;
+  size_t entries;
+  char* strings;
+} snapshot_t;
+
+/**
+ * Background committer: a single thread writes the latest snapshot to the routing table file.
+ * Snapshots taken while a commit is in flight replace each other, so only the newest one is written next.
+ */
+
+typedef struct committer_t {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  char* filename;
+  snapshot_t* pending;  //Next snapshot to write; NULL if none
+  int writing;          //Whether a snapshot is being written
+  int failed;           //Last background commit failed (not reported yet)
+  ino_t committed;      //Inode of the last file written by the committer
+  int stop;
+} committer_t;
+
+/**
+ * @function freeSnapshot
+ * @description free a routing table snapshot; NULL is allowed
+ * @param snapshot_t*
+ */
+
+void freeSnapshot(snapshot_t* snapshot) {
+  if (snapshot == NULL) {
+    return;
+  }
+  free(snapshot->routes);
+  free(snapshot->strings);
+  free(snapshot);
+}
+
+/**
+ * @function copyString
+ * @description copy a string to the snapshot buffer
+ * @param char** ptr: position in the buffer; moved after the copy
+ * @param const char* str
+ * @returns const char*: the copy
+ */
+
+static inline const char* copyString(char** ptr, const char* str) {
+  char* copy = *ptr;
+  size_t len = strlen(str) + 1;
+  memcpy(copy, str, len);
+  *ptr += len;
+  return copy;
+}
+
+/**
+ * @function takeSnapshot
+ * @description copy the routes of the routing table; no I/O and no formatting, so the table is blocked only for the copy
+ * @param RIB*
+ * @returns snapshot_t*: NULL if allocation failed
+ */
+
+snapshot_t* takeSnapshot(RIB* rtab) {
+  snapshot_t* snapshot = (snapshot_t*) calloc(1, sizeof(snapshot_t));
+  if (snapshot == NULL) {
+    return NULL;
+  }
+  size_t size = 1;
+  for (size_t i = 0; i < rtab->entries; i++) {
+    const Route* route = rtab->routes[i];
+    size += strlen(route->destination) + strlen(route->netmask) + strlen(route->gateway) + strlen(route->iface) + 4;
+  }
+  snapshot->routes = (snapshot_route_t*) malloc(sizeof(snapshot_route_t) * (rtab->entries > 0 ? rtab->entries : 1));
+  snapshot->strings = (char*) malloc(size);
+  if (snapshot->routes == NULL || snapshot->strings == NULL) {
+    freeSnapshot(snapshot);
+    return NULL;
+  }
+  char* ptr = snapshot->strings;
+  for (size_t i = 0; i < rtab->entries; i++) {
+    const Route* route = rtab->routes[i];
+    snapshot_route_t* copy = &snapshot->routes[i];
+    copy->destination = copyString(&ptr, route->destination);
+    copy->netmask = copyString(&ptr, route->netmask);
+    copy->gateway = copyString(&ptr, route->gateway);
+    copy->iface = copyString(&ptr, route->iface);
+    copy->metric = route->metric;
+  }
+  snapshot->entries = rtab->entries;
+  return snapshot;
+}
+
+/**
+ * @function writeSnapshot
+ * @description write a snapshot to a temporary file, sync it and rename it to the routing table file,
+ *              so the routing table file is always complete
+ * @param const snapshot_t*
+ * @param const char* filename
+ * @param ino_t* inode: inode of the written file (may be NULL)
+ * @returns int
+ */
+
+int writeSnapshot(const snapshot_t* snapshot, const char* filename, ino_t* inode) {
+  size_t len = strlen(filename);
+  char* tmpFilename = (char*) malloc(len + 5);
+  if (tmpFilename == NULL) {
+    return 1;
+  }
+  memcpy(tmpFilename, filename, len);
+  memcpy(tmpFilename + len, ".tmp", 5);
+  FILE* filePtr = fopen(tmpFilename, "w");
+  if (!filePtr) {
+    free(tmpFilename);
+    return 1;
+  }
+  int ret = 0;
+  for (size_t i = 0; i < snapshot->entries && ret == 0; i++) {
+    const snapshot_route_t* route = &snapshot->routes[i];
+    if (fprintf(filePtr, "%s %s %s %s %d\n", route->destination, route->netmask, route->gateway, route->iface, route->metric) < 0) {
+      ret = 1;
+    }
+  }
+  struct stat info;
+  if (fflush(filePtr) != 0 || fsync(fileno(filePtr)) != 0 || fstat(fileno(filePtr), &info) != 0) {
+    ret = 1;
+  } else if (inode != NULL) {
+    *inode = info.st_ino;
+  }
+  if (fclose(filePtr) != 0) {
+    ret = 1;
+  }
+  if (ret == 0 && rename(tmpFilename, filename) != 0) {
+    ret = 1;
+  }
+  if (ret != 0) {
+    unlink(tmpFilename);
+  }
+  free(tmpFilename);
+  return ret;
+}
+
+/**
+ * @function commitRoutingTable
+ * @description commit routing table changes to file
+ * @param RIB*
+ * @param char*
+ * @returns int
+ */
+
+int commitRoutingTable(RIB* rtab, char* filename) {
+  if (rtab == NULL) {
+    return 1;
+  }
+  snapshot_t* snapshot = takeSnapshot(rtab);
+  if (snapshot == NULL) {
+    return 1;
+  }
+  int ret = writeSnapshot(snapshot, filename, NULL);
+  if (ret != 0) {
+    printf("Could not write file %s\n", filename);
+  }
+  freeSnapshot(snapshot);
+  return ret;
+}
+
+/**
+ * @function committerMain
+ * @description committer thread: write the pending snapshots until stopped
+ * @param void* committer_t
+ * @returns void*
+ */
+
+void* committerMain(void* arg) {
+  committer_t* committer = (committer_t*) arg;
+  pthread_mutex_lock(&committer->lock);
+  while (1) {
+    while (committer->pending == NULL && !committer->stop) {
+      pthread_cond_wait(&committer->changed, &committer->lock);
+    }
+    if (committer->pending == NULL) {
+      break;
+    }
+    snapshot_t* snapshot = committer->pending;
+    committer->pending = NULL;
+    committer->writing = 1;
+    pthread_mutex_unlock(&committer->lock);
+    ino_t inode;
+    int ret = writeSnapshot(snapshot, committer->filename, &inode);
+    freeSnapshot(snapshot);
+    pthread_mutex_lock(&committer->lock);
+    committer->writing = 0;
+    if (ret != 0) {
+      committer->failed = 1;
+    } else {
+      committer->committed = inode;
+    }
+    pthread_cond_broadcast(&committer->changed);
+  }
+  pthread_mutex_unlock(&committer->lock);
+  return NULL;
+}
+
+/**
+ * @function startCommitter
+ * @description start the background committer of the routing table file
+ * @param committer_t*
+ * @param char* filename
+ * @returns int
+ */
+
+int startCommitter(committer_t* committer, char* filename) {
+  committer->filename = filename;
+  committer->pending = NULL;
+  committer->writing = 0;
+  committer->failed = 0;
+  committer->committed = 0;
+  committer->stop = 0;
+  pthread_mutex_init(&committer->lock, NULL);
+  pthread_cond_init(&committer->changed, NULL);
+  if (pthread_create(&committer->thread, NULL, committerMain, committer) != 0) {
+    pthread_cond_destroy(&committer->changed);
+    pthread_mutex_destroy(&committer->lock);
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * @function commitInBackground
+ * @description snapshot the routing table and hand it to the committer; if a commit is already waiting, it's replaced
+ * @param committer_t*
+ * @param RIB*
+ * @returns int: 1 if the snapshot couldn't be taken
+ */
+
+int commitInBackground(committer_t* committer, RIB* rtab) {
+  snapshot_t* snapshot = takeSnapshot(rtab);
+  if (snapshot == NULL) {
+    return 1;
+  }
+  pthread_mutex_lock(&committer->lock);
+  //Coalesce with the commit which hasn't been started yet
+  freeSnapshot(committer->pending);
+  committer->pending = snapshot;
+  pthread_cond_broadcast(&committer->changed);
+  pthread_mutex_unlock(&committer->lock);
+  return 0;
+}
+
+/**
+ * @function commitFailed
+ * @description returns whether a background commit failed since the last call
+ * @param committer_t*
+ * @returns int
+ */
+
+int commitFailed(committer_t* committer) {
+  pthread_mutex_lock(&committer->lock);
+  int failed = committer->failed;
+  committer->failed = 0;
+  pthread_mutex_unlock(&committer->lock);
+  return failed;
+}
+
+/**
+ * @function waitCommitter
+ * @description wait until the pending commits have been written
+ * @param committer_t*
+ */
+
+void waitCommitter(committer_t* committer) {
+  pthread_mutex_lock(&committer->lock);
+  while (committer->pending != NULL || committer->writing) {
+    pthread_cond_wait(&committer->changed, &committer->lock);
+  }
+  pthread_mutex_unlock(&committer->lock);
+}
+
+/**
+ * @function isCommittedFile
+ * @description returns whether the routing table file is the last one written by the committer
+ * @param committer_t*
+ * @returns int
+ */
+
+int isCommittedFile(committer_t* committer) {
+  struct stat info;
+  if (stat(committer->filename, &info) != 0) {
+    return 0;
+  }
+  pthread_mutex_lock(&committer->lock);
+  int committed = committer->committed != 0 && info.st_ino == committer->committed;
+  pthread_mutex_unlock(&committer->lock);
+  return committed;
+}
+
+/**
+ * @function stopCommitter
+ * @description wait for the pending commits and stop the committer
+ * @param committer_t*
+ */
+
+void stopCommitter(committer_t* committer) {
+  pthread_mutex_lock(&committer->lock);
+  committer->stop = 1;
+  pthread_cond_broadcast(&committer->changed);
+  pthread_mutex_unlock(&committer->lock);
+  pthread_join(committer->thread, NULL);
+  pthread_cond_destroy(&committer->changed);
+  pthread_mutex_destroy(&committer->lock);
+}
+
+/**
+ * @function runCommand
+ * @description run a command line of the router and print its reply
+ * @param RIB*
+ * @param committer_t*
+ * @param char* routingTableFile
+ * @param char* inputLine: command and arguments; tokenized in place
+ * @returns int: 1 if QUIT was called; -1 if the routing table couldn't be reloaded
+ */
+
+int runCommand(RIB* rtab, committer_t* committer, char* routingTableFile, char* inputLine) {
+  int quit = 0;
+  route_cmd_t command;
+  if (strchr(inputLine, ' ') == NULL) {
+    command = getCommand(inputLine);
+  } else {
+    char* commandStr = nextToken(inputLine, " ");
+    inputLine = nextToken(NULL, "");
+    command = getCommand(commandStr); 
+  }
+  switch (command) {
+    case UNKNOWN:
+    case HELP: {
+      usage();
+      break;
+    }
+    case QUIT: {
+      quit = 1;
+      reply("CLOSING RIB...\n");
+      break;
+    }
+    case ADD: {
+      RIB_ret_code_t ret;
+      if ((ret = command_add(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case DELETE: {
+      RIB_ret_code_t ret;
+      if ((ret = command_delete(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case UPDATE: {
+      RIB_ret_code_t ret;
+      if ((ret = command_update(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case CLEAR: {
+      RIB_ret_code_t ret;
+      if ((ret = command_clear(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case SELECT: {
+      RIB_ret_code_t ret;
+      if ((ret = command_select(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case ROUTE: {
+      RIB_ret_code_t ret;
+      if ((ret = command_route(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case PUBLISH: {
+      RIB_ret_code_t ret;
+      if ((ret = command_publish(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case WITHDRAW: {
+      RIB_ret_code_t ret;
+      if ((ret = command_withdraw(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case IFDOWN: {
+      RIB_ret_code_t ret;
+      if ((ret = command_ifdown(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case NEXTHOP: {
+      RIB_ret_code_t ret;
+      if ((ret = command_nexthop(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case RESOLVE: {
+      RIB_ret_code_t ret;
+      if ((ret = command_resolve(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case ADDPATH: {
+      RIB_ret_code_t ret;
+      if ((ret = command_addpath(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case DELPATH: {
+      RIB_ret_code_t ret;
+      if ((ret = command_delpath(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case FLOW: {
+      RIB_ret_code_t ret;
+      if ((ret = command_flow(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case OFFER: {
+      RIB_ret_code_t ret;
+      if ((ret = command_offer(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case RETRACT: {
+      RIB_ret_code_t ret;
+      if ((ret = command_retract(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case DAMPEN: {
+      RIB_ret_code_t ret;
+      if ((ret = command_dampen(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case PENALTY: {
+      RIB_ret_code_t ret;
+      if ((ret = command_penalty(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case ADDTTL: {
+      RIB_ret_code_t ret;
+      if ((ret = command_addttl(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case ADDSRC: {
+      RIB_ret_code_t ret;
+      if ((ret = command_addsrc(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case DELSRC: {
+      RIB_ret_code_t ret;
+      if ((ret = command_delsrc(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case ROUTEFROM: {
+      RIB_ret_code_t ret;
+      if ((ret = command_routefrom(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case TRACE: {
+      RIB_ret_code_t ret;
+      if ((ret = command_trace(inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case SAVE: {
+      RIB_ret_code_t ret;
+      if ((ret = command_save(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case LOAD: {
+      RIB_ret_code_t ret;
+      if ((ret = command_load(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case MRT: {
+      RIB_ret_code_t ret;
+      if ((ret = command_mrt(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case DUMP: {
+      RIB_ret_code_t ret;
+      if ((ret = command_dump(rtab, inputLine)) != RIB_NO_ERROR) {
+        reply("ERROR: %s\n", RIB_get_error_msg(ret));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case COMMIT: {
+      //The file is written by the committer while commands are still accepted
+      if (commitInBackground(committer, rtab) != 0) {
+        reply("ERROR: %s\n", RIB_get_error_msg(RIB_BAD_ALLOC));
+      } else {
+        reply("OK\n");
+      }
+      break;
+    }
+    case ROLLBACK: {
+      //Only the routes which differ from the file are changed; the file must contain the commits in flight
+      waitCommitter(committer);
+      if (reloadRoutingTable(rtab, routingTableFile) != 0) {
+        reply("ERROR: %d\n", -1);
+        return -1;
+      }
+      reply("OK\n");
+      break;
+    }
+  }
+  if (commitFailed(committer)) {
+    reply("COMMIT FAILED\n");
+  }
+  return quit;
+}
+
+#ifdef __linux__
+
+/**
+ * Router server: an event loop multiplexes the clients of the unix and tcp sockets with epoll;
+ * read only commands run concurrently on the worker threads, commands changing the RIB run one at a time on the writer thread.
+ * The RIB is shared behind a read-write lock; after each change the writer rebuilds the lookup tables (RIB_prepare),
+ * so the lookups of the workers only read it. Until a failed rebuild is retried successfully, lookups are refused.
+ * Each client has at most one request in flight, so its replies keep the order of its commands; the commands it pipelines wait in its input buffer.
+ */
+
+#define SERVER_MAX_LINE 65536       //Longest command line accepted from a client
+#define SERVER_MAX_INPUT 131072     //Input buffer of a client; pipelined commands beyond it are read once the previous ones run
+#define SERVER_MAX_PENDING 1048576  //Unsent reply bytes after which the commands of a client aren't run until its replies are sent
+#define SERVER_EXPIRE_INTERVAL 1    //Seconds between the expirations of TTLs and dampening run by the writer when idle
+
+/**
+ * Binary lookup protocol, for the clients which look up many addresses: no text is parsed or formatted per lookup.
+ * A client switches its connection to it sending the 8 bytes hello BINARY_HELLO, which the server echoes; then it sends
+ * request frames and receives a response frame for each one, in order. Requests may be pipelined. Integers are little endian.
+ *
+ * Request:  uint32 length (of the whole frame), uint32 request id, uint8 type (BINARY_LOOKUP), uint8 ip version (4/6),
+ *           uint16 count (up to BINARY_MAX_COUNT), then count addresses in network byte order (4 or 16 bytes each)
+ * Response: uint32 length, uint32 request id (copied from the request), uint8 type, uint8 status (RIB_ret_code_t),
+ *           uint16 count, uint32 next hops, then count uint32 next hop ids (BINARY_NO_ROUTE if no route matched),
+ *           then the next hops sent for the first time on the connection: uint32 id, uint8 ip version,
+ *           uint8 interface length, gateway (4 or 16 bytes), interface (not terminated)
+ *
+ * Next hop ids are assigned by the server for each connection and never change, so clients keep the table of the next hops
+ * they've been sent and each next hop is sent once.
+ */
+
+#define BINARY_HELLO "\0RIBLKP\1"
+#define BINARY_HELLO_SIZE 8
+#define BINARY_LOOKUP 1
+#define BINARY_MAX_COUNT 4096
+#define BINARY_REQUEST_HEADER 12
+#define BINARY_RESPONSE_HEADER 16
+#define BINARY_MAX_FRAME (BINARY_REQUEST_HEADER + BINARY_MAX_COUNT * 16)
+#define BINARY_NO_ROUTE 0xFFFFFFFF
+
+typedef enum endpoint_kind_t {
+  ENDPOINT_LISTENER,
+  ENDPOINT_CLIENT,
+  ENDPOINT_DONE,
+  ENDPOINT_SIGNAL,
+  ENDPOINT_WATCH
+} endpoint_kind_t;
+
+/**
+ * File descriptor registered to epoll (epoll events point to it)
+ */
+
+typedef struct endpoint_t {
+  endpoint_kind_t kind;
+  int fd;
+} endpoint_t;
+
+/**
+ * Next hops sent to a binary client: a dictionary from gateway and interface to the next hop id,
+ * plus a cache of the matched routes, valid until the RIB changes (version)
+ */
+
+typedef struct client_nexthop_t {
+  char* gateway;      //Gateway and interface share the buffer
+  char* iface;
+  int ipv;
+  uint64_t hash;
+} client_nexthop_t;
+
+typedef struct route_slot_t {
+  const Route* route;
+  uint32_t id;
+  uint64_t version;   //Version of the RIB in which the slot was filled; slots of previous versions (and 0) are free
+} route_slot_t;
+
+typedef struct nexthop_table_t {
+  client_nexthop_t* nexthops; //By id
+  size_t count;
+  uint32_t* slots;            //Ids; BINARY_NO_ROUTE if free
+  size_t slotCount;
+  route_slot_t* routes;
+  size_t routeCount;
+  size_t routeCapacity;
+  uint64_t version;
+} nexthop_table_t;
+
+typedef struct client_t {
+  endpoint_t endpoint;
+  char* input;        //Received bytes not run yet
+  size_t inputLen;
+  size_t inputSize;
+  char* output;       //Replies not sent yet
+  size_t outputLen;
+  size_t outputSize;
+  size_t outputSent;
+  uint32_t events;    //Registered epoll events
+  int busy;           //A command of the client is running
+  int eof;            //The client shut down its side of the connection
+  int closing;        //Close once the replies have been sent (QUIT or end of the input)
+  int closed;         //Disconnected; freed by the event loop once its running command completes
+  int binary;         //Binary lookup protocol
+  nexthop_table_t* nexthops; //Next hops sent to a binary client; used by the thread running its request
+  struct client_t* prev;
+  struct client_t* next;     //Next connected client; next released client once closed
+} client_t;
+
+typedef struct request_t {
+  client_t* client;   //NULL for the reloads of the routing table file
+  char* line;         //Command line; lookup frames for binary requests
+  size_t lineLen;
+  int binary;
+  char* reply;
+  size_t replyLen;
+  struct request_t* next;
+} request_t;
+
+typedef struct request_queue_t {
+  request_t* head;
+  request_t* tail;
+  pthread_cond_t ready;
+} request_queue_t;
+
+typedef struct server_t {
+  RIB* rtab;
+  committer_t* committer;
+  char* routingTableFile;
+  pthread_rwlock_t tableLock;
+  pthread_mutex_t lock;     //Queues, completed requests and stop
+  request_queue_t readers;
+  request_queue_t writer;
+  request_t* done;          //Completed requests, handed back to the event loop
+  endpoint_t doneEvent;     //eventfd signaled when requests complete
+  int stop;
+  int epollFd;
+  client_t* clients;        //Connected clients (event loop only)
+  client_t* released;       //Disconnected clients to free after the current batch of events
+  uint64_t version;         //Incremented by each change of the RIB; starts at 1
+  RIB_ret_code_t prepared;  //Result of the last RIB_prepare; lookups are refused until it succeeds (written under the table write lock)
+  pthread_t* workers;
+  size_t workerCount;
+  pthread_t writerThread;
+} server_t;
+
+/**
+ * @function isReadCommand
+ * @description returns whether a command only reads the RIB, so it can run concurrently with other read commands;
+ *              RESOLVE and PENALTY update caches and dampening state
+ * @param route_cmd_t
+ * @returns int
+ */
+
+int isReadCommand(route_cmd_t command) {
+  switch (command) {
+    case HELP:
+    case UNKNOWN:
+    case SELECT:
+    case ROUTE:
+    case DUMP:
+    case COMMIT:
+    case FLOW:
+    case ROUTEFROM:
+    case TRACE:
+    case SAVE:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @function isLookupCommand
+ * @description returns whether a read command looks up the lookup tables, which must have been rebuilt by RIB_prepare
+ * @param route_cmd_t
+ * @returns int
+ */
+
+int isLookupCommand(route_cmd_t command) {
+  return command == ROUTE || command == FLOW || command == ROUTEFROM;
+}
+
+/**
+ * @function peekCommand
+ * @description returns the command of a command line, without changing it
+ * @param const char* line
+ * @returns route_cmd_t
+ */
+
+route_cmd_t peekCommand(const char* line) {
+  char commandStr[16];
+  size_t len = strcspn(line, " ");
+  if (len >= sizeof(commandStr)) {
+    return UNKNOWN;
+  }
+  memcpy(commandStr, line, len);
+  commandStr[len] = 0x00;
+  return getCommand(commandStr);
+}
+
+/**
+ * @function pushRequest
+ * @description append a request to a queue; the server lock must be held
+ * @param request_queue_t*
+ * @param request_t*
+ */
+
+void pushRequest(request_queue_t* queue, request_t* request) {
+  request->next = NULL;
+  if (queue->tail != NULL) {
+    queue->tail->next = request;
+  } else {
+    queue->head = request;
+  }
+  queue->tail = request;
+  pthread_cond_signal(&queue->ready);
+}
+
+/**
+ * @function popRequest
+ * @description remove the first request of a queue; the server lock must be held
+ * @param request_queue_t*
+ * @returns request_t*: NULL if the queue is empty
+ */
+
+request_t* popRequest(request_queue_t* queue) {
+  request_t* request = queue->head;
+  if (request != NULL) {
+    queue->head = request->next;
+    if (queue->head == NULL) {
+      queue->tail = NULL;
+    }
+  }
+  return request;
+}
+
+/**
+ * @function freeRequest
+ * @description free a request
+ * @param request_t*
+ */
+
+void freeRequest(request_t* request) {
+  free(request->line);
+  free(request->reply);
+  free(request);
+}
+
+/**
+ * @function le32
+ * @description read a little endian 32 bits integer of the binary protocol
+ * @param const unsigned char* ptr
+ * @returns uint32_t
+ */
+
+static inline uint32_t le32(const unsigned char* ptr) {
+  uint32_t value;
+  memcpy(&value, ptr, sizeof(value));
+  return le32toh(value);
+}
+
+/**
+ * @function putLe32
+ * @description write a little endian 32 bits integer of the binary protocol
+ * @param unsigned char* ptr
+ * @param uint32_t value
+ */
+
+static inline void putLe32(unsigned char* ptr, uint32_t value) {
+  value = htole32(value);
+  memcpy(ptr, &value, sizeof(value));
+}
+
+/**
+ * @function freeNexthopTable
+ * @description free the next hop table of a binary client; NULL is allowed
+ * @param nexthop_table_t*
+ */
+
+void freeNexthopTable(nexthop_table_t* table) {
+  if (table == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < table->count; i++) {
+    free(table->nexthops[i].gateway);
+  }
+  free(table->nexthops);
+  free(table->slots);
+  free(table->routes);
+  free(table);
+}
+
+/**
+ * @function hashNexthop
+ * @description FNV-1a hash of a next hop (gateway and interface)
+ * @param const char* gateway
+ * @param const char* iface
+ * @returns uint64_t
+ */
+
+static inline uint64_t hashNexthop(const char* gateway, const char* iface) {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (const char* ptr = gateway; *ptr != 0x00; ptr++) {
+    hash = (hash ^ (unsigned char) *ptr) * 0x100000001B3ULL;
+  }
+  hash = (hash ^ 0xFF) * 0x100000001B3ULL;
+  for (const char* ptr = iface; *ptr != 0x00; ptr++) {
+    hash = (hash ^ (unsigned char) *ptr) * 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+/**
+ * @function nexthopSlot
+ * @description returns the slot of a next hop in the dictionary: the slot holding it, or the empty slot where it belongs
+ * @param const nexthop_table_t*
+ * @param uint64_t hash
+ * @param const char* gateway
+ * @param const char* iface
+ * @returns size_t
+ */
+
+static size_t nexthopSlot(const nexthop_table_t* table, uint64_t hash, const char* gateway, const char* iface) {
+  const size_t mask = table->slotCount - 1;
+  for (size_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+    const uint32_t id = table->slots[slot];
+    if (id == BINARY_NO_ROUTE) {
+      return slot;
+    }
+    const client_nexthop_t* nexthop = &table->nexthops[id];
+    if (nexthop->hash == hash && strcmp(nexthop->gateway, gateway) == 0 && strcmp(nexthop->iface, iface) == 0) {
+      return slot;
+    }
+  }
+}
+
+/**
+ * @function addNexthop
+ * @description returns the id of the next hop of a route, adding it to the dictionary if the client hasn't been sent it yet
+ * @param nexthop_table_t*
+ * @param const Route*
+ * @returns uint32_t: BINARY_NO_ROUTE if allocation failed
+ */
+
+static uint32_t addNexthop(nexthop_table_t* table, const Route* route) {
+  //Keep the dictionary at most half full
+  if ((table->count + 1) * 2 > table->slotCount) {
+    size_t slotCount = table->slotCount > 0 ? table->slotCount * 2 : 64;
+    uint32_t* slots = (uint32_t*) malloc(sizeof(uint32_t) * slotCount);
+    client_nexthop_t* nexthops = (client_nexthop_t*) realloc(table->nexthops, sizeof(client_nexthop_t) * (slotCount / 2));
+    if (slots == NULL || nexthops == NULL) {
+      free(slots);
+      if (nexthops != NULL) {
+        table->nexthops = nexthops;
+      }
+      return BINARY_NO_ROUTE;
+    }
+    memset(slots, 0xFF, sizeof(uint32_t) * slotCount);
+    free(table->slots);
+    table->slots = slots;
+    table->slotCount = slotCount;
+    table->nexthops = nexthops;
+    for (uint32_t id = 0; id < table->count; id++) {
+      const client_nexthop_t* nexthop = &table->nexthops[id];
+      table->slots[nexthopSlot(table, nexthop->hash, nexthop->gateway, nexthop->iface)] = id;
+    }
+  }
+  const uint64_t hash = hashNexthop(route->gateway, route->iface);
+  const size_t slot = nexthopSlot(table, hash, route->gateway, route->iface);
+  if (table->slots[slot] != BINARY_NO_ROUTE) {
+    return table->slots[slot];
+  }
+  //Gateway and interface share a buffer
+  const size_t gatewayLen = strlen(route->gateway) + 1;
+  const size_t ifaceLen = strlen(route->iface) + 1;
+  char* strings = (char*) malloc(gatewayLen + ifaceLen);
+  if (strings == NULL) {
+    return BINARY_NO_ROUTE;
+  }
+  client_nexthop_t* nexthop = &table->nexthops[table->count];
+  nexthop->gateway = strings;
+  nexthop->iface = strings + gatewayLen;
+  memcpy(nexthop->gateway, route->gateway, gatewayLen);
+  memcpy(nexthop->iface, route->iface, ifaceLen);
+  nexthop->ipv = route->ipv;
+  nexthop->hash = hash;
+  table->slots[slot] = (uint32_t) table->count;
+  return (uint32_t) table->count++;
+}
+
+/**
+ * @function routeSlot
+ * @description returns the slot of a route in the route cache: the slot holding it, or the free slot where it belongs.
+ *              Slots of the previous versions of the RIB are free
+ * @param const nexthop_table_t*
+ * @param const Route*
+ * @returns size_t
+ */
+
+static inline size_t routeSlot(const nexthop_table_t* table, const Route* route) {
+  const size_t mask = table->routeCapacity - 1;
+  size_t slot = (size_t) ((((uintptr_t) route >> 4) * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+  while (table->routes[slot].version == table->version && table->routes[slot].route != route) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+/**
+ * @function growRouteCache
+ * @description double the route cache
+ * @param nexthop_table_t*
+ * @returns int: 1 if allocation failed
+ */
+
+static int growRouteCache(nexthop_table_t* table) {
+  route_slot_t* old = table->routes;
+  const size_t oldCapacity = table->routeCapacity;
+  table->routeCapacity = oldCapacity > 0 ? oldCapacity * 2 : 1024;
+  table->routes = (route_slot_t*) calloc(table->routeCapacity, sizeof(route_slot_t));
+  if (table->routes == NULL) {
+    table->routes = old;
+    table->routeCapacity = oldCapacity;
+    return 1;
+  }
+  for (size_t i = 0; i < oldCapacity; i++) {
+    if (old[i].version == table->version) {
+      table->routes[routeSlot(table, old[i].route)] = old[i];
+    }
+  }
+  free(old);
+  return 0;
+}
+
+/**
+ * @function nexthopId
+ * @description returns the id of the next hop of a route for a binary client. The routes resolved since the last change
+ *              of the RIB are cached by address (routes may be freed by a change), so the strings of a route are hashed once
+ * @param nexthop_table_t*
+ * @param uint64_t version: version of the RIB
+ * @param const Route*
+ * @returns uint32_t: BINARY_NO_ROUTE if allocation failed
+ */
+
+static uint32_t nexthopId(nexthop_table_t* table, uint64_t version, const Route* route) {
+  if (table->version != version) {
+    table->version = version;
+    table->routeCount = 0;
+  }
+  if ((table->routeCount + 1) * 2 > table->routeCapacity && growRouteCache(table) != 0) {
+    return addNexthop(table, route);
+  }
+  route_slot_t* slot = &table->routes[routeSlot(table, route)];
+  if (slot->version == version) {
+    return slot->id;
+  }
+  const uint32_t id = addNexthop(table, route);
+  if (id != BINARY_NO_ROUTE) {
+    slot->route = route;
+    slot->id = id;
+    slot->version = version;
+    table->routeCount++;
+  }
+  return id;
+}
+
+/**
+ * @function reserveReply
+ * @description make room for the provided number of bytes at the end of the reply of a binary request
+ * @param request_t*
+ * @param size_t* size: allocated bytes of the reply
+ * @param size_t len
+ * @returns unsigned char*: NULL if allocation failed
+ */
+
+static unsigned char* reserveReply(request_t* request, size_t* size, size_t len) {
+  if (request->replyLen + len > *size) {
+    size_t newSize = *size > 0 ? *size : 4096;
+    while (newSize < request->replyLen + len) {
+      newSize *= 2;
+    }
+    char* reply = (char*) realloc(request->reply, newSize);
+    if (reply == NULL) {
+      return NULL;
+    }
+    request->reply = reply;
+    *size = newSize;
+  }
+  unsigned char* ptr = (unsigned char*) request->reply + request->replyLen;
+  request->replyLen += len;
+  return ptr;
+}
+
+/**
+ * @function runLookups
+ * @description run the lookup frames of a binary request and write their response frames; the table lock must be held
+ * @param server_t*
+ * @param request_t*
+ * @returns int: 1 if allocation failed
+ */
+
+int runLookups(server_t* server, request_t* request) {
+  nexthop_table_t* table = request->client->nexthops;
+  Route* routes[BINARY_MAX_COUNT];
+  size_t size = 0;
+  const unsigned char* frame = (const unsigned char*) request->line;
+  const unsigned char* end = frame + request->lineLen;
+  for (; frame < end; frame += le32(frame)) {
+    const uint32_t length = le32(frame);
+    const int ipv = frame[9];
+    const size_t count = (size_t) frame[10] | (size_t) frame[11] << 8;
+    const size_t addressSize = ipv == 6 ? 16 : 4;
+    RIB_ret_code_t rc = RIB_NO_ERROR;
+    if (frame[8] != BINARY_LOOKUP) {
+      rc = RIB_INVALID_ARGUMENT;
+    } else if (ipv != 4 && ipv != 6) {
+      rc = RIB_INVALID_ADDRESS;
+    } else if (count > BINARY_MAX_COUNT || length != BINARY_REQUEST_HEADER + count * addressSize) {
+      rc = RIB_INVALID_ARGUMENT;
+    } else if (server->prepared != RIB_NO_ERROR) {
+      rc = server->prepared;
+    }
+    const size_t results = rc == RIB_NO_ERROR ? count : 0;
+    const size_t offset = request->replyLen;
+    if (reserveReply(request, &size, BINARY_RESPONSE_HEADER + sizeof(uint32_t) * results) == NULL) {
+      return 1;
+    }
+    const uint32_t firstNew = (uint32_t) table->count;
+    if (results > 0) {
+      RIB_match_batch(server->rtab, ipv, frame + BINARY_REQUEST_HEADER, count, routes);
+      unsigned char* ids = (unsigned char*) request->reply + offset + BINARY_RESPONSE_HEADER;
+      for (size_t i = 0; i < count; i++) {
+        putLe32(ids + i * sizeof(uint32_t), routes[i] != NULL ? nexthopId(table, server->version, routes[i]) : BINARY_NO_ROUTE);
+      }
+    }
+    //Next hop table delta: the next hops sent for the first time
+    for (uint32_t id = firstNew; id < table->count; id++) {
+      const client_nexthop_t* nexthop = &table->nexthops[id];
+      const size_t gatewaySize = nexthop->ipv == 6 ? 16 : 4;
+      size_t ifaceLen = strlen(nexthop->iface);
+      ifaceLen = ifaceLen < 255 ? ifaceLen : 255;
+      unsigned char* entry = reserveReply(request, &size, 6 + gatewaySize + ifaceLen);
+      if (entry == NULL) {
+        return 1;
+      }
+      putLe32(entry, id);
+      entry[4] = (unsigned char) nexthop->ipv;
+      entry[5] = (unsigned char) ifaceLen;
+      if (inet_pton(nexthop->ipv == 6 ? AF_INET6 : AF_INET, nexthop->gateway, entry + 6) != 1) {
+        memset(entry + 6, 0x00, gatewaySize);
+      }
+      memcpy(entry + 6 + gatewaySize, nexthop->iface, ifaceLen);
+    }
+    unsigned char* header = (unsigned char*) request->reply + offset;
+    putLe32(header, (uint32_t) (request->replyLen - offset));
+    memcpy(header + 4, frame + 4, sizeof(uint32_t));
+    header[8] = BINARY_LOOKUP;
+    header[9] = (unsigned char) rc;
+    header[10] = (unsigned char) (results & 0xFF);
+    header[11] = (unsigned char) (results >> 8);
+    putLe32(header + 12, (uint32_t) (table->count - firstNew));
+  }
+  return 0;
+}
+
+/**
+ * @function runRequest
+ * @description run the command of a request under the table lock, capturing its reply; the writer expires
+ *              the routes before the command and rebuilds the lookup tables after it
+ * @param server_t*
+ * @param request_t*
+ * @param int write: whether the command changes the RIB
+ */
+
+void runRequest(server_t* server, request_t* request, int write) {
+  if (request->binary) {
+    pthread_rwlock_rdlock(&server->tableLock);
+    if (runLookups(server, request) != 0) {
+      free(request->reply);
+      request->reply = NULL;
+    }
+    pthread_rwlock_unlock(&server->tableLock);
+    return;
+  }
+  FILE* stream = NULL;
+  if (request->client != NULL && (stream = open_memstream(&request->reply, &request->replyLen)) == NULL) {
+    return;
+  }
+  replyStream = stream;
+  if (write) {
+    pthread_rwlock_wrlock(&server->tableLock);
+    RIB_reuse(server->rtab, RIB_clock(), NULL);
+    RIB_expire(server->rtab, RIB_clock(), NULL);
+    if (request->client == NULL) {
+      //Changes made by our commits are skipped: the table may have been edited since the snapshot.
+      //The commit in flight may have replaced the file already
+      waitCommitter(server->committer);
+      if (!isCommittedFile(server->committer)) {
+        printf("ROUTING TABLE CHANGED; RELOADING...\n");
+        if (reloadRoutingTable(server->rtab, server->routingTableFile) != 0) {
+          printf("ERROR: %d\n", -1);
+        }
+      }
+    } else {
+      runCommand(server->rtab, server->committer, server->routingTableFile, request->line);
+    }
+    server->prepared = RIB_prepare(server->rtab);
+    server->version++;
+    pthread_rwlock_unlock(&server->tableLock);
+  } else {
+    pthread_rwlock_rdlock(&server->tableLock);
+    if (server->prepared != RIB_NO_ERROR && isLookupCommand(peekCommand(request->line))) {
+      //The lookup would rebuild the tables while other workers read them
+      reply("ERROR: %s\n", RIB_get_error_msg(server->prepared));
+    } else {
+      runCommand(server->rtab, server->committer, server->routingTableFile, request->line);
+    }
+    pthread_rwlock_unlock(&server->tableLock);
+  }
+  replyStream = NULL;
+  if (stream != NULL) {
+    fclose(stream);
+  }
+}
+
+/**
+ * @function completeRequest
+ * @description hand a request back to the event loop
+ * @param server_t*
+ * @param request_t*
+ */
+
+void completeRequest(server_t* server, request_t* request) {
+  pthread_mutex_lock(&server->lock);
+  request->next = server->done;
+  server->done = request;
+  pthread_mutex_unlock(&server->lock);
+  uint64_t one = 1;
+  if (write(server->doneEvent.fd, &one, sizeof(one)) < 0) {
+    //The counter is already signaled
+  }
+}
+
+/**
+ * @function workerMain
+ * @description worker thread: run the read only commands until the server stops
+ * @param void* server_t
+ * @returns void*
+ */
+
+void* workerMain(void* arg) {
+  server_t* server = (server_t*) arg;
+  pthread_mutex_lock(&server->lock);
+  while (1) {
+    while (server->readers.head == NULL && !server->stop) {
+      pthread_cond_wait(&server->readers.ready, &server->lock);
+    }
+    request_t* request = popRequest(&server->readers);
+    if (request == NULL) {
+      break;
+    }
+    pthread_mutex_unlock(&server->lock);
+    runRequest(server, request, 0);
+    completeRequest(server, request);
+    pthread_mutex_lock(&server->lock);
+  }
+  pthread_mutex_unlock(&server->lock);
+  return NULL;
+}
+
+/**
+ * @function writerMain
+ * @description writer thread: run the commands changing the RIB and expire the routes while idle, until the server stops
+ * @param void* server_t
+ * @returns void*
+ */
+
+void* writerMain(void* arg) {
+  server_t* server = (server_t*) arg;
+  pthread_mutex_lock(&server->lock);
+  while (1) {
+    if (server->writer.head == NULL && !server->stop) {
+      struct timespec deadline;
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_sec += SERVER_EXPIRE_INTERVAL;
+      if (pthread_cond_timedwait(&server->writer.ready, &server->lock, &deadline) == ETIMEDOUT) {
+        //Add back the routes of the prefixes whose suppression expired and delete the expired routes; retry a failed rebuild
+        pthread_mutex_unlock(&server->lock);
+        size_t reused = 0;
+        size_t removed = 0;
+        pthread_rwlock_wrlock(&server->tableLock);
+        RIB_reuse(server->rtab, RIB_clock(), &reused);
+        RIB_expire(server->rtab, RIB_clock(), &removed);
+        if (reused > 0 || removed > 0 || server->prepared != RIB_NO_ERROR) {
+          server->prepared = RIB_prepare(server->rtab);
+          server->version++;
+        }
+        pthread_rwlock_unlock(&server->tableLock);
+        pthread_mutex_lock(&server->lock);
+      }
+      continue;
+    }
+    request_t* request = popRequest(&server->writer);
+    if (request == NULL) {
+      break;
+    }
+    pthread_mutex_unlock(&server->lock);
+    runRequest(server, request, 1);
+    completeRequest(server, request);
+    pthread_mutex_lock(&server->lock);
+  }
+  pthread_mutex_unlock(&server->lock);
+  return NULL;
+}
+
+/**
+ * @function listenUnix
+ * @description listen on a unix domain socket; a stale socket file is replaced
+ * @param const char* path
+ * @returns int: socket; -1 if it failed
+ */
+
+int listenUnix(const char* path) {
+  struct sockaddr_un address;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    return -1;
+  }
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    return -1;
+  }
+  memset(&address, 0x00, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+  unlink(path);
+  if (bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * @function listenTcp
+ * @description listen on a tcp port of the loopback address
+ * @param int port
+ * @returns int: socket; -1 if it failed
+ */
+
+int listenTcp(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    return -1;
+  }
+  int enable = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  struct sockaddr_in address;
+  memset(&address, 0x00, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons((uint16_t) port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * @function freeClient
+ * @description free a client
+ * @param client_t*
+ */
+
+void freeClient(client_t* client) {
+  freeNexthopTable(client->nexthops);
+  free(client->input);
+  free(client->output);
+  free(client);
+}
+
+/**
+ * @function releaseClient
+ * @description hand a disconnected client to the event loop, which frees it after the current batch of events
+ * @param server_t*
+ * @param client_t*
+ */
+
+void releaseClient(server_t* server, client_t* client) {
+  client->next = server->released;
+  server->released = client;
+}
+
+/**
+ * @function freeReleasedClients
+ * @description free the disconnected clients
+ * @param server_t*
+ */
+
+void freeReleasedClients(server_t* server) {
+  while (server->released != NULL) {
+    client_t* client = server->released;
+    server->released = client->next;
+    freeClient(client);
+  }
+}
+
+/**
+ * @function closeClient
+ * @description disconnect a client; it's freed once its running command completes
+ * @param server_t*
+ * @param client_t*
+ */
+
+void closeClient(server_t* server, client_t* client) {
+  epoll_ctl(server->epollFd, EPOLL_CTL_DEL, client->endpoint.fd, NULL);
+  close(client->endpoint.fd);
+  if (client->prev != NULL) {
+    client->prev->next = client->next;
+  } else {
+    server->clients = client->next;
+  }
+  if (client->next != NULL) {
+    client->next->prev = client->prev;
+  }
+  //Events of the client may still be pending in the current epoll batch: it's freed after the batch
+  client->closed = 1;
+  if (!client->busy) {
+    releaseClient(server, client);
+  }
+}
+
+/**
+ * @function appendOutput
+ * @description append bytes to the replies of a client
+ * @param client_t*
+ * @param const char* data
+ * @param size_t len
+ * @returns int: 1 if allocation failed
+ */
+
+int appendOutput(client_t* client, const char* data, size_t len) {
+  if (client->outputSent > 0) {
+    memmove(client->output, client->output + client->outputSent, client->outputLen - client->outputSent);
+    client->outputLen -= client->outputSent;
+    client->outputSent = 0;
+  }
+  if (client->outputLen + len > client->outputSize) {
+    size_t size = client->outputSize > 0 ? client->outputSize : 4096;
+    while (size < client->outputLen + len) {
+      size *= 2;
+    }
+    char* output = (char*) realloc(client->output, size);
+    if (output == NULL) {
+      return 1;
+    }
+    client->output = output;
+    client->outputSize = size;
+  }
+  memcpy(client->output + client->outputLen, data, len);
+  client->outputLen += len;
+  return 0;
+}
+
+/**
+ * @function sendOutput
+ * @description send the pending replies of a client, as much as the socket takes
+ * @param client_t*
+ * @returns int: 1 if the connection failed
+ */
+
+int sendOutput(client_t* client) {
+  while (client->outputSent < client->outputLen) {
+    ssize_t sent = send(client->endpoint.fd, client->output + client->outputSent, client->outputLen - client->outputSent, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return 0;
+    }
+    if (sent <= 0) {
+      return 1;
+    }
+    client->outputSent += (size_t) sent;
+  }
+  client->outputLen = 0;
+  client->outputSent = 0;
+  return 0;
+}
+
+/**
+ * @function receiveInput
+ * @description receive the pending bytes of a client, up to the input buffer size
+ * @param client_t*
+ * @returns int: 1 if the connection failed
+ */
+
+int receiveInput(client_t* client) {
+  while (!client->eof && client->inputLen < SERVER_MAX_INPUT) {
+    if (client->inputLen == client->inputSize) {
+      size_t size = client->inputSize > 0 ? client->inputSize * 2 : 4096;
+      char* input = (char*) realloc(client->input, size < SERVER_MAX_INPUT ? size : SERVER_MAX_INPUT);
+      if (input == NULL) {
+        return 1;
+      }
+      client->input = input;
+      client->inputSize = size < SERVER_MAX_INPUT ? size : SERVER_MAX_INPUT;
+    }
+    ssize_t received = recv(client->endpoint.fd, client->input + client->inputLen, client->inputSize - client->inputLen, 0);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return 0;
+    }
+    if (received < 0) {
+      return 1;
+    }
+    if (received == 0) {
+      //The commands received before the end of the input are still run
+      client->eof = 1;
+    }
+    client->inputLen += (size_t) received;
+  }
+  return 0;
+}
+
+/**
+ * @function hasCommand
+ * @description returns whether a complete command line or lookup frame has been received from a client
+ * @param const client_t*
+ * @returns int
+ */
+
+int hasCommand(const client_t* client) {
+  if (client->binary) {
+    return client->inputLen >= sizeof(uint32_t) && le32((const unsigned char*) client->input) <= client->inputLen;
+  }
+  return memchr(client->input, '\n', client->inputLen) != NULL;
+}
+
+/**
+ * @function dispatchFrames
+ * @description submit the lookup frames received from a binary client; the pipelined frames are run by the same request
+ * @param server_t*
+ * @param client_t*
+ * @returns int: 1 if the client sent an invalid frame or allocation failed
+ */
+
+int dispatchFrames(server_t* server, client_t* client) {
+  size_t len = 0;
+  while (client->inputLen - len >= sizeof(uint32_t)) {
+    const uint32_t length = le32((const unsigned char*) client->input + len);
+    if (length < BINARY_REQUEST_HEADER || length > BINARY_MAX_FRAME) {
+      return 1;
+    }
+    if (length > client->inputLen - len) {
+      break;
+    }
+    len += length;
+  }
+  if (len == 0) {
+    return 0;
+  }
+  request_t* request = (request_t*) calloc(1, sizeof(request_t));
+  if (request == NULL || (request->line = (char*) malloc(len)) == NULL) {
+    free(request);
+    return 1;
+  }
+  memcpy(request->line, client->input, len);
+  memmove(client->input, client->input + len, client->inputLen - len);
+  client->inputLen -= len;
+  request->client = client;
+  request->lineLen = len;
+  request->binary = 1;
+  client->busy = 1;
+  pthread_mutex_lock(&server->lock);
+  pushRequest(&server->readers, request);
+  pthread_mutex_unlock(&server->lock);
+  return 0;
+}
+
+/**
+ * @function dispatchClient
+ * @description submit the next command line received from a client, unless one of its commands is running
+ *              or too many of its replies are still unsent
+ * @param server_t*
+ * @param client_t*
+ * @returns int: 1 if the client sent an invalid line or allocation failed
+ */
+
+int dispatchClient(server_t* server, client_t* client) {
+  while (!client->busy && !client->closing && client->outputLen - client->outputSent < SERVER_MAX_PENDING) {
+    if (client->binary) {
+      return dispatchFrames(server, client);
+    }
+    if (client->inputLen > 0 && client->input[0] == 0x00) {
+      //Switch to the binary lookup protocol
+      if (client->inputLen < BINARY_HELLO_SIZE) {
+        return 0;
+      }
+      if (memcmp(client->input, BINARY_HELLO, BINARY_HELLO_SIZE) != 0 || (client->nexthops = (nexthop_table_t*) calloc(1, sizeof(nexthop_table_t))) == NULL) {
+        return 1;
+      }
+      if (appendOutput(client, BINARY_HELLO, BINARY_HELLO_SIZE) != 0) {
+        return 1;
+      }
+      memmove(client->input, client->input + BINARY_HELLO_SIZE, client->inputLen - BINARY_HELLO_SIZE);
+      client->inputLen -= BINARY_HELLO_SIZE;
+      client->binary = 1;
+      continue;
+    }
+    char* end = (char*) memchr(client->input, '\n', client->inputLen);
+    if (end == NULL) {
+      return client->inputLen >= SERVER_MAX_LINE;
+    }
+    size_t len = (size_t) (end - client->input);
+    size_t consumed = len + 1;
+    //remove CRLF
+    if (len > 0 && client->input[len - 1] == 0x0d) {
+      len--;
+    }
+    char* line = (char*) malloc(len + 1);
+    if (line == NULL) {
+      return 1;
+    }
+    memcpy(line, client->input, len);
+    line[len] = 0x00;
+    memmove(client->input, client->input + consumed, client->inputLen - consumed);
+    client->inputLen -= consumed;
+    if (len == 0) {
+      free(line);
+      continue;
+    }
+    route_cmd_t command = peekCommand(line);
+    if (command == QUIT) {
+      //QUIT closes the connection; the server is stopped with a signal
+      free(line);
+      client->closing = 1;
+      break;
+    }
+    request_t* request = (request_t*) calloc(1, sizeof(request_t));
+    if (request == NULL) {
+      free(line);
+      return 1;
+    }
+    request->client = client;
+    request->line = line;
+    client->busy = 1;
+    pthread_mutex_lock(&server->lock);
+    pushRequest(isReadCommand(command) ? &server->readers : &server->writer, request);
+    pthread_mutex_unlock(&server->lock);
+  }
+  return 0;
+}
+
+/**
+ * @function serveClient
+ * @description submit the next command of a client, send its replies and update its epoll events:
+ *              it's read while its input buffer has room and written while it has unsent replies.
+ *              The client is closed after QUIT or the end of its input, once its replies have been sent
+ * @param server_t*
+ * @param client_t*
+ */
+
+void serveClient(server_t* server, client_t* client) {
+  if (dispatchClient(server, client) != 0 || sendOutput(client) != 0) {
+    closeClient(server, client);
+    return;
+  }
+  int pending = client->outputSent < client->outputLen;
+  if (client->eof && !client->busy && !hasCommand(client)) {
+    client->closing = 1;
+  }
+  if (client->closing && !client->busy && !pending) {
+    closeClient(server, client);
+    return;
+  }
+  uint32_t events = (pending ? EPOLLOUT : 0);
+  if (!client->eof && !client->closing && client->inputLen < SERVER_MAX_INPUT) {
+    events |= EPOLLIN | EPOLLRDHUP;
+  }
+  if (events != client->events) {
+    struct epoll_event event;
+    event.events = events;
+    event.data.ptr = &client->endpoint;
+    epoll_ctl(server->epollFd, EPOLL_CTL_MOD, client->endpoint.fd, &event);
+    client->events = events;
+  }
+}
+
+/**
+ * @function acceptClients
+ * @description accept the pending connections of a listening socket
+ * @param server_t*
+ * @param int listenFd
+ */
+
+void acceptClients(server_t* server, int listenFd) {
+  int fd;
+  while ((fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    client_t* client = (client_t*) calloc(1, sizeof(client_t));
+    if (client == NULL) {
+      close(fd);
+      continue;
+    }
+    client->endpoint.kind = ENDPOINT_CLIENT;
+    client->endpoint.fd = fd;
+    client->events = EPOLLIN | EPOLLRDHUP;
+    struct epoll_event event;
+    event.events = client->events;
+    event.data.ptr = &client->endpoint;
+    if (epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+      close(fd);
+      free(client);
+      continue;
+    }
+    client->next = server->clients;
+    if (server->clients != NULL) {
+      server->clients->prev = client;
+    }
+    server->clients = client;
+  }
+}
+
+/**
+ * @function completeRequests
+ * @description hand the replies of the completed requests to their clients and submit their next commands
+ * @param server_t*
+ */
+
+void completeRequests(server_t* server) {
+  uint64_t count;
+  if (read(server->doneEvent.fd, &count, sizeof(count)) < 0) {
+    //Nothing completed since the last call
+  }
+  pthread_mutex_lock(&server->lock);
+  request_t* request = server->done;
+  server->done = NULL;
+  pthread_mutex_unlock(&server->lock);
+  while (request != NULL) {
+    request_t* next = request->next;
+    client_t* client = request->client;
+    if (client != NULL) {
+      client->busy = 0;
+      if (client->closed) {
+        releaseClient(server, client);
+      } else {
+        int failed;
+        if (request->reply == NULL) {
+          //Binary clients can't be sent text errors
+          const char* error = RIB_get_error_msg(RIB_BAD_ALLOC);
+          failed = request->binary || appendOutput(client, "ERROR: ", 7) || appendOutput(client, error, strlen(error)) || appendOutput(client, "\n", 1);
+        } else if (client->outputLen == client->outputSent) {
+          //Nothing to send before the reply: it becomes the output buffer
+          free(client->output);
+          client->output = request->reply;
+          client->outputLen = request->replyLen;
+          client->outputSize = request->replyLen;
+          client->outputSent = 0;
+          request->reply = NULL;
+          failed = 0;
+        } else {
+          failed = appendOutput(client, request->reply, request->replyLen);
+        }
+        if (failed) {
+          closeClient(server, client);
+        } else {
+          serveClient(server, client);
+        }
+      }
+    }
+    freeRequest(request);
+    request = next;
+  }
+}
+
+/**
+ * @function addEndpoint
+ * @description register an endpoint to epoll for input
+ * @param server_t*
+ * @param endpoint_t*
+ * @returns int
+ */
+
+int addEndpoint(server_t* server, endpoint_t* endpoint) {
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = endpoint;
+  return epoll_ctl(server->epollFd, EPOLL_CTL_ADD, endpoint->fd, &event);
+}
+
+/**
+ * @function blockStopSignals
+ * @description block SIGINT and SIGTERM in the current thread; the threads started afterwards inherit the mask
+ * @param sigset_t* mask: blocked signals
+ */
+
+void blockStopSignals(sigset_t* mask) {
+  sigemptyset(mask);
+  sigaddset(mask, SIGINT);
+  sigaddset(mask, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, mask, NULL);
+}
+
+/**
+ * @function runServer
+ * @description serve the router commands on a unix domain socket and/or a loopback tcp port until SIGINT or SIGTERM
+ * @param RIB*
+ * @param committer_t*
+ * @param char* routingTableFile
+ * @param const char* socketPath: unix domain socket; NULL to disable
+ * @param int port: tcp port; 0 to disable
+ * @param size_t threads: worker threads
+ * @param int inotifyFd: watch of the routing table file; -1 if not watched
+ * @returns int
+ */
+
+int runServer(RIB* rtab, committer_t* committer, char* routingTableFile, const char* socketPath, int port, size_t threads, int inotifyFd) {
+  server_t server;
+  memset(&server, 0x00, sizeof(server));
+  server.rtab = rtab;
+  server.committer = committer;
+  //Version 0 marks the free slots of the route caches
+  server.version = 1;
+  server.routingTableFile = routingTableFile;
+  server.workerCount = threads > 0 ? threads : 1;
+  //Readers mustn't starve the writer
+  pthread_rwlockattr_t lockAttr;
+  pthread_rwlockattr_init(&lockAttr);
+  pthread_rwlockattr_setkind_np(&lockAttr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+  pthread_rwlock_init(&server.tableLock, &lockAttr);
+  pthread_rwlockattr_destroy(&lockAttr);
+  pthread_mutex_init(&server.lock, NULL);
+  pthread_cond_init(&server.readers.ready, NULL);
+  pthread_cond_init(&server.writer.ready, NULL);
+  endpoint_t listeners[2] = {{ENDPOINT_LISTENER, -1}, {ENDPOINT_LISTENER, -1}};
+  endpoint_t signals = {ENDPOINT_SIGNAL, -1};
+  endpoint_t watch = {ENDPOINT_WATCH, inotifyFd};
+  server.doneEvent.kind = ENDPOINT_DONE;
+  server.doneEvent.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  server.epollFd = epoll_create1(EPOLL_CLOEXEC);
+  //Stop on SIGINT and SIGTERM, read from a signalfd: they must be blocked in all the threads
+  sigset_t mask;
+  blockStopSignals(&mask);
+  signals.fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  int ret = 0;
+  if (server.doneEvent.fd == -1 || server.epollFd == -1 || signals.fd == -1 || addEndpoint(&server, &server.doneEvent) != 0 || addEndpoint(&server, &signals) != 0) {
+    printf("COULD NOT START SERVER!\n");
+    ret = 1;
+  }
+  if (ret == 0 && socketPath != NULL && ((listeners[0].fd = listenUnix(socketPath)) == -1 || addEndpoint(&server, &listeners[0]) != 0)) {
+    printf("COULD NOT LISTEN ON %s!\n", socketPath);
+    ret = 1;
+  }
+  if (ret == 0 && port > 0 && ((listeners[1].fd = listenTcp(port)) == -1 || addEndpoint(&server, &listeners[1]) != 0)) {
+    printf("COULD NOT LISTEN ON PORT %d!\n", port);
+    ret = 1;
+  }
+  if (ret == 0 && inotifyFd != -1 && addEndpoint(&server, &watch) != 0) {
+    printf("COULD NOT WATCH ROUTING TABLE!\n");
+  }
+  //Rebuild the lookup tables before the workers start
+  server.prepared = RIB_prepare(rtab);
+  size_t started = 0;
+  int writerStarted = 0;
+  if (ret == 0 && (server.workers = (pthread_t*) malloc(sizeof(pthread_t) * server.workerCount)) != NULL) {
+    while (started < server.workerCount && pthread_create(&server.workers[started], NULL, workerMain, &server) == 0) {
+      started++;
+    }
+    writerStarted = pthread_create(&server.writerThread, NULL, writerMain, &server) == 0;
+  }
+  if (ret == 0 && (started < server.workerCount || !writerStarted)) {
+    printf("COULD NOT START SERVER!\n");
+    ret = 1;
+  }
+  if (ret == 0) {
+    printf("LISTENING (%zu WORKERS)\n", server.workerCount);
+    fflush(stdout);
+  }
+  //Event loop
+  struct epoll_event events[64];
+  int stop = ret != 0;
+  while (!stop) {
+    int count = epoll_wait(server.epollFd, events, 64, -1);
+    if (count < 0 && errno != EINTR) {
+      ret = 1;
+      break;
+    }
+    for (int i = 0; i < count; i++) {
+      endpoint_t* endpoint = (endpoint_t*) events[i].data.ptr;
+      switch (endpoint->kind) {
+        case ENDPOINT_LISTENER: {
+          acceptClients(&server, endpoint->fd);
+          break;
+        }
+        case ENDPOINT_CLIENT: {
+          client_t* client = (client_t*) endpoint;
+          if (client->closed) {
+            break;
+          }
+          if ((events[i].events & (EPOLLHUP | EPOLLERR)) || ((events[i].events & (EPOLLIN | EPOLLRDHUP)) && receiveInput(client) != 0)) {
+            closeClient(&server, client);
+          } else {
+            serveClient(&server, client);
+          }
+          break;
+        }
+        case ENDPOINT_DONE: {
+          completeRequests(&server);
+          break;
+        }
+        case ENDPOINT_SIGNAL: {
+          struct signalfd_siginfo info;
+          while (read(signals.fd, &info, sizeof(info)) == sizeof(info)) {
+            stop = 1;
+          }
+          break;
+        }
+        case ENDPOINT_WATCH: {
+          if (routingTableChanged(inotifyFd, routingTableFile)) {
+            //Reloads are run by the writer; their output is printed to stdout
+            request_t* request = (request_t*) calloc(1, sizeof(request_t));
+            if (request != NULL) {
+              pthread_mutex_lock(&server.lock);
+              pushRequest(&server.writer, request);
+              pthread_mutex_unlock(&server.lock);
+            }
+          }
+          break;
+        }
+      }
+    }
+    freeReleasedClients(&server);
+  }
+  //Stop the threads once the submitted commands have run, then send the last replies and disconnect the clients
+  pthread_mutex_lock(&server.lock);
+  server.stop = 1;
+  pthread_cond_broadcast(&server.readers.ready);
+  pthread_cond_broadcast(&server.writer.ready);
+  pthread_mutex_unlock(&server.lock);
+  for (size_t i = 0; i < started; i++) {
+    pthread_join(server.workers[i], NULL);
+  }
+  if (writerStarted) {
+    pthread_join(server.writerThread, NULL);
+  }
+  free(server.workers);
+  while (server.done != NULL) {
+    request_t* request = server.done;
+    server.done = request->next;
+    if (request->client != NULL) {
+      request->client->busy = 0;
+      if (request->client->closed) {
+        releaseClient(&server, request->client);
+      } else if (request->reply != NULL && appendOutput(request->client, request->reply, request->replyLen) == 0) {
+        sendOutput(request->client);
+      }
+    }
+    freeRequest(request);
+  }
+  while (server.clients != NULL) {
+    closeClient(&server, server.clients);
+  }
+  freeReleasedClients(&server);
+  for (size_t i = 0; i < 2; i++) {
+    if (listeners[i].fd != -1) {
+      close(listeners[i].fd);
+    }
+  }
+  if (listeners[0].fd != -1) {
+    unlink(socketPath);
+  }
+  if (signals.fd != -1) {
+    close(signals.fd);
+  }
+  if (server.doneEvent.fd != -1) {
+    close(server.doneEvent.fd);
+  }
+  if (server.epollFd != -1) {
+    close(server.epollFd);
+  }
+  pthread_sigmask(SIG_UNBLOCK, &mask, NULL);
+  pthread_cond_destroy(&server.writer.ready);
+  pthread_cond_destroy(&server.readers.ready);
+  pthread_mutex_destroy(&server.lock);
+  pthread_rwlock_destroy(&server.tableLock);
+  return ret;
+}
+
+#endif
+
+int main(int argc, char* argv[]) {
+
+  //Get command
+  if (argc < 2) {
+    printf("%s\n", USAGE);
+    return 1;
+  }
+  //Initialize routing table
+  RIB* rtab = NULL;
+  RIB_ret_code_t rc = RIB_init(&rtab);
+  if (rc != RIB_NO_ERROR) {
+    printf("COULD NOT INITIALIZE RIB!\n");
+    return rc;
+  }
+  //Parse routing table
+  char* routingTableFile = argv[1];
+  if (parseRoutingTable(rtab, routingTableFile) != 0) {
+    printf("COULD NOT PARSE ROUTING TABLE!\n");
+    RIB_free(rtab);
+    return 1;
+  }
+  //Parse options
+  int watch = 0;
+  const char* socketPath = NULL;
+  int port = 0;
+  size_t threads = 4;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--watch") == 0) {
+      watch = 1;
+    } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+      socketPath = argv[++i];
+    } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = (size_t) atoi(argv[++i]);
+    } else {
+      printf("%s\n", USAGE);
+      RIB_free(rtab);
+      return 1;
+    }
+  }
+  int serve = socketPath != NULL || port > 0;
+  //Reload routing table when the file changes
+  int inotifyFd = -1;
+  if (watch) {
+#ifdef __linux__
+    inotifyFd = watchRoutingTable(routingTableFile);
+#endif
+    if (inotifyFd == -1) {
+      printf("COULD NOT WATCH ROUTING TABLE!\n");
+    }
+  }
+
+  //Count the lookups of each route (a shard for each lookup thread)
+  if (RIB_set_hit_counters(rtab, serve ? threads + 1 : 1) != RIB_NO_ERROR) {
+    printf("COULD NOT ENABLE HIT COUNTERS!\n");
+  }
+#ifdef __linux__
+  //The server reads the stop signals from a signalfd, so the committer mustn't receive them
+  if (serve) {
+    sigset_t mask;
+    blockStopSignals(&mask);
+  }
+#endif
+    //Write commits in background
+  committer_t committer;
+  if (startCommitter(&committer, routingTableFile) != 0) {
+    printf("COULD NOT START COMMITTER!\n");
+    RIB_free(rtab);
+    return 1;
+  }
+
+  int quitCalled = 0;
+  //Serve the sockets instead of stdin
+  if (serve) {
+#ifdef __linux__
+    if (runServer(rtab, &committer, routingTableFile, socketPath, port, threads, inotifyFd) != 0) {
+      printf("SERVER FAILED\n");
+    }
+    printf("CLOSING RIB...\n");
+#else
+    printf("SERVER MODE REQUIRES LINUX!\n");
+#endif
+    quitCalled = 1;
+  }
+
+  while (!quitCalled) {
+    size_t bufSize = 255;
+    char* inputLine = (char*) malloc(sizeof(char) * bufSize);
+    printf("> ");
+#ifdef __linux__
+    if (inotifyFd != -1) {
+      fflush(stdout);
+      //Wait for a command, reloading the routing table each time it changes
+      struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {inotifyFd, POLLIN, 0}};
+      while (poll(fds, 2, -1) > 0 && !(fds[0].revents & (POLLIN | POLLHUP))) {
+        //Changes made by our commits are skipped: the table may have been edited since the snapshot
+        if (routingTableChanged(inotifyFd, routingTableFile) && !isCommittedFile(&committer)) {
+          printf("\nROUTING TABLE CHANGED; RELOADING...\n");
+          if (reloadRoutingTable(rtab, routingTableFile) != 0) {
+            printf("ERROR: %d\n", -1);
+          }
+          printf("> ");
+          fflush(stdout);
+        }
+      }
+    }
+#endif
+    size_t len = getline(&inputLine, &bufSize, stdin);
+    //remove CRLF
+    if (inputLine[len - 1] == 0x0a) {
+      inputLine[len - 1] = 0x00;
+    }
+    if (inputLine[len - 2] == 0x0d) {
+      inputLine[len - 2] = 0x00;
+    }
+    //Add back the routes of the prefixes whose suppression expired and delete the expired routes
+    RIB_reuse(rtab, RIB_clock(), NULL);
+    RIB_expire(rtab, RIB_clock(), NULL);
+    int ret = runCommand(rtab, &committer, routingTableFile, inputLine);
+    free(inputLine);
+    if (ret < 0) {
+      stopCommitter(&committer);
+      RIB_free(rtab);
+      return 1;
+    }
+    quitCalled = ret;
+  }
+
+  //Wait for the commits in flight, then commit changes
+  stopCommitter(&committer);
+  int ret;
+  if ((ret = commitRoutingTable(rtab, routingTableFile)) != 0) {
+    printf("COMMIT FAILED (%d)\n", ret);
+  }
+  //Free RIB table
+#ifdef __linux__
+  if (inotifyFd != -1) {
+    close(inotifyFd);
+  }
+#endif
   RIB_free(rtab);
   printf("RIB CLOSED.\n");
 